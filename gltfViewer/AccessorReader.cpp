@@ -0,0 +1,221 @@
+﻿#include "AccessorReader.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+
+namespace {
+
+    size_t getComponentSize(int componentType) {
+        switch (componentType) {
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            return 1;
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            return 2;
+        case TINYGLTF_COMPONENT_TYPE_INT:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    // 1成分を float として読み出す（normalized の場合は [-1, 1] / [0, 1] に正規化）
+    float readComponentFloat(const unsigned char* src, int componentType, bool normalized) {
+        switch (componentType) {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+            float v;
+            std::memcpy(&v, src, sizeof(v));
+            return v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_BYTE: {
+            int8_t v;
+            std::memcpy(&v, src, sizeof(v));
+            return normalized ? std::max(v / 127.0f, -1.0f) : static_cast<float>(v);
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+            uint8_t v = *src;
+            return normalized ? v / 255.0f : static_cast<float>(v);
+        }
+        case TINYGLTF_COMPONENT_TYPE_SHORT: {
+            int16_t v;
+            std::memcpy(&v, src, sizeof(v));
+            return normalized ? std::max(v / 32767.0f, -1.0f) : static_cast<float>(v);
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t v;
+            std::memcpy(&v, src, sizeof(v));
+            return normalized ? v / 65535.0f : static_cast<float>(v);
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+            uint32_t v;
+            std::memcpy(&v, src, sizeof(v));
+            return normalized ? static_cast<float>(v / 4294967295.0) : static_cast<float>(v);
+        }
+        default:
+            return 0.0f;
+        }
+    }
+
+    unsigned int readComponentUInt(const unsigned char* src, int componentType) {
+        switch (componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            return *src;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t v;
+            std::memcpy(&v, src, sizeof(v));
+            return v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+            uint32_t v;
+            std::memcpy(&v, src, sizeof(v));
+            return v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+            float v;
+            std::memcpy(&v, src, sizeof(v));
+            return static_cast<unsigned int>(v);
+        }
+        default:
+            return 0;
+        }
+    }
+
+    // バッファービュー内の指定範囲が有効かを確認して先頭ポインタを返す
+    const unsigned char* getViewData(const tinygltf::Model& model, int bufferViewIndex, size_t byteOffset, size_t requiredBytes) {
+        if (bufferViewIndex < 0 || bufferViewIndex >= static_cast<int>(model.bufferViews.size())) {
+            return nullptr;
+        }
+        const tinygltf::BufferView& view = model.bufferViews[bufferViewIndex];
+        if (view.buffer < 0 || view.buffer >= static_cast<int>(model.buffers.size())) {
+            return nullptr;
+        }
+        const tinygltf::Buffer& buffer = model.buffers[view.buffer];
+        if (byteOffset + requiredBytes > view.byteLength || view.byteOffset + view.byteLength > buffer.data.size()) {
+            return nullptr;
+        }
+        return buffer.data.data() + view.byteOffset + byteOffset;
+    }
+
+    // 要素を読み出す共通処理（Reader は (src, componentType) -> T）
+    template <typename T, typename Reader>
+    bool readAccessor(const tinygltf::Model& model, int accessorIndex, std::vector<T>& out, int expectedComponents, Reader reader) {
+        if (accessorIndex < 0 || accessorIndex >= static_cast<int>(model.accessors.size())) {
+            std::cerr << "エラー: 無効なアクセサーインデックス: " << accessorIndex << std::endl;
+            return false;
+        }
+
+        const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+        const int components = AccessorReader::getComponentCount(accessor.type);
+        const size_t componentSize = getComponentSize(accessor.componentType);
+        if (components == 0 || componentSize == 0) {
+            std::cerr << "エラー: 未対応のアクセサータイプ (アクセサー " << accessorIndex << ")" << std::endl;
+            return false;
+        }
+        if (expectedComponents != 0 && components != expectedComponents) {
+            std::cerr << "エラー: アクセサー " << accessorIndex << " の成分数が一致しません ("
+                << components << " != " << expectedComponents << ")" << std::endl;
+            return false;
+        }
+
+        out.assign(accessor.count * components, T());
+
+        // bufferView が無い場合はゼロ初期化（スパースのみで値を与えるアクセサー）
+        if (accessor.bufferView >= 0) {
+            if (accessor.bufferView >= static_cast<int>(model.bufferViews.size())) {
+                std::cerr << "エラー: アクセサー " << accessorIndex << " のバッファービューインデックスが無効です: "
+                    << accessor.bufferView << std::endl;
+                return false;
+            }
+            const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+            const size_t elementSize = componentSize * components;
+            const size_t stride = view.byteStride > 0 ? view.byteStride : elementSize;
+            const size_t requiredBytes = accessor.count > 0 ? stride * (accessor.count - 1) + elementSize : 0;
+
+            const unsigned char* src = getViewData(model, accessor.bufferView, accessor.byteOffset, requiredBytes);
+            if (!src) {
+                std::cerr << "エラー: アクセサー " << accessorIndex << " がバッファー範囲を超えています" << std::endl;
+                return false;
+            }
+
+            // float VEC3 など密に詰まったデータは一括コピー
+            if (std::is_same<T, float>::value && accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT &&
+                stride == elementSize) {
+                std::memcpy(out.data(), src, accessor.count * elementSize);
+            } else {
+                for (size_t i = 0; i < accessor.count; ++i) {
+                    const unsigned char* element = src + i * stride;
+                    for (int c = 0; c < components; ++c) {
+                        out[i * components + c] = reader(element + c * componentSize, accessor.componentType);
+                    }
+                }
+            }
+        }
+
+        // スパースアクセサーの値で上書き
+        if (accessor.sparse.isSparse && accessor.sparse.count > 0) {
+            const size_t sparseCount = static_cast<size_t>(accessor.sparse.count);
+            const int indexType = accessor.sparse.indices.componentType;
+            const size_t indexSize = getComponentSize(indexType);
+            const size_t valueSize = componentSize * components;
+
+            const unsigned char* indexData = getViewData(model, accessor.sparse.indices.bufferView,
+                accessor.sparse.indices.byteOffset, indexSize * sparseCount);
+            const unsigned char* valueData = getViewData(model, accessor.sparse.values.bufferView,
+                accessor.sparse.values.byteOffset, valueSize * sparseCount);
+            if (!indexData || !valueData || indexSize == 0) {
+                std::cerr << "エラー: アクセサー " << accessorIndex << " のスパースデータが不正です" << std::endl;
+                return false;
+            }
+
+            for (size_t s = 0; s < sparseCount; ++s) {
+                size_t target = readComponentUInt(indexData + s * indexSize, indexType);
+                if (target >= accessor.count) {
+                    continue;
+                }
+                for (int c = 0; c < components; ++c) {
+                    out[target * components + c] = reader(valueData + s * valueSize + c * componentSize, accessor.componentType);
+                }
+            }
+        }
+
+        return true;
+    }
+}
+
+int AccessorReader::getComponentCount(int accessorType) {
+    switch (accessorType) {
+    case TINYGLTF_TYPE_SCALAR: return 1;
+    case TINYGLTF_TYPE_VEC2: return 2;
+    case TINYGLTF_TYPE_VEC3: return 3;
+    case TINYGLTF_TYPE_VEC4: return 4;
+    case TINYGLTF_TYPE_MAT2: return 4;
+    case TINYGLTF_TYPE_MAT3: return 9;
+    case TINYGLTF_TYPE_MAT4: return 16;
+    default: return 0;
+    }
+}
+
+bool AccessorReader::readFloats(const tinygltf::Model& model, int accessorIndex, std::vector<float>& out, int expectedComponents) {
+    if (accessorIndex < 0 || accessorIndex >= static_cast<int>(model.accessors.size())) {
+        std::cerr << "エラー: 無効なアクセサーインデックス: " << accessorIndex << std::endl;
+        return false;
+    }
+    const bool normalized = model.accessors[accessorIndex].normalized;
+    return readAccessor(model, accessorIndex, out, expectedComponents,
+        [normalized](const unsigned char* src, int componentType) {
+            return readComponentFloat(src, componentType, normalized);
+        });
+}
+
+bool AccessorReader::readUInts(const tinygltf::Model& model, int accessorIndex, std::vector<unsigned int>& out, int expectedComponents) {
+    return readAccessor(model, accessorIndex, out, expectedComponents,
+        [](const unsigned char* src, int componentType) {
+            return readComponentUInt(src, componentType);
+        });
+}
@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace tinygltf {
+    class Model;
+}
+
+// glTFアクセサーの汎用読み出し
+// byteStride・正規化整数・スパースアクセサーを考慮して float 配列へ展開する
+namespace AccessorReader {
+
+    // アクセサーの要素あたりの成分数（SCALAR=1, VEC3=3, MAT4=16 など）
+    int getComponentCount(int accessorType);
+
+    // アクセサー全体を float 配列として読み出す（out のサイズは count * 成分数）
+    // expectedComponents が 0 以外の場合は成分数が一致しなければ失敗する
+    bool readFloats(const tinygltf::Model& model, int accessorIndex, std::vector<float>& out, int expectedComponents = 0);
+
+    // アクセサー全体を符号なし整数配列として読み出す（JOINTS_0 など）
+    bool readUInts(const tinygltf::Model& model, int accessorIndex, std::vector<unsigned int>& out, int expectedComponents = 0);
+}
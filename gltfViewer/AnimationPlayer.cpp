@@ -0,0 +1,433 @@
+﻿#include "AnimationPlayer.h"
+#include "AccessorReader.h"
+#include "SceneGraph.h"
+#include "SimdMath.h"
+#include "ThreadPool.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // 共通の4要素演算（SSEが使えない環境ではスカラー）
+#ifdef GLTFVIEWER_SIMD_SSE
+    inline __m128 load(const glm::vec4& v) { return _mm_loadu_ps(&v.x); }
+
+    inline glm::vec4 store(__m128 v) {
+        glm::vec4 result;
+        _mm_storeu_ps(&result.x, v);
+        return result;
+    }
+
+    inline __m128 normalize4(__m128 v) {
+        const float lengthSquared = SimdMath::horizontalSum(_mm_mul_ps(v, v));
+        return lengthSquared > 0.0f ? _mm_mul_ps(v, _mm_set1_ps(1.0f / std::sqrt(lengthSquared))) : v;
+    }
+#endif
+
+    glm::vec4 lerp(const glm::vec4& a, const glm::vec4& b, float s) {
+#ifdef GLTFVIEWER_SIMD_SSE
+        const __m128 va = load(a);
+        return store(_mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(load(b), va), _mm_set1_ps(s))));
+#else
+        return a + (b - a) * s;
+#endif
+    }
+
+    // 最短経路の球面線形補間（nlerp が true なら線形補間後に正規化）
+    glm::vec4 interpolateQuaternion(const glm::vec4& a, const glm::vec4& b, float s, bool nlerp) {
+#ifdef GLTFVIEWER_SIMD_SSE
+        const __m128 va = load(a);
+        __m128 vb = load(b);
+        float cosTheta = SimdMath::horizontalSum(_mm_mul_ps(va, vb));
+        if (cosTheta < 0.0f) {
+            vb = _mm_sub_ps(_mm_setzero_ps(), vb);
+            cosTheta = -cosTheta;
+        }
+
+        // 角度が非常に小さい場合は sin による除算が不安定になるため nlerp で代用
+        if (nlerp || cosTheta > 0.9995f) {
+            return store(normalize4(_mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), _mm_set1_ps(s)))));
+        }
+
+        const float theta = std::acos(cosTheta);
+        const float invSinTheta = 1.0f / std::sin(theta);
+        const float weightA = std::sin((1.0f - s) * theta) * invSinTheta;
+        const float weightB = std::sin(s * theta) * invSinTheta;
+        return store(_mm_add_ps(_mm_mul_ps(va, _mm_set1_ps(weightA)), _mm_mul_ps(vb, _mm_set1_ps(weightB))));
+#else
+        glm::vec4 target = b;
+        float cosTheta = glm::dot(a, b);
+        if (cosTheta < 0.0f) {
+            target = -b;
+            cosTheta = -cosTheta;
+        }
+
+        if (nlerp || cosTheta > 0.9995f) {
+            glm::vec4 result = a + (target - a) * s;
+            const float length = std::sqrt(glm::dot(result, result));
+            return length > 0.0f ? result / length : result;
+        }
+
+        const float theta = std::acos(cosTheta);
+        const float invSinTheta = 1.0f / std::sin(theta);
+        return a * (std::sin((1.0f - s) * theta) * invSinTheta) + target * (std::sin(s * theta) * invSinTheta);
+#endif
+    }
+
+    // エルミート補間（glTF の CUBICSPLINE。接線は区間の長さ delta を掛けて使う）
+    glm::vec4 hermite(const glm::vec4& v0, const glm::vec4& outTangent0, const glm::vec4& inTangent1, const glm::vec4& v1,
+        float s, float delta, bool normalizeResult)
+    {
+        const float s2 = s * s;
+        const float s3 = s2 * s;
+        const float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+        const float h10 = (s3 - 2.0f * s2 + s) * delta;
+        const float h01 = -2.0f * s3 + 3.0f * s2;
+        const float h11 = (s3 - s2) * delta;
+
+#ifdef GLTFVIEWER_SIMD_SSE
+        __m128 result = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(load(v0), _mm_set1_ps(h00)), _mm_mul_ps(load(outTangent0), _mm_set1_ps(h10))),
+            _mm_add_ps(_mm_mul_ps(load(v1), _mm_set1_ps(h01)), _mm_mul_ps(load(inTangent1), _mm_set1_ps(h11))));
+        if (normalizeResult) {
+            result = normalize4(result);
+        }
+        return store(result);
+#else
+        glm::vec4 result = v0 * h00 + outTangent0 * h10 + v1 * h01 + inTangent1 * h11;
+        if (normalizeResult) {
+            const float length = std::sqrt(glm::dot(result, result));
+            if (length > 0.0f) {
+                result /= length;
+            }
+        }
+        return result;
+#endif
+    }
+
+    bool parsePath(const std::string& path, AnimationPath& result) {
+        if (path == "translation") {
+            result = AnimationPath::Translation;
+        } else if (path == "rotation") {
+            result = AnimationPath::Rotation;
+        } else if (path == "scale") {
+            result = AnimationPath::Scale;
+        } else if (path == "weights") {
+            result = AnimationPath::Weights;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    AnimationInterpolation parseInterpolation(const std::string& interpolation) {
+        if (interpolation == "STEP") {
+            return AnimationInterpolation::Step;
+        }
+        if (interpolation == "CUBICSPLINE") {
+            return AnimationInterpolation::CubicSpline;
+        }
+        return AnimationInterpolation::Linear;
+    }
+}
+
+AnimationPlayer::AnimationPlayer()
+    : m_activeAnimation(-1)
+    , m_time(0.0f)
+    , m_speed(1.0f)
+    , m_playing(true)
+    , m_parallel(true)
+    , m_keyCacheEnabled(true)
+    , m_quaternionInterpolation(QuaternionInterpolation::Slerp)
+{
+}
+
+void AnimationPlayer::clear() {
+    m_samplerTimeOffset.clear();
+    m_samplerKeyCount.clear();
+    m_samplerValueOffset.clear();
+    m_samplerInterpolation.clear();
+    m_times.clear();
+    m_values.clear();
+
+    m_channelSampler.clear();
+    m_channelNode.clear();
+    m_channelPath.clear();
+    m_channelAnimation.clear();
+    m_channelWeightOffset.clear();
+    m_channelCursor.clear();
+    m_channelResult.clear();
+
+    m_animationDuration.clear();
+    m_animationName.clear();
+    m_animationTime.clear();
+
+    m_activeAnimation = -1;
+    m_time = 0.0f;
+    m_lastStats = AnimationStats();
+}
+
+bool AnimationPlayer::build(const tinygltf::Model& model, const SceneGraph& sceneGraph) {
+    clear();
+
+    size_t skippedChannels = 0;
+    for (size_t animationIndex = 0; animationIndex < model.animations.size(); ++animationIndex) {
+        const tinygltf::Animation& animation = model.animations[animationIndex];
+        const int animationId = static_cast<int>(m_animationDuration.size());
+        float duration = 0.0f;
+
+        // 同じサンプラーを参照するチャンネルはキーフレームを共有する
+        std::vector<int> samplerMap(animation.samplers.size(), -1);
+        std::vector<int> samplerComponents(animation.samplers.size(), 0);
+
+        for (const auto& channel : animation.channels) {
+            AnimationPath path;
+            const int node = channel.target_node >= 0 ? sceneGraph.getIndexOfNode(channel.target_node) : -1;
+            if (node < 0 || !parsePath(channel.target_path, path) ||
+                channel.sampler < 0 || channel.sampler >= static_cast<int>(animation.samplers.size())) {
+                // 未知のパスと、シーンに含まれないノードへのチャンネルは再生しない
+                ++skippedChannels;
+                continue;
+            }
+
+            // weights はキーごとにノードのモーフターゲット数の値を持ち、4つずつ別のサンプラーに分けて格納する
+            int components = path == AnimationPath::Rotation ? 4 : 3;
+            if (path == AnimationPath::Weights) {
+                components = sceneGraph.getMorphWeightCount(node);
+                if (components == 0) {
+                    ++skippedChannels;
+                    continue;
+                }
+            }
+            const int chunkCount = (components + 3) / 4;
+
+            int sampler = samplerMap[channel.sampler];
+            if (sampler >= 0 && samplerComponents[channel.sampler] != components) {
+                std::cerr << "警告: アニメーション \"" << animation.name << "\" のサンプラー " << channel.sampler
+                    << " が要素数の異なるチャンネルから参照されています" << std::endl;
+                ++skippedChannels;
+                continue;
+            }
+            if (sampler < 0) {
+                const tinygltf::AnimationSampler& source = animation.samplers[channel.sampler];
+                const AnimationInterpolation interpolation = parseInterpolation(source.interpolation);
+
+                std::vector<float> times;
+                std::vector<float> values;
+                if (!AccessorReader::readFloats(model, source.input, times, 1) ||
+                    !AccessorReader::readFloats(model, source.output, values, path == AnimationPath::Weights ? 1 : components)) {
+                    std::cerr << "警告: アニメーション \"" << animation.name << "\" のサンプラー " << channel.sampler
+                        << " を読み込めません" << std::endl;
+                    ++skippedChannels;
+                    continue;
+                }
+
+                const size_t valuesPerKey = interpolation == AnimationInterpolation::CubicSpline ? 3 : 1;
+                const size_t valueCount = values.size() / components;
+                if (times.empty() || valueCount != times.size() * valuesPerKey || values.size() % components != 0) {
+                    std::cerr << "警告: アニメーション \"" << animation.name << "\" のサンプラー " << channel.sampler
+                        << " のキーフレーム数が一致しません (時刻: " << times.size() << ", 値: " << valueCount << ")" << std::endl;
+                    ++skippedChannels;
+                    continue;
+                }
+
+                sampler = static_cast<int>(m_samplerKeyCount.size());
+                samplerMap[channel.sampler] = sampler;
+                samplerComponents[channel.sampler] = components;
+                const int timeOffset = static_cast<int>(m_times.size());
+                m_times.insert(m_times.end(), times.begin(), times.end());
+
+                // 4要素ごとのサンプラー（時刻は共有し、足りない要素は 0 で埋める）
+                for (int chunk = 0; chunk < chunkCount; ++chunk) {
+                    m_samplerTimeOffset.push_back(timeOffset);
+                    m_samplerKeyCount.push_back(static_cast<int>(times.size()));
+                    m_samplerValueOffset.push_back(static_cast<int>(m_values.size()));
+                    m_samplerInterpolation.push_back(interpolation);
+
+                    for (size_t v = 0; v < valueCount; ++v) {
+                        glm::vec4 value(0.0f);
+                        for (int lane = 0; lane < 4 && chunk * 4 + lane < components; ++lane) {
+                            value[lane] = values[v * components + chunk * 4 + lane];
+                        }
+                        m_values.push_back(value);
+                    }
+                }
+                duration = std::max(duration, times.back());
+            }
+
+            for (int chunk = 0; chunk < chunkCount; ++chunk) {
+                m_channelSampler.push_back(sampler + chunk);
+                m_channelNode.push_back(node);
+                m_channelPath.push_back(path);
+                m_channelAnimation.push_back(animationId);
+                m_channelWeightOffset.push_back(chunk * 4);
+            }
+        }
+
+        m_animationDuration.push_back(duration);
+        m_animationName.push_back(animation.name);
+    }
+
+    m_channelCursor.assign(m_channelSampler.size(), 0);
+    m_channelResult.assign(m_channelSampler.size(), glm::vec4(0.0f));
+    m_animationTime.assign(m_animationDuration.size(), 0.0f);
+
+    if (!model.animations.empty()) {
+        std::cout << "アニメーション: " << m_animationDuration.size() << " (チャンネル数: " << m_channelSampler.size()
+            << ", サンプラー数: " << m_samplerKeyCount.size() << ", キーフレーム数: " << m_times.size();
+        if (skippedChannels > 0) {
+            std::cout << ", 未対応・無効なチャンネル: " << skippedChannels;
+        }
+        std::cout << ")" << std::endl;
+    }
+    return true;
+}
+
+// times[key] <= time < times[key + 1] となる key を探す
+// 通常の再生では前回の位置かその次になるため、キャッシュで二分探索を省く
+int AnimationPlayer::findKey(int channel, int sampler, float time, bool& cacheHit) {
+    const int keyCount = m_samplerKeyCount[sampler];
+    const float* times = &m_times[m_samplerTimeOffset[sampler]];
+    cacheHit = false;
+
+    if (keyCount <= 1 || time <= times[0]) {
+        return 0;
+    }
+    if (time >= times[keyCount - 1]) {
+        return keyCount - 1;
+    }
+
+    int& cursor = m_channelCursor[channel];
+    if (m_keyCacheEnabled && cursor < keyCount - 1 && times[cursor] <= time) {
+        if (time < times[cursor + 1]) {
+            cacheHit = true;
+            return cursor;
+        }
+        if (cursor + 2 < keyCount && time < times[cursor + 2]) {
+            cacheHit = true;
+            return ++cursor;
+        }
+    }
+
+    cursor = static_cast<int>(std::upper_bound(times, times + keyCount, time) - times) - 1;
+    return cursor;
+}
+
+glm::vec4 AnimationPlayer::evaluateSampler(int sampler, int key, float time, bool isRotation) const {
+    const int keyCount = m_samplerKeyCount[sampler];
+    const float* times = &m_times[m_samplerTimeOffset[sampler]];
+    const glm::vec4* values = &m_values[m_samplerValueOffset[sampler]];
+    const AnimationInterpolation interpolation = m_samplerInterpolation[sampler];
+
+    // 範囲外（最初のキーより前・最後のキー以降）は端の値で止める
+    if (interpolation == AnimationInterpolation::CubicSpline) {
+        if (key >= keyCount - 1 || time <= times[0]) {
+            return values[key * 3 + 1];
+        }
+    } else if (interpolation == AnimationInterpolation::Step || key >= keyCount - 1 || time <= times[0]) {
+        return values[key];
+    }
+
+    const float delta = times[key + 1] - times[key];
+    const float s = delta > 0.0f ? std::min(std::max((time - times[key]) / delta, 0.0f), 1.0f) : 0.0f;
+
+    if (interpolation == AnimationInterpolation::CubicSpline) {
+        return hermite(values[key * 3 + 1], values[key * 3 + 2], values[(key + 1) * 3 + 0], values[(key + 1) * 3 + 1],
+            s, delta, isRotation);
+    }
+    if (isRotation) {
+        return interpolateQuaternion(values[key], values[key + 1], s,
+            m_quaternionInterpolation == QuaternionInterpolation::Nlerp);
+    }
+    return lerp(values[key], values[key + 1], s);
+}
+
+void AnimationPlayer::evaluateRange(size_t begin, size_t end, size_t& cacheHits) {
+    for (size_t channel = begin; channel < end; ++channel) {
+        const int animation = m_channelAnimation[channel];
+        if (m_activeAnimation >= 0 && animation != m_activeAnimation) {
+            continue;
+        }
+
+        const int sampler = m_channelSampler[channel];
+        const float time = m_animationTime[animation];
+        bool cacheHit;
+        const int key = findKey(static_cast<int>(channel), sampler, time, cacheHit);
+        if (cacheHit) {
+            ++cacheHits;
+        }
+        m_channelResult[channel] = evaluateSampler(sampler, key, time, m_channelPath[channel] == AnimationPath::Rotation);
+    }
+}
+
+void AnimationPlayer::update(float deltaSeconds, SceneGraph& sceneGraph) {
+    if (!m_playing || !hasChannels()) {
+        return;
+    }
+    m_time += deltaSeconds * m_speed;
+    evaluate(m_time, sceneGraph);
+}
+
+void AnimationPlayer::evaluate(float time, SceneGraph& sceneGraph) {
+    m_lastStats = AnimationStats();
+    if (!hasChannels()) {
+        return;
+    }
+
+    for (size_t animation = 0; animation < m_animationDuration.size(); ++animation) {
+        const float duration = m_animationDuration[animation];
+        float localTime = duration > 0.0f ? std::fmod(time, duration) : 0.0f;
+        if (localTime < 0.0f) {
+            localTime += duration;
+        }
+        m_animationTime[animation] = localTime;
+    }
+
+    // チャンネルの評価（キャッシュとチャンネルの結果はチャンネルごとに独立しているため並列化できる）
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t channelCount = m_channelSampler.size();
+    std::atomic<size_t> cacheHits(0);
+    if (m_parallel) {
+        ThreadPool::getInstance().parallelFor(channelCount, 1024, [this, &cacheHits](size_t begin, size_t end) {
+            size_t hits = 0;
+            evaluateRange(begin, end, hits);
+            cacheHits += hits;
+        });
+    } else {
+        size_t hits = 0;
+        evaluateRange(0, channelCount, hits);
+        cacheHits = hits;
+    }
+    m_lastStats.m_evaluateTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    m_lastStats.m_cacheHits = cacheHits;
+
+    // シーングラフへの書き込み（変更追跡のリストを更新するため単一スレッドで行う）
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t channel = 0; channel < channelCount; ++channel) {
+        if (m_activeAnimation >= 0 && m_channelAnimation[channel] != m_activeAnimation) {
+            continue;
+        }
+
+        const glm::vec4& value = m_channelResult[channel];
+        const int node = m_channelNode[channel];
+        switch (m_channelPath[channel]) {
+        case AnimationPath::Translation:
+            sceneGraph.setTranslation(node, glm::vec3(value));
+            break;
+        case AnimationPath::Rotation:
+            sceneGraph.setRotation(node, value);
+            break;
+        case AnimationPath::Scale:
+            sceneGraph.setScale(node, glm::vec3(value));
+            break;
+        case AnimationPath::Weights:
+            sceneGraph.setMorphWeights(node, m_channelWeightOffset[channel], &value.x, 4);
+            break;
+        }
+        ++m_lastStats.m_channels;
+    }
+    m_lastStats.m_applyTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace tinygltf {
+    class Model;
+}
+
+class SceneGraph;
+
+// サンプラーの補間方法
+enum class AnimationInterpolation : uint8_t {
+    Step,
+    Linear,
+    CubicSpline
+};
+
+// チャンネルの書き込み先
+enum class AnimationPath : uint8_t {
+    Translation,
+    Rotation,
+    Scale,
+    Weights     // モーフターゲットのウェイト（4ターゲットずつのチャンネルに分割する）
+};
+
+// 回転の線形補間の方法
+enum class QuaternionInterpolation {
+    Slerp,  // 球面線形補間（glTF仕様どおり）
+    Nlerp   // 線形補間後に正規化（高速・角度が小さい場合はほぼ同じ結果）
+};
+
+// 1回の update() の統計
+struct AnimationStats {
+    size_t m_channels;      // 評価したチャンネル数
+    size_t m_cacheHits;     // 前回のキーフレーム位置（またはその次）で見つかった数
+    double m_evaluateTimeMs;
+    double m_applyTimeMs;   // シーングラフへの書き込み
+
+    AnimationStats() : m_channels(0), m_cacheHits(0), m_evaluateTimeMs(0.0), m_applyTimeMs(0.0) {}
+};
+
+// glTFアニメーションの再生
+// キーフレームはサンプラーごとの区間を持つフラットな配列（時刻・値を別配列のSoA）に格納し、
+// 値は成分数に関わらず4要素に揃えてSIMDで補間する
+// チャンネルはスレッドプールで並列に評価し、結果をシーングラフのTRSへ書き込む
+class AnimationPlayer {
+private:
+    // === サンプラー（SoA） ===
+    std::vector<int> m_samplerTimeOffset;       // m_times 内の先頭
+    std::vector<int> m_samplerKeyCount;
+    std::vector<int> m_samplerValueOffset;      // m_values 内の先頭（vec4 単位）
+    std::vector<AnimationInterpolation> m_samplerInterpolation;
+
+    std::vector<float> m_times;                 // キーフレーム時刻
+    std::vector<glm::vec4> m_values;            // キーフレーム値（CUBICSPLINE は入力接線・値・出力接線の3つ組）
+
+    // === チャンネル（SoA） ===
+    std::vector<int> m_channelSampler;
+    std::vector<int> m_channelNode;             // シーングラフ内インデックス
+    std::vector<AnimationPath> m_channelPath;
+    std::vector<int> m_channelAnimation;
+    std::vector<int> m_channelWeightOffset;     // Weights の場合に担当する先頭ターゲット
+    std::vector<int> m_channelCursor;           // 前回のキーフレーム位置（キャッシュ）
+    std::vector<glm::vec4> m_channelResult;
+
+    // === アニメーション ===
+    std::vector<float> m_animationDuration;
+    std::vector<std::string> m_animationName;
+    std::vector<float> m_animationTime;         // 評価中のアニメーションごとのローカル時刻
+
+    int m_activeAnimation;                      // -1 の場合はすべてを同時に再生
+    float m_time;
+    float m_speed;
+    bool m_playing;
+    bool m_parallel;
+    bool m_keyCacheEnabled;
+    QuaternionInterpolation m_quaternionInterpolation;
+    AnimationStats m_lastStats;
+
+    int findKey(int channel, int sampler, float time, bool& cacheHit);
+    glm::vec4 evaluateSampler(int sampler, int key, float time, bool isRotation) const;
+    void evaluateRange(size_t begin, size_t end, size_t& cacheHits);
+
+public:
+    AnimationPlayer();
+
+    // モデルのアニメーションを読み込む（シーングラフに含まれないノードへのチャンネルは無視する）
+    // weights のチャンネルはシーングラフのノードが持つモーフターゲット数に合わせて読み込む
+    bool build(const tinygltf::Model& model, const SceneGraph& sceneGraph);
+    void clear();
+
+    // 時間を進めて全チャンネルを評価し、シーングラフへ書き込む
+    void update(float deltaSeconds, SceneGraph& sceneGraph);
+
+    // 指定時刻で評価してシーングラフへ書き込む（各アニメーションは長さでループ）
+    void evaluate(float time, SceneGraph& sceneGraph);
+
+    bool hasChannels() const { return !m_channelSampler.empty(); }
+    size_t getChannelCount() const { return m_channelSampler.size(); }
+    size_t getAnimationCount() const { return m_animationDuration.size(); }
+    float getDuration(int animation) const { return m_animationDuration[animation]; }
+    const std::string& getAnimationName(int animation) const { return m_animationName[animation]; }
+
+    void setActiveAnimation(int animation) { m_activeAnimation = animation; }
+    int getActiveAnimation() const { return m_activeAnimation; }
+    void setPlaying(bool playing) { m_playing = playing; }
+    bool isPlaying() const { return m_playing; }
+    void setSpeed(float speed) { m_speed = speed; }
+    void setTime(float time) { m_time = time; }
+    float getTime() const { return m_time; }
+
+    void setParallel(bool parallel) { m_parallel = parallel; }
+    void setKeyCacheEnabled(bool enabled) { m_keyCacheEnabled = enabled; }
+    void setQuaternionInterpolation(QuaternionInterpolation mode) { m_quaternionInterpolation = mode; }
+
+    const AnimationStats& getLastStats() const { return m_lastStats; }
+};
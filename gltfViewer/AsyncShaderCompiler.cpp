@@ -0,0 +1,266 @@
+﻿#include "AsyncShaderCompiler.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // 並列コンパイル拡張に任せるスレッド数（ドライバーが決める上限まで使う）
+    const GLuint kMaxCompilerThreads = 0xFFFFFFFFu;
+
+    std::string getShaderLog(GLuint shader) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log(static_cast<size_t>(std::max(length, 1)), '\0');
+        glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+        return log.c_str();
+    }
+
+    std::string getProgramLog(GLuint program) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string log(static_cast<size_t>(std::max(length, 1)), '\0');
+        glGetProgramInfoLog(program, length, nullptr, &log[0]);
+        return log.c_str();
+    }
+
+    double getElapsedMs(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+AsyncShaderCompiler::AsyncShaderCompiler()
+    : m_mode(Mode::Synchronous)
+    , m_stopping(false)
+{
+}
+
+AsyncShaderCompiler::~AsyncShaderCompiler() {
+    // ワーカーの停止とOpenGLリソースの解放は cleanup() で行う（コンテキスト破棄後の呼び出しを避ける）
+}
+
+const char* AsyncShaderCompiler::getModeName(Mode mode) {
+    switch (mode) {
+    case Mode::ParallelExtension:
+        return "並列コンパイル拡張 (KHR_parallel_shader_compile)";
+    case Mode::WorkerContext:
+        return "共有コンテキストのワーカースレッド";
+    default:
+        return "同期（描画スレッドで完了まで待つ）";
+    }
+}
+
+void AsyncShaderCompiler::initialize(GLContext& mainContext) {
+    cleanup();
+
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(kMaxCompilerThreads);
+        m_mode = Mode::ParallelExtension;
+        return;
+    }
+    if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(kMaxCompilerThreads);
+        m_mode = Mode::ParallelExtension;
+        return;
+    }
+
+    m_workerContext = mainContext.createSharedContext();
+    if (m_workerContext) {
+        m_stopping = false;
+        m_worker = std::thread(&AsyncShaderCompiler::workerLoop, this);
+        m_mode = Mode::WorkerContext;
+        return;
+    }
+    std::cerr << "警告: シェーダーコンパイル用の共有コンテキストを作成できません（描画スレッドでコンパイルします）" << std::endl;
+    m_mode = Mode::Synchronous;
+}
+
+void AsyncShaderCompiler::cleanup() {
+    if (m_worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        m_worker.join();
+    }
+    m_workerContext.reset();
+
+    // ワーカーが処理しなかった要求は失敗として終える
+    for (const auto& job : m_queue) {
+        job->m_log = "シェーダーコンパイラーの終了により中断されました";
+        job->m_state = ShaderCompileJob::State::Failed;
+    }
+    m_queue.clear();
+    for (const auto& job : m_inFlight) {
+        deleteObjects(*job);
+        if (job->m_state == ShaderCompileJob::State::Pending) {
+            job->m_state = ShaderCompileJob::State::Failed;
+        }
+    }
+    m_inFlight.clear();
+    m_mode = Mode::Synchronous;
+}
+
+std::shared_ptr<ShaderCompileJob> AsyncShaderCompiler::submit(const std::string& vertexSource, const std::string& fragmentSource, bool binaryRetrievable) {
+    auto job = std::make_shared<ShaderCompileJob>();
+    job->m_vertexSource = vertexSource;
+    job->m_fragmentSource = fragmentSource;
+    job->m_binaryRetrievable = binaryRetrievable;
+    job->m_submitTime = std::chrono::high_resolution_clock::now();
+
+    switch (m_mode) {
+    case Mode::ParallelExtension:
+        // 発行だけ行い、完了は update() で GL_COMPLETION_STATUS_KHR を問い合わせて確認する
+        startCompile(*job);
+        m_inFlight.push_back(job);
+        break;
+    case Mode::WorkerContext:
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(job);
+        }
+        m_condition.notify_one();
+        m_inFlight.push_back(job);
+        break;
+    default:
+        startCompile(*job);
+        {
+            const bool success = finishCompile(*job);
+            job->m_timeMs = getElapsedMs(job->m_submitTime);
+            job->m_state = success ? ShaderCompileJob::State::Ready : ShaderCompileJob::State::Failed;
+        }
+        break;
+    }
+    return job;
+}
+
+void AsyncShaderCompiler::release(const std::shared_ptr<ShaderCompileJob>& job) {
+    if (!job) {
+        return;
+    }
+    job->m_released = true;
+    if (job->m_state != ShaderCompileJob::State::Pending) {
+        deleteObjects(*job);
+    }
+}
+
+void AsyncShaderCompiler::update() {
+    size_t kept = 0;
+    for (size_t i = 0; i < m_inFlight.size(); ++i) {
+        std::shared_ptr<ShaderCompileJob> job = m_inFlight[i];
+        if (m_mode == Mode::ParallelExtension && job->m_state == ShaderCompileJob::State::Pending) {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(job->m_program, GL_COMPLETION_STATUS_KHR, &completed);
+            if (completed) {
+                const bool success = finishCompile(*job);
+                job->m_timeMs = getElapsedMs(job->m_submitTime);
+                job->m_state = success ? ShaderCompileJob::State::Ready : ShaderCompileJob::State::Failed;
+            }
+        }
+
+        if (job->m_state == ShaderCompileJob::State::Pending) {
+            m_inFlight[kept++] = job;
+        } else if (job->m_released) {
+            deleteObjects(*job);
+        }
+    }
+    m_inFlight.resize(kept);
+}
+
+// 共有コンテキストでコンパイル・リンクし、描画コンテキストから使えるよう glFinish で完了させてから結果を公開する
+void AsyncShaderCompiler::workerLoop() {
+    const bool current = m_workerContext->makeCurrent();
+
+    for (;;) {
+        std::shared_ptr<ShaderCompileJob> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) {
+                break;
+            }
+            job = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        bool success = false;
+        if (current) {
+            startCompile(*job);
+            success = finishCompile(*job);
+            glFinish();
+        } else {
+            job->m_log = "ワーカースレッドでOpenGLコンテキストを有効にできません";
+        }
+        job->m_timeMs = getElapsedMs(job->m_submitTime);
+        job->m_state = success ? ShaderCompileJob::State::Ready : ShaderCompileJob::State::Failed;
+    }
+
+    if (current) {
+        m_workerContext->doneCurrent();
+    }
+}
+
+void AsyncShaderCompiler::startCompile(ShaderCompileJob& job) {
+    const char* vertexSource = job.m_vertexSource.c_str();
+    job.m_vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(job.m_vertexShader, 1, &vertexSource, nullptr);
+    glCompileShader(job.m_vertexShader);
+
+    const char* fragmentSource = job.m_fragmentSource.c_str();
+    job.m_fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(job.m_fragmentShader, 1, &fragmentSource, nullptr);
+    glCompileShader(job.m_fragmentShader);
+
+    job.m_program = glCreateProgram();
+    glAttachShader(job.m_program, job.m_vertexShader);
+    glAttachShader(job.m_program, job.m_fragmentShader);
+    if (job.m_binaryRetrievable) {
+        glProgramParameteri(job.m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(job.m_program);
+}
+
+bool AsyncShaderCompiler::finishCompile(ShaderCompileJob& job) {
+    GLint status = GL_FALSE;
+    glGetShaderiv(job.m_vertexShader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        job.m_log += "シェーダーコンパイルエラー [VERTEX]:\n" + getShaderLog(job.m_vertexShader) + "\n";
+    }
+    glGetShaderiv(job.m_fragmentShader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        job.m_log += "シェーダーコンパイルエラー [FRAGMENT]:\n" + getShaderLog(job.m_fragmentShader) + "\n";
+    }
+    glGetProgramiv(job.m_program, GL_LINK_STATUS, &status);
+    if (!status && job.m_log.empty()) {
+        job.m_log = "シェーダーリンクエラー:\n" + getProgramLog(job.m_program);
+    }
+
+    // シェーダーオブジェクトは不要になったので削除（リンク済みのプログラムだけを残す）
+    glDetachShader(job.m_program, job.m_vertexShader);
+    glDetachShader(job.m_program, job.m_fragmentShader);
+    glDeleteShader(job.m_vertexShader);
+    glDeleteShader(job.m_fragmentShader);
+    job.m_vertexShader = 0;
+    job.m_fragmentShader = 0;
+
+    if (!status) {
+        glDeleteProgram(job.m_program);
+        job.m_program = 0;
+        return false;
+    }
+    return true;
+}
+
+void AsyncShaderCompiler::deleteObjects(ShaderCompileJob& job) {
+    if (job.m_vertexShader != 0) {
+        glDeleteShader(job.m_vertexShader);
+        job.m_vertexShader = 0;
+    }
+    if (job.m_fragmentShader != 0) {
+        glDeleteShader(job.m_fragmentShader);
+        job.m_fragmentShader = 0;
+    }
+    if (job.m_program != 0) {
+        glDeleteProgram(job.m_program);
+        job.m_program = 0;
+    }
+}
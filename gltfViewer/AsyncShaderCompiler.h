@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GLContext.h"
+
+// 1つのプログラムのコンパイル・リンクの要求と結果
+struct ShaderCompileJob {
+    enum class State { Pending, Ready, Failed };
+
+    std::string m_vertexSource;
+    std::string m_fragmentSource;
+    bool m_binaryRetrievable;
+    std::atomic<State> m_state;
+    GLuint m_program;          // Ready の場合のリンク済みプログラム（要求元が ShaderManager::adoptProgram で引き取り 0 にする）
+    GLuint m_vertexShader;     // 完了するまでの間だけ保持
+    GLuint m_fragmentShader;
+    std::string m_log;         // Failed の場合のコンパイル・リンクのログ
+    double m_timeMs;           // 要求から完了までの時間
+    std::chrono::high_resolution_clock::time_point m_submitTime;
+    bool m_released;           // 要求元が結果を使わない（完了後にプログラムを削除する）
+
+    ShaderCompileJob()
+        : m_binaryRetrievable(false), m_state(State::Pending), m_program(0), m_vertexShader(0), m_fragmentShader(0), m_timeMs(0.0), m_released(false) {}
+};
+
+// 描画スレッドを止めずにプログラムをコンパイル・リンクする
+// KHR / ARB_parallel_shader_compile がある場合はドライバーのスレッドでコンパイルし、GL_COMPLETION_STATUS_KHR で完了を確認する
+// 無い場合は描画コンテキストとオブジェクトを共有するコンテキストをワーカースレッドで有効にしてコンパイルする
+// （共有コンテキストも作れない場合は submit() の中で完了まで待つ）
+// 要求・結果の受け取り・update() はすべて描画スレッドから呼ぶ
+class AsyncShaderCompiler {
+public:
+    enum class Mode { Synchronous, ParallelExtension, WorkerContext };
+
+private:
+    Mode m_mode;
+    std::unique_ptr<GLContext> m_workerContext;
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::shared_ptr<ShaderCompileJob>> m_queue;      // ワーカーが未処理の要求
+    bool m_stopping;
+    std::vector<std::shared_ptr<ShaderCompileJob>> m_inFlight;  // 完了を確認していない要求と、解放待ちの要求
+
+    void workerLoop();
+    static void startCompile(ShaderCompileJob& job);    // コンパイル・リンクの発行（状態は問い合わせない）
+    static bool finishCompile(ShaderCompileJob& job);   // 状態とログの取得、シェーダーオブジェクトの削除
+    static void deleteObjects(ShaderCompileJob& job);
+
+public:
+    AsyncShaderCompiler();
+    ~AsyncShaderCompiler();
+
+    AsyncShaderCompiler(const AsyncShaderCompiler&) = delete;
+    AsyncShaderCompiler& operator=(const AsyncShaderCompiler&) = delete;
+
+    // 描画コンテキストが有効な状態で呼ぶ（ワーカー用の共有コンテキストを作成する場合がある）
+    void initialize(GLContext& mainContext);
+    void cleanup();   // OpenGLコンテキストが有効なうちに呼ぶこと
+
+    std::shared_ptr<ShaderCompileJob> submit(const std::string& vertexSource, const std::string& fragmentSource, bool binaryRetrievable);
+
+    // 結果を使わなくなった要求（完了していればプログラムを削除、未完了なら完了後に削除）
+    void release(const std::shared_ptr<ShaderCompileJob>& job);
+
+    // 並列コンパイルの完了確認と、解放された要求の後始末（毎フレーム呼ぶ）
+    void update();
+
+    Mode getMode() const { return m_mode; }
+    static const char* getModeName(Mode mode);
+};
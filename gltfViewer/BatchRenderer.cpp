@@ -0,0 +1,204 @@
+﻿#include "BatchRenderer.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include "GLTFModel.h"
+#include "ThreadPool.h"
+
+namespace {
+    double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // ワーカースレッドで読み込み中のモデル
+    struct PendingModel {
+        std::string m_path;
+        GLTFModel m_model;
+        bool m_loaded;
+        double m_parseMs;
+        std::future<void> m_done;
+
+        PendingModel() : m_loaded(false), m_parseMs(0.0) {}
+    };
+
+    std::shared_ptr<PendingModel> startLoad(const std::string& path) {
+        std::shared_ptr<PendingModel> pending = std::make_shared<PendingModel>();
+        pending->m_path = path;
+        PendingModel* target = pending.get();
+        // 完了は m_done で待つので、タスクが pending より長く生きることはない
+        pending->m_done = ThreadPool::getInstance().submit([target] {
+            const auto start = std::chrono::high_resolution_clock::now();
+            target->m_loaded = target->m_model.loadFromFile(target->m_path) && target->m_model.validateModel();
+            target->m_parseMs = elapsedMs(start);
+        });
+        return pending;
+    }
+
+    std::string getBaseName(const std::string& path) {
+        return std::filesystem::path(path).stem().string();
+    }
+}
+
+double BatchStats::getModelsPerMinute(bool includeInit) const {
+    const double ms = m_totalMs + (includeInit ? m_initMs : 0.0);
+    return ms > 0.0 ? m_rendered * 60000.0 / ms : 0.0;
+}
+
+BatchRenderer::BatchRenderer() {
+}
+
+BatchRenderer::~BatchRenderer() {
+    cleanup();
+}
+
+bool BatchRenderer::initialize(const BatchSettings& settings) {
+    cleanup();
+    m_settings = settings;
+    m_settings.m_prefetchModels = std::max(m_settings.m_prefetchModels, 1);
+    m_stats = BatchStats();
+
+    if (!m_settings.m_outputDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(m_settings.m_outputDirectory, error);
+        if (error) {
+            std::cerr << "エラー: 出力ディレクトリを作成できません: " << m_settings.m_outputDirectory << " (" << error.message() << ")" << std::endl;
+            return false;
+        }
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    if (!m_headless.initialize(m_settings.m_headless)) {
+        return false;
+    }
+    m_writer.reset(new ImageWriter(m_settings.m_writerQueueBytes));
+    m_headless.setImageWriter(m_writer.get());
+    m_stats.m_initMs = elapsedMs(start);
+    return true;
+}
+
+void BatchRenderer::cleanup() {
+    m_headless.setImageWriter(nullptr);
+    // 書き出し待ちの画像を書き終えてから破棄する
+    m_writer.reset();
+    m_headless.cleanup();
+}
+
+bool BatchRenderer::run(const std::vector<std::string>& modelPaths) {
+    if (!m_writer) {
+        std::cerr << "エラー: 一括描画が初期化されていません" << std::endl;
+        return false;
+    }
+
+    // 前回の run() で取り出されなかった失敗は数えない
+    m_writer->takeFailedPaths();
+    const auto start = std::chrono::high_resolution_clock::now();
+    const std::filesystem::path directory(m_settings.m_outputDirectory);
+
+    std::deque<std::shared_ptr<PendingModel>> pending;
+    size_t nextLoad = 0;
+    std::set<std::string> usedNames;
+    std::map<std::string, size_t> imageModels;        // 書き出しキューへ渡した画像のパス → モデル番号
+    std::vector<bool> renderedModels(modelPaths.size(), false);
+    size_t failed = 0;
+    for (size_t i = 0; i < modelPaths.size(); ++i) {
+        // 描画中のモデルの後に m_prefetchModels 個の読み込みが進んでいるようにする
+        while (nextLoad < modelPaths.size() && pending.size() < static_cast<size_t>(m_settings.m_prefetchModels) + 1) {
+            pending.push_back(startLoad(modelPaths[nextLoad++]));
+        }
+        std::shared_ptr<PendingModel> current = pending.front();
+        pending.pop_front();
+
+        const auto waitStart = std::chrono::high_resolution_clock::now();
+        current->m_done.wait();
+        m_stats.m_parseWaitMs += elapsedMs(waitStart);
+        m_stats.m_parseMs += current->m_parseMs;
+        ++m_stats.m_models;
+        if (!current->m_loaded) {
+            std::cerr << "エラー: モデルを読み込めないためスキップします: " << current->m_path << std::endl;
+            ++failed;
+            continue;
+        }
+
+        // 同じファイル名のモデルが別のディレクトリにある場合は番号を付けて上書きを避ける
+        std::string name = getBaseName(current->m_path);
+        if (!usedNames.insert(name).second) {
+            name += "_" + std::to_string(i);
+            usedNames.insert(name);
+        }
+
+        const std::string outputPath = (directory / (name + m_settings.m_extension)).string();
+        if (m_headless.renderModel(current->m_model.getModel(), outputPath)) {
+            ++m_stats.m_rendered;
+            renderedModels[i] = true;
+        } else {
+            ++failed;
+        }
+        for (const HeadlessImageStats& image : m_headless.getImageStats()) {
+            imageModels[image.m_path] = i;
+        }
+        m_stats.m_loadMs += m_headless.getLoadTimeMs();
+        m_stats.m_renderMs += m_headless.getTotalTimeMs() - m_headless.getLoadTimeMs();
+    }
+
+    const auto flushStart = std::chrono::high_resolution_clock::now();
+    m_writer->flush();
+    m_stats.m_flushMs = elapsedMs(flushStart);
+    m_stats.m_totalMs += elapsedMs(start);
+
+    m_stats.m_writer = m_writer->getStats();
+    // 書き出しスレッドで画像の書き出しに失敗したモデルも失敗として数える（方向が複数失敗しても1モデル）
+    std::set<size_t> writeFailedModels;
+    for (const std::string& path : m_writer->takeFailedPaths()) {
+        const auto found = imageModels.find(path);
+        if (found != imageModels.end() && renderedModels[found->second]) {
+            writeFailedModels.insert(found->second);
+        }
+    }
+    m_stats.m_rendered -= writeFailedModels.size();
+    failed += writeFailedModels.size();
+    m_stats.m_failed += failed;
+    return failed == 0;
+}
+
+void BatchRenderer::printStats() const {
+    const double models = static_cast<double>(std::max<size_t>(m_stats.m_models, 1));
+    std::cout << "=== 一括描画 (" << m_settings.m_headless.m_width << "x" << m_settings.m_headless.m_height << ", "
+        << m_settings.m_headless.m_views << " 方向) ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  モデル: " << m_stats.m_models << " (成功 " << m_stats.m_rendered << ", 失敗 " << m_stats.m_failed << ")" << std::endl;
+    std::cout << "  スループット: " << std::setprecision(1) << m_stats.getModelsPerMinute(false) << " モデル/分 (初期化込み "
+        << m_stats.getModelsPerMinute(true) << " モデル/分)" << std::setprecision(3) << std::endl;
+    std::cout << "  初期化: " << m_stats.m_initMs << " ms, 全体: " << m_stats.m_totalMs << " ms" << std::endl;
+    std::cout << "  1モデルあたり: 読み込み " << m_stats.m_parseMs / models << " ms (待ち " << m_stats.m_parseWaitMs / models
+        << " ms), ロード " << m_stats.m_loadMs / models << " ms, 描画 " << m_stats.m_renderMs / models << " ms" << std::endl;
+    const double images = static_cast<double>(std::max<size_t>(m_stats.m_writer.m_queued, 1));
+    std::cout << "  書き出し: " << m_stats.m_writer.m_written << " 枚 (失敗 " << m_stats.m_writer.m_failed << " 枚), 平均 " << m_stats.m_writer.m_writeMs / images
+        << " ms/枚, キュー待ち合計 " << m_stats.m_writer.m_stallMs << " ms, 最大待ち " << m_stats.m_writer.m_maxQueuedImages
+        << " 枚, 最後の書き出し待ち " << m_stats.m_flushMs << " ms" << std::endl;
+}
+
+bool BatchRenderer::readModelList(const std::string& listPath, std::vector<std::string>& modelPaths) {
+    std::ifstream file(listPath);
+    if (!file) {
+        std::cerr << "エラー: モデル一覧を開けません: " << listPath << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') {
+            continue;
+        }
+        const size_t end = line.find_last_not_of(" \t\r");
+        modelPaths.push_back(line.substr(begin, end - begin + 1));
+    }
+    return true;
+}
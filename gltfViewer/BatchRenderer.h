@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "HeadlessRenderer.h"
+#include "ImageWriter.h"
+
+// 一括描画の設定
+struct BatchSettings {
+    HeadlessSettings m_headless;    // 画像の大きさと方向の数（既定はサムネイル向けの 256x256、1方向）
+    std::string m_outputDirectory;  // 空の場合はカレントディレクトリ
+    std::string m_extension;        // ".png" / ".jpg"
+    int m_prefetchModels;           // 描画中に先読みするモデルの数
+    size_t m_writerQueueBytes;      // 書き出し待ちの画素の上限
+
+    BatchSettings() : m_extension(".png"), m_prefetchModels(2), m_writerQueueBytes(256 * 1024 * 1024) {
+        m_headless.m_width = 256;
+        m_headless.m_height = 256;
+    }
+};
+
+// 一括描画の計測結果
+struct BatchStats {
+    size_t m_models;
+    size_t m_rendered;
+    size_t m_failed;            // 読み込み・描画・書き出しのいずれかに失敗したモデル
+    double m_initMs;            // コンテキストの作成と初期化
+    double m_parseMs;           // glTF の読み込みの合計（ワーカースレッド、描画と重なる）
+    double m_parseWaitMs;       // 先読みが間に合わず描画スレッドが待った合計
+    double m_loadMs;            // loadGLTFModel() とカメラ合わせの合計
+    double m_renderMs;          // 描画・読み出し・書き出しキューへ渡すまでの合計
+    double m_flushMs;           // 最後のモデルの後に書き出しの完了を待った時間
+    double m_totalMs;           // 初期化を除く、最初のモデルから全画像の書き出し完了まで
+    ImageWriterStats m_writer;
+
+    BatchStats()
+        : m_models(0), m_rendered(0), m_failed(0), m_initMs(0.0), m_parseMs(0.0), m_parseWaitMs(0.0)
+        , m_loadMs(0.0), m_renderMs(0.0), m_flushMs(0.0), m_totalMs(0.0) {}
+
+    // 描画できたモデル数 / 分（初期化を含めるかどうか）
+    double getModelsPerMinute(bool includeInit) const;
+};
+
+// 1つのオフスクリーンコンテキストとシェーダーを使い続けて、モデルの一覧を順にサムネイル画像へ描画する
+// モデルごとのプロセス起動・コンテキスト作成・シェーダーのコンパイルを省き、
+// 次のモデルの glTF の読み込みはワーカースレッドで、画像のエンコードと書き込みは ImageWriter のスレッドで描画と並行して行う
+class BatchRenderer {
+private:
+    HeadlessRenderer m_headless;
+    std::unique_ptr<ImageWriter> m_writer;
+    BatchSettings m_settings;
+    BatchStats m_stats;
+
+public:
+    BatchRenderer();
+    ~BatchRenderer();
+
+    BatchRenderer(const BatchRenderer&) = delete;
+    BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+    bool initialize(const BatchSettings& settings = BatchSettings());
+    void cleanup();
+
+    // 一覧のモデルを描画して出力ディレクトリへ書き出す（すべて書き出せた場合に true）
+    bool run(const std::vector<std::string>& modelPaths);
+
+    const BatchStats& getStats() const { return m_stats; }
+    void printStats() const;
+
+    // 1行に1つのモデルのパスを書いたファイルを読む（空行と # で始まる行は無視）
+    static bool readModelList(const std::string& listPath, std::vector<std::string>& modelPaths);
+};
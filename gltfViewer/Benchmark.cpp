@@ -0,0 +1,2127 @@
+﻿#include "Benchmark.h"
+#include "OpenGLRenderer.h"
+#include "Camera.h"
+#include "SceneBVH.h"
+#include "FrustumCulling.h"
+#include "ThreadPool.h"
+#include "SceneGraph.h"
+#include "AnimationPlayer.h"
+#include "Skinning.h"
+#include "MorphTargets.h"
+#include "InstanceBatcher.h"
+#include "Picking.h"
+#include "GeometryStreaming.h"
+#include "TextureStreaming.h"
+#include "RenderQueue.h"
+#include "ShaderManager.h"
+#include "SoftwareRenderer.h"
+#include "HeadlessRenderer.h"
+#include <tiny_gltf.h>
+#include <stb_image.h>
+#include <stb_image_write.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    // 描画を伴うベンチマークのFBOとピッキングのビューポートの大きさ（ウィンドウの既定の大きさ）
+    const int kViewportWidth = 800;
+    const int kViewportHeight = 600;
+
+    // バッファーにデータを追加してバッファービューを作成
+    int appendBufferView(tinygltf::Model& model, const void* data, size_t byteLength, int target) {
+        if (model.buffers.empty()) {
+            model.buffers.push_back(tinygltf::Buffer());
+        }
+        tinygltf::Buffer& buffer = model.buffers[0];
+
+        // 4バイト境界に揃える
+        while (buffer.data.size() % 4 != 0) {
+            buffer.data.push_back(0);
+        }
+
+        tinygltf::BufferView view;
+        view.buffer = 0;
+        view.byteOffset = buffer.data.size();
+        view.byteLength = byteLength;
+        view.target = target;
+
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        buffer.data.insert(buffer.data.end(), bytes, bytes + byteLength);
+
+        model.bufferViews.push_back(view);
+        return static_cast<int>(model.bufferViews.size()) - 1;
+    }
+
+    int appendAccessor(tinygltf::Model& model, int bufferView, int componentType, int type, size_t count) {
+        tinygltf::Accessor accessor;
+        accessor.bufferView = bufferView;
+        accessor.byteOffset = 0;
+        accessor.componentType = componentType;
+        accessor.type = type;
+        accessor.count = count;
+        model.accessors.push_back(accessor);
+        return static_cast<int>(model.accessors.size()) - 1;
+    }
+
+    // 単位立方体のメッシュを追加してメッシュインデックスを返す
+    int appendCubeMesh(tinygltf::Model& model) {
+        const float positions[] = {
+            -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+            -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f
+        };
+        const unsigned int indices[] = {
+            4, 5, 6,  4, 6, 7,   // +Z
+            1, 0, 3,  1, 3, 2,   // -Z
+            5, 1, 2,  5, 2, 6,   // +X
+            0, 4, 7,  0, 7, 3,   // -X
+            7, 6, 2,  7, 2, 3,   // +Y
+            0, 1, 5,  0, 5, 4    // -Y
+        };
+
+        int positionView = appendBufferView(model, positions, sizeof(positions), TINYGLTF_TARGET_ARRAY_BUFFER);
+        int positionAccessor = appendAccessor(model, positionView, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, 8);
+        model.accessors[positionAccessor].minValues = { -0.5, -0.5, -0.5 };
+        model.accessors[positionAccessor].maxValues = { 0.5, 0.5, 0.5 };
+
+        int indexView = appendBufferView(model, indices, sizeof(indices), TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+        int indexAccessor = appendAccessor(model, indexView, TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, 36);
+
+        tinygltf::Material material;
+        material.pbrMetallicRoughness.baseColorFactor = { 0.8, 0.6, 0.3, 1.0 };
+        model.materials.push_back(material);
+
+        tinygltf::Primitive primitive;
+        primitive.attributes["POSITION"] = positionAccessor;
+        primitive.indices = indexAccessor;
+        primitive.material = static_cast<int>(model.materials.size()) - 1;
+        primitive.mode = TINYGLTF_MODE_TRIANGLES;
+
+        tinygltf::Mesh mesh;
+        mesh.name = "BenchmarkCube";
+        mesh.primitives.push_back(primitive);
+        model.meshes.push_back(mesh);
+        return static_cast<int>(model.meshes.size()) - 1;
+    }
+
+    // instanceCount 個の位置を立方体グリッド状に生成
+    std::vector<float> makeGridPositions(int instanceCount, float spacing) {
+        const int side = std::max(1, static_cast<int>(std::ceil(std::cbrt(static_cast<double>(instanceCount)))));
+        std::vector<float> positions;
+        positions.reserve(static_cast<size_t>(instanceCount) * 3);
+        for (int i = 0; i < instanceCount; ++i) {
+            positions.push_back((i % side) * spacing);
+            positions.push_back(((i / side) % side) * spacing);
+            positions.push_back((i / (side * side)) * spacing);
+        }
+        return positions;
+    }
+
+    // シーン全体が収まるようにカメラを配置
+    void fitCamera(OpenGLRenderer& renderer, Camera& camera) {
+        const BoundingBox& bounds = renderer.getSceneBounds();
+        if (bounds.isValid()) {
+            const BoundingSphere& sphere = renderer.getSceneBoundingSphere();
+            camera.fitToBoundingBox(bounds.m_min, bounds.m_max);
+            camera.fitClipPlanesToSphere(sphere.m_center, sphere.m_radius);
+        }
+        renderer.updateCamera(&camera);
+    }
+
+    struct FrameResult {
+        size_t m_drawCalls;
+        double m_cpuTimeMs;    // renderGLTF() のCPU時間の平均
+        double m_frameTimeMs;  // glFinish() までを含むフレーム時間の平均
+    };
+
+    FrameResult measureFrames(OpenGLRenderer& renderer, int frameCount) {
+        // ウォームアップ（初回のドライバー処理を除外）
+        for (int i = 0; i < 3; ++i) {
+            renderer.render();
+        }
+        glFinish();
+
+        FrameResult result = { 0, 0.0, 0.0 };
+        for (int i = 0; i < frameCount; ++i) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            renderer.render();
+            glFinish();
+            const auto end = std::chrono::high_resolution_clock::now();
+
+            result.m_drawCalls = renderer.getRenderStats().m_drawCalls;
+            result.m_cpuTimeMs += renderer.getRenderStats().m_cpuTimeMs;
+            result.m_frameTimeMs += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        result.m_cpuTimeMs /= frameCount;
+        result.m_frameTimeMs /= frameCount;
+        return result;
+    }
+
+    // 画素の FNV-1a ハッシュ（描画方法を変えても同じ画像になるかの比較に使う）
+    uint64_t hashPixels(const std::vector<unsigned char>& pixels) {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char value : pixels) {
+            hash = (hash ^ value) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // バインドされているフレームバッファー（オフスクリーンのFBO）のビューポートを読み出したハッシュ
+    uint64_t hashFramebuffer() {
+        GLint viewport[4] = { 0, 0, 0, 0 };
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        std::vector<unsigned char> pixels(static_cast<size_t>(viewport[2]) * viewport[3] * 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(viewport[0], viewport[1], viewport[2], viewport[3], GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return hashPixels(pixels);
+    }
+
+    bool runInstancing(int instanceCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int frameCount = 20;
+
+        std::cout << "=== インスタンス描画ベンチマーク (インスタンス数: " << instanceCount
+            << ", フレーム数: " << frameCount << ") ===" << std::endl;
+        std::cout << std::left << std::setw(28) << "シーン" << std::setw(14) << "モード"
+            << std::right << std::setw(12) << "ドロー数" << std::setw(14) << "CPU(ms)" << std::setw(14) << "フレーム(ms)" << std::endl;
+
+        const bool sceneTypes[] = { false, true };
+        for (bool useGPUInstancing : sceneTypes) {
+            tinygltf::Model model;
+            Benchmark::createInstancedScene(instanceCount, useGPUInstancing, model);
+            if (!renderer.loadGLTFModel(model)) {
+                std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+                return false;
+            }
+            fitCamera(renderer, camera);
+
+            const bool modes[] = { true, false };
+            for (bool instancing : modes) {
+                renderer.setInstancingEnabled(instancing);
+                FrameResult result = measureFrames(renderer, frameCount);
+
+                std::cout << std::left << std::setw(28) << (useGPUInstancing ? "EXT_mesh_gpu_instancing" : "ノード")
+                    << std::setw(14) << (instancing ? "インスタンス" : "個別描画")
+                    << std::right << std::setw(12) << result.m_drawCalls
+                    << std::setw(14) << std::fixed << std::setprecision(3) << result.m_cpuTimeMs
+                    << std::setw(14) << result.m_frameTimeMs << std::endl;
+            }
+
+            renderer.setInstancingEnabled(true);
+            renderer.cleanupGLTFResources();
+        }
+        return true;
+    }
+
+    double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // 一様乱数で配置したAABB（シーンの広さはオブジェクト数に合わせて密度を一定に保つ）
+    std::vector<BoundingBox> makeRandomBoxes(int count, std::mt19937& random) {
+        const float extent = 10.0f * std::cbrt(static_cast<float>(count));
+        std::uniform_real_distribution<float> position(0.0f, extent);
+        std::uniform_real_distribution<float> halfSize(0.1f, 2.0f);
+
+        std::vector<BoundingBox> boxes(count);
+        for (auto& box : boxes) {
+            glm::vec3 center(position(random), position(random), position(random));
+            glm::vec3 half(halfSize(random), halfSize(random), halfSize(random));
+            box = BoundingBox(center - half, center + half);
+        }
+        return boxes;
+    }
+
+    bool runBVH(int objectCount, Camera& camera) {
+        const int queryCount = 10000;
+        std::vector<int> counts;
+        if (objectCount > 0) {
+            counts.push_back(objectCount);
+        } else {
+            counts = { 10000, 100000, 1000000 };
+        }
+
+        std::cout << "=== シーンBVHベンチマーク (ワーカースレッド数: " << ThreadPool::getInstance().getThreadCount()
+            << ", クエリ数: " << queryCount << ") ===" << std::endl;
+        std::cout << std::right << std::setw(10) << "オブジェクト" << std::setw(12) << "構築(ms)" << std::setw(14) << "並列構築(ms)"
+            << std::setw(12) << "refit(ms)" << std::setw(14) << "視錐台(ms)" << std::setw(14) << "総当たり(ms)"
+            << std::setw(12) << "レイ(ms)" << std::setw(12) << "最近傍(ms)" << std::setw(10) << "深さ" << std::endl;
+
+        std::mt19937 random(12345);
+        for (int count : counts) {
+            std::vector<BoundingBox> boxes = makeRandomBoxes(count, random);
+            const float extent = 10.0f * std::cbrt(static_cast<float>(count));
+
+            SceneBVH bvh;
+            auto start = std::chrono::high_resolution_clock::now();
+            bvh.build(boxes, false);
+            const double serialMs = elapsedMs(start);
+
+            start = std::chrono::high_resolution_clock::now();
+            bvh.build(boxes, true);
+            const double parallelMs = elapsedMs(start);
+
+            // 全オブジェクトを少し動かしてから refit
+            for (auto& box : boxes) {
+                box.m_min += glm::vec3(0.5f);
+                box.m_max += glm::vec3(0.5f);
+            }
+            start = std::chrono::high_resolution_clock::now();
+            bvh.refit(boxes);
+            const double refitMs = elapsedMs(start);
+
+            // シーンの角から中心を向くカメラの視錐台
+            const glm::vec3 center(extent * 0.5f);
+            camera.setPosition(glm::vec3(-extent * 0.25f));
+            camera.setTarget(center);
+            camera.setPerspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, extent * 2.0f);
+            const Frustum frustum = BoundingVolume::extractFrustum(camera.getViewProjectionMatrix());
+
+            std::vector<int> visible;
+            visible.reserve(count);
+            start = std::chrono::high_resolution_clock::now();
+            bvh.queryFrustum(frustum, visible);
+            const double frustumMs = elapsedMs(start);
+
+            size_t bruteForceVisible = 0;
+            start = std::chrono::high_resolution_clock::now();
+            for (const auto& box : boxes) {
+                if (BoundingVolume::intersectsFrustum(box, frustum)) {
+                    ++bruteForceVisible;
+                }
+            }
+            const double bruteForceMs = elapsedMs(start);
+            if (bruteForceVisible != visible.size()) {
+                std::cerr << "警告: BVHと総当たりの可視数が一致しません (" << visible.size() << " != " << bruteForceVisible << ")" << std::endl;
+            }
+
+            std::uniform_real_distribution<float> position(0.0f, extent);
+            std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+            size_t rayHits = 0;
+            start = std::chrono::high_resolution_clock::now();
+            for (int q = 0; q < queryCount; ++q) {
+                Ray ray(glm::vec3(position(random), position(random), position(random)),
+                    glm::vec3(direction(random), direction(random), direction(random)));
+                BVHRayHit hit;
+                if (bvh.raycast(ray, std::numeric_limits<float>::max(), hit)) {
+                    ++rayHits;
+                }
+            }
+            const double rayMs = elapsedMs(start);
+
+            start = std::chrono::high_resolution_clock::now();
+            for (int q = 0; q < queryCount; ++q) {
+                float distance;
+                bvh.findNearest(glm::vec3(position(random), position(random), position(random)),
+                    std::numeric_limits<float>::max(), distance);
+            }
+            const double nearestMs = elapsedMs(start);
+
+            std::cout << std::right << std::setw(10) << count << std::fixed << std::setprecision(2)
+                << std::setw(12) << serialMs << std::setw(14) << parallelMs << std::setw(12) << refitMs
+                << std::setw(14) << frustumMs << std::setw(14) << bruteForceMs
+                << std::setw(12) << rayMs << std::setw(12) << nearestMs << std::setw(10) << bvh.getDepth() << std::endl;
+            std::cout << "    可視: " << visible.size() << " / " << count << ", レイのヒット: " << rayHits << " / " << queryCount << std::endl;
+        }
+        return true;
+    }
+
+    // 固定のカメラ姿勢（シーンの広さ extent に対する相対位置）
+    struct CameraPose {
+        const char* m_name;
+        glm::vec3 m_position;
+        glm::vec3 m_target;
+    };
+
+    std::vector<CameraPose> makeCameraPoses(float extent) {
+        const glm::vec3 center(extent * 0.5f);
+        return {
+            { "外側から全体", glm::vec3(-extent * 0.25f), center },
+            { "中心から+X方向", center, center + glm::vec3(1.0f, 0.0f, 0.0f) },
+            { "上から見下ろす", glm::vec3(center.x, extent * 1.2f, center.z + 0.01f), center },
+            { "外側へ向ける", glm::vec3(-extent * 0.25f), glm::vec3(-extent) },
+        };
+    }
+
+    void applyCameraPose(Camera& camera, const CameraPose& pose, float extent) {
+        camera.setPosition(pose.m_position);
+        camera.setTarget(pose.m_target);
+        camera.setPerspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, extent * 2.0f);
+    }
+
+    // 視錐台カリングのみを固定のカメラ姿勢で計測（GLを使わない）と、レンダラーに組み込んだ状態での計測
+    bool runCulling(int objectCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int iterations = 20;
+        std::vector<int> counts;
+        if (objectCount > 0) {
+            counts.push_back(objectCount);
+        } else {
+            counts = { 10000, 100000, 1000000 };
+        }
+
+        std::cout << "=== 視錐台カリングベンチマーク (反復回数: " << iterations << ") ===" << std::endl;
+        std::cout << std::left << std::setw(10) << "オブジェクト" << " " << std::setw(18) << "カメラ"
+            << std::right << std::setw(10) << "可視" << std::setw(10) << "カリング"
+            << std::setw(12) << "Scalar(ms)" << std::setw(12) << "SSE(ms)" << std::setw(12) << "AVX(ms)"
+            << std::setw(12) << "BVH(ms)" << std::setw(14) << "総当たり(ms)" << std::endl;
+
+        const CullingPath paths[] = { CullingPath::Scalar, CullingPath::SSE, CullingPath::AVX };
+        std::mt19937 random(12345);
+        for (int count : counts) {
+            const std::vector<BoundingBox> boxes = makeRandomBoxes(count, random);
+            const float extent = 10.0f * std::cbrt(static_cast<float>(count));
+
+            FrustumCuller culler;
+            culler.setBounds(boxes);
+            SceneBVH bvh;
+            bvh.build(boxes);
+
+            std::vector<int> visible;
+            visible.reserve(count);
+            for (const CameraPose& pose : makeCameraPoses(extent)) {
+                applyCameraPose(camera, pose, extent);
+                const Frustum frustum = camera.getFrustum();
+
+                size_t expectedVisible = 0;
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < iterations; ++i) {
+                    expectedVisible = 0;
+                    for (const auto& box : boxes) {
+                        if (BoundingVolume::intersectsFrustum(box, frustum)) {
+                            ++expectedVisible;
+                        }
+                    }
+                }
+                const double bruteForceMs = elapsedMs(start) / iterations;
+
+                double pathMs[3];
+                CullingStats stats;
+                for (int p = 0; p < 3; ++p) {
+                    start = std::chrono::high_resolution_clock::now();
+                    for (int i = 0; i < iterations; ++i) {
+                        stats = culler.cull(frustum, visible, paths[p]);
+                    }
+                    pathMs[p] = elapsedMs(start) / iterations;
+                    if (stats.m_visible != expectedVisible) {
+                        std::cerr << "警告: " << FrustumCuller::getPathName(FrustumCuller::resolvePath(paths[p]))
+                            << " と総当たりの可視数が一致しません (" << stats.m_visible << " != " << expectedVisible << ")" << std::endl;
+                    }
+                }
+
+                start = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < iterations; ++i) {
+                    bvh.queryFrustum(frustum, visible);
+                }
+                const double bvhMs = elapsedMs(start) / iterations;
+
+                std::cout << std::left << std::setw(10) << count << " " << std::setw(18) << pose.m_name
+                    << std::right << std::setw(10) << stats.m_visible << std::setw(10) << stats.m_culled
+                    << std::fixed << std::setprecision(3)
+                    << std::setw(12) << pathMs[0] << std::setw(12) << pathMs[1] << std::setw(12) << pathMs[2]
+                    << std::setw(12) << bvhMs << std::setw(14) << bruteForceMs << std::endl;
+            }
+        }
+        std::cout << "    (SSE/AVX がビルドされていない場合は利用可能な実装で計測: 既定 "
+            << FrustumCuller::getPathName(FrustumCuller::resolvePath(CullingPath::Best)) << ")" << std::endl;
+
+        // レンダラーに組み込んだ状態でのドロー数・インスタンス数の比較
+        const int instanceCount = std::min(counts.back(), 100000);
+        const int frameCount = 20;
+        tinygltf::Model model;
+        Benchmark::createInstancedScene(instanceCount, false, model);
+        if (!renderer.loadGLTFModel(model)) {
+            std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+            return false;
+        }
+
+        std::cout << std::endl << "=== レンダラーでの視錐台カリング (インスタンス数: " << instanceCount << ") ===" << std::endl;
+        std::cout << std::left << std::setw(18) << "カメラ" << std::setw(10) << "カリング"
+            << std::right << std::setw(12) << "描画数" << std::setw(12) << "カリング数" << std::setw(14) << "CPU(ms)" << std::setw(14) << "フレーム(ms)" << std::endl;
+
+        const BoundingBox& bounds = renderer.getSceneBounds();
+        const float extent = bounds.isValid() ? glm::length(bounds.getSize()) : 1.0f;
+        for (const CameraPose& pose : makeCameraPoses(extent)) {
+            applyCameraPose(camera, pose, extent);
+            renderer.updateCamera(&camera);
+
+            const bool modes[] = { true, false };
+            for (bool culling : modes) {
+                renderer.setFrustumCullingEnabled(culling);
+                FrameResult result = measureFrames(renderer, frameCount);
+                const CullingStats& stats = renderer.getRenderStats().m_culling;
+
+                std::cout << std::left << std::setw(18) << pose.m_name << std::setw(10) << (culling ? "有効" : "無効")
+                    << std::right << std::setw(12) << stats.m_visible << std::setw(12) << stats.m_culled
+                    << std::setw(14) << std::fixed << std::setprecision(3) << result.m_cpuTimeMs
+                    << std::setw(14) << result.m_frameTimeMs << std::endl;
+            }
+        }
+
+        renderer.setFrustumCullingEnabled(true);
+        renderer.cleanupGLTFResources();
+        return true;
+    }
+
+    // グリッド状の立方体の手前 (+Z側) に、グリッド全体を隠す大きさの壁を追加する
+    void appendOccluderWall(tinygltf::Model& model, int instanceCount) {
+        const int side = std::max(1, static_cast<int>(std::ceil(std::cbrt(static_cast<double>(instanceCount)))));
+        const double extent = side * 2.0;
+
+        tinygltf::Node wall;
+        wall.name = "OccluderWall";
+        wall.mesh = 0;
+        wall.translation = { extent * 0.5, extent * 0.5, extent + 2.0 };
+        wall.scale = { extent * 1.5, extent * 1.5, 0.5 };
+        model.nodes.push_back(wall);
+        model.scenes[0].nodes.push_back(static_cast<int>(model.nodes.size()) - 1);
+    }
+
+    bool runOcclusion(int instanceCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int frameCount = 20;
+
+        tinygltf::Model model;
+        Benchmark::createInstancedScene(instanceCount, false, model);
+        appendOccluderWall(model, instanceCount);
+        if (!renderer.loadGLTFModel(model)) {
+            std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+            return false;
+        }
+
+        // マスクによる判定をピクセルごとの深度バッファーによる判定と比べ、遮蔽しきれなかった割合を表示する
+        OcclusionCuller& culler = renderer.getOcclusionCuller();
+        culler.setValidationEnabled(true);
+        std::cout << "=== オクルージョンカリングベンチマーク (インスタンス数: " << instanceCount + 1
+            << ", 被覆マスク: " << culler.getWidth() << "x" << culler.getHeight()
+            << ", ワーカースレッド数: " << ThreadPool::getInstance().getThreadCount() << ") ===" << std::endl;
+        std::cout << std::left << std::setw(16) << "カメラ" << std::setw(8) << "遮蔽"
+            << std::right << std::setw(10) << "視錐台内" << std::setw(10) << "描画数" << std::setw(10) << "遮蔽率(%)"
+            << std::setw(10) << "参照(%)" << std::setw(10) << "見逃し(%)" << std::setw(10) << "オクルーダー" << std::setw(10) << "三角形" << std::setw(12) << "ラスタ(ms)" << std::setw(12) << "判定(ms)"
+            << std::setw(12) << "CPU(ms)" << std::setw(14) << "フレーム(ms)" << std::endl;
+
+        // 壁の正面（ほぼ全体が隠れる）、斜め上（一部が隠れる）、壁の反対側（立方体どうしの遮蔽のみ）
+        const BoundingBox& bounds = renderer.getSceneBounds();
+        const glm::vec3 center = bounds.getCenter();
+        const float extent = glm::length(bounds.getSize());
+        const CameraPose poses[] = {
+            { "壁の正面", center + glm::vec3(0.0f, 0.0f, extent * 0.8f), center },
+            { "斜め上", center + glm::vec3(extent * 0.3f, extent * 0.6f, extent * 0.6f), center },
+            { "壁の反対側", center - glm::vec3(0.0f, 0.0f, extent * 0.8f), center },
+        };
+
+        for (const CameraPose& pose : poses) {
+            applyCameraPose(camera, pose, extent);
+            renderer.updateCamera(&camera);
+
+            const bool modes[] = { true, false };
+            for (bool occlusion : modes) {
+                renderer.setOcclusionCullingEnabled(occlusion);
+                FrameResult result = measureFrames(renderer, frameCount);
+                const RenderStats& stats = renderer.getRenderStats();
+                const OcclusionStats& occlusionStats = stats.m_occlusion;
+
+                std::cout << std::left << std::setw(16) << pose.m_name << std::setw(8) << (occlusion ? "有効" : "無効")
+                    << std::right << std::setw(10) << stats.m_culling.m_visible << std::setw(10) << stats.m_instances
+                    << std::fixed << std::setprecision(1) << std::setw(10) << occlusionStats.getOccludedPercent()
+                    << std::setw(10) << occlusionStats.getReferenceOccludedPercent() << std::setw(10) << occlusionStats.getFalseVisiblePercent()
+                    << std::setw(10) << occlusionStats.m_occluders << std::setw(10) << occlusionStats.m_occluderTriangles
+                    << std::setprecision(3) << std::setw(12) << occlusionStats.m_rasterTimeMs << std::setw(12) << occlusionStats.m_testTimeMs
+                    << std::setw(12) << result.m_cpuTimeMs << std::setw(14) << result.m_frameTimeMs << std::endl;
+            }
+        }
+        std::cout << "    (ラスタ・判定はカメラが動いたフレームでのみ発生し、CPU(ms) は静止フレームの描画コスト)" << std::endl;
+        std::cout << "    (参照: 同じオクルーダーをピクセルごとの深度バッファーに描いた場合の遮蔽率、見逃し: そのうち描画に残した割合)" << std::endl;
+
+        culler.setValidationEnabled(false);
+        renderer.setOcclusionCullingEnabled(true);
+        renderer.cleanupGLTFResources();
+        return true;
+    }
+
+    // 8分木状のノード階層の各ノードに translation/rotation/scale のチャンネルを持たせたアニメーションを作成
+    // 補間方法はチャンネルごとに LINEAR / STEP / CUBICSPLINE を順に割り当てる
+    void createAnimatedScene(int channelCount, int keyCount, tinygltf::Model& model) {
+        model = tinygltf::Model();
+        model.asset.version = "2.0";
+        model.asset.generator = "gltfViewer Benchmark";
+        const int mesh = appendCubeMesh(model);
+
+        std::vector<float> times(keyCount);
+        for (int k = 0; k < keyCount; ++k) {
+            times[k] = k / 30.0f;
+        }
+        const int timeView = appendBufferView(model, times.data(), times.size() * sizeof(float), 0);
+        const int timeAccessor = appendAccessor(model, timeView, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_SCALAR, keyCount);
+
+        const char* const interpolations[] = { "LINEAR", "STEP", "CUBICSPLINE" };
+        const char* const paths[] = { "translation", "rotation", "scale" };
+        std::mt19937 random(777);
+        std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+        const int nodeCount = std::max(1, (channelCount + 2) / 3);
+        tinygltf::Animation animation;
+        animation.name = "BenchmarkAnimation";
+        model.nodes.resize(nodeCount);
+        for (int node = 0; node < nodeCount; ++node) {
+            model.nodes[node].mesh = mesh;
+            if (node > 0) {
+                model.nodes[(node - 1) / 8].children.push_back(node);
+            }
+
+            for (int path = 0; path < 3 && static_cast<int>(animation.channels.size()) < channelCount; ++path) {
+                const int interpolation = (node + path) % 3;
+                const int components = path == 1 ? 4 : 3;
+                const int valuesPerKey = interpolation == 2 ? 3 : 1;
+
+                std::vector<float> values;
+                values.reserve(static_cast<size_t>(keyCount) * valuesPerKey * components);
+                for (int k = 0; k < keyCount * valuesPerKey; ++k) {
+                    float key[4] = { value(random), value(random), value(random), value(random) };
+                    if (path == 1) {
+                        const float length = std::sqrt(key[0] * key[0] + key[1] * key[1] + key[2] * key[2] + key[3] * key[3]);
+                        for (float& c : key) {
+                            c /= length;
+                        }
+                    } else if (path == 2) {
+                        for (float& c : key) {
+                            c = 1.0f + 0.25f * c;
+                        }
+                    }
+                    values.insert(values.end(), key, key + components);
+                }
+                const int valueView = appendBufferView(model, values.data(), values.size() * sizeof(float), 0);
+                const int valueAccessor = appendAccessor(model, valueView, TINYGLTF_COMPONENT_TYPE_FLOAT,
+                    components == 4 ? TINYGLTF_TYPE_VEC4 : TINYGLTF_TYPE_VEC3, static_cast<size_t>(keyCount) * valuesPerKey);
+
+                tinygltf::AnimationSampler sampler;
+                sampler.input = timeAccessor;
+                sampler.output = valueAccessor;
+                sampler.interpolation = interpolations[interpolation];
+                animation.samplers.push_back(sampler);
+
+                tinygltf::AnimationChannel channel;
+                channel.sampler = static_cast<int>(animation.samplers.size()) - 1;
+                channel.target_node = node;
+                channel.target_path = paths[path];
+                animation.channels.push_back(channel);
+            }
+        }
+        model.animations.push_back(animation);
+
+        tinygltf::Scene scene;
+        scene.nodes.push_back(0);
+        model.scenes.push_back(scene);
+        model.defaultScene = 0;
+    }
+
+    // チャンネル評価・シーングラフへの書き込み・ワールド行列の更新を 60fps 相当の時間送りで計測（GLを使わない）
+    bool runAnimation(int channelCount) {
+        const int keyCount = 64;
+        const int frameCount = 120;
+        std::vector<int> counts;
+        if (channelCount > 0) {
+            counts.push_back(channelCount);
+        } else {
+            counts = { 10000, 100000 };
+        }
+
+        struct Mode {
+            const char* m_name;
+            bool m_parallel;
+            bool m_keyCache;
+            QuaternionInterpolation m_quaternion;
+        };
+        const Mode modes[] = {
+            { "並列・キャッシュ・slerp", true, true, QuaternionInterpolation::Slerp },
+            { "単一スレッド", false, true, QuaternionInterpolation::Slerp },
+            { "キャッシュなし", true, false, QuaternionInterpolation::Slerp },
+            { "nlerp", true, true, QuaternionInterpolation::Nlerp },
+        };
+
+        std::cout << "=== アニメーションベンチマーク (キーフレーム数: " << keyCount << ", フレーム数: " << frameCount
+            << ", ワーカースレッド数: " << ThreadPool::getInstance().getThreadCount() << ") ===" << std::endl;
+        std::cout << std::left << std::setw(10) << "チャンネル" << " " << std::setw(26) << "モード"
+            << std::right << std::setw(12) << "評価(ms)" << std::setw(12) << "書込(ms)" << std::setw(14) << "ワールド(ms)"
+            << std::setw(14) << "キャッシュ(%)" << std::endl;
+
+        for (int count : counts) {
+            tinygltf::Model model;
+            createAnimatedScene(count, keyCount, model);
+
+            SceneGraph sceneGraph;
+            sceneGraph.build(model);
+            AnimationPlayer player;
+            player.build(model, sceneGraph);
+
+            for (const Mode& mode : modes) {
+                player.setParallel(mode.m_parallel);
+                player.setKeyCacheEnabled(mode.m_keyCache);
+                player.setQuaternionInterpolation(mode.m_quaternion);
+                player.setTime(0.0f);
+
+                double evaluateMs = 0.0;
+                double applyMs = 0.0;
+                double worldMs = 0.0;
+                size_t cacheHits = 0;
+                size_t channels = 0;
+                for (int frame = 0; frame < frameCount; ++frame) {
+                    player.update(1.0f / 60.0f, sceneGraph);
+                    const AnimationStats& stats = player.getLastStats();
+                    evaluateMs += stats.m_evaluateTimeMs;
+                    applyMs += stats.m_applyTimeMs;
+                    cacheHits += stats.m_cacheHits;
+                    channels += stats.m_channels;
+
+                    const auto start = std::chrono::high_resolution_clock::now();
+                    sceneGraph.updateWorldTransforms();
+                    worldMs += elapsedMs(start);
+                }
+
+                std::cout << std::left << std::setw(10) << player.getChannelCount() << " " << std::setw(26) << mode.m_name
+                    << std::right << std::fixed << std::setprecision(3)
+                    << std::setw(12) << evaluateMs / frameCount << std::setw(12) << applyMs / frameCount
+                    << std::setw(14) << worldMs / frameCount
+                    << std::setprecision(1) << std::setw(14) << (channels > 0 ? 100.0 * cacheHits / channels : 0.0) << std::endl;
+            }
+        }
+        return true;
+    }
+
+    // 関節の鎖に沿って曲がる筒状のスキンメッシュを持つキャラクターを characterCount 体並べたシーンを作成
+    // メッシュと逆バインド行列は共有し、キャラクターごとに関節ノードとスキンを持つ
+    // 各関節は位相の異なる4つのサンプラーのいずれかで Z 軸まわりに揺れる
+    void createSkinnedScene(int characterCount, int jointCount, tinygltf::Model& model) {
+        model = tinygltf::Model();
+        model.asset.version = "2.0";
+        model.asset.generator = "gltfViewer Benchmark";
+
+        // 筒: 関節ごとに1リング（先端に1リング追加）、リング上の頂点は隣接する2関節に半分ずつ重み付け
+        const int ringSegments = 16;
+        const int ringCount = jointCount + 1;
+        const float pi = 3.14159265f;
+        std::vector<float> positions;
+        std::vector<unsigned short> joints;
+        std::vector<float> weights;
+        for (int ring = 0; ring < ringCount; ++ring) {
+            const int lower = std::max(0, ring - 1);
+            const int upper = std::min(ring, jointCount - 1);
+            for (int segment = 0; segment < ringSegments; ++segment) {
+                const float angle = 2.0f * pi * segment / ringSegments;
+                positions.insert(positions.end(), { 0.3f * std::cos(angle), static_cast<float>(ring), 0.3f * std::sin(angle) });
+                joints.insert(joints.end(), { static_cast<unsigned short>(lower), static_cast<unsigned short>(upper), 0, 0 });
+                if (lower == upper) {
+                    weights.insert(weights.end(), { 1.0f, 0.0f, 0.0f, 0.0f });
+                } else {
+                    weights.insert(weights.end(), { 0.5f, 0.5f, 0.0f, 0.0f });
+                }
+            }
+        }
+        std::vector<unsigned int> indices;
+        for (int ring = 0; ring + 1 < ringCount; ++ring) {
+            for (int segment = 0; segment < ringSegments; ++segment) {
+                const unsigned int a = ring * ringSegments + segment;
+                const unsigned int b = ring * ringSegments + (segment + 1) % ringSegments;
+                indices.insert(indices.end(), { a, a + ringSegments, b, b, a + ringSegments, b + ringSegments });
+            }
+        }
+
+        const size_t vertexCount = positions.size() / 3;
+        const int positionAccessor = appendAccessor(model,
+            appendBufferView(model, positions.data(), positions.size() * sizeof(float), TINYGLTF_TARGET_ARRAY_BUFFER),
+            TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, vertexCount);
+        model.accessors[positionAccessor].minValues = { -0.3, 0.0, -0.3 };
+        model.accessors[positionAccessor].maxValues = { 0.3, static_cast<double>(jointCount), 0.3 };
+        const int jointAccessor = appendAccessor(model,
+            appendBufferView(model, joints.data(), joints.size() * sizeof(unsigned short), TINYGLTF_TARGET_ARRAY_BUFFER),
+            TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_VEC4, vertexCount);
+        const int weightAccessor = appendAccessor(model,
+            appendBufferView(model, weights.data(), weights.size() * sizeof(float), TINYGLTF_TARGET_ARRAY_BUFFER),
+            TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, vertexCount);
+        const int indexAccessor = appendAccessor(model,
+            appendBufferView(model, indices.data(), indices.size() * sizeof(unsigned int), TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER),
+            TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, indices.size());
+
+        tinygltf::Material material;
+        material.pbrMetallicRoughness.baseColorFactor = { 0.4, 0.7, 0.9, 1.0 };
+        model.materials.push_back(material);
+
+        tinygltf::Primitive primitive;
+        primitive.attributes["POSITION"] = positionAccessor;
+        primitive.attributes["JOINTS_0"] = jointAccessor;
+        primitive.attributes["WEIGHTS_0"] = weightAccessor;
+        primitive.indices = indexAccessor;
+        primitive.material = 0;
+        primitive.mode = TINYGLTF_MODE_TRIANGLES;
+        tinygltf::Mesh mesh;
+        mesh.name = "BenchmarkTube";
+        mesh.primitives.push_back(primitive);
+        model.meshes.push_back(mesh);
+
+        // 関節 k のバインド姿勢は y = k なので逆バインド行列は (0, -k, 0) の平行移動
+        std::vector<float> inverseBind(static_cast<size_t>(jointCount) * 16, 0.0f);
+        for (int joint = 0; joint < jointCount; ++joint) {
+            float* matrix = &inverseBind[joint * 16];
+            matrix[0] = matrix[5] = matrix[10] = matrix[15] = 1.0f;
+            matrix[13] = -static_cast<float>(joint);
+        }
+        const int inverseBindAccessor = appendAccessor(model,
+            appendBufferView(model, inverseBind.data(), inverseBind.size() * sizeof(float), 0),
+            TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_MAT4, jointCount);
+
+        // Z 軸まわりに ±0.3 rad 揺れる回転（位相違いで4種類）
+        const int keyCount = 32;
+        std::vector<float> times(keyCount);
+        for (int k = 0; k < keyCount; ++k) {
+            times[k] = k / 15.0f;
+        }
+        const int timeAccessor = appendAccessor(model,
+            appendBufferView(model, times.data(), times.size() * sizeof(float), 0),
+            TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_SCALAR, keyCount);
+
+        tinygltf::Animation animation;
+        animation.name = "BenchmarkSway";
+        const int samplerCount = 4;
+        for (int phase = 0; phase < samplerCount; ++phase) {
+            std::vector<float> rotations;
+            for (int k = 0; k < keyCount; ++k) {
+                const float angle = 0.3f * std::sin(2.0f * pi * (static_cast<float>(k) / (keyCount - 1) + 0.25f * phase));
+                rotations.insert(rotations.end(), { 0.0f, 0.0f, std::sin(angle * 0.5f), std::cos(angle * 0.5f) });
+            }
+            tinygltf::AnimationSampler sampler;
+            sampler.input = timeAccessor;
+            sampler.output = appendAccessor(model,
+                appendBufferView(model, rotations.data(), rotations.size() * sizeof(float), 0),
+                TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, keyCount);
+            sampler.interpolation = "LINEAR";
+            animation.samplers.push_back(sampler);
+        }
+
+        const std::vector<float> grid = makeGridPositions(characterCount, 3.0f);
+        const int side = std::max(1, static_cast<int>(std::ceil(std::cbrt(static_cast<double>(characterCount)))));
+        tinygltf::Scene scene;
+        model.nodes.reserve(static_cast<size_t>(characterCount) * (jointCount + 2));
+        for (int character = 0; character < characterCount; ++character) {
+            // キャラクターのルート → スキンメッシュノードと関節の鎖
+            const int root = static_cast<int>(model.nodes.size());
+            tinygltf::Node rootNode;
+            rootNode.translation = { grid[character * 3 + 0], grid[character * 3 + 2] * jointCount / (side * 3.0), grid[character * 3 + 1] };
+            model.nodes.push_back(rootNode);
+            scene.nodes.push_back(root);
+
+            tinygltf::Skin skin;
+            for (int joint = 0; joint < jointCount; ++joint) {
+                const int node = static_cast<int>(model.nodes.size());
+                tinygltf::Node jointNode;
+                if (joint > 0) {
+                    jointNode.translation = { 0.0, 1.0, 0.0 };
+                }
+                model.nodes.push_back(jointNode);
+                model.nodes[joint == 0 ? root : node - 1].children.push_back(node);
+                skin.joints.push_back(node);
+
+                tinygltf::AnimationChannel channel;
+                channel.sampler = (character + joint) % samplerCount;
+                channel.target_node = node;
+                channel.target_path = "rotation";
+                animation.channels.push_back(channel);
+            }
+            skin.skeleton = skin.joints[0];
+            skin.inverseBindMatrices = inverseBindAccessor;
+            model.skins.push_back(skin);
+
+            tinygltf::Node meshNode;
+            meshNode.mesh = 0;
+            meshNode.skin = static_cast<int>(model.skins.size()) - 1;
+            model.nodes.push_back(meshNode);
+            model.nodes[root].children.push_back(static_cast<int>(model.nodes.size()) - 1);
+        }
+        model.animations.push_back(animation);
+        model.scenes.push_back(scene);
+        model.defaultScene = 0;
+    }
+
+    // 関節パレットの計算とCPUスキニングを単一スレッド・並列で比較し、レンダラーでのGPUスキニングを計測
+    bool runSkinning(int characterCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int jointCount = 32;
+        const int iterations = 20;
+
+        tinygltf::Model model;
+        createSkinnedScene(characterCount, jointCount, model);
+
+        SceneGraph sceneGraph;
+        sceneGraph.build(model);
+        AnimationPlayer player;
+        player.build(model, sceneGraph);
+        SkinningSystem skinning;
+        skinning.build(model, sceneGraph);
+
+        SkinnedVertices vertices;
+        if (!SkinningSystem::readSkinnedVertices(model, model.meshes[0].primitives[0], vertices)) {
+            std::cerr << "エラー: ベンチマーク用スキンメッシュの読み込みに失敗しました" << std::endl;
+            return false;
+        }
+        const size_t skinCount = skinning.getSkinCount();
+        const size_t totalVertices = vertices.getVertexCount() * skinCount;
+
+        std::cout << "=== スキニングベンチマーク (キャラクター数: " << characterCount << ", 関節数: " << skinning.getJointCount()
+            << ", スキン頂点数: " << totalVertices << ", ワーカースレッド数: " << ThreadPool::getInstance().getThreadCount() << ") ===" << std::endl;
+        std::cout << std::left << std::setw(16) << "モード" << std::right << std::setw(14) << "パレット(ms)"
+            << std::setw(16) << "CPUスキン(ms)" << std::setw(14) << "AABB(ms)" << std::setw(16) << "頂点/秒(M)" << std::endl;
+
+        std::vector<std::vector<float>> skinnedPositions(skinCount);
+        std::vector<BoundingBox> skinBounds(skinCount);
+        const bool modes[] = { false, true };
+        for (bool parallel : modes) {
+            skinning.setParallel(parallel);
+            double paletteMs = 0.0;
+            double skinMs = 0.0;
+            double boundsMs = 0.0;
+            for (int iteration = 0; iteration < iterations; ++iteration) {
+                player.update(1.0f / 60.0f, sceneGraph);
+                sceneGraph.updateWorldTransforms();
+
+                skinning.updatePalettes(sceneGraph);
+                paletteMs += skinning.getLastStats().m_paletteTimeMs;
+
+                // キャラクター単位で分割（1体の頂点数は少ないため頂点単位より効率が良い）
+                auto skinRange = [&](size_t begin, size_t end) {
+                    for (size_t skin = begin; skin < end; ++skin) {
+                        const int offset = skinning.getPaletteOffset(static_cast<int>(skin));
+                        SkinningSystem::skinPositions(vertices, &skinning.getPalette()[offset],
+                            skinning.getPaletteSize(static_cast<int>(skin)), skinnedPositions[skin], false);
+                    }
+                };
+                auto start = std::chrono::high_resolution_clock::now();
+                if (parallel) {
+                    ThreadPool::getInstance().parallelFor(skinCount, 16, skinRange);
+                } else {
+                    skinRange(0, skinCount);
+                }
+                skinMs += elapsedMs(start);
+
+                start = std::chrono::high_resolution_clock::now();
+                for (size_t skin = 0; skin < skinCount; ++skin) {
+                    skinBounds[skin] = skinning.computeSkinBounds(static_cast<int>(skin));
+                }
+                boundsMs += elapsedMs(start);
+            }
+            skinMs /= iterations;
+            std::cout << std::left << std::setw(16) << (parallel ? "並列" : "単一スレッド") << std::right
+                << std::fixed << std::setprecision(3) << std::setw(14) << paletteMs / iterations << std::setw(16) << skinMs
+                << std::setw(14) << boundsMs / iterations
+                << std::setprecision(1) << std::setw(16) << (skinMs > 0.0 ? totalVertices / (skinMs * 1000.0) : 0.0) << std::endl;
+        }
+        skinning.setParallel(true);
+
+        // 関節ごとのAABBから求めた境界がCPUスキニングの結果を包んでいるかを確認
+        size_t outside = 0;
+        for (size_t skin = 0; skin < skinCount; ++skin) {
+            const std::vector<float>& positions = skinnedPositions[skin];
+            const BoundingBox& bounds = skinBounds[skin];
+            for (size_t v = 0; v < positions.size(); v += 3) {
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (positions[v + axis] < bounds.m_min[axis] - 1e-3f || positions[v + axis] > bounds.m_max[axis] + 1e-3f) {
+                        ++outside;
+                        break;
+                    }
+                }
+            }
+        }
+        std::cout << "    AABB外の頂点数: " << outside << std::endl;
+
+        // GPUスキニング（パレットはテクスチャバッファー、同じメッシュのキャラクターは1回のインスタンス描画）
+        if (!renderer.loadGLTFModel(model)) {
+            std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+            return false;
+        }
+        fitCamera(renderer, camera);
+
+        const int frameCount = 60;
+        const bool instancingModes[] = { true, false };
+        for (bool instancing : instancingModes) {
+            renderer.setInstancingEnabled(instancing);
+            FrameResult result = measureFrames(renderer, frameCount);
+            const RenderStats& stats = renderer.getRenderStats();
+            std::cout << "  GPUスキニング (" << (instancing ? "インスタンス描画" : "個別描画") << "): ドローコール " << result.m_drawCalls
+                << ", パレット " << std::fixed << std::setprecision(3) << stats.m_skinning.m_paletteTimeMs << " ms"
+                << ", CPU " << result.m_cpuTimeMs << " ms, フレーム " << result.m_frameTimeMs << " ms" << std::endl;
+            std::cout << "    動的データのリング転送: " << stats.m_upload.m_bytesUploaded << " バイト/フレーム (確保 " << stats.m_upload.m_allocations
+                << " 回, 溢れ " << stats.m_upload.m_overflows << " 回, フェンス待ち " << stats.m_upload.m_stalls << " 回 "
+                << stats.m_upload.m_stallTimeMs << " ms)" << std::endl;
+        }
+
+        renderer.setInstancingEnabled(true);
+        renderer.cleanupGLTFResources();
+        return true;
+    }
+
+    // 格子状の面（顔を想定）に、それぞれ一部の領域だけを動かす targetCount 個のモーフターゲットを持たせたシーンを作成
+    // 差分は密なアクセサーで格納し（読み込み時に疎な形式へ変換される）、nodeCount 個のノードが同じメッシュを参照する
+    void createMorphScene(int nodeCount, int targetCount, int gridSize, tinygltf::Model& model,
+        std::vector<float>& positions, std::vector<std::vector<float>>& denseDeltas)
+    {
+        model = tinygltf::Model();
+        model.asset.version = "2.0";
+        model.asset.generator = "gltfViewer Benchmark";
+
+        const int vertexCount = gridSize * gridSize;
+        positions.clear();
+        positions.reserve(static_cast<size_t>(vertexCount) * 3);
+        for (int y = 0; y < gridSize; ++y) {
+            for (int x = 0; x < gridSize; ++x) {
+                positions.insert(positions.end(), { static_cast<float>(x) / (gridSize - 1), static_cast<float>(y) / (gridSize - 1), 0.0f });
+            }
+        }
+        std::vector<unsigned int> indices;
+        for (int y = 0; y + 1 < gridSize; ++y) {
+            for (int x = 0; x + 1 < gridSize; ++x) {
+                const unsigned int a = y * gridSize + x;
+                indices.insert(indices.end(), { a, a + 1, a + gridSize, a + 1, a + gridSize + 1, a + gridSize });
+            }
+        }
+
+        tinygltf::Primitive primitive;
+        primitive.attributes["POSITION"] = appendAccessor(model,
+            appendBufferView(model, positions.data(), positions.size() * sizeof(float), TINYGLTF_TARGET_ARRAY_BUFFER),
+            TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, vertexCount);
+        model.accessors.back().minValues = { 0.0, 0.0, 0.0 };
+        model.accessors.back().maxValues = { 1.0, 1.0, 0.0 };
+        primitive.indices = appendAccessor(model,
+            appendBufferView(model, indices.data(), indices.size() * sizeof(unsigned int), TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER),
+            TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, indices.size());
+        primitive.mode = TINYGLTF_MODE_TRIANGLES;
+
+        tinygltf::Material material;
+        material.pbrMetallicRoughness.baseColorFactor = { 0.9, 0.7, 0.6, 1.0 };
+        model.materials.push_back(material);
+        primitive.material = 0;
+
+        // 各ターゲットは半径 0.1 の円内の頂点だけを Z 方向に膨らませる（全頂点の約3%）
+        std::mt19937 random(4242);
+        std::uniform_real_distribution<float> center(0.1f, 0.9f);
+        denseDeltas.assign(targetCount, std::vector<float>(static_cast<size_t>(vertexCount) * 3, 0.0f));
+        for (int target = 0; target < targetCount; ++target) {
+            const float cx = center(random);
+            const float cy = center(random);
+            std::vector<float>& deltas = denseDeltas[target];
+            for (int vertex = 0; vertex < vertexCount; ++vertex) {
+                const float dx = positions[vertex * 3 + 0] - cx;
+                const float dy = positions[vertex * 3 + 1] - cy;
+                const float distance = std::sqrt(dx * dx + dy * dy);
+                if (distance < 0.1f) {
+                    deltas[vertex * 3 + 0] = 0.02f * dx;
+                    deltas[vertex * 3 + 1] = 0.02f * dy;
+                    deltas[vertex * 3 + 2] = 0.05f * (1.0f - distance / 0.1f);
+                }
+            }
+
+            std::map<std::string, int> morphTarget;
+            morphTarget["POSITION"] = appendAccessor(model,
+                appendBufferView(model, deltas.data(), deltas.size() * sizeof(float), TINYGLTF_TARGET_ARRAY_BUFFER),
+                TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, vertexCount);
+            primitive.targets.push_back(morphTarget);
+        }
+
+        tinygltf::Mesh mesh;
+        mesh.name = "BenchmarkMorphGrid";
+        mesh.primitives.push_back(primitive);
+        mesh.weights.assign(targetCount, 0.0);
+        model.meshes.push_back(mesh);
+
+        const std::vector<float> grid = makeGridPositions(nodeCount, 1.5f);
+        tinygltf::Scene scene;
+        for (int i = 0; i < nodeCount; ++i) {
+            tinygltf::Node node;
+            node.mesh = 0;
+            node.translation = { grid[i * 3 + 0], grid[i * 3 + 1], grid[i * 3 + 2] };
+            model.nodes.push_back(node);
+            scene.nodes.push_back(i);
+        }
+        model.scenes.push_back(scene);
+        model.defaultScene = 0;
+    }
+
+    // 全ノードの先頭 activeCount 個のターゲットに 0 でないウェイトを設定（フレームごとに値を変えて再計算させる）
+    void setActiveMorphWeights(SceneGraph& sceneGraph, int activeCount, int frame) {
+        for (size_t node = 0; node < sceneGraph.getNodeCount(); ++node) {
+            const int weightCount = sceneGraph.getMorphWeightCount(static_cast<int>(node));
+            std::vector<float> weights(weightCount, 0.0f);
+            for (int target = 0; target < std::min(activeCount, weightCount); ++target) {
+                weights[target] = 0.5f + 0.5f * std::sin(0.1f * frame + 0.3f * target + 0.7f * node);
+            }
+            sceneGraph.setMorphWeights(static_cast<int>(node), 0, weights.data(), weightCount);
+        }
+    }
+
+    // 疎な差分の加算（単一スレッド・並列）と、全頂点を走査する密な加算を有効ターゲット数ごとに比較
+    bool runMorph(int nodeCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int targetCount = 100;
+        const int gridSize = 100;
+        const int iterations = 20;
+
+        tinygltf::Model model;
+        std::vector<float> basePositions;
+        std::vector<std::vector<float>> denseDeltas;
+        createMorphScene(nodeCount, targetCount, gridSize, model, basePositions, denseDeltas);
+
+        SceneGraph sceneGraph;
+        sceneGraph.build(model);
+        MorphTargetSystem morphTargets;
+        morphTargets.build(model, sceneGraph);
+        morphTargets.update(sceneGraph);
+
+        const int vertexCount = gridSize * gridSize;
+        std::cout << "=== モーフターゲットベンチマーク (ノード数: " << nodeCount << ", 頂点数: " << vertexCount
+            << ", ターゲット数: " << targetCount << ", 差分: " << morphTargets.getDeltaCount() << " / " << vertexCount * targetCount
+            << ", ワーカースレッド数: " << ThreadPool::getInstance().getThreadCount() << ") ===" << std::endl;
+        std::cout << std::left << std::setw(12) << "有効数" << std::right << std::setw(14) << "疎・並列(ms)" << std::setw(14) << "疎・単一(ms)"
+            << std::setw(14) << "密・単一(ms)" << std::setw(14) << "加算差分数" << std::setw(10) << "速度比" << std::endl;
+
+        std::vector<float> densePositions(basePositions.size());
+        const int activeCounts[] = { 0, 10, 100 };
+        int frame = 0;
+        for (int activeCount : activeCounts) {
+            double sparseParallelMs = 0.0;
+            double sparseSerialMs = 0.0;
+            double denseMs = 0.0;
+            size_t appliedDeltas = 0;
+
+            for (int iteration = 0; iteration < iterations; ++iteration) {
+                morphTargets.setParallel(true);
+                setActiveMorphWeights(sceneGraph, activeCount, ++frame);
+                morphTargets.update(sceneGraph);
+                sparseParallelMs += morphTargets.getLastStats().m_timeMs;
+                appliedDeltas = morphTargets.getLastStats().m_appliedDeltas;
+
+                morphTargets.setParallel(false);
+                setActiveMorphWeights(sceneGraph, activeCount, ++frame);
+                morphTargets.update(sceneGraph);
+                sparseSerialMs += morphTargets.getLastStats().m_timeMs;
+
+                // 比較用: ウェイトが 0 でないターゲットについて全頂点の差分を加算
+                const auto start = std::chrono::high_resolution_clock::now();
+                for (int node = 0; node < nodeCount; ++node) {
+                    const float* weights = sceneGraph.getMorphWeights(node);
+                    std::memcpy(densePositions.data(), basePositions.data(), basePositions.size() * sizeof(float));
+                    for (int target = 0; target < targetCount; ++target) {
+                        if (weights[target] == 0.0f) {
+                            continue;
+                        }
+                        const std::vector<float>& deltas = denseDeltas[target];
+                        for (size_t i = 0; i < densePositions.size(); ++i) {
+                            densePositions[i] += weights[target] * deltas[i];
+                        }
+                    }
+                }
+                denseMs += elapsedMs(start);
+            }
+
+            sparseParallelMs /= iterations;
+            sparseSerialMs /= iterations;
+            denseMs /= iterations;
+            std::cout << std::left << std::setw(12) << activeCount << std::right << std::fixed << std::setprecision(3)
+                << std::setw(14) << sparseParallelMs << std::setw(14) << sparseSerialMs << std::setw(14) << denseMs
+                << std::setw(14) << appliedDeltas
+                << std::setprecision(1) << std::setw(10) << (sparseSerialMs > 0.0 ? denseMs / sparseSerialMs : 0.0) << std::endl;
+        }
+        std::cout << "    (速度比は 密・単一 / 疎・単一。有効数 0 でも基本形状のコピーは行う)" << std::endl;
+
+        // レンダラーでの描画（毎フレーム 10 個のターゲットのウェイトを変更）
+        if (!renderer.loadGLTFModel(model)) {
+            std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+            return false;
+        }
+        fitCamera(renderer, camera);
+
+        const int frameCount = 60;
+        renderer.render();
+        glFinish();
+
+        double morphMs = 0.0;
+        double cpuMs = 0.0;
+        double frameMs = 0.0;
+        for (int i = 0; i < frameCount; ++i) {
+            setActiveMorphWeights(renderer.getSceneGraph(), 10, i);
+            const auto start = std::chrono::high_resolution_clock::now();
+            renderer.render();
+            glFinish();
+            frameMs += elapsedMs(start);
+            morphMs += renderer.getRenderStats().m_morph.m_timeMs;
+            cpuMs += renderer.getRenderStats().m_cpuTimeMs;
+        }
+        std::cout << "  描画 (有効ターゲット 10): ドローコール " << renderer.getRenderStats().m_drawCalls << std::fixed << std::setprecision(3)
+            << ", モーフ " << morphMs / frameCount << " ms, CPU " << cpuMs / frameCount
+            << " ms, フレーム " << frameMs / frameCount << " ms" << std::endl;
+
+        renderer.cleanupGLTFResources();
+        return true;
+    }
+
+    // UV球のメッシュを追加してメッシュインデックスを返す（三角形数は 2 * rings * segments 程度）
+    int appendSphereMesh(tinygltf::Model& model, int rings, int segments, float radius) {
+        std::vector<float> positions;
+        positions.reserve(static_cast<size_t>(rings + 1) * (segments + 1) * 3);
+        for (int ring = 0; ring <= rings; ++ring) {
+            const float theta = 3.14159265f * ring / rings;
+            for (int segment = 0; segment <= segments; ++segment) {
+                const float phi = 2.0f * 3.14159265f * segment / segments;
+                positions.insert(positions.end(), {
+                    radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta), radius * std::sin(theta) * std::sin(phi) });
+            }
+        }
+        std::vector<unsigned int> indices;
+        indices.reserve(static_cast<size_t>(rings) * segments * 6);
+        for (int ring = 0; ring < rings; ++ring) {
+            for (int segment = 0; segment < segments; ++segment) {
+                const unsigned int a = ring * (segments + 1) + segment;
+                const unsigned int b = a + segments + 1;
+                indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+
+        tinygltf::Primitive primitive;
+        primitive.attributes["POSITION"] = appendAccessor(model,
+            appendBufferView(model, positions.data(), positions.size() * sizeof(float), TINYGLTF_TARGET_ARRAY_BUFFER),
+            TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, positions.size() / 3);
+        model.accessors.back().minValues = { -radius, -radius, -radius };
+        model.accessors.back().maxValues = { radius, radius, radius };
+        primitive.indices = appendAccessor(model,
+            appendBufferView(model, indices.data(), indices.size() * sizeof(unsigned int), TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER),
+            TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, indices.size());
+        primitive.mode = TINYGLTF_MODE_TRIANGLES;
+
+        tinygltf::Mesh mesh;
+        mesh.name = "BenchmarkSphere";
+        mesh.primitives.push_back(primitive);
+        model.meshes.push_back(mesh);
+        return static_cast<int>(model.meshes.size()) - 1;
+    }
+
+    // 異なるメッシュを持つ meshCount 個の高分割球と、それぞれを参照する instancesPerMesh 個のノードを配置したシーン
+    void createPickingScene(int meshCount, int instancesPerMesh, int rings, tinygltf::Model& model) {
+        model = tinygltf::Model();
+        model.asset.version = "2.0";
+        model.asset.generator = "gltfViewer Benchmark";
+
+        for (int mesh = 0; mesh < meshCount; ++mesh) {
+            appendSphereMesh(model, rings, rings * 2, 0.5f);
+        }
+
+        const int nodeCount = meshCount * instancesPerMesh;
+        const std::vector<float> grid = makeGridPositions(nodeCount, 1.5f);
+        tinygltf::Scene scene;
+        for (int i = 0; i < nodeCount; ++i) {
+            tinygltf::Node node;
+            node.mesh = i % meshCount;
+            node.translation = { grid[i * 3 + 0], grid[i * 3 + 1], grid[i * 3 + 2] };
+            model.nodes.push_back(node);
+            scene.nodes.push_back(i);
+        }
+        model.scenes.push_back(scene);
+        model.defaultScene = 0;
+    }
+
+    // 高分割球のシーンをソフトウェアレンダラーで 1 スレッドからハードウェアスレッド数まで描画し、スケーリングを比較（GPUは使用しない）
+    bool runSoftware(int meshCount, Camera& camera) {
+        const int instancesPerMesh = 4;
+        const int rings = 64;
+        const int width = 1920;
+        const int height = 1080;
+        const int frameCount = 10;
+
+        tinygltf::Model model;
+        createPickingScene(meshCount, instancesPerMesh, rings, model);
+
+        SoftwareRenderer renderer;
+        renderer.onResize(width, height);
+        if (!renderer.initialize() || !renderer.loadGLTFModel(model)) {
+            std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+            return false;
+        }
+        camera.setPerspective(glm::radians(45.0f), static_cast<float>(width) / height, 0.1f, 100.0f);
+        const BoundingBox& bounds = renderer.getSceneBounds();
+        const BoundingSphere& sphere = renderer.getSceneBoundingSphere();
+        camera.fitToBoundingBox(bounds.m_min, bounds.m_max);
+        camera.fitClipPlanesToSphere(sphere.m_center, sphere.m_radius);
+        renderer.updateCamera(&camera);
+
+        // 1, 2, 4, ... とハードウェアスレッド数
+        const int hardwareThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        std::vector<int> threadCounts;
+        for (int threads = 1; threads < hardwareThreads; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(hardwareThreads);
+
+        std::cout << "=== ソフトウェアレンダラーのスケーリング (メッシュ数: " << meshCount << ", インスタンス数: " << meshCount * instancesPerMesh
+            << ", " << width << "x" << height << ", フレーム数: " << frameCount << ") ===" << std::endl;
+        std::cout << std::right << std::setw(10) << "スレッド" << std::setw(14) << "フレーム(ms)" << std::setw(16) << "セットアップ(ms)"
+            << std::setw(16) << "ラスタライズ(ms)" << std::setw(12) << "M三角形/秒" << std::setw(10) << "速度比" << std::setw(10) << "効率(%)"
+            << "  画像" << std::endl;
+
+        double singleThreadMs = 0.0;
+        uint64_t referenceHash = 0;
+        bool identical = true;
+        for (int threads : threadCounts) {
+            renderer.setThreadCount(threads);
+            // ウォームアップ（ワーカーの起動とビンの確保を除外）
+            renderer.renderFrame();
+            renderer.renderFrame();
+
+            double frameMs = 0.0;
+            double setupMs = 0.0;
+            double rasterMs = 0.0;
+            for (int frame = 0; frame < frameCount; ++frame) {
+                renderer.renderFrame();
+                frameMs += renderer.getStats().m_frameMs;
+                setupMs += renderer.getStats().m_setupMs;
+                rasterMs += renderer.getStats().m_rasterMs;
+            }
+            frameMs /= frameCount;
+            setupMs /= frameCount;
+            rasterMs /= frameCount;
+
+            // スレッド数によらず同じ画像になるか（FNV-1a）
+            ReadbackImage image;
+            renderer.readPixels(image);
+            const uint64_t hash = hashPixels(image.m_pixels);
+            if (threads == threadCounts.front()) {
+                singleThreadMs = frameMs;
+                referenceHash = hash;
+            }
+            const bool matches = hash == referenceHash;
+            identical = identical && matches;
+
+            const double speedup = frameMs > 0.0 ? singleThreadMs / frameMs : 0.0;
+            std::cout << std::setw(10) << threads << std::fixed << std::setprecision(3) << std::setw(14) << frameMs
+                << std::setw(16) << setupMs << std::setw(16) << rasterMs
+                << std::setw(12) << std::setprecision(1) << (frameMs > 0.0 ? renderer.getStats().m_triangles / frameMs / 1000.0 : 0.0)
+                << std::setw(10) << std::setprecision(2) << speedup << std::setw(10) << std::setprecision(1) << speedup / threads * 100.0
+                << "  " << (matches ? "一致" : "不一致") << std::endl;
+        }
+
+        const SoftwareRenderStats& stats = renderer.getStats();
+        std::cout << "  三角形: " << stats.m_triangles << " (ビニング " << stats.m_rasterTriangles << ", タイル登録 " << stats.m_binEntries
+            << "), 視錐台内インスタンス: " << stats.m_instances << std::endl;
+        if (!identical) {
+            std::cerr << "エラー: スレッド数によって描画結果が異なります" << std::endl;
+        }
+        return identical;
+    }
+
+    // スクリーン上の格子点を通るレイでピッキングし、レイごとの処理時間と総当たりとの一致を調べる
+    // BVH・スラブ判定・三角形との交差だけを使うCPUの計測なので、OpenGLコンテキストを作らずに実行する
+    bool runPicking(int meshCount, Camera& camera) {
+        const int instancesPerMesh = 4;
+        const int rings = 128;
+        const int viewportWidth = kViewportWidth;
+        const int viewportHeight = kViewportHeight;
+        const int raysX = 64;
+        const int raysY = 48;
+        const int verifyStride = 64;   // 総当たりとの比較はこの間隔のレイだけ行う
+
+        tinygltf::Model model;
+        createPickingScene(meshCount, instancesPerMesh, rings, model);
+
+        SceneGraph sceneGraph;
+        sceneGraph.build(model);
+        InstanceBatcher instanceBatcher;
+        instanceBatcher.build(model, sceneGraph);
+
+        Picker picker;
+        picker.build(model);
+
+        // インスタンスのAABBに対するシーンBVH（レンダラーと同じ構成）
+        const BoundingBox sphereBounds(glm::vec3(-0.5f), glm::vec3(0.5f));
+        const std::vector<glm::mat4>& instanceMatrices = instanceBatcher.getInstanceMatrices();
+        std::vector<BoundingBox> instanceBounds(instanceMatrices.size());
+        BoundingBox sceneBounds;
+        for (size_t instance = 0; instance < instanceMatrices.size(); ++instance) {
+            instanceBounds[instance] = BoundingVolume::transform(sphereBounds, instanceMatrices[instance]);
+            sceneBounds.expand(instanceBounds[instance]);
+        }
+        SceneBVH sceneBVH;
+        sceneBVH.build(instanceBounds);
+
+        camera.setPerspective(glm::radians(45.0f), static_cast<float>(viewportWidth) / viewportHeight, 0.1f, 100.0f);
+        camera.fitToBoundingBox(sceneBounds.m_min, sceneBounds.m_max);
+
+        std::cout << "=== ピッキングベンチマーク (メッシュ数: " << meshCount << ", インスタンス数: " << instanceMatrices.size()
+            << ", 三角形: " << picker.getTriangleCount() << " (インスタンス込み: " << picker.getTriangleCount() * instancesPerMesh
+            << "), レイ数: " << raysX * raysY << ") ===" << std::endl;
+        std::cout << std::fixed << std::setprecision(3) << "  BVH構築: " << picker.getBuildTimeMs() << " ms, メモリ: "
+            << picker.getMemoryBytes() / (1024 * 1024) << " MB" << std::endl;
+
+        std::vector<double> latencies;
+        latencies.reserve(raysX * raysY);
+        size_t hitCount = 0;
+        size_t verified = 0;
+        size_t matched = 0;
+        double bruteForceMs = 0.0;
+        for (int y = 0; y < raysY; ++y) {
+            for (int x = 0; x < raysX; ++x) {
+                const float screenX = (x + 0.5f) * viewportWidth / raysX;
+                const float screenY = (y + 0.5f) * viewportHeight / raysY;
+                const Ray ray = camera.screenPointToRay(screenX, screenY, viewportWidth, viewportHeight);
+
+                PickResult result;
+                const auto start = std::chrono::high_resolution_clock::now();
+                const bool hit = picker.pick(ray, sceneBVH, instanceBatcher, sceneGraph, result);
+                latencies.push_back(elapsedMs(start));
+                if (hit) {
+                    ++hitCount;
+                }
+
+                if (latencies.size() % verifyStride != 0) {
+                    continue;
+                }
+                PickResult reference;
+                const auto bruteForceStart = std::chrono::high_resolution_clock::now();
+                const bool referenceHit = picker.pickBruteForce(ray, instanceBatcher, sceneGraph, reference);
+                bruteForceMs += elapsedMs(bruteForceStart);
+
+                // 辺上でのヒットは隣接する三角形のどちらになるかが異なりうるため、距離で比較する
+                ++verified;
+                if (hit == referenceHit &&
+                    (!hit || (result.m_instance == reference.m_instance &&
+                        std::abs(result.m_distance - reference.m_distance) <= 1e-4f * std::max(1.0f, reference.m_distance)))) {
+                    ++matched;
+                }
+            }
+        }
+
+        std::vector<double> sorted = latencies;
+        std::sort(sorted.begin(), sorted.end());
+        double totalMs = 0.0;
+        for (double latency : latencies) {
+            totalMs += latency;
+        }
+        std::cout << "  ヒット: " << hitCount << " / " << latencies.size()
+            << ", 平均 " << totalMs / latencies.size() << " ms, 中央値 " << sorted[sorted.size() / 2]
+            << " ms, 99% " << sorted[sorted.size() * 99 / 100] << " ms, 最大 " << sorted.back() << " ms" << std::endl;
+        std::cout << "  総当たりとの一致: " << matched << " / " << verified
+            << " (総当たり平均 " << (verified > 0 ? bruteForceMs / verified : 0.0) << " ms)" << std::endl;
+        return matched == verified;
+    }
+
+    // 球のグリッドをチャンクパックに変換し、予算をシーン全体より小さくしてグリッドの中を通過するカメラで描画する
+    bool runStreaming(int meshCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int instancesPerMesh = 8;
+        const int rings = 48;
+        const size_t maxTrianglesPerChunk = 8192;
+        const int frameCount = 300;
+        const int reportInterval = 50;
+        const char* packPath = "gltfViewer_streaming_benchmark.chunks";
+
+        tinygltf::Model model;
+        createPickingScene(meshCount, instancesPerMesh, rings, model);
+        if (!ChunkPack::build(model, packPath, maxTrianglesPerChunk)) {
+            return false;
+        }
+        model = tinygltf::Model();
+
+        // 予算を決めるためにチャンク表だけ開いてシーン全体のサイズを調べる
+        StreamingSettings settings;
+        {
+            std::ifstream file(packPath, std::ios::binary | std::ios::ate);
+            const size_t fileBytes = static_cast<size_t>(file.tellg());
+            settings.m_cpuBudgetBytes = fileBytes / 8;
+            settings.m_gpuBudgetBytes = fileBytes / 4;
+            settings.m_uploadBytesPerFrame = std::max<size_t>(fileBytes / 64, 1);
+        }
+        if (!renderer.openStreamingScene(packPath, settings)) {
+            std::remove(packPath);
+            return false;
+        }
+
+        const BoundingBox& bounds = renderer.getSceneBounds();
+        const glm::vec3 center = bounds.getCenter();
+        const float extent = glm::length(bounds.getSize());
+        camera.setPerspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, extent * 2.0f);
+
+        std::cout << "=== ストリーミングベンチマーク (チャンク数: " << renderer.getStreamer().getChunkCount()
+            << ", CPU予算: " << settings.m_cpuBudgetBytes / 1024 << " KB, GPU予算: " << settings.m_gpuBudgetBytes / 1024
+            << " KB, フレーム数: " << frameCount << ") ===" << std::endl;
+        std::cout << "  フレーム | 描画チャンク | GPU常駐 | 読み込み待ち |  CPU KB  |  GPU KB  | update ms" << std::endl;
+
+        // シーンの外側から中心を抜けて奥へ移動しながら、視線を進行方向の周りで振る
+        size_t cpuPeakBytes = 0;
+        size_t gpuPeakBytes = 0;
+        double updateTotalMs = 0.0;
+        double frameTotalMs = 0.0;
+        for (int frame = 0; frame < frameCount; ++frame) {
+            const float t = static_cast<float>(frame) / (frameCount - 1);
+            const glm::vec3 position = center + glm::vec3(-0.8f + 1.1f * t, 0.1f, -0.8f + 1.1f * t) * (extent * 0.5f);
+            const float yaw = 0.785398f + 0.8f * std::sin(t * 6.2831853f * 2.0f);
+            camera.setPosition(position);
+            camera.setTarget(position + glm::vec3(std::sin(yaw), 0.0f, std::cos(yaw)));
+            renderer.updateCamera(&camera);
+
+            const auto start = std::chrono::high_resolution_clock::now();
+            renderer.render();
+            glFinish();
+            frameTotalMs += elapsedMs(start);
+
+            const StreamingStats& stats = renderer.getRenderStats().m_streaming;
+            cpuPeakBytes = std::max(cpuPeakBytes, stats.m_cpuBytes);
+            gpuPeakBytes = std::max(gpuPeakBytes, stats.m_gpuBytes);
+            updateTotalMs += stats.m_updateTimeMs;
+            if (frame % reportInterval == 0 || frame == frameCount - 1) {
+                std::cout << std::fixed << std::setprecision(3) << std::setw(10) << frame << std::setw(14) << stats.m_visibleChunks
+                    << std::setw(10) << stats.m_gpuResidentChunks << std::setw(14) << stats.m_pendingLoads
+                    << std::setw(11) << stats.m_cpuBytes / 1024 << std::setw(11) << stats.m_gpuBytes / 1024
+                    << std::setw(11) << stats.m_updateTimeMs << std::endl;
+            }
+        }
+
+        const StreamingStats stats = renderer.getStreamer().getStats();
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "  ピークメモリ: CPU " << cpuPeakBytes / 1024 << " / " << stats.m_cpuBudgetBytes / 1024
+            << " KB, GPU " << gpuPeakBytes / 1024 << " / " << stats.m_gpuBudgetBytes / 1024 << " KB" << std::endl;
+        std::cout << "  読み込み: " << stats.m_loadsCompleted << " 回 (" << stats.m_bytesRead / 1024 << " KB), 転送: " << stats.m_uploads
+            << " 回, 破棄: CPU " << stats.m_cpuEvictions << " 回, GPU " << stats.m_gpuEvictions << " 回" << std::endl;
+        std::cout << "  読み込み遅延: 平均 " << stats.m_averageLoadMs << " ms, 最大 " << stats.m_maxLoadMs
+            << " ms / 描画可能になるまで: 平均 " << stats.m_averageResidentMs << " ms, 最大 " << stats.m_maxResidentMs << " ms" << std::endl;
+        std::cout << "  update 平均 " << updateTotalMs / frameCount << " ms, フレーム平均 " << frameTotalMs / frameCount << " ms" << std::endl;
+
+        const bool withinBudget = cpuPeakBytes <= stats.m_cpuBudgetBytes && gpuPeakBytes <= stats.m_gpuBudgetBytes;
+        renderer.cleanupGLTFResources();
+        std::remove(packPath);
+        return withinBudget;
+    }
+
+    // 1x1 の四角形（XY平面）を X 方向に textureCount 個並べ、それぞれに textureSize の別のテクスチャを割り当てたシーン
+    void createTexturedScene(int textureCount, int textureSize, tinygltf::Model& model) {
+        model = tinygltf::Model();
+        model.asset.version = "2.0";
+        model.asset.generator = "gltfViewer Benchmark";
+
+        const float positions[] = { -0.5f, -0.5f, 0.0f,   0.5f, -0.5f, 0.0f,   0.5f, 0.5f, 0.0f,   -0.5f, 0.5f, 0.0f };
+        const float texcoords[] = { 0.0f, 1.0f,   1.0f, 1.0f,   1.0f, 0.0f,   0.0f, 0.0f };
+        const unsigned int indices[] = { 0, 1, 2,  0, 2, 3 };
+
+        const int positionView = appendBufferView(model, positions, sizeof(positions), TINYGLTF_TARGET_ARRAY_BUFFER);
+        const int positionAccessor = appendAccessor(model, positionView, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, 4);
+        model.accessors[positionAccessor].minValues = { -0.5, -0.5, 0.0 };
+        model.accessors[positionAccessor].maxValues = { 0.5, 0.5, 0.0 };
+        const int texcoordView = appendBufferView(model, texcoords, sizeof(texcoords), TINYGLTF_TARGET_ARRAY_BUFFER);
+        const int texcoordAccessor = appendAccessor(model, texcoordView, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, 4);
+        const int indexView = appendBufferView(model, indices, sizeof(indices), TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+        const int indexAccessor = appendAccessor(model, indexView, TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, 6);
+
+        tinygltf::Scene scene;
+        for (int i = 0; i < textureCount; ++i) {
+            // テクスチャごとに色の異なるチェッカー（ミップの違いが見て分かるよう1マス16テクセル）
+            tinygltf::Image image;
+            image.width = textureSize;
+            image.height = textureSize;
+            image.component = 4;
+            image.bits = 8;
+            image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+            image.image.resize(static_cast<size_t>(textureSize) * textureSize * 4);
+            const float hue = static_cast<float>(i) / textureCount * 6.2831853f;
+            const unsigned char color[3] = {
+                static_cast<unsigned char>(127.5f + 127.5f * std::cos(hue)),
+                static_cast<unsigned char>(127.5f + 127.5f * std::sin(hue)),
+                static_cast<unsigned char>(255.0f * i / std::max(textureCount - 1, 1))
+            };
+            for (int y = 0; y < textureSize; ++y) {
+                for (int x = 0; x < textureSize; ++x) {
+                    unsigned char* pixel = &image.image[(static_cast<size_t>(y) * textureSize + x) * 4];
+                    const bool dark = ((x / 16) + (y / 16)) % 2 == 0;
+                    for (int c = 0; c < 3; ++c) {
+                        pixel[c] = dark ? static_cast<unsigned char>(color[c] / 4) : color[c];
+                    }
+                    pixel[3] = 255;
+                }
+            }
+            model.images.push_back(std::move(image));
+
+            tinygltf::Texture texture;
+            texture.source = i;
+            model.textures.push_back(texture);
+
+            tinygltf::Material material;
+            material.pbrMetallicRoughness.baseColorFactor = { 1.0, 1.0, 1.0, 1.0 };
+            material.pbrMetallicRoughness.baseColorTexture.index = i;
+            model.materials.push_back(material);
+
+            tinygltf::Primitive primitive;
+            primitive.attributes["POSITION"] = positionAccessor;
+            primitive.attributes["TEXCOORD_0"] = texcoordAccessor;
+            primitive.indices = indexAccessor;
+            primitive.material = i;
+            primitive.mode = TINYGLTF_MODE_TRIANGLES;
+            tinygltf::Mesh mesh;
+            mesh.primitives.push_back(primitive);
+            model.meshes.push_back(mesh);
+
+            tinygltf::Node node;
+            node.mesh = i;
+            node.translation = { i * 1.5, 0.0, 0.0 };
+            model.nodes.push_back(node);
+            scene.nodes.push_back(i);
+        }
+        model.scenes.push_back(scene);
+        model.defaultScene = 0;
+    }
+
+    // 全ミップを常駐させると予算の4倍になるテクスチャの列に沿って、近づいたり離れたりしながらカメラを動かし、
+    // 常駐量・1フレームの転送量・破棄の回数を計測する
+    bool runTextures(int textureCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int textureSize = 2048;
+        const int frameCount = 240;
+        const int reportInterval = 30;
+
+        tinygltf::Model model;
+        createTexturedScene(textureCount, textureSize, model);
+
+        // 全ミップの合計はおよそ レベル0 の 4/3 倍
+        const size_t levelZeroBytes = static_cast<size_t>(textureSize) * textureSize * 4;
+        const size_t fullBytes = levelZeroBytes * textureCount * 4 / 3;
+        const TextureStreamingSettings defaultSettings = renderer.getTextureStreamer().getSettings();
+        TextureStreamingSettings settings = defaultSettings;
+        settings.m_gpuBudgetBytes = std::max(fullBytes / 4, levelZeroBytes * 2);
+        settings.m_uploadBytesPerFrame = levelZeroBytes;
+        renderer.setTextureStreamingSettings(settings);
+
+        if (!renderer.loadGLTFModel(model)) {
+            std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+            renderer.setTextureStreamingSettings(defaultSettings);
+            return false;
+        }
+        camera.setPerspective(glm::radians(45.0f), 16.0f / 9.0f, 0.05f, 100.0f);
+
+        std::cout << "=== テクスチャストリーミングベンチマーク (テクスチャ: " << textureCount << " 枚 x " << textureSize << "x" << textureSize
+            << ", 全ミップ " << fullBytes / 1024 << " KB, 予算 " << settings.m_gpuBudgetBytes / 1024 << " KB, フレーム数: " << frameCount << ") ===" << std::endl;
+        std::cout << "  フレーム |  常駐 KB  |  転送 KB  | コピー KB | 破棄 | 不足 | 作成中 | update ms" << std::endl;
+
+        // 列の端から端へ移動しながら、距離を遠く → 近く → 遠く と変える
+        size_t peakResidentBytes = 0;
+        size_t peakFrameUploadBytes = 0;
+        double updateTotalMs = 0.0;
+        double frameTotalMs = 0.0;
+        double maxFrameMs = 0.0;
+        const float rowLength = (textureCount - 1) * 1.5f;
+        for (int frame = 0; frame < frameCount; ++frame) {
+            const float t = static_cast<float>(frame) / (frameCount - 1);
+            const float distance = 0.6f + 2.4f * (0.5f + 0.5f * std::cos(t * 6.2831853f));
+            const glm::vec3 target(rowLength * t, 0.0f, 0.0f);
+            camera.setPosition(target + glm::vec3(0.0f, 0.0f, distance));
+            camera.setTarget(target);
+            renderer.updateCamera(&camera);
+
+            const auto start = std::chrono::high_resolution_clock::now();
+            renderer.render();
+            glFinish();
+            const double frameMs = elapsedMs(start);
+            frameTotalMs += frameMs;
+            maxFrameMs = std::max(maxFrameMs, frameMs);
+
+            const TextureStreamingStats& stats = renderer.getRenderStats().m_textures;
+            peakResidentBytes = std::max(peakResidentBytes, stats.m_residentBytes);
+            peakFrameUploadBytes = std::max(peakFrameUploadBytes, stats.m_frameUploadedBytes);
+            updateTotalMs += stats.m_updateTimeMs;
+            if (frame % reportInterval == 0 || frame == frameCount - 1) {
+                std::cout << std::fixed << std::setprecision(3) << std::setw(10) << frame << std::setw(12) << stats.m_residentBytes / 1024
+                    << std::setw(12) << stats.m_frameUploadedBytes / 1024 << std::setw(12) << stats.m_frameCopiedBytes / 1024
+                    << std::setw(7) << stats.m_frameEvictions << std::setw(7) << stats.m_wantedTextures
+                    << std::setw(9) << stats.m_pendingTextures << std::setw(11) << stats.m_updateTimeMs << std::endl;
+            }
+        }
+
+        const TextureStreamingStats stats = renderer.getTextureStreamer().getStats();
+        renderer.getTextureStreamer().printResidency();
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "  ピーク常駐: " << peakResidentBytes / 1024 << " / " << settings.m_gpuBudgetBytes / 1024
+            << " KB, 1フレームの最大転送: " << peakFrameUploadBytes / 1024 << " KB, 転送累計: " << stats.m_totalUploadedBytes / 1024
+            << " KB (全ミップの " << std::setprecision(1) << 100.0 * stats.m_totalUploadedBytes / fullBytes << " %), 破棄: " << stats.m_totalEvictions << " 回" << std::endl;
+        std::cout << std::setprecision(3) << "  update 平均 " << updateTotalMs / frameCount << " ms, フレーム平均 " << frameTotalMs / frameCount
+            << " ms, 最大 " << maxFrameMs << " ms" << std::endl;
+
+        const bool withinBudget = peakResidentBytes <= settings.m_gpuBudgetBytes;
+        renderer.cleanupGLTFResources();
+        renderer.setTextureStreamingSettings(defaultSettings);
+        return withinBudget;
+    }
+
+    // 画像を JPEG にエンコードし、ファイルから読み込んだ場合と同じくエンコードされたまま（as_is）にする
+    void encodeSceneImages(tinygltf::Model& model) {
+        for (tinygltf::Image& image : model.images) {
+            std::vector<unsigned char> encoded;
+            stbi_write_jpg_to_func([](void* context, void* data, int size) {
+                std::vector<unsigned char>& output = *static_cast<std::vector<unsigned char>*>(context);
+                const unsigned char* bytes = static_cast<const unsigned char*>(data);
+                output.insert(output.end(), bytes, bytes + size);
+            }, &encoded, image.width, image.height, image.component, image.image.data(), 90);
+            image.image.swap(encoded);
+            image.component = 3;
+            image.mimeType = "image/jpeg";
+            image.as_is = true;
+        }
+    }
+
+    // エンコードされた画像のテクスチャを読み込んでから全ミップが常駐するまでのフレーム時間を、
+    // PBOを経由する非同期転送と描画スレッドからの直接転送で比較する（スパイクの大きさと1フレームの転送量の上限）
+    bool runTextureUpload(int textureCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int textureSize = 2048;
+        const int maxFrames = 2000;
+
+        tinygltf::Model model;
+        createTexturedScene(textureCount, textureSize, model);
+        encodeSceneImages(model);
+
+        // 読み込み時に描画スレッドで全画像をデコードした場合に止まる時間（変更前の動作）
+        const auto decodeStart = std::chrono::high_resolution_clock::now();
+        for (const tinygltf::Image& image : model.images) {
+            int width = 0;
+            int height = 0;
+            int component = 0;
+            stbi_uc* decoded = stbi_load_from_memory(image.image.data(), static_cast<int>(image.image.size()), &width, &height, &component, 4);
+            stbi_image_free(decoded);
+        }
+        const double decodeMs = elapsedMs(decodeStart);
+
+        const size_t levelZeroBytes = static_cast<size_t>(textureSize) * textureSize * 4;
+        const size_t fullBytes = levelZeroBytes * textureCount * 4 / 3;
+        const TextureStreamingSettings defaultSettings = renderer.getTextureStreamer().getSettings();
+        // 1回の転送は最大で1枚の全ミップ（1フレームの上限を超えても最低1件は発行する）
+        const size_t frameBound = std::max(defaultSettings.m_uploadBytesPerFrame, fullBytes / textureCount);
+
+        std::cout << "=== テクスチャ転送ベンチマーク (テクスチャ: " << textureCount << " 枚 x " << textureSize << "x" << textureSize
+            << " JPEG, 全ミップ " << fullBytes / 1024 << " KB, 1フレームの上限 " << defaultSettings.m_uploadBytesPerFrame / 1024 << " KB) ===" << std::endl;
+        std::cout << std::fixed << std::setprecision(3) << "  読み込み時に全画像をデコードした場合の描画スレッドの停止: " << decodeMs << " ms" << std::endl;
+        std::cout << "  転送方法 | フレーム数 | 完了まで ms | 中央値 ms | 99% ms | 最大 ms | update最大 ms | 1フレーム最大転送 KB" << std::endl;
+
+        bool bounded = true;
+        const bool modes[] = { true, false };
+        for (bool usePixelBuffers : modes) {
+            if (usePixelBuffers && !PixelStagingPool::isSupported()) {
+                std::cout << "  PBO       | (PBO・フェンスが使えないため省略)" << std::endl;
+                continue;
+            }
+            TextureStreamingSettings settings = defaultSettings;
+            settings.m_usePixelBuffers = usePixelBuffers;
+            settings.m_gpuBudgetBytes = std::max(settings.m_gpuBudgetBytes, fullBytes);
+            settings.m_lodBias = -16.0f;    // 画面上の大きさに関わらず最も詳細なミップまで要求する
+            renderer.setTextureStreamingSettings(settings);
+
+            if (!renderer.loadGLTFModel(model)) {
+                std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+                renderer.setTextureStreamingSettings(defaultSettings);
+                return false;
+            }
+            fitCamera(renderer, camera);
+
+            std::vector<double> frameTimes;
+            size_t peakFrameUploadBytes = 0;
+            bool completed = false;
+            const auto loadStart = std::chrono::high_resolution_clock::now();
+            for (int frame = 0; frame < maxFrames && !completed; ++frame) {
+                const auto start = std::chrono::high_resolution_clock::now();
+                renderer.render();
+                glFinish();
+                frameTimes.push_back(elapsedMs(start));
+
+                const TextureStreamingStats& stats = renderer.getRenderStats().m_textures;
+                peakFrameUploadBytes = std::max(peakFrameUploadBytes, stats.m_frameUploadedBytes);
+                completed = stats.m_pendingTextures == 0 && stats.m_pendingUploads == 0 && stats.m_residentBytes >= stats.m_fullResidentBytes;
+            }
+            const double completeMs = elapsedMs(loadStart);
+            const double maxUpdateMs = renderer.getTextureStreamer().getStats().m_maxUpdateTimeMs;
+
+            std::vector<double> sorted = frameTimes;
+            std::sort(sorted.begin(), sorted.end());
+            const double medianMs = sorted[sorted.size() / 2];
+            const double p99Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+            std::cout << std::setw(10) << (usePixelBuffers ? "PBO" : "直接") << std::setw(12) << frameTimes.size()
+                << std::setw(14) << completeMs << std::setw(12) << medianMs << std::setw(10) << p99Ms << std::setw(10) << sorted.back()
+                << std::setw(15) << maxUpdateMs << std::setw(20) << peakFrameUploadBytes / 1024 << (completed ? "" : " (未完了)") << std::endl;
+
+            bounded = bounded && completed && peakFrameUploadBytes <= frameBound;
+            renderer.cleanupGLTFResources();
+        }
+
+        renderer.setTextureStreamingSettings(defaultSettings);
+        return bounded;
+    }
+
+    // primitiveCount 個の別メッシュ（同じ立方体のアクセサーを参照し、materialCount 色のマテリアルを順に割り当てる）を
+    // それぞれ1ノードで配置したシーン（インスタンス描画ではまとまらず、プリミティブごとにドローコールが必要）
+    void createManyPrimitiveScene(int primitiveCount, int materialCount, tinygltf::Model& model) {
+        model = tinygltf::Model();
+        model.asset.version = "2.0";
+        model.asset.generator = "gltfViewer Benchmark";
+
+        const int cube = appendCubeMesh(model);
+        const tinygltf::Primitive cubePrimitive = model.meshes[cube].primitives[0];
+        model.meshes.clear();
+        for (int material = 0; material < materialCount; ++material) {
+            tinygltf::Material gltfMaterial;
+            const float hue = static_cast<float>(material) / materialCount;
+            gltfMaterial.pbrMetallicRoughness.baseColorFactor = { 0.5 + 0.5 * std::cos(hue * 6.2831853), 0.5 + 0.5 * std::sin(hue * 6.2831853), 1.0 - hue, 1.0 };
+            model.materials.push_back(gltfMaterial);
+        }
+
+        const std::vector<float> positions = makeGridPositions(primitiveCount, 2.0f);
+        tinygltf::Scene scene;
+        model.meshes.reserve(primitiveCount);
+        model.nodes.reserve(primitiveCount);
+        for (int i = 0; i < primitiveCount; ++i) {
+            tinygltf::Mesh mesh;
+            mesh.primitives.push_back(cubePrimitive);
+            mesh.primitives.back().material = i % materialCount;
+            model.meshes.push_back(mesh);
+
+            tinygltf::Node node;
+            node.mesh = i;
+            node.translation = { positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2] };
+            model.nodes.push_back(node);
+            scene.nodes.push_back(i);
+        }
+        model.scenes.push_back(scene);
+        model.defaultScene = 0;
+    }
+
+    // プリミティブごとにVAOを切り替えて描画する従来のループと、共有バッファー + マルチドローの発行時間を比較
+    // オフスクリーンのFBOへ描画するので、GPUの無い環境（Mesa の llvmpipe）でも計測でき、両方の画像が一致するかも確認する
+    bool runMultiDraw(int primitiveCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int frameCount = 20;
+        const int materialCount = 8;
+
+        if (!renderer.hasMultiDraw()) {
+            std::cout << "警告: glMultiDrawElementsIndirect が使用できないため、従来のループのみ計測します" << std::endl;
+        }
+        std::cout << "=== マルチドローベンチマーク (プリミティブ数: " << primitiveCount << ", マテリアル数: " << materialCount
+            << ", フレーム数: " << frameCount << ") ===" << std::endl;
+
+        tinygltf::Model model;
+        createManyPrimitiveScene(primitiveCount, materialCount, model);
+        if (!renderer.loadGLTFModel(model)) {
+            std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+            return false;
+        }
+        fitCamera(renderer, camera);
+
+        // 全プリミティブを描画対象にして、カリングではなく発行の差だけを比べる
+        renderer.setFrustumCullingEnabled(false);
+        renderer.setOcclusionCullingEnabled(false);
+
+        std::cout << "  描画: " << glGetString(GL_RENDERER) << " (OpenGL " << glGetString(GL_VERSION) << ")" << std::endl;
+        std::cout << std::left << std::setw(28) << "モード" << std::right << std::setw(12) << "ドロー数"
+            << std::setw(14) << "間接コマンド" << std::setw(14) << "CPU(ms)" << std::setw(14) << "フレーム(ms)" << std::endl;
+        const bool modes[] = { false, true };
+        double cpuTimes[2] = { 0.0, 0.0 };
+        uint64_t imageHashes[2] = { 0, 0 };
+        for (bool multiDraw : modes) {
+            if (multiDraw && !renderer.hasMultiDraw()) {
+                continue;
+            }
+            renderer.setMultiDrawEnabled(multiDraw);
+            const FrameResult result = measureFrames(renderer, frameCount);
+            cpuTimes[multiDraw ? 1 : 0] = result.m_cpuTimeMs;
+            imageHashes[multiDraw ? 1 : 0] = hashFramebuffer();
+
+            std::cout << std::left << std::setw(28) << (multiDraw ? "共有バッファー + マルチドロー" : "プリミティブごと (VAO切り替え)")
+                << std::right << std::setw(12) << result.m_drawCalls
+                << std::setw(14) << renderer.getRenderStats().m_indirectCommands
+                << std::setw(14) << std::fixed << std::setprecision(3) << result.m_cpuTimeMs
+                << std::setw(14) << result.m_frameTimeMs << std::endl;
+        }
+        if (cpuTimes[1] > 0.0) {
+            std::cout << "  CPU時間の比: " << std::setprecision(2) << cpuTimes[0] / cpuTimes[1] << " 倍" << std::endl;
+        }
+        if (renderer.hasMultiDraw()) {
+            // 同じシェーダー・同じインスタンス属性で描くので、発行方法が違っても画像は一致するはず
+            const bool identical = imageHashes[0] == imageHashes[1];
+            std::cout << "  画像: " << (identical ? "一致" : "不一致") << std::endl;
+            if (!identical) {
+                std::cerr << "警告: マルチドローとプリミティブごとの描画で画像が異なります" << std::endl;
+            }
+        }
+
+        renderer.setMultiDrawEnabled(true);
+        renderer.setFrustumCullingEnabled(true);
+        renderer.setOcclusionCullingEnabled(true);
+        renderer.cleanupGLTFResources();
+        return true;
+    }
+
+    // マテリアルが交互に並ぶシーンで、描画リスト順の発行と描画キュー（ソートキー順 + 重複するステート変更の省略）の
+    // 1フレームあたりのステート変更回数とCPU時間を比較
+    bool runRenderQueue(int primitiveCount, OpenGLRenderer& renderer, Camera& camera) {
+        const int frameCount = 20;
+        const int materialCount = 8;
+
+        std::cout << "=== 描画キューベンチマーク (プリミティブ数: " << primitiveCount << ", マテリアル数: " << materialCount
+            << ", フレーム数: " << frameCount << ") ===" << std::endl;
+
+        tinygltf::Model model;
+        createManyPrimitiveScene(primitiveCount, materialCount, model);
+        if (!renderer.loadGLTFModel(model)) {
+            std::cerr << "エラー: ベンチマーク用シーンのロードに失敗しました" << std::endl;
+            return false;
+        }
+        fitCamera(renderer, camera);
+        renderer.setFrustumCullingEnabled(false);
+        renderer.setOcclusionCullingEnabled(false);
+
+        std::cout << std::left << std::setw(24) << "発行方法" << std::setw(16) << "描画順"
+            << std::right << std::setw(10) << "ドロー数" << std::setw(12) << "プログラム" << std::setw(12) << "マテリアル"
+            << std::setw(10) << "VAO" << std::setw(10) << "合計" << std::setw(12) << "CPU(ms)" << std::endl;
+        const bool multiDrawModes[] = { false, true };
+        const bool queueModes[] = { false, true };
+        for (bool multiDraw : multiDrawModes) {
+            if (multiDraw && !renderer.hasMultiDraw()) {
+                continue;
+            }
+            renderer.setMultiDrawEnabled(multiDraw);
+
+            size_t totals[2] = { 0, 0 };
+            for (bool queue : queueModes) {
+                renderer.setRenderQueueEnabled(queue);
+                const FrameResult result = measureFrames(renderer, frameCount);
+                const StateChangeStats& changes = renderer.getRenderStats().m_stateChanges;
+                totals[queue ? 1 : 0] = changes.getTotal();
+
+                std::cout << std::left << std::setw(24) << (multiDraw ? "マルチドロー" : "プリミティブごと")
+                    << std::setw(16) << (queue ? "ソートキー順" : "描画リスト順")
+                    << std::right << std::setw(10) << result.m_drawCalls
+                    << std::setw(12) << changes.m_programChanges
+                    << std::setw(12) << changes.m_materialChanges
+                    << std::setw(10) << changes.m_vertexArrayChanges
+                    << std::setw(10) << changes.getTotal()
+                    << std::setw(12) << std::fixed << std::setprecision(3) << result.m_cpuTimeMs << std::endl;
+            }
+            if (totals[1] > 0) {
+                std::cout << "  ステート変更の削減: " << totals[0] << " -> " << totals[1] << " ("
+                    << std::setprecision(1) << 100.0 * (1.0 - static_cast<double>(totals[1]) / totals[0]) << "% 減)" << std::endl;
+            }
+        }
+
+        // 描画キューのソート自体のコスト（描画リストの再作成のたびに行う）
+        RenderQueue queue;
+        std::vector<uint64_t> keys(static_cast<size_t>(primitiveCount));
+        uint32_t seed = 12345u;
+        for (uint64_t& key : keys) {
+            seed = seed * 1664525u + 1013904223u;
+            key = RenderQueue::makeKey(0, (seed >> 8) & 1, (seed >> 9) % materialCount, seed >> 12, seed & 0xffff);
+        }
+        const int sortRepeat = 10;
+        const auto sortStart = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < sortRepeat; ++i) {
+            queue.clear();
+            for (size_t k = 0; k < keys.size(); ++k) {
+                queue.push(keys[k], static_cast<uint32_t>(k));
+            }
+            queue.sort();
+        }
+        const auto sortEnd = std::chrono::high_resolution_clock::now();
+        std::cout << "  基数ソート (" << keys.size() << " 件): " << std::setprecision(3)
+            << std::chrono::duration<double, std::milli>(sortEnd - sortStart).count() / sortRepeat << " ms" << std::endl;
+
+        renderer.setRenderQueueEnabled(true);
+        renderer.setMultiDrawEnabled(true);
+        renderer.setFrustumCullingEnabled(true);
+        renderer.setOcclusionCullingEnabled(true);
+        renderer.cleanupGLTFResources();
+        return true;
+    }
+
+    // 文字列指定と型付きハンドルでのuniform設定の1秒あたりの回数を比較
+    // （どちらも glUniform を呼ぶので、差は名前の検索・std::string の構築の分）
+    bool runUniforms(int updateCount, OpenGLRenderer& renderer, Camera& camera) {
+        (void)renderer;
+        (void)camera;
+
+        std::cout << "=== uniform設定ベンチマーク (設定回数: " << updateCount << ") ===" << std::endl;
+
+        ShaderManager shader;
+        if (!shader.createShader(ShaderManager::getColoredVertexShader(), ShaderManager::getColoredFragmentShader())) {
+            std::cerr << "エラー: ベンチマーク用シェーダーの作成に失敗しました" << std::endl;
+            return false;
+        }
+        shader.use();
+
+        const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+        const UniformHandle colorHandle = shader.getUniformHandle("u_materialColor");
+
+        auto measure = [&](const char* label, int callsPerIteration, const std::function<void(int)>& body) {
+            const int iterations = std::max(updateCount / callsPerIteration, 1);
+            glFinish();
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                body(i);
+            }
+            glFinish();
+            const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            const double updates = static_cast<double>(iterations) * callsPerIteration;
+            std::cout << std::left << std::setw(36) << label << std::right
+                << std::setw(16) << std::fixed << std::setprecision(0) << updates / seconds
+                << std::setw(12) << std::setprecision(1) << seconds * 1e9 / updates << std::endl;
+            return updates / seconds;
+        };
+
+        std::cout << std::left << std::setw(36) << "方法" << std::right << std::setw(16) << "回/秒" << std::setw(12) << "ns/回" << std::endl;
+        const double stringColor = measure("vec3 (文字列)", 1, [&](int i) {
+            shader.setUniform("u_materialColor", glm::vec3(static_cast<float>(i & 255) / 255.0f));
+        });
+        const double handleColor = measure("vec3 (Uniform::MaterialColor)", 1, [&](int i) {
+            shader.setUniform(Uniform::MaterialColor, glm::vec3(static_cast<float>(i & 255) / 255.0f));
+        });
+        measure("vec3 (UniformHandle)", 1, [&](int i) {
+            shader.setUniform(colorHandle, glm::vec3(static_cast<float>(i & 255) / 255.0f));
+        });
+
+        // setMVPMatrices 相当（4行列）の従来の文字列指定と、ハンドルを使う現在の実装
+        const double stringMVP = measure("MVP 4行列 (文字列)", 4, [&](int i) {
+            const glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i & 255), 0.0f, 0.0f));
+            shader.setUniform("u_model", model);
+            shader.setUniform("u_view", view);
+            shader.setUniform("u_projection", projection);
+            shader.setUniform("u_mvp", projection * view * model);
+        });
+        const double handleMVP = measure("MVP 4行列 (setMVPMatrices)", 4, [&](int i) {
+            const glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i & 255), 0.0f, 0.0f));
+            shader.setMVPMatrices(model, view, projection);
+        });
+
+        std::cout << "  vec3 の速度比: " << std::setprecision(2) << handleColor / stringColor << " 倍, MVP の速度比: "
+            << handleMVP / stringMVP << " 倍" << std::endl;
+
+        shader.unuse();
+        shader.cleanup();
+        return true;
+    }
+
+    // OpenGLで描画するベンチマーク（count が 0 以下なら既定値）
+    typedef std::function<bool(int count, OpenGLRenderer& renderer, Camera& camera)> RendererBenchmark;
+
+    const std::map<std::string, RendererBenchmark>& getRendererBenchmarks() {
+        static const std::map<std::string, RendererBenchmark> benchmarks = {
+            { "instancing", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runInstancing(count > 0 ? count : 100000, renderer, camera); } },
+            { "culling", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runCulling(count, renderer, camera); } },
+            { "occlusion", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runOcclusion(count > 0 ? count : 100000, renderer, camera); } },
+            { "morph", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runMorph(count > 0 ? count : 100, renderer, camera); } },
+            { "skinning", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runSkinning(count > 0 ? count : 1000, renderer, camera); } },
+            { "streaming", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runStreaming(count > 0 ? count : 64, renderer, camera); } },
+            { "textures", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runTextures(count > 0 ? count : 16, renderer, camera); } },
+            { "textureupload", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runTextureUpload(count > 0 ? count : 16, renderer, camera); } },
+            { "multidraw", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runMultiDraw(count > 0 ? count : 50000, renderer, camera); } },
+            { "uniforms", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runUniforms(count > 0 ? count : 1000000, renderer, camera); } },
+            { "renderqueue", [](int count, OpenGLRenderer& renderer, Camera& camera) { return runRenderQueue(count > 0 ? count : 50000, renderer, camera); } },
+        };
+        return benchmarks;
+    }
+}
+
+void Benchmark::createInstancedScene(int instanceCount, bool useGPUInstancing, tinygltf::Model& model) {
+    model = tinygltf::Model();
+    model.asset.version = "2.0";
+    model.asset.generator = "gltfViewer Benchmark";
+
+    const int mesh = appendCubeMesh(model);
+    const std::vector<float> positions = makeGridPositions(instanceCount, 2.0f);
+
+    tinygltf::Scene scene;
+
+    if (useGPUInstancing) {
+        int translationView = appendBufferView(model, positions.data(), positions.size() * sizeof(float), 0);
+        int translationAccessor = appendAccessor(model, translationView, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, instanceCount);
+
+        tinygltf::Value::Object attributes;
+        attributes["TRANSLATION"] = tinygltf::Value(translationAccessor);
+        tinygltf::Value::Object extension;
+        extension["attributes"] = tinygltf::Value(attributes);
+
+        tinygltf::Node node;
+        node.name = "InstancedCubes";
+        node.mesh = mesh;
+        node.extensions["EXT_mesh_gpu_instancing"] = tinygltf::Value(extension);
+        model.nodes.push_back(node);
+        scene.nodes.push_back(0);
+        model.extensionsUsed.push_back("EXT_mesh_gpu_instancing");
+    } else {
+        model.nodes.reserve(instanceCount);
+        scene.nodes.reserve(instanceCount);
+        for (int i = 0; i < instanceCount; ++i) {
+            tinygltf::Node node;
+            node.mesh = mesh;
+            node.translation = { positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2] };
+            model.nodes.push_back(node);
+            scene.nodes.push_back(i);
+        }
+    }
+
+    model.scenes.push_back(scene);
+    model.defaultScene = 0;
+}
+
+bool Benchmark::run(const std::string& name, int count) {
+    // CPUだけで計測するもの（OpenGLコンテキストを作らない）
+    Camera camera;
+    camera.setPerspective(glm::radians(45.0f), static_cast<float>(kViewportWidth) / kViewportHeight, 0.1f, 100.0f);
+    if (name == "bvh") {
+        return runBVH(count, camera);
+    }
+    if (name == "animation") {
+        return runAnimation(count);
+    }
+    if (name == "picking") {
+        return runPicking(count > 0 ? count : 64, camera);
+    }
+    if (name == "software") {
+        return runSoftware(count > 0 ? count : 64, camera);
+    }
+
+    const std::map<std::string, RendererBenchmark>& benchmarks = getRendererBenchmarks();
+    const auto found = benchmarks.find(name);
+    if (found == benchmarks.end()) {
+        std::cerr << "エラー: 不明なベンチマーク名です: " << name << std::endl;
+        printUsage();
+        return false;
+    }
+
+    // 描画を伴うものはオフスクリーンのコンテキストのFBO（ウィンドウの既定の大きさ）へ描画する
+    HeadlessSettings settings;
+    settings.m_width = kViewportWidth;
+    settings.m_height = kViewportHeight;
+    HeadlessRenderer headless;
+    if (!headless.initialize(settings)) {
+        std::cerr << "エラー: ベンチマーク用のOpenGLコンテキストを初期化できません" << std::endl;
+        return false;
+    }
+    headless.bindFramebuffer();
+    const bool result = found->second(count, headless.getRenderer(), headless.getCamera());
+    headless.cleanup();
+    return result;
+}
+
+void Benchmark::printUsage() {
+    std::cout << "ベンチマーク: --benchmark <名前> [数]" << std::endl;
+    std::cout << "  instancing [インスタンス数]  : インスタンス描画と個別描画のドローコール数・CPU時間を比較 (既定: 100000)" << std::endl;
+    std::cout << "  bvh [オブジェクト数]         : BVHの構築・refit・視錐台/レイ/最近傍クエリ時間 (既定: 10000, 100000, 1000000)" << std::endl;
+    std::cout << "  culling [オブジェクト数]     : 固定カメラ姿勢での視錐台カリング (Scalar/SSE/AVX/BVH/総当たり) とレンダラーでの効果 (既定: 10000, 100000, 1000000)" << std::endl;
+    std::cout << "  occlusion [インスタンス数]   : 壁に隠れた立方体グリッドでのオクルージョンカリングの遮蔽率・処理時間 (既定: 100000)" << std::endl;
+    std::cout << "  animation [チャンネル数]     : アニメーションの評価・書き込み・ワールド行列更新の時間 (既定: 10000, 100000)" << std::endl;
+    std::cout << "  morph [ノード数]             : 有効ターゲット数 0/10/100 での疎な差分の加算と密な加算の比較、描画時間 (既定: 100)" << std::endl;
+    std::cout << "  skinning [キャラクター数]    : 関節パレット・CPUスキニングの単一スレッド/並列比較とGPUスキニングの描画時間 (既定: 1000)" << std::endl;
+    std::cout << "  picking [メッシュ数]         : 高分割球のシーンでスクリーン格子のレイによるピッキングの遅延と総当たりとの一致 (既定: 64)" << std::endl;
+    std::cout << "  software [メッシュ数]        : 高分割球のシーンをソフトウェアレンダラーで描画し、1スレッドからハードウェアスレッド数までのスケーリングを比較 (既定: 64)" << std::endl;
+    std::cout << "  streaming [メッシュ数]       : 球のグリッドをチャンクパックに変換し、予算内での読み込み・転送・破棄と遅延を計測 (既定: 64)" << std::endl;
+    std::cout << "  textures [テクスチャ数]      : 2048x2048 のテクスチャの列を予算の4倍の全ミップで、ミップの常駐・転送量・破棄を計測 (既定: 16)" << std::endl;
+    std::cout << "  textureupload [テクスチャ数] : JPEG のテクスチャを全ミップ常駐させるまでのフレーム時間のスパイクをPBO経由と直接転送で比較 (既定: 16)" << std::endl;
+    std::cout << "  multidraw [プリミティブ数]   : プリミティブごとの描画ループと共有バッファー + マルチドローの発行時間と画像の一致を比較 (既定: 50000)" << std::endl;
+    std::cout << "  renderqueue [プリミティブ数] : マテリアルが交互に並ぶシーンで描画リスト順とソートキー順のステート変更回数・CPU時間を比較 (既定: 50000)" << std::endl;
+    std::cout << "  uniforms [設定回数]          : 文字列指定と型付きハンドルでのuniform設定の回数/秒を比較 (既定: 1000000)" << std::endl;
+}
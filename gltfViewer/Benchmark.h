@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include <string>
+
+namespace tinygltf {
+    class Model;
+}
+
+// 合成シーンによる性能計測
+// コマンドライン引数 --benchmark <名前> [数] で起動し、結果をコンソールへ出力する
+namespace Benchmark {
+
+    // 1つの立方体メッシュを共有する instanceCount 個のノードをグリッド状に配置したシーンを作成
+    // useGPUInstancing が true の場合はノードを1つだけ作り、EXT_mesh_gpu_instancing で配置する
+    void createInstancedScene(int instanceCount, bool useGPUInstancing, tinygltf::Model& model);
+
+    // 名前で指定されたベンチマークを実行（count が 0 以下なら各ベンチマークの既定値）
+    // ウィンドウは使わない。CPUだけの計測はOpenGLコンテキストを作らずに行い、描画を伴う計測は
+    // HeadlessRenderer のオフスクリーンのコンテキスト（GLContext::createHeadless()）のFBOへ描画する
+    bool run(const std::string& name, int count);
+
+    // 利用可能なベンチマーク名の一覧を表示
+    void printUsage();
+}
@@ -0,0 +1,211 @@
+﻿#include "BoundingVolume.h"
+#include "SimdMath.h"
+#include <algorithm>
+#include <cmath>
+
+BoundingBox BoundingVolume::computeAABB(const float* positions, size_t vertexCount) {
+    BoundingBox box;
+    if (!positions || vertexCount == 0) {
+        return box;
+    }
+
+    size_t i = 0;
+    float minX = std::numeric_limits<float>::max();
+    float minY = minX, minZ = minX;
+    float maxX = -std::numeric_limits<float>::max();
+    float maxY = maxX, maxZ = maxX;
+
+#ifdef GLTFVIEWER_SIMD_SSE
+    // 4頂点 (12 float) を3レジスタのまま処理し、最後にレーンを集約する
+    // レーン配置: r0 = [x y z x], r1 = [y z x y], r2 = [z x y z]
+    if (vertexCount >= 4) {
+        __m128 min0 = _mm_set1_ps(minX), min1 = min0, min2 = min0;
+        __m128 max0 = _mm_set1_ps(maxX), max1 = max0, max2 = max0;
+
+        for (; i + 4 <= vertexCount; i += 4) {
+            const float* p = positions + i * 3;
+            __m128 v0 = _mm_loadu_ps(p);
+            __m128 v1 = _mm_loadu_ps(p + 4);
+            __m128 v2 = _mm_loadu_ps(p + 8);
+            min0 = _mm_min_ps(min0, v0); max0 = _mm_max_ps(max0, v0);
+            min1 = _mm_min_ps(min1, v1); max1 = _mm_max_ps(max1, v1);
+            min2 = _mm_min_ps(min2, v2); max2 = _mm_max_ps(max2, v2);
+        }
+
+        alignas(16) float a[4], b[4], c[4];
+        _mm_store_ps(a, min0); _mm_store_ps(b, min1); _mm_store_ps(c, min2);
+        minX = std::min({ a[0], a[3], b[2], c[1] });
+        minY = std::min({ a[1], b[0], b[3], c[2] });
+        minZ = std::min({ a[2], b[1], c[0], c[3] });
+
+        _mm_store_ps(a, max0); _mm_store_ps(b, max1); _mm_store_ps(c, max2);
+        maxX = std::max({ a[0], a[3], b[2], c[1] });
+        maxY = std::max({ a[1], b[0], b[3], c[2] });
+        maxZ = std::max({ a[2], b[1], c[0], c[3] });
+    }
+#endif
+
+    // 残りの頂点（またはスカラー実装）
+    for (; i < vertexCount; ++i) {
+        const float* p = positions + i * 3;
+        minX = std::min(minX, p[0]); maxX = std::max(maxX, p[0]);
+        minY = std::min(minY, p[1]); maxY = std::max(maxY, p[1]);
+        minZ = std::min(minZ, p[2]); maxZ = std::max(maxZ, p[2]);
+    }
+
+    box.m_min = glm::vec3(minX, minY, minZ);
+    box.m_max = glm::vec3(maxX, maxY, maxZ);
+    return box;
+}
+
+BoundingSphere BoundingVolume::computeSphere(const float* positions, size_t vertexCount, const glm::vec3& center) {
+    if (!positions || vertexCount == 0) {
+        return BoundingSphere();
+    }
+
+    size_t i = 0;
+    float maxDistSq = 0.0f;
+
+#ifdef GLTFVIEWER_SIMD_SSE
+    if (vertexCount >= 4) {
+        const __m128 cx = _mm_set1_ps(center.x);
+        const __m128 cy = _mm_set1_ps(center.y);
+        const __m128 cz = _mm_set1_ps(center.z);
+        __m128 maxSq = _mm_setzero_ps();
+
+        for (; i + 4 <= vertexCount; i += 4) {
+            __m128 x, y, z;
+            SimdMath::loadPoints4(positions + i * 3, x, y, z);
+            __m128 dx = _mm_sub_ps(x, cx);
+            __m128 dy = _mm_sub_ps(y, cy);
+            __m128 dz = _mm_sub_ps(z, cz);
+            __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            maxSq = _mm_max_ps(maxSq, d2);
+        }
+        maxDistSq = SimdMath::horizontalMax(maxSq);
+    }
+#endif
+
+    for (; i < vertexCount; ++i) {
+        const float* p = positions + i * 3;
+        float dx = p[0] - center.x;
+        float dy = p[1] - center.y;
+        float dz = p[2] - center.z;
+        maxDistSq = std::max(maxDistSq, dx * dx + dy * dy + dz * dz);
+    }
+
+    return BoundingSphere(center, std::sqrt(maxDistSq));
+}
+
+bool BoundingVolume::fromMinMax(const double* minValues, const double* maxValues, BoundingBox& box) {
+    for (int k = 0; k < 3; ++k) {
+        if (!std::isfinite(minValues[k]) || !std::isfinite(maxValues[k]) || minValues[k] > maxValues[k]) {
+            return false;
+        }
+    }
+
+    box.m_min = glm::vec3(static_cast<float>(minValues[0]), static_cast<float>(minValues[1]), static_cast<float>(minValues[2]));
+    box.m_max = glm::vec3(static_cast<float>(maxValues[0]), static_cast<float>(maxValues[1]), static_cast<float>(maxValues[2]));
+    return true;
+}
+
+BoundingBox BoundingVolume::transform(const BoundingBox& box, const glm::mat4& matrix) {
+    if (!box.isValid()) {
+        return box;
+    }
+
+    // Arvoの方法: 平行移動から開始し、各軸の寄与の最小・最大を加算する
+    glm::vec3 newMin(matrix[3][0], matrix[3][1], matrix[3][2]);
+    glm::vec3 newMax = newMin;
+
+    for (int col = 0; col < 3; ++col) {
+        for (int row = 0; row < 3; ++row) {
+            float a = matrix[col][row] * box.m_min[col];
+            float b = matrix[col][row] * box.m_max[col];
+            newMin[row] += std::min(a, b);
+            newMax[row] += std::max(a, b);
+        }
+    }
+
+    return BoundingBox(newMin, newMax);
+}
+
+BoundingSphere BoundingVolume::sphereFromBox(const BoundingBox& box) {
+    if (!box.isValid()) {
+        return BoundingSphere();
+    }
+    return BoundingSphere(box.getCenter(), glm::length(box.getSize()) * 0.5f);
+}
+
+Frustum BoundingVolume::extractFrustum(const glm::mat4& viewProjection) {
+    // Gribb-Hartmann法: 行列の行の和・差から平面を得る（glm は列優先なので m[列][行]）
+    const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    Frustum frustum;
+    frustum.m_planes[Frustum::Left] = row3 + row0;
+    frustum.m_planes[Frustum::Right] = row3 - row0;
+    frustum.m_planes[Frustum::Bottom] = row3 + row1;
+    frustum.m_planes[Frustum::Top] = row3 - row1;
+    frustum.m_planes[Frustum::Near] = row3 + row2;
+    frustum.m_planes[Frustum::Far] = row3 - row2;
+
+    for (int i = 0; i < Frustum::PlaneCount; ++i) {
+        float length = glm::length(glm::vec3(frustum.m_planes[i]));
+        if (length > 0.0f) {
+            frustum.m_planes[i] /= length;
+        }
+    }
+    return frustum;
+}
+
+bool BoundingVolume::intersectsFrustum(const BoundingBox& box, const Frustum& frustum) {
+    if (!box.isValid()) {
+        return false;
+    }
+
+    // 各平面について法線方向に最も遠い頂点 (p-vertex) が外側なら完全に外
+    for (int i = 0; i < Frustum::PlaneCount; ++i) {
+        const glm::vec4& plane = frustum.m_planes[i];
+        glm::vec3 farthest(
+            plane.x >= 0.0f ? box.m_max.x : box.m_min.x,
+            plane.y >= 0.0f ? box.m_max.y : box.m_min.y,
+            plane.z >= 0.0f ? box.m_max.z : box.m_min.z);
+        if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BoundingVolume::intersectRay(const BoundingBox& box, const glm::vec3& origin, const glm::vec3& inverseDirection,
+    float maxDistance, float& hitDistance)
+{
+    float tMin = 0.0f;
+    float tMax = maxDistance;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        float t0 = (box.m_min[axis] - origin[axis]) * inverseDirection[axis];
+        float t1 = (box.m_max[axis] - origin[axis]) * inverseDirection[axis];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        // NaN（方向成分0で原点が面上）の場合は比較が偽になり範囲は変わらない
+        tMin = t0 > tMin ? t0 : tMin;
+        tMax = t1 < tMax ? t1 : tMax;
+        if (tMin > tMax) {
+            return false;
+        }
+    }
+
+    hitDistance = tMin;
+    return true;
+}
+
+float BoundingVolume::distanceSquared(const BoundingBox& box, const glm::vec3& point) {
+    glm::vec3 clamped = glm::clamp(point, box.m_min, box.m_max);
+    glm::vec3 delta = point - clamped;
+    return glm::dot(delta, delta);
+}
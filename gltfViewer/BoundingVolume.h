@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <limits>
+
+// 軸平行バウンディングボックス (AABB)
+struct BoundingBox {
+    glm::vec3 m_min;
+    glm::vec3 m_max;
+
+    // 空のボックス（min > max）で初期化
+    BoundingBox()
+        : m_min(std::numeric_limits<float>::max())
+        , m_max(-std::numeric_limits<float>::max())
+    {
+    }
+
+    BoundingBox(const glm::vec3& minPoint, const glm::vec3& maxPoint)
+        : m_min(minPoint)
+        , m_max(maxPoint)
+    {
+    }
+
+    bool isValid() const {
+        return m_min.x <= m_max.x && m_min.y <= m_max.y && m_min.z <= m_max.z;
+    }
+
+    glm::vec3 getCenter() const { return (m_min + m_max) * 0.5f; }
+    glm::vec3 getSize() const { return m_max - m_min; }
+
+    void expand(const glm::vec3& point) {
+        m_min = glm::min(m_min, point);
+        m_max = glm::max(m_max, point);
+    }
+
+    void expand(const BoundingBox& other) {
+        if (!other.isValid()) {
+            return;
+        }
+        m_min = glm::min(m_min, other.m_min);
+        m_max = glm::max(m_max, other.m_max);
+    }
+};
+
+// バウンディングスフィア
+struct BoundingSphere {
+    glm::vec3 m_center;
+    float m_radius;
+
+    BoundingSphere()
+        : m_center(0.0f)
+        , m_radius(-1.0f)
+    {
+    }
+
+    BoundingSphere(const glm::vec3& center, float radius)
+        : m_center(center)
+        , m_radius(radius)
+    {
+    }
+
+    bool isValid() const { return m_radius >= 0.0f; }
+};
+
+// レイ（方向は正規化されていなくてもよい。距離は方向ベクトルの長さ単位）
+struct Ray {
+    glm::vec3 m_origin;
+    glm::vec3 m_direction;
+
+    Ray() : m_origin(0.0f), m_direction(0.0f, 0.0f, -1.0f) {}
+    Ray(const glm::vec3& origin, const glm::vec3& direction) : m_origin(origin), m_direction(direction) {}
+};
+
+// 視錐台（6平面。法線は内側向きで、plane.xyz・p + plane.w >= 0 が内側）
+struct Frustum {
+    enum { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+    glm::vec4 m_planes[PlaneCount];
+};
+
+// バウンディングボリューム計算（頂点走査はSIMDで処理）
+namespace BoundingVolume {
+
+    // xyz が連続する位置配列からAABBを計算
+    BoundingBox computeAABB(const float* positions, size_t vertexCount);
+
+    // center からの最大距離を半径とするスフィアを計算
+    BoundingSphere computeSphere(const float* positions, size_t vertexCount, const glm::vec3& center);
+
+    // アクセサーの min/max を検証してAABBを作成（不正な値の場合は false）
+    bool fromMinMax(const double* minValues, const double* maxValues, BoundingBox& box);
+
+    // AABBを行列で変換し、変換後の8頂点を包むAABBを返す
+    BoundingBox transform(const BoundingBox& box, const glm::mat4& matrix);
+
+    // AABBに外接するスフィア
+    BoundingSphere sphereFromBox(const BoundingBox& box);
+
+    // ビュー投影行列から視錐台の6平面を抽出（平面は正規化される）
+    Frustum extractFrustum(const glm::mat4& viewProjection);
+
+    // AABBが視錐台と交差する（または内側にある）か
+    bool intersectsFrustum(const BoundingBox& box, const Frustum& frustum);
+
+    // レイとAABBの交差判定（スラブ法）。inverseDirection は 1 / 方向
+    // 交差する場合は [0, maxDistance] 内の入射距離を hitDistance に返す
+    bool intersectRay(const BoundingBox& box, const glm::vec3& origin, const glm::vec3& inverseDirection,
+        float maxDistance, float& hitDistance);
+
+    // 点からAABBまでの距離の2乗（内側なら0）
+    float distanceSquared(const BoundingBox& box, const glm::vec3& point);
+}
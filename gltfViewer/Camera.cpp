@@ -24,11 +24,11 @@ Camera::Camera(const glm::vec3& position, const glm::vec3& target, const glm::ve
     glm::vec3 direction = glm::normalize(target - position);
 
     // ヨー角度を計算（XZ平面での角度）
-    m_yaw = std::atan2(direction.x, direction.z);
+    m_yaw = std::atan2(direction.z, direction.x);
 
     // ピッチ角度を計算（Y軸での角度）
     float horizontalDistance = std::sqrt(direction.x * direction.x + direction.z * direction.z);
-    m_pitch = std::atan2(-direction.y, horizontalDistance);
+    m_pitch = std::atan2(direction.y, horizontalDistance);
 
     // 内部ベクトルを更新
     updateVectors();
@@ -52,11 +52,11 @@ void Camera::setTarget(const glm::vec3& target) {
     glm::vec3 direction = glm::normalize(target - m_position);
 
     // ヨー角度を計算
-    m_yaw = std::atan2(direction.x, direction.z);
+    m_yaw = std::atan2(direction.z, direction.x);
 
     // ピッチ角度を計算
     float horizontalDistance = std::sqrt(direction.x * direction.x + direction.z * direction.z);
-    m_pitch = constrainPitch(std::atan2(-direction.y, horizontalDistance));
+    m_pitch = constrainPitch(std::atan2(direction.y, horizontalDistance));
 
     updateVectors();
 }
@@ -172,6 +172,44 @@ glm::mat4 Camera::getViewProjectionMatrix() const {
     return getProjectionMatrix() * getViewMatrix();
 }
 
+Frustum Camera::getFrustum() const {
+    return BoundingVolume::extractFrustum(getViewProjectionMatrix());
+}
+
+// === スクリーン座標変換 ===
+
+glm::vec3 Camera::unproject(float screenX, float screenY, float depth, int viewportWidth, int viewportHeight) const {
+    const float width = static_cast<float>(std::max(viewportWidth, 1));
+    const float height = static_cast<float>(std::max(viewportHeight, 1));
+
+    // スクリーン座標（Y下向き）→ 正規化デバイス座標（Y上向き）
+    const glm::vec4 ndc(
+        2.0f * screenX / width - 1.0f,
+        1.0f - 2.0f * screenY / height,
+        depth,
+        1.0f);
+
+    const glm::vec4 world = glm::inverse(getViewProjectionMatrix()) * ndc;
+    if (std::abs(world.w) < 1e-12f) {
+        return glm::vec3(world);
+    }
+    return glm::vec3(world) / world.w;
+}
+
+Ray Camera::screenPointToRay(float screenX, float screenY, int viewportWidth, int viewportHeight) const {
+    const glm::vec3 nearPoint = unproject(screenX, screenY, -1.0f, viewportWidth, viewportHeight);
+    const glm::vec3 farPoint = unproject(screenX, screenY, 1.0f, viewportWidth, viewportHeight);
+
+    glm::vec3 direction = farPoint - nearPoint;
+    const float length = glm::length(direction);
+    if (length < 1e-12f) {
+        direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    } else {
+        direction /= length;
+    }
+    return Ray(nearPoint, direction);
+}
+
 // === 自動フィッティング ===
 
 void Camera::fitToBoundingBox(const glm::vec3& boundingBoxMin, const glm::vec3& boundingBoxMax, float padding) {
@@ -228,6 +266,30 @@ void Camera::fitToBoundingBox(const glm::vec3& boundingBoxMin, const glm::vec3&
     std::cout << "  Near: " << newNear << ", Far: " << newFar << std::endl;
 }
 
+void Camera::fitClipPlanesToSphere(const glm::vec3& center, float radius, float maxDepthRatio) {
+    if (radius <= 0.0f) {
+        return;
+    }
+
+    // 視線方向に沿ったスフィア中心までの深度
+    float depth = glm::dot(center - m_position, m_forwardV);
+
+    float newFar = depth + radius;
+    if (newFar <= 0.0f) {
+        // スフィア全体がカメラの後方にある場合は変更しない
+        return;
+    }
+
+    // カメラがスフィア内部にある場合でも far/near 比を制限して深度精度を保つ
+    float newNear = std::max(depth - radius, newFar / maxDepthRatio);
+
+    if (m_projectionType == ProjectionType::PERSPECTIVE) {
+        setPerspective(m_fov, m_aspectRatio, newNear, newFar);
+    } else {
+        setOrthographic(m_left, m_right, m_bottom, m_top, newNear, newFar);
+    }
+}
+
 // === デバッグ ===
 
 void Camera::debugPrint() const {
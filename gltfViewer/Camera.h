@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "BoundingVolume.h"
 
 /**
 * @brief OpenGL用カメラクラス
@@ -206,6 +207,35 @@ public:
     */
     glm::mat4 getViewProjectionMatrix() const;
 
+    /**
+    * @brief ビュー・投影行列から視錐台を取得
+    * @return 内側向きに正規化された6平面（カリング用）
+    */
+    Frustum getFrustum() const;
+
+    // === スクリーン座標変換 ===
+
+    /**
+    * @brief スクリーン座標と深度からワールド座標を求める
+    * @param screenX スクリーンX座標（左上原点のピクセル）
+    * @param screenY スクリーンY座標（左上原点のピクセル）
+    * @param depth 正規化デバイス座標の深度（-1で近クリップ面、1で遠クリップ面）
+    * @param viewportWidth ビューポートの幅
+    * @param viewportHeight ビューポートの高さ
+    * @return ワールド座標
+    */
+    glm::vec3 unproject(float screenX, float screenY, float depth, int viewportWidth, int viewportHeight) const;
+
+    /**
+    * @brief スクリーン座標を通るレイを取得（ピッキング用）
+    * @param screenX スクリーンX座標（左上原点のピクセル）
+    * @param screenY スクリーンY座標（左上原点のピクセル）
+    * @param viewportWidth ビューポートの幅
+    * @param viewportHeight ビューポートの高さ
+    * @return 近クリップ面上の点を原点とし、正規化された方向を持つレイ
+    */
+    Ray screenPointToRay(float screenX, float screenY, int viewportWidth, int viewportHeight) const;
+
     // === 自動フィッティング ===
 
     /**
@@ -216,6 +246,14 @@ public:
     */
     void fitToBoundingBox(const glm::vec3& boundingBoxMin, const glm::vec3& boundingBoxMax, float padding = 1.2f);
 
+    /**
+    * @brief バウンディングスフィアが収まるように近・遠クリップ面を設定
+    * @param center スフィアの中心
+    * @param radius スフィアの半径
+    * @param maxDepthRatio 遠クリップ面/近クリップ面の上限（深度精度の確保）
+    */
+    void fitClipPlanesToSphere(const glm::vec3& center, float radius, float maxDepthRatio = 10000.0f);
+
     // === デバッグ ===
 
     /**
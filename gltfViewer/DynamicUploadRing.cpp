@@ -0,0 +1,185 @@
+﻿#include "DynamicUploadRing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // フェンスの待機1回あたりのタイムアウト（ナノ秒）
+    const GLuint64 kFenceWaitTimeout = 1000000;
+}
+
+DynamicUploadRing::DynamicUploadRing()
+    : m_buffer(0)
+    , m_mapped(nullptr)
+    , m_regionSize(0)
+    , m_requestedRegionSize(0)
+    , m_fences()
+    , m_region(0)
+    , m_offset(0)
+    , m_inFrame(false)
+{
+}
+
+DynamicUploadRing::~DynamicUploadRing() {
+    // OpenGLリソースは cleanup() で解放する（コンテキスト破棄後の呼び出しを避ける）
+}
+
+bool DynamicUploadRing::isSupported() {
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+bool DynamicUploadRing::initialize(size_t regionSize) {
+    cleanup();
+    if (!isSupported()) {
+        return false;
+    }
+    return createBuffer(regionSize);
+}
+
+bool DynamicUploadRing::createBuffer(size_t regionSize) {
+    // 領域の境界がどの用途のアラインメントにも合うよう256バイト単位に切り上げる
+    regionSize = (regionSize + 255) & ~static_cast<size_t>(255);
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glBufferStorage(GL_ARRAY_BUFFER, regionSize * kRegionCount, nullptr, flags);
+    m_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * kRegionCount, flags));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!m_mapped) {
+        std::cerr << "エラー: 動的データのリングバッファーを永続マップできませんでした" << std::endl;
+        destroyBuffer();
+        return false;
+    }
+
+    m_regionSize = regionSize;
+    m_requestedRegionSize = regionSize;
+    m_region = 0;
+    m_offset = 0;
+    return true;
+}
+
+void DynamicUploadRing::destroyBuffer() {
+    for (GLsync& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (m_buffer != 0) {
+        if (m_mapped) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+    m_mapped = nullptr;
+    m_regionSize = 0;
+}
+
+void DynamicUploadRing::cleanup() {
+    destroyBuffer();
+    m_requestedRegionSize = 0;
+    m_inFrame = false;
+    m_frameStats = DynamicUploadStats();
+    m_lastFrameStats = DynamicUploadStats();
+}
+
+// 領域に置いたフェンスが通過するまで待つ（既に通過していれば待機に数えない）
+void DynamicUploadRing::waitForRegion(int region) {
+    GLsync& fence = m_fences[region];
+    if (!fence) {
+        return;
+    }
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        ++m_frameStats.m_stalls;
+        const auto start = std::chrono::high_resolution_clock::now();
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceWaitTimeout);
+        } while (result == GL_TIMEOUT_EXPIRED);
+        m_frameStats.m_stallTimeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    if (result == GL_WAIT_FAILED) {
+        std::cerr << "警告: リングバッファーのフェンスの待機に失敗しました" << std::endl;
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void DynamicUploadRing::beginFrame() {
+    if (!m_mapped) {
+        return;
+    }
+    if (m_inFrame) {
+        endFrame();
+    }
+    m_frameStats = DynamicUploadStats();
+
+    // 前のフレームで溢れた場合は、全領域の読み出し完了を待ってから大きなバッファーに作り直す
+    if (m_requestedRegionSize > m_regionSize) {
+        for (int region = 0; region < kRegionCount; ++region) {
+            waitForRegion(region);
+        }
+        const size_t regionSize = m_requestedRegionSize;
+        destroyBuffer();
+        if (!createBuffer(regionSize)) {
+            return;
+        }
+        std::cout << "  動的データのリングバッファーを拡張: 1フレーム " << m_regionSize << " バイト" << std::endl;
+    } else {
+        m_region = (m_region + 1) % kRegionCount;
+        waitForRegion(m_region);
+    }
+
+    m_offset = 0;
+    m_inFrame = true;
+}
+
+void DynamicUploadRing::endFrame() {
+    if (!m_inFrame) {
+        return;
+    }
+    if (m_frameStats.m_allocations > 0) {
+        m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    m_lastFrameStats = m_frameStats;
+    m_inFrame = false;
+}
+
+bool DynamicUploadRing::allocate(size_t size, size_t alignment, Allocation& allocation) {
+    if (!m_inFrame || size == 0) {
+        return false;
+    }
+
+    const size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+    if (offset + size > m_regionSize) {
+        // 次に作り直すときはこのフレームの要求が収まる大きさにする
+        ++m_frameStats.m_overflows;
+        m_requestedRegionSize = std::max(m_requestedRegionSize, (offset + size) * 2);
+        return false;
+    }
+
+    const size_t bufferOffset = static_cast<size_t>(m_region) * m_regionSize + offset;
+    allocation.m_data = m_mapped + bufferOffset;
+    allocation.m_offset = static_cast<GLintptr>(bufferOffset);
+    allocation.m_size = size;
+    m_offset = offset + size;
+    ++m_frameStats.m_allocations;
+    return true;
+}
+
+bool DynamicUploadRing::upload(const void* data, size_t size, size_t alignment, Allocation& allocation) {
+    if (!allocate(size, alignment, allocation)) {
+        return false;
+    }
+    std::memcpy(allocation.m_data, data, size);
+    m_frameStats.m_bytesUploaded += size;
+    return true;
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+
+// 1フレーム分の動的データの転送統計
+struct DynamicUploadStats {
+    size_t m_bytesUploaded;   // リングに書き込んだバイト数（アラインメントの詰め物を除く）
+    size_t m_allocations;
+    size_t m_overflows;       // 領域に収まらず確保できなかった回数（呼び出し側は従来の転送に切り替える）
+    size_t m_stalls;          // 領域の再利用時にGPUの読み出し完了を待った回数
+    double m_stallTimeMs;
+
+    DynamicUploadStats() : m_bytesUploaded(0), m_allocations(0), m_overflows(0), m_stalls(0), m_stallTimeMs(0.0) {}
+};
+
+// 永続マップしたバッファー（GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT）をフレームごとの領域に3分割したリング
+// 各フレームは自分の領域の先頭から線形に確保して書き込み、オフセット指定でバインドする
+// フレームの終わりにフェンスを置き、3フレーム後に同じ領域を再利用する前にGPUの読み出し完了を待つ
+// （GL 4.4 / ARB_buffer_storage が無い環境では使えないので、呼び出し側は従来の glBufferSubData で転送する）
+class DynamicUploadRing {
+public:
+    static const int kRegionCount = 3;
+
+    struct Allocation {
+        void* m_data;          // 書き込み先（永続マップされたメモリ）
+        GLintptr m_offset;     // バッファー先頭からのオフセット（バインドに使う）
+        size_t m_size;
+    };
+
+private:
+    GLuint m_buffer;
+    unsigned char* m_mapped;
+    size_t m_regionSize;
+    size_t m_requestedRegionSize;   // 溢れた場合に次の beginFrame() で拡張する大きさ
+    GLsync m_fences[kRegionCount];
+    int m_region;
+    size_t m_offset;                // 現在の領域内の次の確保位置
+    bool m_inFrame;
+
+    DynamicUploadStats m_frameStats;
+    DynamicUploadStats m_lastFrameStats;
+
+    bool createBuffer(size_t regionSize);
+    void destroyBuffer();
+    void waitForRegion(int region);
+
+public:
+    DynamicUploadRing();
+    ~DynamicUploadRing();
+
+    DynamicUploadRing(const DynamicUploadRing&) = delete;
+    DynamicUploadRing& operator=(const DynamicUploadRing&) = delete;
+
+    static bool isSupported();
+
+    // regionSize は1フレームで確保できる上限
+    bool initialize(size_t regionSize);
+    void cleanup();   // OpenGLコンテキストが有効なうちに呼ぶこと
+
+    // 次の領域へ進み、その領域をGPUが読み終えるまで待つ
+    void beginFrame();
+    // 領域にフェンスを置く（このフレームの描画コマンドをすべて発行した後に呼ぶ）
+    void endFrame();
+
+    // 現在の領域から確保（alignment は2のべき乗）。収まらない場合は false
+    bool allocate(size_t size, size_t alignment, Allocation& allocation);
+
+    // 確保してデータを書き込む
+    bool upload(const void* data, size_t size, size_t alignment, Allocation& allocation);
+
+    bool isInitialized() const { return m_mapped != nullptr; }
+    GLuint getBuffer() const { return m_buffer; }
+    size_t getRegionSize() const { return m_regionSize; }
+
+    // 直近に endFrame() したフレームの統計
+    const DynamicUploadStats& getLastFrameStats() const { return m_lastFrameStats; }
+};
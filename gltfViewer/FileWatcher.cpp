@@ -0,0 +1,31 @@
+﻿#include "FileWatcher.h"
+#include <filesystem>
+
+uint64_t FileWatcher::getWriteTime(const std::string& path) {
+    std::error_code error;
+    const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return 0;
+    }
+    return static_cast<uint64_t>(writeTime.time_since_epoch().count());
+}
+
+void FileWatcher::setFiles(const std::vector<std::string>& paths) {
+    m_files.clear();
+    m_files.reserve(paths.size());
+    for (const std::string& path : paths) {
+        m_files.push_back(WatchedFile{ path, getWriteTime(path) });
+    }
+}
+
+bool FileWatcher::poll() {
+    bool changed = false;
+    for (WatchedFile& file : m_files) {
+        const uint64_t writeTime = getWriteTime(file.m_path);
+        if (writeTime != file.m_writeTime) {
+            file.m_writeTime = writeTime;
+            changed = true;
+        }
+    }
+    return changed;
+}
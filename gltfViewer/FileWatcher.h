@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ファイルの更新日時を記録しておき、poll() で変更を検出する（シェーダーのホットリロード用）
+// エディターが一時ファイルからの置き換えで保存した場合や、一時的に消えた場合も変更として扱う
+class FileWatcher {
+private:
+    struct WatchedFile {
+        std::string m_path;
+        uint64_t m_writeTime;   // 0 はファイルが無い
+    };
+
+    std::vector<WatchedFile> m_files;
+
+    static uint64_t getWriteTime(const std::string& path);
+
+public:
+    // 監視するファイルを置き換え、現在の更新日時を記録
+    void setFiles(const std::vector<std::string>& paths);
+    void clear() { m_files.clear(); }
+    bool empty() const { return m_files.empty(); }
+
+    // 前回の setFiles() / poll() から更新されたファイルがあるか（記録も更新する）
+    bool poll();
+};
@@ -0,0 +1,208 @@
+﻿#include "FrustumCulling.h"
+#include "SimdMath.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+    const size_t kPadding = 8;
+
+    size_t paddedSize(size_t count) {
+        return (count + kPadding - 1) / kPadding * kPadding;
+    }
+
+    // 各平面の法線の絶対値（中心・半径形式の判定で使用）
+    struct PlaneSet {
+        float m_nx[Frustum::PlaneCount], m_ny[Frustum::PlaneCount], m_nz[Frustum::PlaneCount], m_w[Frustum::PlaneCount];
+        float m_ax[Frustum::PlaneCount], m_ay[Frustum::PlaneCount], m_az[Frustum::PlaneCount];
+
+        explicit PlaneSet(const Frustum& frustum) {
+            for (int p = 0; p < Frustum::PlaneCount; ++p) {
+                const glm::vec4& plane = frustum.m_planes[p];
+                m_nx[p] = plane.x; m_ny[p] = plane.y; m_nz[p] = plane.z; m_w[p] = plane.w;
+                m_ax[p] = std::fabs(plane.x); m_ay[p] = std::fabs(plane.y); m_az[p] = std::fabs(plane.z);
+            }
+        }
+    };
+
+    // 可視ビットの立っているオブジェクトを出力
+    inline void emitVisible(int mask, size_t base, size_t width, size_t count, std::vector<int>& visible) {
+        for (size_t bit = 0; bit < width && mask != 0; ++bit, mask >>= 1) {
+            if ((mask & 1) && base + bit < count) {
+                visible.push_back(static_cast<int>(base + bit));
+            }
+        }
+    }
+}
+
+FrustumCuller::FrustumCuller()
+    : m_count(0)
+{
+}
+
+void FrustumCuller::clear() {
+    m_centerX.clear(); m_centerY.clear(); m_centerZ.clear();
+    m_extentX.clear(); m_extentY.clear(); m_extentZ.clear();
+    m_count = 0;
+}
+
+void FrustumCuller::setBounds(const std::vector<BoundingBox>& bounds) {
+    m_count = bounds.size();
+    const size_t padded = paddedSize(m_count);
+
+    // 半径が負の無限大に近いダミーは d + r < 0 となり常にカリングされる
+    const float culledExtent = -std::numeric_limits<float>::max();
+    m_centerX.assign(padded, 0.0f); m_centerY.assign(padded, 0.0f); m_centerZ.assign(padded, 0.0f);
+    m_extentX.assign(padded, culledExtent); m_extentY.assign(padded, culledExtent); m_extentZ.assign(padded, culledExtent);
+
+    for (size_t i = 0; i < m_count; ++i) {
+        updateBounds(i, bounds[i]);
+    }
+}
+
+void FrustumCuller::updateBounds(size_t index, const BoundingBox& box) {
+    if (!box.isValid()) {
+        const float culledExtent = -std::numeric_limits<float>::max();
+        m_centerX[index] = m_centerY[index] = m_centerZ[index] = 0.0f;
+        m_extentX[index] = m_extentY[index] = m_extentZ[index] = culledExtent;
+        return;
+    }
+
+    const glm::vec3 center = box.getCenter();
+    const glm::vec3 extent = box.getSize() * 0.5f;
+    m_centerX[index] = center.x; m_centerY[index] = center.y; m_centerZ[index] = center.z;
+    m_extentX[index] = extent.x; m_extentY[index] = extent.y; m_extentZ[index] = extent.z;
+}
+
+CullingPath FrustumCuller::resolvePath(CullingPath path) {
+#ifdef GLTFVIEWER_SIMD_AVX
+    const CullingPath best = CullingPath::AVX;
+#elif defined(GLTFVIEWER_SIMD_SSE)
+    const CullingPath best = CullingPath::SSE;
+#else
+    const CullingPath best = CullingPath::Scalar;
+#endif
+
+    if (path == CullingPath::Best) {
+        return best;
+    }
+    // ビルドされていない命令セットは利用可能な実装へ落とす
+    if (path == CullingPath::AVX && best != CullingPath::AVX) {
+        return best;
+    }
+    if (path == CullingPath::SSE && best == CullingPath::Scalar) {
+        return best;
+    }
+    return path;
+}
+
+const char* FrustumCuller::getPathName(CullingPath path) {
+    switch (path) {
+    case CullingPath::Scalar: return "Scalar";
+    case CullingPath::SSE: return "SSE";
+    case CullingPath::AVX: return "AVX";
+    default: return "Best";
+    }
+}
+
+CullingStats FrustumCuller::cull(const Frustum& frustum, std::vector<int>& visible, CullingPath path) const {
+    visible.clear();
+
+    switch (resolvePath(path)) {
+    case CullingPath::AVX:
+        cullAVX(frustum, visible);
+        break;
+    case CullingPath::SSE:
+        cullSSE(frustum, visible);
+        break;
+    default:
+        cullScalar(frustum, visible);
+        break;
+    }
+
+    CullingStats stats;
+    stats.m_total = m_count;
+    stats.m_visible = visible.size();
+    stats.m_culled = m_count - visible.size();
+    return stats;
+}
+
+void FrustumCuller::cullScalar(const Frustum& frustum, std::vector<int>& visible) const {
+    const PlaneSet planes(frustum);
+
+    for (size_t i = 0; i < m_count; ++i) {
+        bool inside = true;
+        for (int p = 0; p < Frustum::PlaneCount && inside; ++p) {
+            // 中心の符号付き距離 + 法線方向の半径が負なら平面の外側
+            const float distance = planes.m_nx[p] * m_centerX[i] + planes.m_ny[p] * m_centerY[i] + planes.m_nz[p] * m_centerZ[i] + planes.m_w[p];
+            const float radius = planes.m_ax[p] * m_extentX[i] + planes.m_ay[p] * m_extentY[i] + planes.m_az[p] * m_extentZ[i];
+            inside = distance + radius >= 0.0f;
+        }
+        if (inside) {
+            visible.push_back(static_cast<int>(i));
+        }
+    }
+}
+
+void FrustumCuller::cullSSE(const Frustum& frustum, std::vector<int>& visible) const {
+#ifdef GLTFVIEWER_SIMD_SSE
+    const PlaneSet planes(frustum);
+    const __m128 zero = _mm_setzero_ps();
+    const size_t padded = m_centerX.size();
+
+    for (size_t i = 0; i < padded; i += 4) {
+        const __m128 cx = _mm_loadu_ps(&m_centerX[i]);
+        const __m128 cy = _mm_loadu_ps(&m_centerY[i]);
+        const __m128 cz = _mm_loadu_ps(&m_centerZ[i]);
+        const __m128 ex = _mm_loadu_ps(&m_extentX[i]);
+        const __m128 ey = _mm_loadu_ps(&m_extentY[i]);
+        const __m128 ez = _mm_loadu_ps(&m_extentZ[i]);
+
+        int mask = 0xF;
+        for (int p = 0; p < Frustum::PlaneCount && mask != 0; ++p) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.m_nx[p]), cx), _mm_mul_ps(_mm_set1_ps(planes.m_ny[p]), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.m_nz[p]), cz), _mm_set1_ps(planes.m_w[p])));
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.m_ax[p]), ex), _mm_mul_ps(_mm_set1_ps(planes.m_ay[p]), ey)),
+                _mm_mul_ps(_mm_set1_ps(planes.m_az[p]), ez));
+            mask &= _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        emitVisible(mask, i, 4, m_count, visible);
+    }
+#else
+    cullScalar(frustum, visible);
+#endif
+}
+
+void FrustumCuller::cullAVX(const Frustum& frustum, std::vector<int>& visible) const {
+#ifdef GLTFVIEWER_SIMD_AVX
+    const PlaneSet planes(frustum);
+    const __m256 zero = _mm256_setzero_ps();
+    const size_t padded = m_centerX.size();
+
+    for (size_t i = 0; i < padded; i += 8) {
+        const __m256 cx = _mm256_loadu_ps(&m_centerX[i]);
+        const __m256 cy = _mm256_loadu_ps(&m_centerY[i]);
+        const __m256 cz = _mm256_loadu_ps(&m_centerZ[i]);
+        const __m256 ex = _mm256_loadu_ps(&m_extentX[i]);
+        const __m256 ey = _mm256_loadu_ps(&m_extentY[i]);
+        const __m256 ez = _mm256_loadu_ps(&m_extentZ[i]);
+
+        int mask = 0xFF;
+        for (int p = 0; p < Frustum::PlaneCount && mask != 0; ++p) {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.m_nx[p]), cx), _mm256_mul_ps(_mm256_set1_ps(planes.m_ny[p]), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.m_nz[p]), cz), _mm256_set1_ps(planes.m_w[p])));
+            __m256 radius = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.m_ax[p]), ex), _mm256_mul_ps(_mm256_set1_ps(planes.m_ay[p]), ey)),
+                _mm256_mul_ps(_mm256_set1_ps(planes.m_az[p]), ez));
+            mask &= _mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+        }
+
+        emitVisible(mask, i, 8, m_count, visible);
+    }
+#else
+    cullSSE(frustum, visible);
+#endif
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include "BoundingVolume.h"
+#include <vector>
+#include <cstddef>
+
+// カリングの判定に使う命令セット
+enum class CullingPath {
+    Scalar,
+    SSE,    // 4オブジェクト単位
+    AVX,    // 8オブジェクト単位（__AVX__ でビルドされた場合のみ）
+    Best    // 利用可能な最も幅の広い実装
+};
+
+// 1フレーム分のカリング統計
+struct CullingStats {
+    size_t m_total;
+    size_t m_visible;
+    size_t m_culled;
+
+    CullingStats() : m_total(0), m_visible(0), m_culled(0) {}
+};
+
+// AABBをSoA形式（中心・半径の各成分ごとの配列）で保持し、視錐台カリングをSIMDで一括処理する
+// GLに依存しないため、固定のカメラ姿勢を与えればウィンドウなしで実行できる
+class FrustumCuller {
+private:
+    // 要素数は8の倍数に切り上げ、余りは常にカリングされるダミーで埋める
+    std::vector<float> m_centerX, m_centerY, m_centerZ;
+    std::vector<float> m_extentX, m_extentY, m_extentZ;
+    size_t m_count;
+
+    void cullScalar(const Frustum& frustum, std::vector<int>& visible) const;
+    void cullSSE(const Frustum& frustum, std::vector<int>& visible) const;
+    void cullAVX(const Frustum& frustum, std::vector<int>& visible) const;
+
+public:
+    FrustumCuller();
+
+    // オブジェクトのAABBを設定（無効なAABBは常にカリングされる）
+    void setBounds(const std::vector<BoundingBox>& bounds);
+    void updateBounds(size_t index, const BoundingBox& box);
+    void clear();
+
+    // 視錐台と交差するオブジェクトの番号を昇順で visible に格納する
+    CullingStats cull(const Frustum& frustum, std::vector<int>& visible, CullingPath path = CullingPath::Best) const;
+
+    size_t getCount() const { return m_count; }
+
+    // 実際に使用される命令セット
+    static CullingPath resolvePath(CullingPath path);
+    static const char* getPathName(CullingPath path);
+};
@@ -0,0 +1,285 @@
+﻿#include "GLContext.h"
+#include <iostream>
+#ifdef _WIN32
+#include <tchar.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
+
+namespace {
+#ifdef _WIN32
+    const LPCTSTR kHeadlessWindowClassName = _T("gltfViewerHeadless");
+
+    // WGL のコンテキスト
+    // owner の場合はデバイスコンテキストを（headless の場合はウィンドウも）所有し、共有コンテキストはそれを借りる
+    class WGLContext : public GLContext {
+    private:
+        HWND m_hWnd;
+        HDC m_hDC;
+        HGLRC m_hRC;
+        bool m_owner;
+        bool m_headless;
+
+    public:
+        WGLContext(HWND window, HDC hDC, HGLRC hRC, bool owner, bool headless)
+            : m_hWnd(window), m_hDC(hDC), m_hRC(hRC), m_owner(owner), m_headless(headless) {}
+
+        ~WGLContext() override {
+            if (wglGetCurrentContext() == m_hRC) {
+                wglMakeCurrent(nullptr, nullptr);
+            }
+            wglDeleteContext(m_hRC);
+            if (m_owner) {
+                ReleaseDC(m_hWnd, m_hDC);
+                if (m_headless) {
+                    DestroyWindow(m_hWnd);
+                }
+            }
+        }
+
+        bool makeCurrent() override {
+            return wglMakeCurrent(m_hDC, m_hRC) != FALSE;
+        }
+
+        void doneCurrent() override {
+            wglMakeCurrent(nullptr, nullptr);
+        }
+
+        void swapBuffers() override {
+            if (!m_headless) {
+                SwapBuffers(m_hDC);
+            }
+        }
+
+        bool isHeadless() const override { return m_headless; }
+
+        std::string getDescription() const override {
+            return m_headless ? "WGL（表示しないウィンドウ）" : "WGL";
+        }
+
+        std::unique_ptr<GLContext> createSharedContext() override {
+            // 共有コンテキストはオブジェクトを作る前に wglShareLists で関連付ける必要がある
+            HGLRC context = wglCreateContext(m_hDC);
+            if (!context) {
+                return nullptr;
+            }
+            if (!wglShareLists(m_hRC, context)) {
+                wglDeleteContext(context);
+                return nullptr;
+            }
+            return std::unique_ptr<GLContext>(new WGLContext(m_hWnd, m_hDC, context, false, m_headless));
+        }
+    };
+
+    std::unique_ptr<GLContext> createWGLContext(HWND window, bool headless) {
+        // デバイスコンテキストを取得
+        HDC hDC = GetDC(window);
+        if (!hDC) {
+            std::cerr << "デバイスコンテキストの取得に失敗しました" << std::endl;
+            return nullptr;
+        }
+
+        // ピクセルフォーマットを設定
+        PIXELFORMATDESCRIPTOR pfd = {};
+        pfd.nSize = sizeof(PIXELFORMATDESCRIPTOR);
+        pfd.nVersion = 1;
+        pfd.dwFlags = PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER;
+        pfd.iPixelType = PFD_TYPE_RGBA;
+        pfd.cColorBits = 32;
+        pfd.cDepthBits = 24;
+        pfd.cStencilBits = 8;
+        pfd.iLayerType = PFD_MAIN_PLANE;
+
+        int pixelFormat = ChoosePixelFormat(hDC, &pfd);
+        if (!pixelFormat) {
+            std::cerr << "適切なピクセルフォーマットが見つかりません" << std::endl;
+            ReleaseDC(window, hDC);
+            return nullptr;
+        }
+
+        if (!SetPixelFormat(hDC, pixelFormat, &pfd)) {
+            std::cerr << "ピクセルフォーマットの設定に失敗しました" << std::endl;
+            ReleaseDC(window, hDC);
+            return nullptr;
+        }
+
+        // OpenGLレンダリングコンテキストを作成
+        HGLRC hRC = wglCreateContext(hDC);
+        if (!hRC) {
+            std::cerr << "OpenGLコンテキストの作成に失敗しました" << std::endl;
+            ReleaseDC(window, hDC);
+            return nullptr;
+        }
+        return std::unique_ptr<GLContext>(new WGLContext(window, hDC, hRC, true, headless));
+    }
+#else
+    // 初期化した EGLDisplay（共有コンテキストも同じディスプレイを使うので、最後のコンテキストの破棄で終了する）
+    struct EGLDisplayHandle {
+        EGLDisplay m_display;
+
+        explicit EGLDisplayHandle(EGLDisplay display) : m_display(display) {}
+        ~EGLDisplayHandle() { eglTerminate(m_display); }
+    };
+
+    // サーフェスを持たない EGL のコンテキスト（eglMakeCurrent に EGL_NO_SURFACE を渡して有効にする）
+    class EGLSurfacelessContext : public GLContext {
+    private:
+        std::shared_ptr<EGLDisplayHandle> m_display;
+        EGLConfig m_config;
+        EGLContext m_context;
+        std::string m_description;
+
+    public:
+        EGLSurfacelessContext(const std::shared_ptr<EGLDisplayHandle>& display, EGLConfig config, EGLContext context, const std::string& description)
+            : m_display(display), m_config(config), m_context(context), m_description(description) {}
+
+        ~EGLSurfacelessContext() override {
+            if (eglGetCurrentContext() == m_context) {
+                eglMakeCurrent(m_display->m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            }
+            eglDestroyContext(m_display->m_display, m_context);
+        }
+
+        bool makeCurrent() override {
+            return eglMakeCurrent(m_display->m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context) == EGL_TRUE;
+        }
+
+        void doneCurrent() override {
+            eglMakeCurrent(m_display->m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        }
+
+        void swapBuffers() override {
+            // 表示するサーフェスが無い
+        }
+
+        bool isHeadless() const override { return true; }
+
+        std::string getDescription() const override { return m_description; }
+
+        std::unique_ptr<GLContext> createSharedContext() override {
+            EGLContext context = eglCreateContext(m_display->m_display, m_config, m_context, nullptr);
+            if (context == EGL_NO_CONTEXT) {
+                return nullptr;
+            }
+            return std::unique_ptr<GLContext>(new EGLSurfacelessContext(m_display, m_config, context, m_description));
+        }
+    };
+
+    bool hasExtension(const char* extensions, const char* name) {
+        if (!extensions) {
+            return false;
+        }
+        const size_t length = std::strlen(name);
+        for (const char* found = std::strstr(extensions, name); found; found = std::strstr(found + length, name)) {
+            if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // X11 / Wayland のディスプレイを開かない Mesa の surfaceless プラットフォームを優先し、
+    // 無い場合（Mesa 以外のドライバー）は既定のディスプレイを使う
+    EGLDisplay openDisplay(std::string& platform) {
+        const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+            EGLDisplay display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+                platform = "surfaceless";
+                return display;
+            }
+        }
+        EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+            platform = "default display";
+            return display;
+        }
+        return EGL_NO_DISPLAY;
+    }
+#endif
+}
+
+#ifdef _WIN32
+std::unique_ptr<GLContext> GLContext::createForWindow(HWND window) {
+    return createWGLContext(window, false);
+}
+
+// EGL が無いため、表示しないウィンドウ（デバイスコンテキストを得るためだけに使う）に WGL のコンテキストを作る
+std::unique_ptr<GLContext> GLContext::createHeadless() {
+    HINSTANCE hInstance = GetModuleHandle(nullptr);
+
+    static bool registered = false;
+    if (!registered) {
+        WNDCLASSEX wc = {};
+        wc.cbSize = sizeof(WNDCLASSEX);
+        wc.style = CS_OWNDC;
+        wc.lpfnWndProc = DefWindowProc;
+        wc.hInstance = hInstance;
+        wc.lpszClassName = kHeadlessWindowClassName;
+        if (!RegisterClassEx(&wc)) {
+            std::cerr << "オフスクリーン描画用のウィンドウクラスの登録に失敗しました" << std::endl;
+            return nullptr;
+        }
+        registered = true;
+    }
+
+    // ShowWindow を呼ばないので画面には表示されない
+    HWND window = CreateWindowEx(0, kHeadlessWindowClassName, _T("gltfViewer (headless)"), WS_OVERLAPPEDWINDOW,
+        CW_USEDEFAULT, CW_USEDEFAULT, 64, 64, nullptr, nullptr, hInstance, nullptr);
+    if (!window) {
+        std::cerr << "オフスクリーン描画用のウィンドウの作成に失敗しました" << std::endl;
+        return nullptr;
+    }
+    std::unique_ptr<GLContext> context = createWGLContext(window, true);
+    if (!context) {
+        DestroyWindow(window);
+    }
+    return context;
+}
+#else
+std::unique_ptr<GLContext> GLContext::createHeadless() {
+    std::string platform;
+    EGLDisplay display = openDisplay(platform);
+    if (display == EGL_NO_DISPLAY) {
+        std::cerr << "エラー: EGLディスプレイを初期化できません (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return nullptr;
+    }
+    std::shared_ptr<EGLDisplayHandle> handle = std::make_shared<EGLDisplayHandle>(display);
+
+    if (!hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        std::cerr << "エラー: EGLがサーフェスの無いコンテキスト (EGL_KHR_surfaceless_context) に対応していません" << std::endl;
+        return nullptr;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "エラー: EGLでOpenGL（OpenGL ES ではない）を使えません" << std::endl;
+        return nullptr;
+    }
+
+    // 描画先はFBOなので、コンテキストを作れればどの構成でもよい
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cerr << "エラー: OpenGLを描画できるEGLの構成がありません" << std::endl;
+        return nullptr;
+    }
+
+    // WGL と同じく版を指定せず、互換プロファイルの最新の版で作る
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "エラー: EGLのOpenGLコンテキストを作成できません (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return nullptr;
+    }
+
+    const char* vendor = eglQueryString(display, EGL_VENDOR);
+    const char* version = eglQueryString(display, EGL_VERSION);
+    const std::string description = "EGL " + platform + " (" + (vendor ? vendor : "") + " " + (version ? version : "") + ")";
+    return std::unique_ptr<GLContext>(new EGLSurfacelessContext(handle, config, context, description));
+}
+#endif
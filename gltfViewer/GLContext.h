@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <memory>
+#include <string>
+
+// OpenGLコンテキストの作成と有効化（OpenGLRenderer・AsyncShaderCompiler はウィンドウやプラットフォームに依存せずこれを使う）
+// ウィンドウ: WGL でウィンドウのデバイスコンテキストに作る（Windows のみ）
+// オフスクリーン: 既定のフレームバッファーを持たないコンテキスト（描画先は呼び出し側が作るFBO）
+//   Linux などでは EGL のサーフェスを使わないコンテキスト（EGL_MESA_platform_surfaceless）で、ディスプレイもGPUも不要
+//   （GPUが無い場合は Mesa の llvmpipe で描画する）
+//   Windows では EGL が無いため、表示しないウィンドウの WGL コンテキストを使う
+class GLContext {
+public:
+    virtual ~GLContext() {}
+
+    // 呼び出したスレッドで有効にする / 無効にする
+    virtual bool makeCurrent() = 0;
+    virtual void doneCurrent() = 0;
+
+    // ウィンドウのバックバッファーを表示する（オフスクリーンでは何もしない）
+    virtual void swapBuffers() = 0;
+
+    virtual bool isHeadless() const = 0;
+    virtual std::string getDescription() const = 0;
+
+    // オブジェクト（シェーダー・プログラム・バッファーなど）を共有するコンテキストを作る（作れない場合は nullptr）
+    // 有効にしていない状態で返すので、使うスレッドで makeCurrent() する
+    virtual std::unique_ptr<GLContext> createSharedContext() = 0;
+
+#ifdef _WIN32
+    static std::unique_ptr<GLContext> createForWindow(HWND window);
+#endif
+    static std::unique_ptr<GLContext> createHeadless();
+};
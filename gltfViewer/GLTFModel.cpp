@@ -1,13 +1,47 @@
-﻿#include <Windows.h>
-#include <iostream>
+﻿#include <iostream>
 
 #include <tiny_gltf.h>
+#include <stb_image.h>
 #include "GLTFModel.h"
 
+namespace {
+    // 画像はエンコードされたまま（as_is）保持し、大きさと要素数だけをヘッダーから読み取る
+    // デコードはテクスチャストリーミングのワーカースレッドで行う（読み込み中に全画像をデコードしない）
+    bool keepEncodedImage(tinygltf::Image* image, const int imageIndex, std::string* err, std::string* warn,
+        int requestedWidth, int requestedHeight, const unsigned char* bytes, int size, void* userData)
+    {
+        (void)err;
+        (void)requestedWidth;
+        (void)requestedHeight;
+        (void)userData;
+
+        int width = 0;
+        int height = 0;
+        int component = 0;
+        if (!stbi_info_from_memory(bytes, size, &width, &height, &component)) {
+            // 読み込み自体は続け、テクスチャは白で描画する
+            if (warn) {
+                *warn += "画像 " + std::to_string(imageIndex) + " の形式に対応していません: " + stbi_failure_reason() + "\n";
+            }
+            return true;
+        }
+
+        image->width = width;
+        image->height = height;
+        image->component = component;
+        image->bits = stbi_is_16_bit_from_memory(bytes, size) ? 16 : 8;
+        image->pixel_type = image->bits == 16 ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+        image->image.assign(bytes, bytes + size);
+        image->as_is = true;
+        return true;
+    }
+}
+
 
 bool GLTFModel::loadFromFile(const std::string& filepath)
 {
     tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(keepEncodedImage, nullptr);
     std::string err;
     std::string warn;
 
@@ -0,0 +1,68 @@
+﻿#include "GPUBufferCache.h"
+#include <iostream>
+
+GPUBuffer::GPUBuffer(GLenum target, const void* data, size_t byteSize, GLenum usage)
+    : m_buffer(0)
+    , m_target(target)
+    , m_byteSize(byteSize)
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(m_target, m_buffer);
+    glBufferData(m_target, static_cast<GLsizeiptr>(byteSize), data, usage);
+    glBindBuffer(m_target, 0);
+}
+
+GPUBuffer::~GPUBuffer() {
+    if (m_buffer != 0) {
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+}
+
+GPUBufferCache::GPUBufferCache()
+    : m_uploadedBytes(0)
+    , m_reusedBytes(0)
+    , m_uploadCount(0)
+    , m_reuseCount(0)
+{
+}
+
+std::shared_ptr<GPUBuffer> GPUBufferCache::find(const BufferKey& key) {
+    auto it = m_buffers.find(key);
+    if (it == m_buffers.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<GPUBuffer> buffer = it->second.lock();
+    if (!buffer) {
+        // 既に解放済み
+        m_buffers.erase(it);
+        return nullptr;
+    }
+
+    m_reusedBytes += buffer->getByteSize();
+    ++m_reuseCount;
+    return buffer;
+}
+
+std::shared_ptr<GPUBuffer> GPUBufferCache::create(const BufferKey& key, GLenum target, const void* data, size_t byteSize) {
+    auto buffer = std::make_shared<GPUBuffer>(target, data, byteSize);
+    m_buffers[key] = buffer;
+
+    m_uploadedBytes += byteSize;
+    ++m_uploadCount;
+    return buffer;
+}
+
+void GPUBufferCache::printStatistics() const {
+    std::cout << "  GPUバッファー共有: アップロード " << m_uploadCount << " 個 (" << m_uploadedBytes << " バイト), "
+        << "共有 " << m_reuseCount << " 回 (重複回避 " << m_reusedBytes << " バイト)" << std::endl;
+}
+
+void GPUBufferCache::clear() {
+    m_buffers.clear();
+    m_uploadedBytes = 0;
+    m_reusedBytes = 0;
+    m_uploadCount = 0;
+    m_reuseCount = 0;
+}
@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include <functional>
+
+// 参照カウントで共有されるOpenGLバッファー
+// 最後の参照が解放されたときに glDeleteBuffers される
+class GPUBuffer {
+private:
+    GLuint m_buffer;
+    GLenum m_target;
+    size_t m_byteSize;
+
+public:
+    GPUBuffer(GLenum target, const void* data, size_t byteSize, GLenum usage = GL_STATIC_DRAW);
+    ~GPUBuffer();
+
+    GPUBuffer(const GPUBuffer&) = delete;
+    GPUBuffer& operator=(const GPUBuffer&) = delete;
+
+    GLuint getID() const { return m_buffer; }
+    GLenum getTarget() const { return m_target; }
+    size_t getByteSize() const { return m_byteSize; }
+};
+
+// バッファーのデータレイアウト（同じアクセサーでも変換結果が異なればキーを分ける）
+enum class BufferLayout : int {
+    PositionFloat3 = 0,      // 頂点位置 (float x3)
+    IndexTriangles = 1,      // 正規化済み三角形リスト (uint32)
+    IndexLines = 2,          // 正規化済みラインリスト (uint32)
+    IndexPoints = 3,         // 正規化済みポイントリスト (uint32)
+    JointsUInt4 = 4,         // スキンの関節番号 JOINTS_0 (uint32 x4)
+    WeightsFloat4 = 5        // スキンのウェイト WEIGHTS_0 (float x4)
+};
+
+// (アクセサー, レイアウト) をキーとする共有キー
+struct BufferKey {
+    int m_accessorIndex;   // インデックスなしプリミティブの場合は -1
+    int m_layout;          // BufferLayout と変換元のglTFモードの組み合わせ
+    size_t m_count;        // インデックスなしプリミティブの頂点数（アクセサーがある場合は 0）
+
+    bool operator==(const BufferKey& other) const {
+        return m_accessorIndex == other.m_accessorIndex && m_layout == other.m_layout && m_count == other.m_count;
+    }
+};
+
+struct BufferKeyHash {
+    size_t operator()(const BufferKey& key) const {
+        size_t h = std::hash<int>()(key.m_accessorIndex);
+        h ^= std::hash<int>()(key.m_layout) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<size_t>()(key.m_count) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+    }
+};
+
+// アクセサー単位でGPUバッファーを共有するキャッシュ
+// 同じアクセサーを参照する複数のプリミティブ・メッシュ（マルチマテリアル、LODなど）は
+// 1つのバッファーを共有し、VRAM使用量の重複を避ける
+class GPUBufferCache {
+private:
+    std::unordered_map<BufferKey, std::weak_ptr<GPUBuffer>, BufferKeyHash> m_buffers;
+
+    // 統計情報
+    size_t m_uploadedBytes;   // 実際にアップロードしたバイト数
+    size_t m_reusedBytes;     // 共有により回避した重複バイト数
+    size_t m_uploadCount;
+    size_t m_reuseCount;
+
+public:
+    GPUBufferCache();
+
+    // キャッシュ済みのバッファーを取得（無ければ nullptr）
+    std::shared_ptr<GPUBuffer> find(const BufferKey& key);
+
+    // 新しいバッファーを作成してキャッシュに登録
+    std::shared_ptr<GPUBuffer> create(const BufferKey& key, GLenum target, const void* data, size_t byteSize);
+
+    // 統計情報
+    size_t getUploadedBytes() const { return m_uploadedBytes; }
+    size_t getReusedBytes() const { return m_reusedBytes; }
+    size_t getUploadCount() const { return m_uploadCount; }
+    size_t getReuseCount() const { return m_reuseCount; }
+    void printStatistics() const;
+
+    // キャッシュと統計をクリア（バッファー自体は参照が残る限り解放されない）
+    void clear();
+};
@@ -0,0 +1,138 @@
+﻿#include "GeometryPool.h"
+#include <iostream>
+#include <limits>
+
+GeometryPool::GeometryPool()
+    : m_indexCount(0)
+    , m_uploaded(false)
+    , m_reusedBytes(0)
+    , m_reuseCount(0)
+{
+}
+
+GLint GeometryPool::findVertices(VertexFormat format, const VertexKey& key) {
+    FormatStorage& storage = m_formats[static_cast<int>(format)];
+    auto it = storage.m_vertexRanges.find(key);
+    if (it == storage.m_vertexRanges.end()) {
+        return -1;
+    }
+
+    ++m_reuseCount;
+    return it->second;
+}
+
+GLint GeometryPool::addVertices(VertexFormat format, const VertexKey& key, const std::vector<float>& positions,
+    const std::vector<unsigned int>& joints, const std::vector<float>& weights, const std::vector<float>& texcoords)
+{
+    FormatStorage& storage = m_formats[static_cast<int>(format)];
+    const GLint baseVertex = storage.m_vertexCount;
+    const size_t vertexCount = positions.size() / 3;
+    if (static_cast<size_t>(baseVertex) + vertexCount > static_cast<size_t>(std::numeric_limits<GLint>::max())) {
+        std::cerr << "エラー: 共有頂点バッファーの頂点数が上限を超えました" << std::endl;
+        return -1;
+    }
+
+    storage.m_positions.insert(storage.m_positions.end(), positions.begin(), positions.begin() + vertexCount * 3);
+    if (format == VertexFormat::Skinned) {
+        storage.m_joints.insert(storage.m_joints.end(), joints.begin(), joints.begin() + vertexCount * 4);
+        storage.m_weights.insert(storage.m_weights.end(), weights.begin(), weights.begin() + vertexCount * 4);
+    }
+    if (texcoords.size() >= vertexCount * 2) {
+        storage.m_texcoords.insert(storage.m_texcoords.end(), texcoords.begin(), texcoords.begin() + vertexCount * 2);
+    } else {
+        storage.m_texcoords.resize(storage.m_texcoords.size() + vertexCount * 2, 0.0f);
+    }
+    storage.m_vertexCount += static_cast<GLint>(vertexCount);
+    storage.m_vertexRanges[key] = baseVertex;
+    return baseVertex;
+}
+
+bool GeometryPool::findIndices(const BufferKey& key, GLuint& firstIndex, GLsizei& indexCount) {
+    auto it = m_indexRanges.find(key);
+    if (it == m_indexRanges.end()) {
+        return false;
+    }
+
+    firstIndex = it->second.first;
+    indexCount = it->second.second;
+    m_reusedBytes += static_cast<size_t>(indexCount) * sizeof(unsigned int);
+    ++m_reuseCount;
+    return true;
+}
+
+GLuint GeometryPool::addIndices(const BufferKey& key, const std::vector<unsigned int>& indices) {
+    const GLuint firstIndex = m_indexCount;
+    m_indices.insert(m_indices.end(), indices.begin(), indices.end());
+    m_indexCount += static_cast<GLuint>(indices.size());
+    m_indexRanges[key] = std::make_pair(firstIndex, static_cast<GLsizei>(indices.size()));
+    return firstIndex;
+}
+
+bool GeometryPool::upload() {
+    for (int format = 0; format < kVertexFormatCount; ++format) {
+        FormatStorage& storage = m_formats[format];
+        if (storage.m_vertexRanges.empty()) {
+            continue;
+        }
+        storage.m_positionBuffer = std::make_shared<GPUBuffer>(GL_ARRAY_BUFFER,
+            storage.m_positions.data(), storage.m_positions.size() * sizeof(float));
+        if (format == static_cast<int>(VertexFormat::Skinned)) {
+            storage.m_jointBuffer = std::make_shared<GPUBuffer>(GL_ARRAY_BUFFER,
+                storage.m_joints.data(), storage.m_joints.size() * sizeof(unsigned int));
+            storage.m_weightBuffer = std::make_shared<GPUBuffer>(GL_ARRAY_BUFFER,
+                storage.m_weights.data(), storage.m_weights.size() * sizeof(float));
+        }
+        storage.m_texcoordBuffer = std::make_shared<GPUBuffer>(GL_ARRAY_BUFFER,
+            storage.m_texcoords.data(), storage.m_texcoords.size() * sizeof(float));
+
+        // 以降はGPUバッファーだけを参照するので解放する
+        std::vector<float>().swap(storage.m_positions);
+        std::vector<unsigned int>().swap(storage.m_joints);
+        std::vector<float>().swap(storage.m_weights);
+        std::vector<float>().swap(storage.m_texcoords);
+    }
+
+    if (!m_indexRanges.empty()) {
+        m_indexBuffer = std::make_shared<GPUBuffer>(GL_ELEMENT_ARRAY_BUFFER, m_indices.data(), m_indices.size() * sizeof(unsigned int));
+        std::vector<unsigned int>().swap(m_indices);
+    }
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        std::cerr << "エラー: 共有バッファーの転送中にOpenGLエラーが発生しました: " << error << std::endl;
+        return false;
+    }
+
+    m_uploaded = true;
+    return true;
+}
+
+void GeometryPool::clear() {
+    for (FormatStorage& storage : m_formats) {
+        storage = FormatStorage();
+    }
+    m_indices.clear();
+    m_indexRanges.clear();
+    m_indexCount = 0;
+    m_indexBuffer.reset();
+    m_uploaded = false;
+    m_reusedBytes = 0;
+    m_reuseCount = 0;
+}
+
+size_t GeometryPool::getGPUBytes() const {
+    size_t bytes = m_indexBuffer ? m_indexBuffer->getByteSize() : 0;
+    for (const FormatStorage& storage : m_formats) {
+        bytes += storage.m_positionBuffer ? storage.m_positionBuffer->getByteSize() : 0;
+        bytes += storage.m_jointBuffer ? storage.m_jointBuffer->getByteSize() : 0;
+        bytes += storage.m_weightBuffer ? storage.m_weightBuffer->getByteSize() : 0;
+        bytes += storage.m_texcoordBuffer ? storage.m_texcoordBuffer->getByteSize() : 0;
+    }
+    return bytes;
+}
+
+void GeometryPool::printStatistics() const {
+    std::cout << "  共有ジオメトリバッファー: 頂点 " << getVertexCount(VertexFormat::Position)
+        << " (スキン " << getVertexCount(VertexFormat::Skinned) << "), インデックス " << m_indexCount
+        << ", GPU " << getGPUBytes() << " バイト, 共有 " << m_reuseCount << " 回 (インデックスの重複回避 " << m_reusedBytes << " バイト)" << std::endl;
+}
@@ -0,0 +1,117 @@
+﻿#pragma once
+
+#include "GPUBufferCache.h"
+#include <GL/glew.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+// 頂点フォーマット（同じフォーマットのジオメトリは頂点バッファーとVAOを共有する）
+// どちらのフォーマットも TEXCOORD_0 (float x2) を別のバッファーに持つ（無いプリミティブは 0）
+enum class VertexFormat : int {
+    Position = 0,   // 位置 (float x3)
+    Skinned = 1     // 位置 + JOINTS_0 (uint32 x4) + WEIGHTS_0 (float x4)
+};
+const int kVertexFormatCount = 2;
+
+// glMultiDrawElementsIndirect のコマンド（メンバーの並びはOpenGLの仕様どおり）
+struct DrawElementsIndirectCommand {
+    GLuint m_count;
+    GLuint m_instanceCount;
+    GLuint m_firstIndex;
+    GLint m_baseVertex;
+    GLuint m_baseInstance;
+};
+
+// 頂点データのキー（スキンなしの場合は関節・ウェイトを、TEXCOORD_0 が無い場合はテクスチャ座標を -1 とする）
+struct VertexKey {
+    int m_positionAccessor;
+    int m_jointAccessor;
+    int m_weightAccessor;
+    int m_texcoordAccessor;
+
+    bool operator==(const VertexKey& other) const {
+        return m_positionAccessor == other.m_positionAccessor &&
+            m_jointAccessor == other.m_jointAccessor && m_weightAccessor == other.m_weightAccessor &&
+            m_texcoordAccessor == other.m_texcoordAccessor;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& key) const {
+        size_t h = std::hash<int>()(key.m_positionAccessor);
+        h ^= std::hash<int>()(key.m_jointAccessor) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<int>()(key.m_weightAccessor) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<int>()(key.m_texcoordAccessor) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+    }
+};
+
+// 全ジオメトリを頂点フォーマットごとの大きな頂点バッファーと、共通の大きなインデックスバッファーに詰めたもの
+// プリミティブは (先頭頂点, 先頭インデックス) で参照し、インデックスはプリミティブ内の頂点番号のまま格納する
+// （描画時に baseVertex を加える）。同じアクセサーのデータは1回だけ格納して共有する
+// ロード中は add で CPU 側に溜め、upload() で一度に転送する
+class GeometryPool {
+private:
+    struct FormatStorage {
+        std::vector<float> m_positions;
+        std::vector<unsigned int> m_joints;
+        std::vector<float> m_weights;
+        std::vector<float> m_texcoords;
+        std::unordered_map<VertexKey, GLint, VertexKeyHash> m_vertexRanges;  // キー → 先頭頂点
+        GLint m_vertexCount;
+
+        std::shared_ptr<GPUBuffer> m_positionBuffer;
+        std::shared_ptr<GPUBuffer> m_jointBuffer;
+        std::shared_ptr<GPUBuffer> m_weightBuffer;
+        std::shared_ptr<GPUBuffer> m_texcoordBuffer;
+
+        FormatStorage() : m_vertexCount(0) {}
+    };
+
+    FormatStorage m_formats[kVertexFormatCount];
+    std::vector<unsigned int> m_indices;
+    std::unordered_map<BufferKey, std::pair<GLuint, GLsizei>, BufferKeyHash> m_indexRanges;  // キー → (先頭, 数)
+    GLuint m_indexCount;
+    std::shared_ptr<GPUBuffer> m_indexBuffer;
+    bool m_uploaded;
+
+    // 統計情報
+    size_t m_reusedBytes;
+    size_t m_reuseCount;
+
+public:
+    GeometryPool();
+
+    // 格納済みの頂点データの先頭頂点（無ければ -1）
+    GLint findVertices(VertexFormat format, const VertexKey& key);
+
+    // 頂点データを追加して先頭頂点を返す（joints・weights は Skinned のみ、頂点あたり4要素）
+    // texcoords は頂点あたり2要素（空の場合は 0 で埋める）
+    GLint addVertices(VertexFormat format, const VertexKey& key, const std::vector<float>& positions,
+        const std::vector<unsigned int>& joints, const std::vector<float>& weights, const std::vector<float>& texcoords);
+
+    // 格納済みのインデックスの範囲（無ければ false）
+    bool findIndices(const BufferKey& key, GLuint& firstIndex, GLsizei& indexCount);
+
+    // インデックスを追加して先頭を返す
+    GLuint addIndices(const BufferKey& key, const std::vector<unsigned int>& indices);
+
+    // 溜めたデータをGPUバッファーへ転送し、CPU側のデータを解放する
+    bool upload();
+    void clear();
+
+    const std::shared_ptr<GPUBuffer>& getPositionBuffer(VertexFormat format) const { return m_formats[static_cast<int>(format)].m_positionBuffer; }
+    const std::shared_ptr<GPUBuffer>& getJointBuffer(VertexFormat format) const { return m_formats[static_cast<int>(format)].m_jointBuffer; }
+    const std::shared_ptr<GPUBuffer>& getWeightBuffer(VertexFormat format) const { return m_formats[static_cast<int>(format)].m_weightBuffer; }
+    const std::shared_ptr<GPUBuffer>& getTexcoordBuffer(VertexFormat format) const { return m_formats[static_cast<int>(format)].m_texcoordBuffer; }
+    const std::shared_ptr<GPUBuffer>& getIndexBuffer() const { return m_indexBuffer; }
+
+    bool isUploaded() const { return m_uploaded; }
+    GLint getVertexCount(VertexFormat format) const { return m_formats[static_cast<int>(format)].m_vertexCount; }
+    GLuint getIndexCount() const { return m_indexCount; }
+    size_t getGPUBytes() const;
+    void printStatistics() const;
+};
@@ -0,0 +1,732 @@
+﻿#include "GeometryStreaming.h"
+#include "InstanceBatcher.h"
+#include "PrimitiveTopology.h"
+#include "SceneGraph.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+    // メッシュのプリミティブ（ローカル空間）
+    struct SourcePrimitive {
+        std::vector<float> m_positions;
+        std::vector<unsigned int> m_indices;
+        uint32_t m_group;
+    };
+
+    struct ChunkRange {
+        size_t m_first;
+        size_t m_count;
+    };
+
+    template <typename T>
+    void writeArray(std::ofstream& file, const std::vector<T>& values) {
+        if (!values.empty()) {
+            file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        }
+    }
+
+    template <typename T>
+    bool readArray(std::ifstream& file, std::vector<T>& values, size_t count) {
+        values.resize(count);
+        if (count == 0) {
+            return true;
+        }
+        file.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+        return static_cast<bool>(file);
+    }
+}
+
+// === チャンクパックの作成 ===
+
+bool ChunkPack::build(const tinygltf::Model& model, const std::string& path, size_t maxTrianglesPerChunk) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    maxTrianglesPerChunk = std::max<size_t>(maxTrianglesPerChunk, 1);
+
+    SceneGraph sceneGraph;
+    sceneGraph.build(model);
+    InstanceBatcher instanceBatcher;
+    instanceBatcher.build(model, sceneGraph);
+
+    // グループ 0 は既定のマテリアル（白）、以降はマテリアル番号 + 1
+    std::vector<glm::vec3> groupColors(1, glm::vec3(1.0f));
+    for (const auto& material : model.materials) {
+        const auto& color = material.pbrMetallicRoughness.baseColorFactor;
+        groupColors.push_back(color.size() >= 3
+            ? glm::vec3(static_cast<float>(color[0]), static_cast<float>(color[1]), static_cast<float>(color[2]))
+            : glm::vec3(1.0f));
+    }
+
+    // メッシュごとの三角形をローカル空間で一度だけ読み込む
+    std::vector<std::vector<SourcePrimitive>> meshPrimitives(model.meshes.size());
+    for (size_t mesh = 0; mesh < model.meshes.size(); ++mesh) {
+        for (const auto& primitive : model.meshes[mesh].primitives) {
+            SourcePrimitive source;
+            if (!PrimitiveTopology::readTriangleList(model, primitive, source.m_positions, source.m_indices)) {
+                continue;
+            }
+            const bool hasMaterial = primitive.material >= 0 && primitive.material < static_cast<int>(model.materials.size());
+            source.m_group = hasMaterial ? static_cast<uint32_t>(primitive.material + 1) : 0;
+            meshPrimitives[mesh].push_back(std::move(source));
+        }
+    }
+
+    // 全インスタンスの頂点をワールド空間へ変換し、三角形を頂点番号の3つ組で並べる
+    const std::vector<glm::mat4>& instanceMatrices = instanceBatcher.getInstanceMatrices();
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> triangleGroups;
+    for (size_t instance = 0; instance < instanceBatcher.getInstanceCount(); ++instance) {
+        const int mesh = instanceBatcher.getInstanceMesh(instance);
+        if (mesh < 0 || mesh >= static_cast<int>(meshPrimitives.size())) {
+            continue;
+        }
+        for (const SourcePrimitive& source : meshPrimitives[mesh]) {
+            const size_t vertexCount = source.m_positions.size() / 3;
+            if (positions.size() + vertexCount > std::numeric_limits<uint32_t>::max()) {
+                std::cerr << "エラー: チャンクパックの作成に失敗しました（頂点数が多すぎます）" << std::endl;
+                return false;
+            }
+            const uint32_t baseVertex = static_cast<uint32_t>(positions.size());
+            for (size_t v = 0; v < vertexCount; ++v) {
+                const glm::vec4 local(source.m_positions[v * 3 + 0], source.m_positions[v * 3 + 1], source.m_positions[v * 3 + 2], 1.0f);
+                positions.push_back(glm::vec3(instanceMatrices[instance] * local));
+            }
+            for (size_t i = 0; i + 2 < source.m_indices.size(); i += 3) {
+                // 範囲外の頂点を参照する三角形は除外
+                if (source.m_indices[i] >= vertexCount || source.m_indices[i + 1] >= vertexCount || source.m_indices[i + 2] >= vertexCount) {
+                    continue;
+                }
+                triangles.push_back(baseVertex + source.m_indices[i]);
+                triangles.push_back(baseVertex + source.m_indices[i + 1]);
+                triangles.push_back(baseVertex + source.m_indices[i + 2]);
+                triangleGroups.push_back(source.m_group);
+            }
+        }
+    }
+    meshPrimitives.clear();
+
+    const size_t triangleCount = triangleGroups.size();
+    if (triangleCount == 0) {
+        std::cerr << "エラー: チャンクパックに書き出す三角形がありません" << std::endl;
+        return false;
+    }
+
+    // 重心の最も広い軸で中央値分割を繰り返し、三角形数が上限以下になった範囲をチャンクとする
+    std::vector<glm::vec3> centroids(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        centroids[t] = (positions[triangles[t * 3]] + positions[triangles[t * 3 + 1]] + positions[triangles[t * 3 + 2]]) / 3.0f;
+    }
+    std::vector<uint32_t> order(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        order[t] = static_cast<uint32_t>(t);
+    }
+
+    std::vector<ChunkRange> chunks;
+    std::vector<ChunkRange> stack(1, ChunkRange{ 0, triangleCount });
+    while (!stack.empty()) {
+        const ChunkRange range = stack.back();
+        stack.pop_back();
+        if (range.m_count <= maxTrianglesPerChunk) {
+            chunks.push_back(range);
+            continue;
+        }
+
+        BoundingBox centroidBounds;
+        for (size_t i = range.m_first; i < range.m_first + range.m_count; ++i) {
+            centroidBounds.expand(centroids[order[i]]);
+        }
+        const glm::vec3 size = centroidBounds.getSize();
+        const int axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+
+        const size_t half = range.m_count / 2;
+        std::nth_element(order.begin() + range.m_first, order.begin() + range.m_first + half, order.begin() + range.m_first + range.m_count,
+            [&centroids, axis](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        stack.push_back(ChunkRange{ range.m_first + half, range.m_count - half });
+        stack.push_back(ChunkRange{ range.m_first, half });
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "エラー: チャンクパックを作成できません: " << path << std::endl;
+        return false;
+    }
+
+    // チャンク表は書き出し後に確定するので、先に領域だけ確保する
+    FileHeader header = {};
+    std::memcpy(header.m_magic, kMagic, sizeof(kMagic));
+    header.m_version = kVersion;
+    header.m_chunkCount = static_cast<uint32_t>(chunks.size());
+    std::vector<ChunkRecord> records(chunks.size());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(file, records);
+
+    BoundingBox sceneBounds;
+    std::unordered_map<uint32_t, uint32_t> vertexRemap;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        const ChunkRange& range = chunks[c];
+
+        // 三角形をマテリアル色ごとに並べ、チャンク内で使用する頂点だけに番号を振り直す
+        std::stable_sort(order.begin() + range.m_first, order.begin() + range.m_first + range.m_count,
+            [&triangleGroups](uint32_t a, uint32_t b) { return triangleGroups[a] < triangleGroups[b]; });
+
+        std::vector<GroupRecord> groups;
+        std::vector<float> chunkPositions;
+        std::vector<uint32_t> chunkIndices;
+        BoundingBox chunkBounds;
+        vertexRemap.clear();
+        for (size_t i = range.m_first; i < range.m_first + range.m_count; ++i) {
+            const uint32_t triangle = order[i];
+            const uint32_t group = triangleGroups[triangle];
+            if (groups.empty() || group != triangleGroups[order[i - 1]]) {
+                GroupRecord record = {};
+                record.m_color[0] = groupColors[group].x;
+                record.m_color[1] = groupColors[group].y;
+                record.m_color[2] = groupColors[group].z;
+                record.m_firstIndex = static_cast<uint32_t>(chunkIndices.size());
+                groups.push_back(record);
+            }
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t vertex = triangles[triangle * 3 + k];
+                auto it = vertexRemap.find(vertex);
+                if (it == vertexRemap.end()) {
+                    it = vertexRemap.emplace(vertex, static_cast<uint32_t>(chunkPositions.size() / 3)).first;
+                    chunkPositions.insert(chunkPositions.end(), { positions[vertex].x, positions[vertex].y, positions[vertex].z });
+                    chunkBounds.expand(positions[vertex]);
+                }
+                chunkIndices.push_back(it->second);
+            }
+            groups.back().m_indexCount += 3;
+        }
+
+        ChunkRecord& record = records[c];
+        for (int axis = 0; axis < 3; ++axis) {
+            record.m_boundsMin[axis] = chunkBounds.m_min[axis];
+            record.m_boundsMax[axis] = chunkBounds.m_max[axis];
+        }
+        record.m_payloadOffset = static_cast<uint64_t>(file.tellp());
+        record.m_vertexCount = static_cast<uint32_t>(chunkPositions.size() / 3);
+        record.m_indexCount = static_cast<uint32_t>(chunkIndices.size());
+        record.m_groupCount = static_cast<uint32_t>(groups.size());
+        record.m_payloadBytes = static_cast<uint32_t>(groups.size() * sizeof(GroupRecord) +
+            chunkPositions.size() * sizeof(float) + chunkIndices.size() * sizeof(uint32_t));
+        writeArray(file, groups);
+        writeArray(file, chunkPositions);
+        writeArray(file, chunkIndices);
+        sceneBounds.expand(chunkBounds);
+    }
+
+    for (int axis = 0; axis < 3; ++axis) {
+        header.m_boundsMin[axis] = sceneBounds.m_min[axis];
+        header.m_boundsMax[axis] = sceneBounds.m_max[axis];
+    }
+    const std::streamoff fileSize = file.tellp();
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(file, records);
+    file.close();
+    if (!file) {
+        std::cerr << "エラー: チャンクパックの書き込みに失敗しました: " << path << std::endl;
+        return false;
+    }
+
+    const double timeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "チャンクパック: " << path << " (チャンク数: " << chunks.size() << ", 三角形: " << triangleCount
+        << ", サイズ: " << fileSize / (1024 * 1024) << " MB, 作成: " << timeMs << " ms)" << std::endl;
+    return true;
+}
+
+// === GeometryStreamer ===
+
+GeometryStreamer::GeometryStreamer()
+    : m_pendingCount(0)
+    , m_stopping(false)
+    , m_totalLoadMs(0.0)
+    , m_totalResidentMs(0.0)
+{
+}
+
+GeometryStreamer::~GeometryStreamer() {
+    close();
+}
+
+bool GeometryStreamer::open(const std::string& path, const StreamingSettings& settings) {
+    close();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "エラー: チャンクパックを開けません: " << path << std::endl;
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    ChunkPack::FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.m_magic, ChunkPack::kMagic, sizeof(ChunkPack::kMagic)) != 0 || header.m_version != ChunkPack::kVersion) {
+        std::cerr << "エラー: チャンクパックの形式が正しくありません: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<ChunkPack::ChunkRecord> records;
+    if (!readArray(file, records, header.m_chunkCount)) {
+        std::cerr << "エラー: チャンク表を読み込めません: " << path << std::endl;
+        return false;
+    }
+    for (const auto& record : records) {
+        const uint64_t expectedBytes = static_cast<uint64_t>(record.m_groupCount) * sizeof(ChunkPack::GroupRecord) +
+            static_cast<uint64_t>(record.m_vertexCount) * 3 * sizeof(float) + static_cast<uint64_t>(record.m_indexCount) * sizeof(uint32_t);
+        if (record.m_payloadBytes != expectedBytes || record.m_payloadOffset + record.m_payloadBytes > fileSize) {
+            std::cerr << "エラー: チャンク表が壊れています: " << path << std::endl;
+            return false;
+        }
+    }
+
+    const size_t chunkCount = records.size();
+    m_records = std::move(records);
+    m_chunkBounds.resize(chunkCount);
+    m_chunkSpheres.resize(chunkCount);
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        const auto& record = m_records[chunk];
+        m_chunkBounds[chunk] = BoundingBox(
+            glm::vec3(record.m_boundsMin[0], record.m_boundsMin[1], record.m_boundsMin[2]),
+            glm::vec3(record.m_boundsMax[0], record.m_boundsMax[1], record.m_boundsMax[2]));
+        m_chunkSpheres[chunk] = BoundingVolume::sphereFromBox(m_chunkBounds[chunk]);
+    }
+    m_sceneBounds = BoundingBox(
+        glm::vec3(header.m_boundsMin[0], header.m_boundsMin[1], header.m_boundsMin[2]),
+        glm::vec3(header.m_boundsMax[0], header.m_boundsMax[1], header.m_boundsMax[2]));
+
+    m_loadState.assign(chunkCount, LoadState::Unloaded);
+    m_payloads.resize(chunkCount);
+    m_chunkVAO.assign(chunkCount, 0);
+    m_chunkVertexBuffer.resize(chunkCount);
+    m_chunkIndexBuffer.resize(chunkCount);
+    m_chunkGroups.resize(chunkCount);
+    m_priority.assign(chunkCount, 0.0f);
+    m_inFrustum.assign(chunkCount, 0);
+    m_requestTime.resize(chunkCount);
+    m_wantGPU.assign(chunkCount, 0);
+    m_wantCPU.assign(chunkCount, 0);
+
+    m_path = path;
+    m_settings = settings;
+    m_stats = StreamingStats();
+    m_stats.m_chunkCount = chunkCount;
+    m_stats.m_cpuBudgetBytes = settings.m_cpuBudgetBytes;
+    m_stats.m_gpuBudgetBytes = settings.m_gpuBudgetBytes;
+
+    m_stopping = false;
+    const int ioThreadCount = std::max(1, settings.m_ioThreadCount);
+    for (int i = 0; i < ioThreadCount; ++i) {
+        m_ioThreads.emplace_back(&GeometryStreamer::ioThreadLoop, this);
+    }
+
+    std::cout << "ストリーミング: " << path << " (チャンク数: " << chunkCount
+        << ", CPU予算: " << settings.m_cpuBudgetBytes / (1024 * 1024) << " MB, GPU予算: " << settings.m_gpuBudgetBytes / (1024 * 1024)
+        << " MB, I/Oスレッド: " << ioThreadCount << ")" << std::endl;
+    return true;
+}
+
+void GeometryStreamer::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_requestQueue.clear();
+    }
+    m_condition.notify_all();
+    for (auto& thread : m_ioThreads) {
+        thread.join();
+    }
+    m_ioThreads.clear();
+    m_completed.clear();
+
+    for (size_t chunk = 0; chunk < m_chunkVAO.size(); ++chunk) {
+        if (m_chunkVAO[chunk] != 0) {
+            glDeleteVertexArrays(1, &m_chunkVAO[chunk]);
+        }
+    }
+
+    m_chunkBounds.clear();
+    m_chunkSpheres.clear();
+    m_records.clear();
+    m_loadState.clear();
+    m_payloads.clear();
+    m_chunkVAO.clear();
+    m_chunkVertexBuffer.clear();
+    m_chunkIndexBuffer.clear();
+    m_chunkGroups.clear();
+    m_priority.clear();
+    m_inFrustum.clear();
+    m_requestTime.clear();
+    m_wantGPU.clear();
+    m_wantCPU.clear();
+    m_drawChunks.clear();
+    m_pendingCount = 0;
+    m_path.clear();
+    m_sceneBounds = BoundingBox();
+    m_stats = StreamingStats();
+    m_totalLoadMs = 0.0;
+    m_totalResidentMs = 0.0;
+}
+
+void GeometryStreamer::ioThreadLoop() {
+    // I/Oスレッドごとにファイルを開き、シーク位置を共有しない
+    std::ifstream file(m_path, std::ios::binary);
+
+    for (;;) {
+        int chunk;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_requestQueue.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            chunk = m_requestQueue.front();
+            m_requestQueue.erase(m_requestQueue.begin());
+        }
+
+        std::unique_ptr<ChunkPayload> payload;
+        if (file) {
+            payload = readPayload(file, m_records[chunk]);
+        }
+        if (!payload) {
+            // 失敗した後もシークできるように状態を戻す
+            file.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        LoadResult result;
+        result.m_chunk = chunk;
+        result.m_payload = std::move(payload);
+        m_completed.push_back(std::move(result));
+    }
+}
+
+std::unique_ptr<GeometryStreamer::ChunkPayload> GeometryStreamer::readPayload(std::ifstream& file, const ChunkPack::ChunkRecord& record) {
+    std::unique_ptr<ChunkPayload> payload(new ChunkPayload());
+    file.seekg(static_cast<std::streamoff>(record.m_payloadOffset));
+    if (!readArray(file, payload->m_groups, record.m_groupCount) ||
+        !readArray(file, payload->m_positions, static_cast<size_t>(record.m_vertexCount) * 3) ||
+        !readArray(file, payload->m_indices, record.m_indexCount)) {
+        return nullptr;
+    }
+
+    // 壊れたファイルで範囲外を描画しないように検証する
+    for (const auto& group : payload->m_groups) {
+        if (static_cast<uint64_t>(group.m_firstIndex) + group.m_indexCount > record.m_indexCount) {
+            return nullptr;
+        }
+    }
+    for (uint32_t index : payload->m_indices) {
+        if (index >= record.m_vertexCount) {
+            return nullptr;
+        }
+    }
+    return payload;
+}
+
+void GeometryStreamer::receiveCompletedLoads() {
+    std::deque<LoadResult> completed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        completed.swap(m_completed);
+    }
+
+    const auto now = Clock::now();
+    for (auto& result : completed) {
+        const int chunk = result.m_chunk;
+        --m_pendingCount;
+        if (!result.m_payload) {
+            std::cerr << "警告: チャンク " << chunk << " を読み込めません" << std::endl;
+            m_loadState[chunk] = LoadState::Unloaded;
+            continue;
+        }
+
+        m_payloads[chunk] = std::move(result.m_payload);
+        m_loadState[chunk] = LoadState::Loaded;
+        m_stats.m_cpuBytes += getCPUBytes(chunk);
+        m_stats.m_bytesRead += getCPUBytes(chunk);
+        ++m_stats.m_loadsCompleted;
+
+        const double loadMs = std::chrono::duration<double, std::milli>(now - m_requestTime[chunk]).count();
+        m_totalLoadMs += loadMs;
+        m_stats.m_maxLoadMs = std::max(m_stats.m_maxLoadMs, loadMs);
+    }
+}
+
+void GeometryStreamer::computePriorities(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float projectionScale) {
+    const Frustum frustum = BoundingVolume::extractFrustum(viewProjection);
+
+    for (size_t chunk = 0; chunk < m_records.size(); ++chunk) {
+        const BoundingSphere& sphere = m_chunkSpheres[chunk];
+        const float distance = glm::length(sphere.m_center - cameraPosition);
+
+        // カメラがスフィアの内側にある場合は画面全体を覆うものとして扱う
+        const float projectedSize = sphere.m_radius * projectionScale / std::max(distance, sphere.m_radius);
+        const bool inFrustum = BoundingVolume::intersectsFrustum(m_chunkBounds[chunk], frustum);
+        m_inFrustum[chunk] = inFrustum ? 1 : 0;
+
+        if (projectedSize < m_settings.m_minProjectedSize) {
+            m_priority[chunk] = 0.0f;
+        } else {
+            m_priority[chunk] = projectedSize * (inFrustum ? 1.0f : m_settings.m_outsideFrustumWeight);
+        }
+    }
+}
+
+void GeometryStreamer::selectResidentSet(std::vector<int>& order) {
+    order.clear();
+    for (size_t chunk = 0; chunk < m_records.size(); ++chunk) {
+        if (m_priority[chunk] > 0.0f) {
+            order.push_back(static_cast<int>(chunk));
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) { return m_priority[a] > m_priority[b]; });
+
+    // 優先度の高い順に予算へ詰める（収まらないチャンクは飛ばして次を試す）
+    // CPU予算の一部はGPUへ転送するためだけに読み込むペイロード用に空けておく
+    std::fill(m_wantGPU.begin(), m_wantGPU.end(), 0);
+    std::fill(m_wantCPU.begin(), m_wantCPU.end(), 0);
+    const size_t transferReserve = std::min(m_settings.m_cpuBudgetBytes / 2, m_settings.m_uploadBytesPerFrame);
+    const size_t cpuTarget = m_settings.m_cpuBudgetBytes - transferReserve;
+    size_t gpuTotal = 0;
+    size_t cpuTotal = 0;
+    size_t wanted = 0;
+    for (int chunk : order) {
+        if (gpuTotal + getGPUBytes(chunk) <= m_settings.m_gpuBudgetBytes) {
+            m_wantGPU[chunk] = 1;
+            gpuTotal += getGPUBytes(chunk);
+        }
+        if (cpuTotal + getCPUBytes(chunk) <= cpuTarget) {
+            m_wantCPU[chunk] = 1;
+            cpuTotal += getCPUBytes(chunk);
+        }
+        if (m_wantGPU[chunk] || m_wantCPU[chunk]) {
+            ++wanted;
+        }
+    }
+    m_stats.m_wantedChunks = wanted;
+}
+
+// 常駐対象のチャンクを受け入れるのに予算が足りない場合だけ、対象外のチャンクを優先度の低い順に破棄する
+// （予算に余裕があるうちは対象外になったチャンクも残し、カメラが戻ったときに再読み込みしない）
+void GeometryStreamer::evict() {
+    auto byPriority = [this](int a, int b) { return m_priority[a] < m_priority[b]; };
+
+    size_t gpuNeeded = 0;
+    size_t cpuNeeded = 0;
+    std::vector<int> gpuCandidates;
+    std::vector<int> cpuCandidates;
+    for (size_t i = 0; i < m_records.size(); ++i) {
+        const int chunk = static_cast<int>(i);
+        const bool needsUpload = m_wantGPU[chunk] && m_chunkVAO[chunk] == 0;
+        if (needsUpload) {
+            gpuNeeded += getGPUBytes(chunk);
+        } else if (m_chunkVAO[chunk] != 0 && !m_wantGPU[chunk]) {
+            gpuCandidates.push_back(chunk);
+        }
+
+        const bool needsPayload = m_wantCPU[chunk] || needsUpload;
+        if (needsPayload && m_loadState[chunk] == LoadState::Unloaded) {
+            cpuNeeded += getCPUBytes(chunk);
+        } else if (!needsPayload && m_loadState[chunk] == LoadState::Loaded) {
+            cpuCandidates.push_back(chunk);
+        }
+    }
+
+    if (m_stats.m_gpuBytes + gpuNeeded > m_settings.m_gpuBudgetBytes) {
+        std::sort(gpuCandidates.begin(), gpuCandidates.end(), byPriority);
+        for (int chunk : gpuCandidates) {
+            if (m_stats.m_gpuBytes + gpuNeeded <= m_settings.m_gpuBudgetBytes) {
+                break;
+            }
+            releaseGPU(chunk);
+            ++m_stats.m_gpuEvictions;
+        }
+    }
+
+    if (m_stats.m_cpuBytes + cpuNeeded > m_settings.m_cpuBudgetBytes) {
+        std::sort(cpuCandidates.begin(), cpuCandidates.end(), byPriority);
+        for (int chunk : cpuCandidates) {
+            if (m_stats.m_cpuBytes + cpuNeeded <= m_settings.m_cpuBudgetBytes) {
+                break;
+            }
+            m_payloads[chunk].reset();
+            m_loadState[chunk] = LoadState::Unloaded;
+            m_stats.m_cpuBytes -= getCPUBytes(chunk);
+            ++m_stats.m_cpuEvictions;
+        }
+    }
+}
+
+void GeometryStreamer::uploadChunks(const std::vector<int>& order) {
+    const auto now = Clock::now();
+    size_t uploadedBytes = 0;
+    for (int chunk : order) {
+        if (!m_wantGPU[chunk] || m_chunkVAO[chunk] != 0 || m_loadState[chunk] != LoadState::Loaded) {
+            continue;
+        }
+        if (uploadedBytes > 0 && uploadedBytes + getGPUBytes(chunk) > m_settings.m_uploadBytesPerFrame) {
+            break;
+        }
+        if (!uploadChunk(chunk)) {
+            continue;
+        }
+        uploadedBytes += getGPUBytes(chunk);
+
+        const double residentMs = std::chrono::duration<double, std::milli>(now - m_requestTime[chunk]).count();
+        m_totalResidentMs += residentMs;
+        m_stats.m_maxResidentMs = std::max(m_stats.m_maxResidentMs, residentMs);
+
+        // CPUの常駐対象でなければ転送のためだけに読み込んだペイロードなので破棄する
+        if (!m_wantCPU[chunk]) {
+            m_payloads[chunk].reset();
+            m_loadState[chunk] = LoadState::Unloaded;
+            m_stats.m_cpuBytes -= getCPUBytes(chunk);
+        }
+    }
+}
+
+void GeometryStreamer::requestLoads(const std::vector<int>& order) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 常駐対象から外れた待ち中の要求を取り消す
+    auto needsPayload = [this](int chunk) {
+        return m_wantCPU[chunk] || (m_wantGPU[chunk] && m_chunkVAO[chunk] == 0);
+    };
+    for (size_t i = 0; i < m_requestQueue.size();) {
+        const int chunk = m_requestQueue[i];
+        if (needsPayload(chunk)) {
+            ++i;
+            continue;
+        }
+        m_requestQueue.erase(m_requestQueue.begin() + i);
+        m_loadState[chunk] = LoadState::Unloaded;
+        --m_pendingCount;
+    }
+
+    // 読み込み中のペイロードも含めてCPU予算を超えないように要求する
+    size_t queuedBytes = 0;
+    for (size_t chunk = 0; chunk < m_records.size(); ++chunk) {
+        if (m_loadState[chunk] == LoadState::Queued) {
+            queuedBytes += getCPUBytes(static_cast<int>(chunk));
+        }
+    }
+
+    const auto now = Clock::now();
+    for (int chunk : order) {
+        if (m_pendingCount >= m_settings.m_maxPendingLoads) {
+            break;
+        }
+        if (!needsPayload(chunk) || m_loadState[chunk] != LoadState::Unloaded) {
+            continue;
+        }
+        if (m_stats.m_cpuBytes + queuedBytes + getCPUBytes(chunk) > m_settings.m_cpuBudgetBytes) {
+            continue;
+        }
+        queuedBytes += getCPUBytes(chunk);
+        m_loadState[chunk] = LoadState::Queued;
+        m_requestTime[chunk] = now;
+        m_requestQueue.push_back(chunk);
+        ++m_pendingCount;
+    }
+
+    std::stable_sort(m_requestQueue.begin(), m_requestQueue.end(), [this](int a, int b) { return m_priority[a] > m_priority[b]; });
+    if (!m_requestQueue.empty()) {
+        m_condition.notify_all();
+    }
+}
+
+bool GeometryStreamer::uploadChunk(int chunk) {
+    const ChunkPayload& payload = *m_payloads[chunk];
+    m_chunkVertexBuffer[chunk] = std::make_shared<GPUBuffer>(GL_ARRAY_BUFFER,
+        payload.m_positions.data(), payload.m_positions.size() * sizeof(float));
+    m_chunkIndexBuffer[chunk] = std::make_shared<GPUBuffer>(GL_ELEMENT_ARRAY_BUFFER,
+        payload.m_indices.data(), payload.m_indices.size() * sizeof(uint32_t));
+
+    glGenVertexArrays(1, &m_chunkVAO[chunk]);
+    glBindVertexArray(m_chunkVAO[chunk]);
+    glBindBuffer(GL_ARRAY_BUFFER, m_chunkVertexBuffer[chunk]->getID());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_chunkIndexBuffer[chunk]->getID());
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        std::cerr << "エラー: チャンク " << chunk << " の転送中にOpenGLエラーが発生しました: " << error << std::endl;
+        glDeleteVertexArrays(1, &m_chunkVAO[chunk]);
+        m_chunkVAO[chunk] = 0;
+        m_chunkVertexBuffer[chunk].reset();
+        m_chunkIndexBuffer[chunk].reset();
+        return false;
+    }
+
+    std::vector<DrawGroup>& groups = m_chunkGroups[chunk];
+    groups.clear();
+    for (const auto& record : payload.m_groups) {
+        DrawGroup group;
+        group.m_color = glm::vec3(record.m_color[0], record.m_color[1], record.m_color[2]);
+        group.m_firstIndex = static_cast<GLsizei>(record.m_firstIndex);
+        group.m_indexCount = static_cast<GLsizei>(record.m_indexCount);
+        groups.push_back(group);
+    }
+
+    m_stats.m_gpuBytes += getGPUBytes(chunk);
+    ++m_stats.m_uploads;
+    return true;
+}
+
+void GeometryStreamer::releaseGPU(int chunk) {
+    glDeleteVertexArrays(1, &m_chunkVAO[chunk]);
+    m_chunkVAO[chunk] = 0;
+    m_chunkVertexBuffer[chunk].reset();
+    m_chunkIndexBuffer[chunk].reset();
+    m_chunkGroups[chunk].clear();
+    m_stats.m_gpuBytes -= getGPUBytes(chunk);
+}
+
+void GeometryStreamer::update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float projectionScale) {
+    if (!isOpen()) {
+        return;
+    }
+    const auto start = Clock::now();
+
+    receiveCompletedLoads();
+    computePriorities(viewProjection, cameraPosition, projectionScale);
+
+    std::vector<int> order;
+    selectResidentSet(order);
+    evict();
+    uploadChunks(order);
+    requestLoads(order);
+
+    // GPUに常駐している視錐台内のチャンクを手前（優先度の高い）順に描画する
+    m_drawChunks.clear();
+    for (int chunk : order) {
+        if (m_chunkVAO[chunk] != 0 && m_inFrustum[chunk]) {
+            m_drawChunks.push_back(chunk);
+        }
+    }
+
+    size_t cpuResident = 0;
+    size_t gpuResident = 0;
+    for (size_t chunk = 0; chunk < m_records.size(); ++chunk) {
+        cpuResident += m_loadState[chunk] == LoadState::Loaded ? 1 : 0;
+        gpuResident += m_chunkVAO[chunk] != 0 ? 1 : 0;
+    }
+    m_stats.m_visibleChunks = m_drawChunks.size();
+    m_stats.m_cpuResidentChunks = cpuResident;
+    m_stats.m_gpuResidentChunks = gpuResident;
+    m_stats.m_pendingLoads = static_cast<size_t>(m_pendingCount);
+    m_stats.m_averageLoadMs = m_stats.m_loadsCompleted > 0 ? m_totalLoadMs / m_stats.m_loadsCompleted : 0.0;
+    m_stats.m_averageResidentMs = m_stats.m_uploads > 0 ? m_totalResidentMs / m_stats.m_uploads : 0.0;
+    m_stats.m_updateTimeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
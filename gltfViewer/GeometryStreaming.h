@@ -0,0 +1,227 @@
+﻿#pragma once
+
+#include "BoundingVolume.h"
+#include "GPUBufferCache.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tinygltf {
+    class Model;
+}
+
+// チャンクパック（空間分割したチャンクごとのバイナリペイロードを1ファイルにまとめたもの）
+// ファイル構成: ヘッダー → チャンク表 → ペイロード（グループ表・頂点位置・インデックス）
+namespace ChunkPack {
+
+    const char kMagic[8] = { 'G', 'V', 'C', 'H', 'U', 'N', 'K', '1' };
+    const uint32_t kVersion = 1;
+
+    struct FileHeader {
+        char m_magic[8];
+        uint32_t m_version;
+        uint32_t m_chunkCount;
+        float m_boundsMin[3];   // シーン全体のワールド空間AABB
+        float m_boundsMax[3];
+    };
+
+    struct ChunkRecord {
+        float m_boundsMin[3];   // チャンクのワールド空間AABB
+        float m_boundsMax[3];
+        uint64_t m_payloadOffset;
+        uint32_t m_payloadBytes;
+        uint32_t m_vertexCount;
+        uint32_t m_indexCount;
+        uint32_t m_groupCount;
+    };
+
+    // 同じマテリアル色の三角形の範囲（チャンク内の三角形は色ごとに並ぶ）
+    struct GroupRecord {
+        float m_color[3];
+        uint32_t m_firstIndex;
+        uint32_t m_indexCount;
+    };
+
+    // モデルの全インスタンスの三角形をワールド空間へ展開し、
+    // 1チャンクの三角形数が maxTrianglesPerChunk 以下になるまで重心の中央値で空間を再帰的に分割して書き出す
+    // （変換は元のモデル全体をメモリに読み込める環境で一度だけ行う）
+    bool build(const tinygltf::Model& model, const std::string& path, size_t maxTrianglesPerChunk = 65536);
+}
+
+// ストリーミングの統計
+struct StreamingStats {
+    size_t m_chunkCount;
+    size_t m_visibleChunks;         // 描画したチャンク数
+    size_t m_wantedChunks;          // 予算内で常駐させたいチャンク数
+    size_t m_cpuResidentChunks;
+    size_t m_gpuResidentChunks;
+    size_t m_pendingLoads;          // 読み込み待ち・読み込み中
+    size_t m_cpuBytes;
+    size_t m_gpuBytes;
+    size_t m_cpuBudgetBytes;
+    size_t m_gpuBudgetBytes;
+    size_t m_loadsCompleted;        // 以下は open() からの累計
+    size_t m_uploads;
+    size_t m_cpuEvictions;
+    size_t m_gpuEvictions;
+    size_t m_bytesRead;
+    double m_averageLoadMs;         // 要求からCPUに読み込まれるまで
+    double m_maxLoadMs;
+    double m_averageResidentMs;     // 要求からGPUに転送されて描画可能になるまで
+    double m_maxResidentMs;
+    double m_updateTimeMs;          // 直近の update() の処理時間（転送を含む）
+
+    StreamingStats()
+        : m_chunkCount(0), m_visibleChunks(0), m_wantedChunks(0), m_cpuResidentChunks(0), m_gpuResidentChunks(0)
+        , m_pendingLoads(0), m_cpuBytes(0), m_gpuBytes(0), m_cpuBudgetBytes(0), m_gpuBudgetBytes(0)
+        , m_loadsCompleted(0), m_uploads(0), m_cpuEvictions(0), m_gpuEvictions(0), m_bytesRead(0)
+        , m_averageLoadMs(0.0), m_maxLoadMs(0.0), m_averageResidentMs(0.0), m_maxResidentMs(0.0), m_updateTimeMs(0.0)
+    {
+    }
+};
+
+// ストリーミングの設定
+struct StreamingSettings {
+    size_t m_cpuBudgetBytes;        // CPUに保持するペイロードの上限
+    size_t m_gpuBudgetBytes;        // GPUに常駐させる頂点・インデックスバッファーの上限
+    size_t m_uploadBytesPerFrame;   // 1フレームに転送する上限（最低1チャンクは転送する）
+    int m_ioThreadCount;
+    int m_maxPendingLoads;          // 同時に要求する読み込みの上限
+    float m_minProjectedSize;       // これより画面上で小さい（ピクセル）チャンクは読み込まない
+    float m_outsideFrustumWeight;   // 視錐台外のチャンクの優先度の係数（カメラの回転に備えた先読み）
+
+    StreamingSettings()
+        : m_cpuBudgetBytes(512u * 1024 * 1024)
+        , m_gpuBudgetBytes(256u * 1024 * 1024)
+        , m_uploadBytesPerFrame(16u * 1024 * 1024)
+        , m_ioThreadCount(2)
+        , m_maxPendingLoads(16)
+        , m_minProjectedSize(1.0f)
+        , m_outsideFrustumWeight(0.25f)
+    {
+    }
+};
+
+// チャンクパックのジオメトリをカメラに応じて読み込み・破棄する常駐管理
+// チャンクの優先度は画面上の投影サイズ（半径 / 距離）で、視錐台外のものは係数を掛けて下げる
+// 優先度順にCPU・GPUの予算に収まるチャンクを常駐対象とし、対象外のものは予算を超える場合だけ優先度の低い順に破棄する
+// ペイロードの読み込みはI/Oスレッドで行い、GPUへの転送はOpenGLコンテキストを持つ update() の呼び出しスレッドで行う
+class GeometryStreamer {
+public:
+    // GPUに常駐しているチャンクの描画データ
+    struct DrawGroup {
+        glm::vec3 m_color;
+        GLsizei m_firstIndex;
+        GLsizei m_indexCount;
+    };
+
+private:
+    enum class LoadState : uint8_t {
+        Unloaded,
+        Queued,     // 読み込み待ち（I/Oスレッドが読み込み中のものを含む）
+        Loaded      // CPUにペイロードがある
+    };
+
+    struct ChunkPayload {
+        std::vector<ChunkPack::GroupRecord> m_groups;
+        std::vector<float> m_positions;
+        std::vector<uint32_t> m_indices;
+    };
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    // === チャンク表（SoA） ===
+    std::vector<BoundingBox> m_chunkBounds;
+    std::vector<BoundingSphere> m_chunkSpheres;
+    std::vector<ChunkPack::ChunkRecord> m_records;
+
+    // === 常駐状態（メインスレッドのみが変更する） ===
+    std::vector<LoadState> m_loadState;
+    std::vector<std::unique_ptr<ChunkPayload>> m_payloads;
+    std::vector<GLuint> m_chunkVAO;                              // 0 はGPUに無い
+    std::vector<std::shared_ptr<GPUBuffer>> m_chunkVertexBuffer;
+    std::vector<std::shared_ptr<GPUBuffer>> m_chunkIndexBuffer;
+    std::vector<std::vector<DrawGroup>> m_chunkGroups;
+    std::vector<float> m_priority;                              // 0 は常駐させない
+    std::vector<uint8_t> m_inFrustum;
+    std::vector<Clock::time_point> m_requestTime;
+    std::vector<uint8_t> m_wantGPU;
+    std::vector<uint8_t> m_wantCPU;
+    std::vector<int> m_drawChunks;
+    int m_pendingCount;
+
+    // === I/Oスレッドとの受け渡し ===
+    struct LoadResult {
+        int m_chunk;
+        std::unique_ptr<ChunkPayload> m_payload;   // 読み込みに失敗した場合は nullptr
+    };
+    std::vector<std::thread> m_ioThreads;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<int> m_requestQueue;                // 優先度の高い順（update() ごとに並べ直す）
+    std::deque<LoadResult> m_completed;
+    bool m_stopping;
+
+    std::string m_path;
+    BoundingBox m_sceneBounds;
+    StreamingSettings m_settings;
+    StreamingStats m_stats;
+    double m_totalLoadMs;
+    double m_totalResidentMs;
+
+    void ioThreadLoop();
+    static std::unique_ptr<ChunkPayload> readPayload(std::ifstream& file, const ChunkPack::ChunkRecord& record);
+
+    size_t getCPUBytes(int chunk) const { return m_records[chunk].m_payloadBytes; }
+    size_t getGPUBytes(int chunk) const {
+        return static_cast<size_t>(m_records[chunk].m_vertexCount) * 3 * sizeof(float) +
+            static_cast<size_t>(m_records[chunk].m_indexCount) * sizeof(uint32_t);
+    }
+
+    void receiveCompletedLoads();
+    void computePriorities(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float projectionScale);
+    void selectResidentSet(std::vector<int>& order);
+    void evict();
+    void uploadChunks(const std::vector<int>& order);
+    void requestLoads(const std::vector<int>& order);
+    bool uploadChunk(int chunk);
+    void releaseGPU(int chunk);
+
+public:
+    GeometryStreamer();
+    ~GeometryStreamer();
+
+    GeometryStreamer(const GeometryStreamer&) = delete;
+    GeometryStreamer& operator=(const GeometryStreamer&) = delete;
+
+    // チャンクパックのヘッダーとチャンク表だけを読み込み、I/Oスレッドを開始する
+    bool open(const std::string& path, const StreamingSettings& settings = StreamingSettings());
+    void close();   // GPUバッファーを解放するためOpenGLコンテキストが有効なうちに呼ぶこと
+
+    // カメラに応じて常駐させるチャンクを選び、読み込み要求・転送・破棄を行って描画リストを作る
+    // projectionScale は距離 1 の位置での1単位の画面上の大きさ（ピクセル）
+    void update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float projectionScale);
+
+    bool isOpen() const { return !m_records.empty(); }
+    size_t getChunkCount() const { return m_records.size(); }
+    const BoundingBox& getSceneBounds() const { return m_sceneBounds; }
+    const BoundingBox& getChunkBounds(int chunk) const { return m_chunkBounds[chunk]; }
+
+    // update() で選ばれた描画対象（GPUに常駐し視錐台内のチャンク）
+    const std::vector<int>& getDrawChunks() const { return m_drawChunks; }
+    GLuint getChunkVAO(int chunk) const { return m_chunkVAO[chunk]; }
+    const std::vector<DrawGroup>& getChunkGroups(int chunk) const { return m_chunkGroups[chunk]; }
+
+    const StreamingSettings& getSettings() const { return m_settings; }
+    const StreamingStats& getStats() const { return m_stats; }
+};
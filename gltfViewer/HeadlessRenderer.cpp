@@ -0,0 +1,288 @@
+﻿#include "HeadlessRenderer.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+HeadlessRenderer::HeadlessRenderer()
+    : m_framebuffer(0)
+    , m_colorBuffer(0)
+    , m_depthBuffer(0)
+    , m_writer(nullptr)
+    , m_hasTimerQuery(false)
+    , m_timerQueries()
+    , m_loadTimeMs(0.0)
+    , m_totalTimeMs(0.0)
+{
+}
+
+HeadlessRenderer::~HeadlessRenderer() {
+    cleanup();
+}
+
+bool HeadlessRenderer::createFramebuffer() {
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_settings.m_width, m_settings.m_height);
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_settings.m_width, m_settings.m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "エラー: オフスクリーン描画用のFBOを作成できません (" << m_settings.m_width << "x" << m_settings.m_height
+            << ", 状態 0x" << std::hex << status << std::dec << ")" << std::endl;
+        destroyFramebuffer();
+        return false;
+    }
+    return true;
+}
+
+void HeadlessRenderer::destroyFramebuffer() {
+    if (m_framebuffer != 0) {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        m_framebuffer = 0;
+    }
+    if (m_colorBuffer != 0) {
+        glDeleteRenderbuffers(1, &m_colorBuffer);
+        m_colorBuffer = 0;
+    }
+    if (m_depthBuffer != 0) {
+        glDeleteRenderbuffers(1, &m_depthBuffer);
+        m_depthBuffer = 0;
+    }
+}
+
+bool HeadlessRenderer::initialize(const HeadlessSettings& settings) {
+    cleanup();
+    m_settings = settings;
+    m_settings.m_width = std::max(m_settings.m_width, 1);
+    m_settings.m_height = std::max(m_settings.m_height, 1);
+    m_settings.m_views = std::max(m_settings.m_views, 1);
+
+    std::unique_ptr<GLContext> context = GLContext::createHeadless();
+    if (!context) {
+        std::cerr << "オフスクリーン描画用のOpenGLコンテキストを作成できません" << std::endl;
+        return false;
+    }
+    m_renderer.reset(new OpenGLRenderer(std::move(context)));
+    if (!m_renderer->initialize()) {
+        std::cerr << "OpenGLレンダラーの初期化に失敗しました" << std::endl;
+        cleanup();
+        return false;
+    }
+    m_renderer->setDemoMode(false);
+    if (!createFramebuffer()) {
+        cleanup();
+        return false;
+    }
+
+    m_readback.initialize(kReadbackSlots);
+    m_hasTimerQuery = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if (m_hasTimerQuery) {
+        glGenQueries(kReadbackSlots, m_timerQueries);
+    }
+
+    m_camera.setPerspective(glm::radians(45.0f), static_cast<float>(m_settings.m_width) / m_settings.m_height, 0.1f, 100.0f);
+    m_renderer->onResize(m_settings.m_width, m_settings.m_height);
+    m_renderer->updateCamera(&m_camera);
+
+    std::cout << "オフスクリーン描画: " << m_settings.m_width << "x" << m_settings.m_height << ", " << m_settings.m_views
+        << " 方向, 読み出し " << kReadbackSlots << " 枚まで非同期, GPU時間 " << (m_hasTimerQuery ? "計測" : "計測なし") << std::endl;
+    return true;
+}
+
+void HeadlessRenderer::cleanup() {
+    if (m_renderer) {
+        m_readback.cleanup();
+        if (m_hasTimerQuery) {
+            glDeleteQueries(kReadbackSlots, m_timerQueries);
+            m_hasTimerQuery = false;
+        }
+        destroyFramebuffer();
+        // OpenGLコンテキストはレンダラーが破棄する
+        m_renderer.reset();
+    }
+}
+
+// コンパイル中のシェーダー、デコード・転送中のテクスチャが無く、必要なミップの追加も進まなくなったか
+bool HeadlessRenderer::isSettled() const {
+    const ShaderBuildStats& shaders = m_renderer->getShaderBuildStats();
+    const TextureStreamingStats& textures = m_renderer->getRenderStats().m_textures;
+    if (shaders.m_pendingPrograms > 0 || textures.m_pendingTextures > 0 || textures.m_pendingUploads > 0) {
+        return false;
+    }
+    // 予算に収まらず不足が残る場合は、そのフレームで何も転送しなくなった時点で撮影する
+    return textures.m_wantedTextures == 0 || (textures.m_frameUploads == 0 && textures.m_deferredUploads == 0);
+}
+
+void HeadlessRenderer::fitCamera() {
+    const BoundingBox& bounds = m_renderer->getSceneBounds();
+    if (bounds.isValid()) {
+        const BoundingSphere& sphere = m_renderer->getSceneBoundingSphere();
+        m_camera.fitToBoundingBox(bounds.m_min, bounds.m_max);
+        m_camera.fitClipPlanesToSphere(sphere.m_center, sphere.m_radius);
+    }
+    m_renderer->updateCamera(&m_camera);
+}
+
+std::string HeadlessRenderer::makeOutputPath(const std::string& path, int view, int viewCount) {
+    if (viewCount <= 1) {
+        return path;
+    }
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "_%03d", view);
+    const size_t dot = path.find_last_of('.');
+    const size_t separator = path.find_last_of("\\/");
+    if (dot == std::string::npos || (separator != std::string::npos && dot < separator)) {
+        return path + suffix;
+    }
+    return path.substr(0, dot) + suffix + path.substr(dot);
+}
+
+glm::vec3 HeadlessRenderer::getOrbitPosition(const glm::vec3& center, const glm::vec3& offset, int view, int viewCount) {
+    const float angle = 6.2831853f * view / std::max(viewCount, 1);
+    const glm::vec3 rotated(offset.x * std::cos(angle) + offset.z * std::sin(angle), offset.y,
+        -offset.x * std::sin(angle) + offset.z * std::cos(angle));
+    return center + rotated;
+}
+
+// 読み出しの完了した画像を受け取って書き出す（all の場合は読み出し中のものが無くなるまで）
+void HeadlessRenderer::receiveImage(bool wait, bool all) {
+    while (m_readback.receive(m_received, wait)) {
+        HeadlessImageStats& stats = m_imageStats[m_received.m_tag];
+        stats.m_readbackMs = m_received.m_latencyMs;
+        if (m_hasTimerQuery) {
+            // 読み出しのフェンスを通過しているので結果は得られている
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(m_timerQueries[m_received.m_tag % kReadbackSlots], GL_QUERY_RESULT, &elapsed);
+            stats.m_renderGpuMs = elapsed / 1.0e6;
+        }
+
+        const auto writeStart = std::chrono::high_resolution_clock::now();
+        if (!m_received.m_valid) {
+            std::cerr << "エラー: 画素を読み出せなかったため書き出しません: " << stats.m_path << std::endl;
+            stats.m_written = false;
+        } else if (m_writer) {
+            m_writer->enqueue(stats.m_path, m_received, m_settings.m_jpegQuality);
+            stats.m_written = true;
+        } else {
+            stats.m_written = ImageReadback::writeImage(stats.m_path, m_received, m_settings.m_jpegQuality);
+        }
+        stats.m_writeMs = elapsedMs(writeStart);
+        if (!all) {
+            break;
+        }
+    }
+}
+
+bool HeadlessRenderer::renderModel(const tinygltf::Model& model, const std::string& outputPath) {
+    m_imageStats.clear();
+    m_loadTimeMs = 0.0;
+    const auto totalStart = std::chrono::high_resolution_clock::now();
+    if (!m_renderer->loadGLTFModel(model)) {
+        std::cerr << "エラー: モデルをロードできないため描画できません: " << outputPath << std::endl;
+        return false;
+    }
+    fitCamera();
+    m_loadTimeMs = elapsedMs(totalStart);
+
+    // 方向ごとにバウンディング球の中心の周りでカメラを水平に回す
+    const glm::vec3 center = m_renderer->getSceneBoundingSphere().m_center;
+    const glm::vec3 offset = m_camera.getPosition() - center;
+    const int viewCount = m_settings.m_views;
+    m_imageStats.resize(static_cast<size_t>(viewCount));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    for (int view = 0; view < viewCount; ++view) {
+        // 読み出し中の画像が上限に達していれば、最も古いものを待って書き出す（タイマークエリもこれで空く）
+        if (m_readback.getPendingCount() >= static_cast<size_t>(kReadbackSlots)) {
+            receiveImage(true, false);
+        }
+
+        m_camera.setPosition(getOrbitPosition(center, offset, view, viewCount));
+        m_camera.setTarget(center);
+        m_renderer->updateCamera(&m_camera);
+
+        HeadlessImageStats& stats = m_imageStats[view];
+        stats.m_path = makeOutputPath(outputPath, view, viewCount);
+        const GLuint query = m_hasTimerQuery ? m_timerQueries[view % kReadbackSlots] : 0;
+        const auto settleStart = std::chrono::high_resolution_clock::now();
+        for (;;) {
+            ++stats.m_frames;
+            if (query != 0) {
+                glBeginQuery(GL_TIME_ELAPSED, query);
+            }
+            const auto renderStart = std::chrono::high_resolution_clock::now();
+            m_renderer->renderFrame();
+            stats.m_renderCpuMs = elapsedMs(renderStart);
+            if (query != 0) {
+                glEndQuery(GL_TIME_ELAPSED);
+            }
+            if (isSettled() || stats.m_frames >= m_settings.m_maxSettleFrames) {
+                break;
+            }
+            // 撮影しないフレームは完了を待ち、コマンドが溜まり続けないようにする
+            glFinish();
+        }
+        stats.m_settleMs = elapsedMs(settleStart);
+
+        m_readback.begin(m_settings.m_width, m_settings.m_height, static_cast<size_t>(view));
+        receiveImage(false, true);
+    }
+    receiveImage(true, true);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_renderer->cleanupGLTFResources();
+    m_totalTimeMs = elapsedMs(totalStart);
+
+    bool written = true;
+    for (const HeadlessImageStats& stats : m_imageStats) {
+        written = written && stats.m_written;
+    }
+    return written;
+}
+
+void HeadlessRenderer::printStats() const {
+    std::cout << "=== オフスクリーン描画 (" << m_settings.m_width << "x" << m_settings.m_height << ", " << m_imageStats.size() << " 枚) ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  ロード: " << m_loadTimeMs << " ms" << std::endl;
+    std::cout << "  画像 | フレーム | 待ち ms | 描画CPU ms | 描画GPU ms | 読み出し ms | 書き出し ms | 出力" << std::endl;
+
+    double renderCpuMs = 0.0;
+    double renderGpuMs = 0.0;
+    double readbackMs = 0.0;
+    double writeMs = 0.0;
+    for (size_t i = 0; i < m_imageStats.size(); ++i) {
+        const HeadlessImageStats& stats = m_imageStats[i];
+        std::cout << std::setw(6) << i << std::setw(10) << stats.m_frames << std::setw(10) << stats.m_settleMs
+            << std::setw(13) << stats.m_renderCpuMs << std::setw(13) << stats.m_renderGpuMs << std::setw(14) << stats.m_readbackMs
+            << std::setw(14) << stats.m_writeMs << "  " << stats.m_path << (stats.m_written ? "" : " (失敗)") << std::endl;
+        renderCpuMs += stats.m_renderCpuMs;
+        renderGpuMs += stats.m_renderGpuMs;
+        readbackMs += stats.m_readbackMs;
+        writeMs += stats.m_writeMs;
+    }
+    if (!m_imageStats.empty()) {
+        const double count = static_cast<double>(m_imageStats.size());
+        std::cout << "  平均: 描画CPU " << renderCpuMs / count << " ms, 描画GPU " << renderGpuMs / count << " ms, 読み出し "
+            << readbackMs / count << " ms, 書き出し " << writeMs / count << " ms / 合計 " << m_totalTimeMs << " ms" << std::endl;
+    }
+}
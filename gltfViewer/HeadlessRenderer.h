@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Camera.h"
+#include "GLContext.h"
+#include "ImageReadback.h"
+#include "ImageWriter.h"
+#include "OpenGLRenderer.h"
+
+// オフスクリーン描画の設定
+struct HeadlessSettings {
+    int m_width;
+    int m_height;
+    int m_views;            // モデルの周りを水平に等分した方向から描画する枚数
+    int m_jpegQuality;
+    int m_maxSettleFrames;  // シェーダーのコンパイルとテクスチャの常駐を待って描画し直す回数の上限
+
+    HeadlessSettings() : m_width(1280), m_height(720), m_views(1), m_jpegQuality(90), m_maxSettleFrames(300) {}
+};
+
+// 1枚の画像の計測結果
+struct HeadlessImageStats {
+    std::string m_path;
+    int m_frames;           // 撮影までに描画したフレーム数（コンパイル・常駐待ちを含む）
+    double m_settleMs;      // カメラを設定してから撮影するフレームを発行し終えるまで
+    double m_renderCpuMs;   // 撮影したフレームの renderFrame() のCPU時間
+    double m_renderGpuMs;   // 同じフレームのGPU時間（タイマークエリが使えない場合は 0）
+    double m_readbackMs;    // 読み出しの発行から画素を受け取るまで
+    double m_writeMs;       // PNG / JPEG のエンコードと書き込み（ImageWriter を使う場合はキューへ渡すまで）
+    bool m_written;         // ImageWriter を使う場合はキューへ渡せたか
+
+    HeadlessImageStats()
+        : m_frames(0), m_settleMs(0.0), m_renderCpuMs(0.0), m_renderGpuMs(0.0), m_readbackMs(0.0), m_writeMs(0.0), m_written(false) {}
+};
+
+// オフスクリーンのOpenGLコンテキスト（GLContext::createHeadless()）を作り、FBOへ描画して画像ファイルへ書き出す
+// Linux では EGL のサーフェスの無いコンテキストなので、ディスプレイの無いサーバーでも動作する（GPUが無い場合は Mesa の llvmpipe）
+// 読み出しは ImageReadback で非同期に行い、待つ間に次の方向を描画する
+class HeadlessRenderer {
+private:
+    static const int kReadbackSlots = 3;
+
+    std::unique_ptr<OpenGLRenderer> m_renderer;
+    Camera m_camera;
+    HeadlessSettings m_settings;
+    GLuint m_framebuffer;
+    GLuint m_colorBuffer;
+    GLuint m_depthBuffer;
+    ImageReadback m_readback;
+    ReadbackImage m_received;
+    ImageWriter* m_writer;
+    bool m_hasTimerQuery;
+    GLuint m_timerQueries[kReadbackSlots];  // 読み出し中の画像ごと（画像番号 % スロット数）
+    std::vector<HeadlessImageStats> m_imageStats;
+    double m_loadTimeMs;
+    double m_totalTimeMs;
+
+    bool createFramebuffer();
+    void destroyFramebuffer();
+    bool isSettled() const;
+    void fitCamera();
+    void receiveImage(bool wait, bool all);
+
+public:
+    HeadlessRenderer();
+    ~HeadlessRenderer();
+
+    HeadlessRenderer(const HeadlessRenderer&) = delete;
+    HeadlessRenderer& operator=(const HeadlessRenderer&) = delete;
+
+    bool initialize(const HeadlessSettings& settings = HeadlessSettings());
+    void cleanup();
+
+    // モデルをロードしてカメラをバウンディングボックスに合わせ、設定の枚数を描画して書き出す（最後にモデルを解放する）
+    // 複数枚の場合は出力パスの拡張子の前に方向の番号を付ける
+    bool renderModel(const tinygltf::Model& model, const std::string& outputPath);
+
+    // renderModel() の view 枚目の出力パスとカメラ位置（中心の周りで offset を水平に回す、ソフトウェアレンダラーも同じ配置で描画する）
+    static std::string makeOutputPath(const std::string& path, int view, int viewCount);
+    static glm::vec3 getOrbitPosition(const glm::vec3& center, const glm::vec3& offset, int view, int viewCount);
+
+    // 画像の書き出しを別スレッドの ImageWriter に任せる（nullptr で描画スレッドが書き出す）
+    void setImageWriter(ImageWriter* writer) { m_writer = writer; }
+
+    // FBOを描画先にする（renderModel() を使わずに getRenderer() で描画する場合）
+    void bindFramebuffer() const { glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer); }
+
+    OpenGLRenderer& getRenderer() { return *m_renderer; }
+    Camera& getCamera() { return m_camera; }
+    const HeadlessSettings& getSettings() const { return m_settings; }
+
+    // 直近の renderModel() の計測結果
+    const std::vector<HeadlessImageStats>& getImageStats() const { return m_imageStats; }
+    double getLoadTimeMs() const { return m_loadTimeMs; }
+    double getTotalTimeMs() const { return m_totalTimeMs; }
+    void printStats() const;
+};
@@ -0,0 +1,179 @@
+﻿#include "ImageReadback.h"
+#include <stb_image_write.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // フェンスの待機1回あたりのタイムアウト（ナノ秒）
+    const GLuint64 kFenceWaitTimeout = 1000000;
+
+    std::string getLowerExtension(const std::string& path) {
+        const size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos) {
+            return "";
+        }
+        std::string extension = path.substr(dot);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        return extension;
+    }
+}
+
+ImageReadback::ImageReadback()
+    : m_sequence(0)
+{
+}
+
+ImageReadback::~ImageReadback() {
+    // OpenGLリソースは cleanup() で解放する（コンテキスト破棄後の呼び出しを避ける）
+}
+
+void ImageReadback::initialize(int slotCount) {
+    cleanup();
+    m_slots.resize(static_cast<size_t>(std::max(slotCount, 1)));
+    for (Slot& slot : m_slots) {
+        slot = Slot{ 0, 0, nullptr, 0, 0, 0, 0, std::chrono::high_resolution_clock::time_point() };
+        glGenBuffers(1, &slot.m_buffer);
+    }
+}
+
+void ImageReadback::cleanup() {
+    for (Slot& slot : m_slots) {
+        if (slot.m_fence) {
+            glDeleteSync(slot.m_fence);
+        }
+        if (slot.m_buffer != 0) {
+            glDeleteBuffers(1, &slot.m_buffer);
+        }
+    }
+    m_slots.clear();
+    m_sequence = 0;
+}
+
+bool ImageReadback::begin(int width, int height, size_t tag) {
+    Slot* target = nullptr;
+    for (Slot& slot : m_slots) {
+        if (!slot.m_fence) {
+            target = &slot;
+            break;
+        }
+    }
+    if (!target || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    const size_t bytes = static_cast<size_t>(width) * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, target->m_buffer);
+    if (target->m_capacity < bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_READ);
+        target->m_capacity = bytes;
+    }
+    // RGBA8 の行は常に4バイト境界なので GL_PACK_ALIGNMENT の既定値 (4) のままでよい
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    target->m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    target->m_width = width;
+    target->m_height = height;
+    target->m_tag = tag;
+    target->m_sequence = ++m_sequence;
+    target->m_startTime = std::chrono::high_resolution_clock::now();
+    return true;
+}
+
+int ImageReadback::findOldest() const {
+    int oldest = -1;
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        if (m_slots[i].m_fence && (oldest < 0 || m_slots[i].m_sequence < m_slots[oldest].m_sequence)) {
+            oldest = static_cast<int>(i);
+        }
+    }
+    return oldest;
+}
+
+bool ImageReadback::receive(ReadbackImage& image, bool wait) {
+    const int index = findOldest();
+    if (index < 0) {
+        return false;
+    }
+    Slot& slot = m_slots[index];
+
+    GLenum result = glClientWaitSync(slot.m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        if (!wait) {
+            return false;
+        }
+        do {
+            result = glClientWaitSync(slot.m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceWaitTimeout);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    if (result == GL_WAIT_FAILED) {
+        std::cerr << "警告: 読み出しのフェンスの待機に失敗しました" << std::endl;
+    }
+    glDeleteSync(slot.m_fence);
+    slot.m_fence = nullptr;
+
+    // フェンスを通過しているのでマップで待たされることはない
+    const auto mapStart = std::chrono::high_resolution_clock::now();
+    const size_t bytes = static_cast<size_t>(slot.m_width) * slot.m_height * 4;
+    image.m_width = slot.m_width;
+    image.m_height = slot.m_height;
+    image.m_tag = slot.m_tag;
+    image.m_pixels.resize(bytes);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.m_buffer);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_READ_BIT);
+    bool copied = false;
+    if (mapped) {
+        std::memcpy(image.m_pixels.data(), mapped, bytes);
+        copied = glUnmapBuffer(GL_PIXEL_PACK_BUFFER) != GL_FALSE;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    image.m_valid = copied;
+    if (!copied) {
+        std::cerr << "エラー: 読み出し用のPBOをマップできません" << std::endl;
+    }
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    image.m_mapTimeMs = std::chrono::duration<double, std::milli>(end - mapStart).count();
+    image.m_latencyMs = std::chrono::duration<double, std::milli>(end - slot.m_startTime).count();
+    return true;
+}
+
+size_t ImageReadback::getPendingCount() const {
+    size_t count = 0;
+    for (const Slot& slot : m_slots) {
+        if (slot.m_fence) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool ImageReadback::writeImage(const std::string& path, const ReadbackImage& image, int jpegQuality) {
+    // OpenGLの画像は下の行からなので、上の行から並べ替える
+    const size_t rowBytes = static_cast<size_t>(image.m_width) * 4;
+    std::vector<unsigned char> flipped(image.m_pixels.size());
+    for (int y = 0; y < image.m_height; ++y) {
+        std::memcpy(flipped.data() + static_cast<size_t>(y) * rowBytes,
+            image.m_pixels.data() + static_cast<size_t>(image.m_height - 1 - y) * rowBytes, rowBytes);
+    }
+
+    const std::string extension = getLowerExtension(path);
+    int written = 0;
+    if (extension == ".jpg" || extension == ".jpeg") {
+        written = stbi_write_jpg(path.c_str(), image.m_width, image.m_height, 4, flipped.data(), jpegQuality);
+    } else if (extension == ".png") {
+        written = stbi_write_png(path.c_str(), image.m_width, image.m_height, 4, flipped.data(), static_cast<int>(rowBytes));
+    } else {
+        std::cerr << "エラー: 対応していない画像形式です (.png / .jpg): " << path << std::endl;
+        return false;
+    }
+    if (!written) {
+        std::cerr << "エラー: 画像を書き出せませんでした: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 読み出した画像（RGBA8、OpenGLと同じく下の行から）
+struct ReadbackImage {
+    int m_width;
+    int m_height;
+    std::vector<unsigned char> m_pixels;
+    size_t m_tag;               // begin() に渡した値（出力先の対応付け用）
+    double m_latencyMs;         // begin() から画素を受け取るまで
+    double m_mapTimeMs;         // マップとコピーにかかった時間
+    bool m_valid;               // 画素を読み出せたか（false の場合 m_pixels の内容は使えない）
+
+    ReadbackImage() : m_width(0), m_height(0), m_tag(0), m_latencyMs(0.0), m_mapTimeMs(0.0), m_valid(false) {}
+};
+
+// フレームバッファーの内容を GL_PIXEL_PACK_BUFFER へ glReadPixels で読み出し、フェンスを置いて描画を続ける
+// GPUが書き終えたもの（フェンスを通過したもの）から receive() で受け取るので、読み出しを待たずに次のフレームを描画できる
+// 同時に読み出し中にできるのはスロット数まで（begin() が false の場合は receive(true) で空きを作る）
+class ImageReadback {
+private:
+    struct Slot {
+        GLuint m_buffer;
+        size_t m_capacity;
+        GLsync m_fence;
+        int m_width;
+        int m_height;
+        size_t m_tag;
+        size_t m_sequence;      // begin() の順番（古いものから受け取る）
+        std::chrono::high_resolution_clock::time_point m_startTime;
+    };
+
+    std::vector<Slot> m_slots;
+    size_t m_sequence;
+
+    int findOldest() const;
+
+public:
+    ImageReadback();
+    ~ImageReadback();
+
+    ImageReadback(const ImageReadback&) = delete;
+    ImageReadback& operator=(const ImageReadback&) = delete;
+
+    void initialize(int slotCount);
+    void cleanup();   // OpenGLコンテキストが有効なうちに呼ぶこと
+
+    // 現在の読み出し元（GL_READ_FRAMEBUFFER のカラーアタッチメント）の (0, 0)-(width, height) の読み出しを発行する
+    bool begin(int width, int height, size_t tag);
+
+    // 最も古い読み出しが完了していれば受け取る（wait の場合は完了まで待つ）。読み出し中のものが無ければ false
+    // PBOをマップできなかった場合も受け取ったものとして true を返し、image.m_valid を false にする
+    bool receive(ReadbackImage& image, bool wait);
+
+    size_t getPendingCount() const;
+
+    // 拡張子（.png / .jpg / .jpeg）に応じて上下を反転して書き出す
+    static bool writeImage(const std::string& path, const ReadbackImage& image, int jpegQuality);
+};
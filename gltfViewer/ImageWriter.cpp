@@ -0,0 +1,98 @@
+﻿#include "ImageWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+ImageWriter::ImageWriter(size_t maxQueuedBytes)
+    : m_queuedBytes(0)
+    , m_maxQueuedBytes(maxQueuedBytes)
+    , m_activeJobs(0)
+    , m_stopping(false)
+{
+    m_thread = std::thread(&ImageWriter::writerLoop, this);
+}
+
+ImageWriter::~ImageWriter() {
+    // 受け付けた画像は書き出してから終了する
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAdded.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void ImageWriter::writerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAdded.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty()) {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_activeJobs;
+        }
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        const bool written = ImageReadback::writeImage(job.m_path, job.m_image, job.m_jpegQuality);
+        const double writeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_activeJobs;
+            m_queuedBytes -= job.m_image.m_pixels.size();
+            m_stats.m_writeMs += writeMs;
+            if (written) {
+                ++m_stats.m_written;
+            } else {
+                ++m_stats.m_failed;
+                m_failedPaths.push_back(job.m_path);
+            }
+        }
+        m_jobDone.notify_all();
+    }
+}
+
+void ImageWriter::enqueue(const std::string& path, ReadbackImage& image, int jpegQuality) {
+    const size_t bytes = image.m_pixels.size();
+    const auto start = std::chrono::high_resolution_clock::now();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // 何も待っていない場合は上限を超える1枚も受け付ける
+    m_jobDone.wait(lock, [this, bytes] { return m_queuedBytes == 0 || m_queuedBytes + bytes <= m_maxQueuedBytes; });
+    m_stats.m_stallMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    Job job;
+    job.m_path = path;
+    job.m_image = std::move(image);
+    job.m_jpegQuality = jpegQuality;
+    m_jobs.push_back(std::move(job));
+    m_queuedBytes += bytes;
+    ++m_stats.m_queued;
+    m_stats.m_maxQueuedImages = std::max(m_stats.m_maxQueuedImages, m_jobs.size() + m_activeJobs);
+    lock.unlock();
+    m_jobAdded.notify_one();
+
+    image.m_pixels.clear();
+}
+
+void ImageWriter::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobDone.wait(lock, [this] { return m_jobs.empty() && m_activeJobs == 0; });
+}
+
+ImageWriterStats ImageWriter::getStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::vector<std::string> ImageWriter::takeFailedPaths() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> paths;
+    paths.swap(m_failedPaths);
+    return paths;
+}
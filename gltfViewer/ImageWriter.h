@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ImageReadback.h"
+
+// ImageWriter の集計
+struct ImageWriterStats {
+    size_t m_queued;            // enqueue() で受け付けた枚数
+    size_t m_written;
+    size_t m_failed;
+    size_t m_maxQueuedImages;   // 同時に書き出し待ちだった最大枚数
+    double m_writeMs;           // エンコードと書き込みの合計（書き出しスレッド）
+    double m_stallMs;           // キューが一杯で enqueue() が待った合計（呼び出し側）
+
+    ImageWriterStats()
+        : m_queued(0), m_written(0), m_failed(0), m_maxQueuedImages(0), m_writeMs(0.0), m_stallMs(0.0) {}
+};
+
+// 読み出した画像のエンコードと書き込みを専用のスレッドで行う
+// PNG の圧縮は描画1フレームより遥かに重いため、描画スレッドは画像を渡すだけで次のモデルへ進む
+// 書き出し待ちの画素の合計が上限に達した場合は enqueue() が空きを待つ（メモリを使い切らないようにする）
+class ImageWriter {
+private:
+    struct Job {
+        std::string m_path;
+        ReadbackImage m_image;
+        int m_jpegQuality;
+    };
+
+    std::thread m_thread;
+    std::deque<Job> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAdded;
+    std::condition_variable m_jobDone;
+    size_t m_queuedBytes;
+    size_t m_maxQueuedBytes;
+    size_t m_activeJobs;        // 取り出して書き出し中の数
+    bool m_stopping;
+    ImageWriterStats m_stats;
+    std::vector<std::string> m_failedPaths;   // takeFailedPaths() で取り出すまでの書き出しに失敗した画像
+
+    void writerLoop();
+
+public:
+    explicit ImageWriter(size_t maxQueuedBytes = 256 * 1024 * 1024);
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    // 画像を書き出しキューへ移す（image の画素は空になる）
+    void enqueue(const std::string& path, ReadbackImage& image, int jpegQuality);
+
+    // キューが空になり、書き出し中のものが無くなるまで待つ
+    void flush();
+
+    ImageWriterStats getStats();
+
+    // 前回の呼び出し以降に書き出しに失敗した画像のパスを取り出す（呼び出し側がモデルなどの単位へまとめる）
+    std::vector<std::string> takeFailedPaths();
+};
@@ -0,0 +1,194 @@
+﻿#include "InstanceBatcher.h"
+#include "SceneGraph.h"
+#include "AccessorReader.h"
+#include "SimdMath.h"
+#include <tiny_gltf.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+
+namespace {
+    const char* const kGPUInstancingExtension = "EXT_mesh_gpu_instancing";
+
+    // 拡張の attributes から属性のアクセサーインデックスを取得
+    int getInstancingAttribute(const tinygltf::Value& attributes, const char* name) {
+        if (!attributes.Has(name)) {
+            return -1;
+        }
+        const tinygltf::Value& value = attributes.Get(name);
+        return value.IsInt() ? value.Get<int>() : -1;
+    }
+}
+
+void InstanceBatcher::clear() {
+    m_instanceNode.clear();
+    m_instanceLocal.clear();
+    m_instanceMesh.clear();
+    m_localMatrices.clear();
+    m_meshRanges.clear();
+    m_matrices.clear();
+}
+
+bool InstanceBatcher::readGPUInstancing(const tinygltf::Model& model, int gltfNodeIndex, std::vector<glm::mat4>& localMatrices) {
+    localMatrices.clear();
+
+    const tinygltf::Node& node = model.nodes[gltfNodeIndex];
+    auto ext = node.extensions.find(kGPUInstancingExtension);
+    if (ext == node.extensions.end() || !ext->second.IsObject() || !ext->second.Has("attributes")) {
+        return false;
+    }
+
+    const tinygltf::Value& attributes = ext->second.Get("attributes");
+    const int translationAccessor = getInstancingAttribute(attributes, "TRANSLATION");
+    const int rotationAccessor = getInstancingAttribute(attributes, "ROTATION");
+    const int scaleAccessor = getInstancingAttribute(attributes, "SCALE");
+
+    std::vector<float> translations, rotations, scales;
+    size_t count = 0;
+    bool valid = true;
+
+    // 各属性のインスタンス数はすべて一致している必要がある
+    auto readAttribute = [&](int accessor, int components, std::vector<float>& out) {
+        if (accessor < 0) {
+            return;
+        }
+        if (!AccessorReader::readFloats(model, accessor, out, components)) {
+            valid = false;
+            return;
+        }
+        size_t attributeCount = out.size() / components;
+        if (count != 0 && attributeCount != count) {
+            valid = false;
+        }
+        count = attributeCount;
+    };
+    readAttribute(translationAccessor, 3, translations);
+    readAttribute(rotationAccessor, 4, rotations);
+    readAttribute(scaleAccessor, 3, scales);
+
+    if (!valid || count == 0) {
+        std::cerr << "警告: ノード " << gltfNodeIndex << " の " << kGPUInstancingExtension << " が不正です" << std::endl;
+        return false;
+    }
+
+    const float zero[3] = { 0.0f, 0.0f, 0.0f };
+    const float identity[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    const float one[3] = { 1.0f, 1.0f, 1.0f };
+
+    localMatrices.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        SimdMath::composeTRS(
+            translations.empty() ? zero : &translations[i * 3],
+            rotations.empty() ? identity : &rotations[i * 4],
+            scales.empty() ? one : &scales[i * 3],
+            glm::value_ptr(localMatrices[i]));
+    }
+    return true;
+}
+
+bool InstanceBatcher::build(const tinygltf::Model& model, const SceneGraph& sceneGraph) {
+    clear();
+
+    const int meshCount = static_cast<int>(model.meshes.size());
+    const int nodeCount = static_cast<int>(sceneGraph.getNodeCount());
+    m_meshRanges.assign(meshCount, InstanceRange());
+
+    // ノードを持たないモデルは各メッシュを単位行列で1回ずつ描画
+    if (nodeCount == 0) {
+        for (int mesh = 0; mesh < meshCount; ++mesh) {
+            m_meshRanges[mesh].m_firstInstance = mesh;
+            m_meshRanges[mesh].m_instanceCount = 1;
+            m_instanceNode.push_back(-1);
+            m_instanceLocal.push_back(-1);
+            m_instanceMesh.push_back(mesh);
+        }
+        m_matrices.assign(m_instanceNode.size(), glm::mat4(1.0f));
+        return true;
+    }
+
+    // 1パス目: ノードごとのインスタンス数を数え、拡張インスタンスを読み込む
+    std::vector<int> nodeInstanceCount(nodeCount, 0);
+    std::vector<int> nodeLocalOffset(nodeCount, -1);
+    std::vector<glm::mat4> extensionMatrices;
+
+    for (int i = 0; i < nodeCount; ++i) {
+        int mesh = sceneGraph.getMesh(i);
+        if (mesh < 0 || mesh >= meshCount) {
+            continue;
+        }
+
+        if (readGPUInstancing(model, sceneGraph.getGLTFNode(i), extensionMatrices)) {
+            nodeLocalOffset[i] = static_cast<int>(m_localMatrices.size());
+            nodeInstanceCount[i] = static_cast<int>(extensionMatrices.size());
+            m_localMatrices.insert(m_localMatrices.end(), extensionMatrices.begin(), extensionMatrices.end());
+        } else {
+            nodeInstanceCount[i] = 1;
+        }
+        m_meshRanges[mesh].m_instanceCount += nodeInstanceCount[i];
+    }
+
+    // メッシュごとの開始位置（計数ソート）
+    int total = 0;
+    for (auto& range : m_meshRanges) {
+        range.m_firstInstance = total;
+        total += range.m_instanceCount;
+    }
+
+    // 2パス目: メッシュごとに連続するようインスタンスを配置
+    m_instanceNode.assign(total, -1);
+    m_instanceLocal.assign(total, -1);
+    m_instanceMesh.assign(total, -1);
+    std::vector<int> cursor(meshCount);
+    for (int mesh = 0; mesh < meshCount; ++mesh) {
+        cursor[mesh] = m_meshRanges[mesh].m_firstInstance;
+    }
+
+    for (int i = 0; i < nodeCount; ++i) {
+        int mesh = sceneGraph.getMesh(i);
+        if (mesh < 0 || mesh >= meshCount) {
+            continue;
+        }
+        for (int k = 0; k < nodeInstanceCount[i]; ++k) {
+            int slot = cursor[mesh]++;
+            m_instanceNode[slot] = i;
+            m_instanceMesh[slot] = mesh;
+            m_instanceLocal[slot] = (nodeLocalOffset[i] >= 0) ? nodeLocalOffset[i] + k : -1;
+        }
+    }
+
+    m_matrices.resize(total);
+    updateMatrices(sceneGraph);
+
+    int batchedMeshes = 0;
+    for (const auto& range : m_meshRanges) {
+        if (range.m_instanceCount > 1) {
+            ++batchedMeshes;
+        }
+    }
+    std::cout << "  インスタンス: " << total << " (" << kGPUInstancingExtension << ": " << m_localMatrices.size()
+        << ", 複数インスタンスのメッシュ: " << batchedMeshes << ")" << std::endl;
+    return true;
+}
+
+void InstanceBatcher::updateMatrices(const SceneGraph& sceneGraph) {
+    const size_t count = m_instanceNode.size();
+    for (size_t i = 0; i < count; ++i) {
+        const int node = m_instanceNode[i];
+        if (node < 0) {
+            m_matrices[i] = glm::mat4(1.0f);
+        } else if (m_instanceLocal[i] < 0) {
+            m_matrices[i] = sceneGraph.getWorldMatrix(node);
+        } else {
+            SimdMath::multiplyMatrix4(
+                glm::value_ptr(sceneGraph.getWorldMatrix(node)),
+                glm::value_ptr(m_localMatrices[m_instanceLocal[i]]),
+                glm::value_ptr(m_matrices[i]));
+        }
+    }
+}
+
+InstanceRange InstanceBatcher::getMeshRange(int meshIndex) const {
+    if (meshIndex < 0 || meshIndex >= static_cast<int>(m_meshRanges.size())) {
+        return InstanceRange();
+    }
+    return m_meshRanges[meshIndex];
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace tinygltf {
+    class Model;
+}
+
+class SceneGraph;
+
+// メッシュ単位のインスタンス範囲（インスタンス配列内で連続している）
+struct InstanceRange {
+    int m_firstInstance;
+    int m_instanceCount;
+
+    InstanceRange() : m_firstInstance(0), m_instanceCount(0) {}
+};
+
+// 同じメッシュを参照するノードを自動的にまとめ、インスタンス描画用の変換行列配列を作成する
+// EXT_mesh_gpu_instancing で指定されたノードごとのインスタンスも同じ配列に展開する
+class InstanceBatcher {
+private:
+    // インスタンスごとの情報（メッシュ順に並ぶ）
+    std::vector<int> m_instanceNode;       // シーングラフ内ノード（-1 の場合は単位行列）
+    std::vector<int> m_instanceLocal;      // m_localMatrices のインデックス（拡張インスタンスでなければ -1）
+    std::vector<int> m_instanceMesh;       // インスタンスが描画するメッシュ
+
+    // EXT_mesh_gpu_instancing のインスタンスごとのローカル変換
+    std::vector<glm::mat4> m_localMatrices;
+
+    // メッシュインデックス → インスタンス範囲
+    std::vector<InstanceRange> m_meshRanges;
+
+    // 描画に使用するインスタンスのワールド行列（m_instanceNode と同じ順序）
+    std::vector<glm::mat4> m_matrices;
+
+    // EXT_mesh_gpu_instancing の属性を読み込み、インスタンスのローカル行列を追加する
+    bool readGPUInstancing(const tinygltf::Model& model, int gltfNodeIndex, std::vector<glm::mat4>& localMatrices);
+
+public:
+    // シーングラフのノードをメッシュごとにまとめる
+    bool build(const tinygltf::Model& model, const SceneGraph& sceneGraph);
+
+    void clear();
+
+    // シーングラフのワールド行列からインスタンス行列を再計算
+    void updateMatrices(const SceneGraph& sceneGraph);
+
+    const std::vector<glm::mat4>& getInstanceMatrices() const { return m_matrices; }
+
+    // メッシュのインスタンス範囲（インスタンスが無ければ m_instanceCount = 0）
+    InstanceRange getMeshRange(int meshIndex) const;
+
+    size_t getInstanceCount() const { return m_instanceNode.size(); }
+    size_t getExtensionInstanceCount() const { return m_localMatrices.size(); }
+    int getInstanceNode(size_t instance) const { return m_instanceNode[instance]; }
+    int getInstanceMesh(size_t instance) const { return m_instanceMesh[instance]; }
+    const std::vector<int>& getInstanceMeshes() const { return m_instanceMesh; }
+};
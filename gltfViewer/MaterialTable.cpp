@@ -0,0 +1,139 @@
+﻿#include "MaterialTable.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // UBOで宣言する配列の要素数の上限（シェーダーのコンパイル時間を抑える）
+    const size_t kMaxUniformMaterials = 4096;
+
+    int32_t getAlphaMode(const std::string& alphaMode) {
+        if (alphaMode == "MASK") {
+            return 1;
+        }
+        if (alphaMode == "BLEND") {
+            return 2;
+        }
+        return 0;
+    }
+}
+
+GPUMaterial::GPUMaterial()
+    : m_baseColorFactor(1.0f)
+    , m_emissiveFactor(0.0f, 0.0f, 0.0f, 0.5f)
+    , m_pbrFactors(1.0f, 1.0f, 1.0f, 1.0f)
+    , m_emissiveTexture(-1)
+    , m_alphaMode(0)
+    , m_doubleSided(0)
+    , m_padding(0)
+{
+    std::fill(m_textures, m_textures + 4, -1);
+}
+
+static_assert(sizeof(GPUMaterial) % 16 == 0, "GPUMaterial は std140 の配列要素として16バイト境界に揃える必要があります");
+
+MaterialTable::MaterialTable()
+    : m_materials(1)
+    , m_buffer(0)
+    , m_target(GL_UNIFORM_BUFFER)
+    , m_capacity(1)
+{
+}
+
+MaterialTable::~MaterialTable() {
+    // OpenGLリソースは clear() で解放する（コンテキスト破棄後の呼び出しを避ける）
+}
+
+void MaterialTable::initialize(bool useStorageBuffer, GLint maxUniformBlockSize) {
+    m_target = useStorageBuffer ? GL_SHADER_STORAGE_BUFFER : GL_UNIFORM_BUFFER;
+    m_capacity = std::min(static_cast<size_t>(std::max(maxUniformBlockSize, 0)) / sizeof(GPUMaterial), kMaxUniformMaterials);
+    m_capacity = std::max<size_t>(m_capacity, 1);
+}
+
+bool MaterialTable::build(const tinygltf::Model& model) {
+    m_materials.assign(1, GPUMaterial());
+    m_materials.reserve(model.materials.size() + 1);
+    for (const tinygltf::Material& material : model.materials) {
+        const tinygltf::PbrMetallicRoughness& pbr = material.pbrMetallicRoughness;
+        GPUMaterial gpuMaterial;
+        for (size_t i = 0; i < std::min<size_t>(pbr.baseColorFactor.size(), 4); ++i) {
+            gpuMaterial.m_baseColorFactor[static_cast<int>(i)] = static_cast<float>(pbr.baseColorFactor[i]);
+        }
+        for (size_t i = 0; i < std::min<size_t>(material.emissiveFactor.size(), 3); ++i) {
+            gpuMaterial.m_emissiveFactor[static_cast<int>(i)] = static_cast<float>(material.emissiveFactor[i]);
+        }
+        gpuMaterial.m_emissiveFactor.w = static_cast<float>(material.alphaCutoff);
+        gpuMaterial.m_pbrFactors = glm::vec4(static_cast<float>(pbr.metallicFactor), static_cast<float>(pbr.roughnessFactor),
+            static_cast<float>(material.normalTexture.scale), static_cast<float>(material.occlusionTexture.strength));
+        gpuMaterial.m_textures[0] = pbr.baseColorTexture.index;
+        gpuMaterial.m_textures[1] = pbr.metallicRoughnessTexture.index;
+        gpuMaterial.m_textures[2] = material.normalTexture.index;
+        gpuMaterial.m_textures[3] = material.occlusionTexture.index;
+        gpuMaterial.m_emissiveTexture = material.emissiveTexture.index;
+        gpuMaterial.m_alphaMode = getAlphaMode(material.alphaMode);
+        gpuMaterial.m_doubleSided = material.doubleSided ? 1 : 0;
+        m_materials.push_back(gpuMaterial);
+    }
+
+    if (!isStorageBuffer() && m_materials.size() > m_capacity) {
+        std::cerr << "警告: マテリアル数 " << model.materials.size() << " がユニフォームバッファーの上限 " << (m_capacity - 1)
+            << " を超えています（超えた分は既定のマテリアルで描画します）" << std::endl;
+    }
+
+    // UBOはシェーダーで宣言した要素数分を確保する（宣言より小さい範囲をバインドすると未定義）
+    std::vector<GPUMaterial> uniformMaterials;
+    const GPUMaterial* data = m_materials.data();
+    size_t count = m_materials.size();
+    if (!isStorageBuffer()) {
+        uniformMaterials.assign(m_materials.begin(), m_materials.begin() + std::min(m_materials.size(), m_capacity));
+        uniformMaterials.resize(m_capacity);
+        data = uniformMaterials.data();
+        count = m_capacity;
+    }
+
+    if (m_buffer == 0) {
+        glGenBuffers(1, &m_buffer);
+    }
+    glBindBuffer(m_target, m_buffer);
+    glBufferData(m_target, count * sizeof(GPUMaterial), data, GL_STATIC_DRAW);
+    glBindBuffer(m_target, 0);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        std::cerr << "エラー: マテリアルテーブルの転送中にOpenGLエラーが発生しました: " << error << std::endl;
+        return false;
+    }
+
+    std::cout << "  マテリアルテーブル: " << m_materials.size() << " 件 (" << (isStorageBuffer() ? "SSBO std430" : "UBO std140")
+        << ", " << getGPUBytes() << " バイト)" << std::endl;
+    return true;
+}
+
+void MaterialTable::clear() {
+    if (m_buffer != 0) {
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+    m_materials.assign(1, GPUMaterial());
+}
+
+void MaterialTable::bind() const {
+    if (m_buffer != 0) {
+        glBindBufferBase(m_target, kMaterialTableBinding, m_buffer);
+    }
+}
+
+int MaterialTable::getMaterialIndex(int gltfMaterial) const {
+    const size_t index = static_cast<size_t>(gltfMaterial) + 1;
+    if (gltfMaterial < 0 || index >= m_materials.size() || (!isStorageBuffer() && index >= m_capacity)) {
+        return 0;
+    }
+    return static_cast<int>(index);
+}
+
+size_t MaterialTable::getGPUBytes() const {
+    if (m_buffer == 0) {
+        return 0;
+    }
+    return (isStorageBuffer() ? m_materials.size() : m_capacity) * sizeof(GPUMaterial);
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tinygltf {
+    class Model;
+}
+
+// GPU上のマテリアル（std140 と std430 で同じ配置になるよう vec4 / ivec4 だけで構成する）
+// シェーダー側の struct Material と同じ並び（shaders/material_table.glsl）
+struct GPUMaterial {
+    glm::vec4 m_baseColorFactor;
+    glm::vec4 m_emissiveFactor;   // xyz: 放射色, w: alphaCutoff
+    glm::vec4 m_pbrFactors;       // x: metallic, y: roughness, z: normalTexture.scale, w: occlusionTexture.strength
+    int32_t m_textures[4];        // baseColor, metallicRoughness, normal, occlusion のテクスチャ番号（-1 はなし）
+    int32_t m_emissiveTexture;
+    int32_t m_alphaMode;          // 0: OPAQUE, 1: MASK, 2: BLEND
+    int32_t m_doubleSided;
+    int32_t m_padding;
+
+    GPUMaterial();
+};
+
+// マテリアルテーブルのバインディングポイント（SSBO・UBOともに同じ番号を使う）
+const GLuint kMaterialTableBinding = 0;
+// マルチドローの間接描画コマンドごとのマテリアル番号（SSBO、gl_DrawIDARB で参照）
+const GLuint kDrawMaterialBinding = 1;
+
+// glTFの全マテリアルのパラメーターをロード時に1つのバッファーへ詰めたもの
+// 0番はマテリアルを持たないプリミティブ用の既定値（白）で、glTFのマテリアル i は i + 1 番に格納する
+// 描画はマテリアル番号だけを参照し、シェーダーがテーブルからパラメーターを読む
+// GL 4.3（SSBO）では std430 の可変長配列、それ以外は std140 の固定長配列（UBOの上限に収まる数まで）として転送する
+class MaterialTable {
+private:
+    std::vector<GPUMaterial> m_materials;
+    GLuint m_buffer;
+    GLenum m_target;            // GL_SHADER_STORAGE_BUFFER または GL_UNIFORM_BUFFER
+    size_t m_capacity;          // UBOの場合にシェーダーで宣言する配列の要素数
+
+public:
+    MaterialTable();
+    ~MaterialTable();
+
+    MaterialTable(const MaterialTable&) = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+
+    // SSBOが使えるかとUBOの上限から転送方法と配列の要素数を決める（シェーダーの作成前に呼ぶ）
+    void initialize(bool useStorageBuffer, GLint maxUniformBlockSize);
+
+    // モデルの全マテリアルをテーブルに詰めて転送（UBOの要素数を超える分は既定値で描画される）
+    bool build(const tinygltf::Model& model);
+    void clear();   // バッファーを解放するためOpenGLコンテキストが有効なうちに呼ぶこと
+
+    void bind() const;
+
+    // glTFのマテリアル番号からテーブルの番号（範囲外・-1 は既定値の 0）
+    int getMaterialIndex(int gltfMaterial) const;
+    const GPUMaterial& getMaterial(int index) const { return m_materials[index]; }
+    glm::vec3 getBaseColor(int index) const { return glm::vec3(m_materials[index].m_baseColorFactor); }
+
+    bool isStorageBuffer() const { return m_target == GL_SHADER_STORAGE_BUFFER; }
+    size_t getCapacity() const { return m_capacity; }
+    size_t getMaterialCount() const { return m_materials.size(); }
+    size_t getGPUBytes() const;
+};
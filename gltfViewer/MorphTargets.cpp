@@ -0,0 +1,273 @@
+﻿#include "MorphTargets.h"
+#include "AccessorReader.h"
+#include "SceneGraph.h"
+#include "SimdMath.h"
+#include "ThreadPool.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+MorphTargetSystem::MorphTargetSystem()
+    : m_parallel(true)
+{
+}
+
+void MorphTargetSystem::clear() {
+    m_primitiveMesh.clear();
+    m_primitiveIndex.clear();
+    m_primitiveVertexCount.clear();
+    m_primitiveBaseOffset.clear();
+    m_primitiveTargetOffset.clear();
+    m_primitiveTargetCount.clear();
+    m_primitiveBounds.clear();
+    m_basePositions.clear();
+
+    m_targetDeltaOffset.clear();
+    m_targetDeltaCount.clear();
+    m_targetDeltaBounds.clear();
+    m_deltaIndices.clear();
+    m_deltas.clear();
+
+    m_instanceNode.clear();
+    m_instancePrimitive.clear();
+    m_instancePositionOffset.clear();
+    m_positions.clear();
+    m_nodeFirstInstance.clear();
+    m_nodeInstanceCount.clear();
+    m_updatedInstances.clear();
+    m_lastStats = MorphStats();
+}
+
+bool MorphTargetSystem::build(const tinygltf::Model& model, const SceneGraph& sceneGraph) {
+    clear();
+
+    // メッシュ → 最初のモーフプリミティブ（メッシュのプリミティブは連続して登録する）
+    std::vector<int> meshFirstPrimitive(model.meshes.size(), -1);
+    std::vector<int> meshPrimitiveCount(model.meshes.size(), 0);
+
+    for (size_t meshIndex = 0; meshIndex < model.meshes.size(); ++meshIndex) {
+        const tinygltf::Mesh& mesh = model.meshes[meshIndex];
+        for (size_t primitiveIndex = 0; primitiveIndex < mesh.primitives.size(); ++primitiveIndex) {
+            const tinygltf::Primitive& primitive = mesh.primitives[primitiveIndex];
+            auto positionIt = primitive.attributes.find("POSITION");
+            if (primitive.targets.empty() || positionIt == primitive.attributes.end()) {
+                continue;
+            }
+
+            std::vector<float> base;
+            if (!AccessorReader::readFloats(model, positionIt->second, base, 3)) {
+                continue;
+            }
+            const int vertexCount = static_cast<int>(base.size() / 3);
+
+            const int primitiveId = static_cast<int>(m_primitiveMesh.size());
+            if (meshFirstPrimitive[meshIndex] < 0) {
+                meshFirstPrimitive[meshIndex] = primitiveId;
+            }
+            ++meshPrimitiveCount[meshIndex];
+
+            m_primitiveMesh.push_back(static_cast<int>(meshIndex));
+            m_primitiveIndex.push_back(static_cast<int>(primitiveIndex));
+            m_primitiveVertexCount.push_back(vertexCount);
+            m_primitiveBaseOffset.push_back(m_basePositions.size());
+            m_primitiveTargetOffset.push_back(static_cast<int>(m_targetDeltaCount.size()));
+            m_primitiveTargetCount.push_back(static_cast<int>(primitive.targets.size()));
+            m_primitiveBounds.push_back(BoundingVolume::computeAABB(base.data(), vertexCount));
+            m_basePositions.insert(m_basePositions.end(), base.begin(), base.end());
+
+            // 差分が 0 の頂点を除いて疎な形式で格納（POSITION を持たないターゲットは空）
+            for (const auto& target : primitive.targets) {
+                m_targetDeltaOffset.push_back(m_deltaIndices.size());
+                BoundingBox deltaBounds;
+                deltaBounds.expand(glm::vec3(0.0f));
+
+                std::vector<float> deltas;
+                auto deltaIt = target.find("POSITION");
+                if (deltaIt != target.end() && AccessorReader::readFloats(model, deltaIt->second, deltas, 3)) {
+                    const int deltaCount = std::min(vertexCount, static_cast<int>(deltas.size() / 3));
+                    for (int vertex = 0; vertex < deltaCount; ++vertex) {
+                        const glm::vec3 delta(deltas[vertex * 3 + 0], deltas[vertex * 3 + 1], deltas[vertex * 3 + 2]);
+                        if (delta.x != 0.0f || delta.y != 0.0f || delta.z != 0.0f) {
+                            m_deltaIndices.push_back(static_cast<uint32_t>(vertex));
+                            m_deltas.push_back(glm::vec4(delta, 0.0f));
+                            deltaBounds.expand(delta);
+                        }
+                    }
+                }
+
+                m_targetDeltaCount.push_back(static_cast<int>(m_deltaIndices.size() - m_targetDeltaOffset.back()));
+                m_targetDeltaBounds.push_back(deltaBounds);
+            }
+        }
+    }
+
+    // ターゲットを持つメッシュを参照するノードごとにモーフ後の頂点領域を確保
+    const int nodeCount = static_cast<int>(sceneGraph.getNodeCount());
+    m_nodeFirstInstance.assign(nodeCount, -1);
+    m_nodeInstanceCount.assign(nodeCount, 0);
+    for (int node = 0; node < nodeCount; ++node) {
+        const int mesh = sceneGraph.getMesh(node);
+        if (mesh < 0 || mesh >= static_cast<int>(meshFirstPrimitive.size()) || meshFirstPrimitive[mesh] < 0) {
+            continue;
+        }
+
+        m_nodeFirstInstance[node] = static_cast<int>(m_instanceNode.size());
+        m_nodeInstanceCount[node] = meshPrimitiveCount[mesh];
+        for (int primitive = meshFirstPrimitive[mesh]; primitive < meshFirstPrimitive[mesh] + meshPrimitiveCount[mesh]; ++primitive) {
+            m_instanceNode.push_back(node);
+            m_instancePrimitive.push_back(primitive);
+            m_instancePositionOffset.push_back(m_positions.size());
+
+            // 4要素単位で加算するため、末尾の頂点の後ろに1要素の余白を置く（隣のインスタンスと重ならない）
+            const float* base = &m_basePositions[m_primitiveBaseOffset[primitive]];
+            m_positions.insert(m_positions.end(), base, base + m_primitiveVertexCount[primitive] * 3);
+            m_positions.push_back(0.0f);
+        }
+    }
+
+    if (!m_primitiveMesh.empty()) {
+        std::cout << "モーフターゲット: " << m_targetDeltaCount.size() << " ターゲット (プリミティブ数: " << m_primitiveMesh.size()
+            << ", 差分: " << m_deltaIndices.size() << ", インスタンス数: " << m_instanceNode.size() << ")" << std::endl;
+    }
+    return true;
+}
+
+bool MorphTargetSystem::hasNodeInstances(int sceneNode) const {
+    return sceneNode >= 0 && sceneNode < static_cast<int>(m_nodeFirstInstance.size()) && m_nodeFirstInstance[sceneNode] >= 0;
+}
+
+int MorphTargetSystem::findInstance(int sceneNode, int primitiveIndex) const {
+    if (!hasNodeInstances(sceneNode)) {
+        return -1;
+    }
+    const int first = m_nodeFirstInstance[sceneNode];
+    for (int instance = first; instance < first + m_nodeInstanceCount[sceneNode]; ++instance) {
+        if (m_primitiveIndex[m_instancePrimitive[instance]] == primitiveIndex) {
+            return instance;
+        }
+    }
+    return -1;
+}
+
+// 基本形状をコピーし、ウェイトが 0 でないターゲットの疎な差分だけを加算
+void MorphTargetSystem::evaluateInstance(int instance, const SceneGraph& sceneGraph, size_t& activeTargets, size_t& appliedDeltas) {
+    const int node = m_instanceNode[instance];
+    const int primitive = m_instancePrimitive[instance];
+    const int vertexCount = m_primitiveVertexCount[primitive];
+    float* positions = &m_positions[m_instancePositionOffset[instance]];
+    std::memcpy(positions, &m_basePositions[m_primitiveBaseOffset[primitive]], vertexCount * 3 * sizeof(float));
+
+    const float* weights = sceneGraph.getMorphWeights(node);
+    const int targetCount = std::min(m_primitiveTargetCount[primitive], sceneGraph.getMorphWeightCount(node));
+    for (int target = 0; target < targetCount; ++target) {
+        const float weight = weights[target];
+        const int globalTarget = m_primitiveTargetOffset[primitive] + target;
+        const int deltaCount = m_targetDeltaCount[globalTarget];
+        if (weight == 0.0f || deltaCount == 0) {
+            continue;
+        }
+
+        const uint32_t* indices = &m_deltaIndices[m_targetDeltaOffset[globalTarget]];
+        const glm::vec4* deltas = &m_deltas[m_targetDeltaOffset[globalTarget]];
+#ifdef GLTFVIEWER_SIMD_SSE
+        // xyz と次の要素を4要素で読み書きする（差分の w は 0 なので次の要素は変わらない）
+        const __m128 scale = _mm_set1_ps(weight);
+        for (int i = 0; i < deltaCount; ++i) {
+            float* position = positions + indices[i] * 3;
+            _mm_storeu_ps(position, _mm_add_ps(_mm_loadu_ps(position), _mm_mul_ps(scale, _mm_loadu_ps(&deltas[i].x))));
+        }
+#else
+        for (int i = 0; i < deltaCount; ++i) {
+            float* position = positions + indices[i] * 3;
+            position[0] += weight * deltas[i].x;
+            position[1] += weight * deltas[i].y;
+            position[2] += weight * deltas[i].z;
+        }
+#endif
+        ++activeTargets;
+        appliedDeltas += deltaCount;
+    }
+}
+
+size_t MorphTargetSystem::update(SceneGraph& sceneGraph) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    m_lastStats = MorphStats();
+    m_updatedInstances.clear();
+
+    for (int node : sceneGraph.getDirtyMorphWeightNodes()) {
+        if (!hasNodeInstances(node)) {
+            continue;
+        }
+        for (int instance = m_nodeFirstInstance[node]; instance < m_nodeFirstInstance[node] + m_nodeInstanceCount[node]; ++instance) {
+            m_updatedInstances.push_back(instance);
+        }
+    }
+    sceneGraph.clearDirtyMorphWeights();
+
+    if (m_updatedInstances.empty()) {
+        return 0;
+    }
+
+    // インスタンスごとに独立した領域へ書き込むので並列に評価できる
+    std::atomic<size_t> activeTargets(0);
+    std::atomic<size_t> appliedDeltas(0);
+    auto evaluateRange = [this, &sceneGraph, &activeTargets, &appliedDeltas](size_t begin, size_t end) {
+        size_t active = 0;
+        size_t applied = 0;
+        for (size_t i = begin; i < end; ++i) {
+            evaluateInstance(m_updatedInstances[i], sceneGraph, active, applied);
+        }
+        activeTargets += active;
+        appliedDeltas += applied;
+    };
+
+    if (m_parallel) {
+        ThreadPool::getInstance().parallelFor(m_updatedInstances.size(), 4, evaluateRange);
+    } else {
+        evaluateRange(0, m_updatedInstances.size());
+    }
+
+    m_lastStats.m_instances = m_updatedInstances.size();
+    m_lastStats.m_activeTargets = activeTargets;
+    m_lastStats.m_appliedDeltas = appliedDeltas;
+    m_lastStats.m_timeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return m_updatedInstances.size();
+}
+
+BoundingBox MorphTargetSystem::computeNodeBounds(int sceneNode, const SceneGraph& sceneGraph) const {
+    BoundingBox bounds;
+    if (!hasNodeInstances(sceneNode)) {
+        return bounds;
+    }
+
+    const float* weights = sceneGraph.getMorphWeights(sceneNode);
+    const int weightCount = sceneGraph.getMorphWeightCount(sceneNode);
+    const int first = m_nodeFirstInstance[sceneNode];
+    for (int instance = first; instance < first + m_nodeInstanceCount[sceneNode]; ++instance) {
+        const int primitive = m_instancePrimitive[instance];
+        BoundingBox box = m_primitiveBounds[primitive];
+        if (!box.isValid()) {
+            continue;
+        }
+
+        // 負のウェイトでは差分の最小・最大が入れ替わる
+        const int targetCount = std::min(m_primitiveTargetCount[primitive], weightCount);
+        for (int target = 0; target < targetCount; ++target) {
+            const float weight = weights[target];
+            if (weight == 0.0f) {
+                continue;
+            }
+            const BoundingBox& delta = m_targetDeltaBounds[m_primitiveTargetOffset[primitive] + target];
+            const glm::vec3 a = delta.m_min * weight;
+            const glm::vec3 b = delta.m_max * weight;
+            box.m_min += glm::min(a, b);
+            box.m_max += glm::max(a, b);
+        }
+        bounds.expand(box);
+    }
+    return bounds;
+}
@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include "BoundingVolume.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace tinygltf {
+    class Model;
+}
+
+class SceneGraph;
+
+// 1回の update() の統計
+struct MorphStats {
+    size_t m_instances;       // 頂点を再計算したインスタンス数
+    size_t m_activeTargets;   // ウェイトが 0 でなく加算したターゲット数（全インスタンスの合計）
+    size_t m_appliedDeltas;   // 加算した差分の数
+    double m_timeMs;
+
+    MorphStats() : m_instances(0), m_activeTargets(0), m_appliedDeltas(0), m_timeMs(0.0) {}
+};
+
+// glTFモーフターゲット（POSITION）の評価
+// ターゲットの差分は 0 でない頂点だけを (頂点番号, 差分) の疎な形式で保持し、
+// ウェイトが 0 でないターゲットだけを基本形状に加算する
+// ノードごとにウェイトが異なるため、モーフ後の頂点は (ノード, プリミティブ) の組ごとに持つ
+class MorphTargetSystem {
+private:
+    // === プリミティブ（モーフターゲットを持つもの） ===
+    std::vector<int> m_primitiveMesh;
+    std::vector<int> m_primitiveIndex;          // メッシュ内のプリミティブ番号
+    std::vector<int> m_primitiveVertexCount;
+    std::vector<size_t> m_primitiveBaseOffset;  // m_basePositions 内の先頭（float 単位）
+    std::vector<int> m_primitiveTargetOffset;   // ターゲット配列内の先頭
+    std::vector<int> m_primitiveTargetCount;
+    std::vector<BoundingBox> m_primitiveBounds; // 基本形状のAABB
+    std::vector<float> m_basePositions;         // xyz
+
+    // === ターゲット（疎な差分） ===
+    std::vector<size_t> m_targetDeltaOffset;
+    std::vector<int> m_targetDeltaCount;
+    std::vector<BoundingBox> m_targetDeltaBounds;  // 差分の範囲（原点を含む）
+    std::vector<uint32_t> m_deltaIndices;
+    std::vector<glm::vec4> m_deltas;               // xyz（w は 0、SIMDで4要素単位に加算するため）
+
+    // === インスタンス（シーングラフのノード × プリミティブ） ===
+    std::vector<int> m_instanceNode;
+    std::vector<int> m_instancePrimitive;
+    std::vector<size_t> m_instancePositionOffset;  // m_positions 内の先頭（float 単位）
+    std::vector<float> m_positions;                // モーフ後の xyz（インスタンスの末尾に1要素の余白）
+    std::vector<int> m_nodeFirstInstance;          // シーングラフ内ノード → 先頭インスタンス（無ければ -1）
+    std::vector<int> m_nodeInstanceCount;
+    std::vector<int> m_updatedInstances;           // 直近の update() で再計算したインスタンス
+
+    bool m_parallel;
+    MorphStats m_lastStats;
+
+    void evaluateInstance(int instance, const SceneGraph& sceneGraph, size_t& activeTargets, size_t& appliedDeltas);
+
+public:
+    MorphTargetSystem();
+
+    // モデルのモーフターゲットを読み込み、ターゲットを持つメッシュを参照するノードごとにインスタンスを作成する
+    bool build(const tinygltf::Model& model, const SceneGraph& sceneGraph);
+    void clear();
+
+    // ウェイトが変更されたノードのインスタンスだけを再計算し、再計算したインスタンス数を返す
+    // （シーングラフのウェイトの変更追跡はクリアされる）
+    size_t update(SceneGraph& sceneGraph);
+
+    // ノードの現在のウェイトでのローカル空間AABB（ターゲットごとの差分の範囲から保守的に求める）
+    BoundingBox computeNodeBounds(int sceneNode, const SceneGraph& sceneGraph) const;
+
+    bool hasInstances() const { return !m_instanceNode.empty(); }
+    size_t getInstanceCount() const { return m_instanceNode.size(); }
+    size_t getTargetCount() const { return m_targetDeltaCount.size(); }
+    size_t getDeltaCount() const { return m_deltaIndices.size(); }
+    bool hasNodeInstances(int sceneNode) const;
+
+    // ノードとメッシュ内のプリミティブ番号からインスタンスを探す（無ければ -1）
+    int findInstance(int sceneNode, int primitiveIndex) const;
+    int getInstanceMesh(int instance) const { return m_primitiveMesh[m_instancePrimitive[instance]]; }
+    int getInstancePrimitiveIndex(int instance) const { return m_primitiveIndex[m_instancePrimitive[instance]]; }
+    int getInstanceVertexCount(int instance) const { return m_primitiveVertexCount[m_instancePrimitive[instance]]; }
+    const float* getInstancePositions(int instance) const { return m_positions.data() + m_instancePositionOffset[instance]; }
+    const std::vector<int>& getUpdatedInstances() const { return m_updatedInstances; }
+
+    void setParallel(bool parallel) { m_parallel = parallel; }
+    const MorphStats& getLastStats() const { return m_lastStats; }
+};
@@ -0,0 +1,685 @@
+﻿#include "OcclusionCulling.h"
+#include "AccessorReader.h"
+#include "PrimitiveTopology.h"
+#include "SimdMath.h"
+#include "ThreadPool.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+namespace {
+    const uint32_t kFullRow = 0xFFFFFFFFu;
+    // ピクセル中心がエッジからこの距離（ピクセル）以内なら覆っていないものとする（誤差で被覆を広げないため）
+    const float kSpanEpsilon = 1e-3f;
+
+    double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    int roundUp(int value, int multiple) {
+        value = std::max(value, multiple);
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    // 画面座標をピクセル番号へ変換（画面外の大きな値も int へ安全に変換できるよう先に範囲を制限する）
+    // 範囲外の場合は最小側が size、最大側が -1 になり、min > max となる
+    inline int toPixel(float coordinate, int size, bool roundUp) {
+        coordinate = std::max(-1.0f, std::min(coordinate, static_cast<float>(size)));
+        const int pixel = roundUp ? static_cast<int>(std::ceil(coordinate)) - 1 : static_cast<int>(std::floor(coordinate));
+        return roundUp ? std::min(pixel, size - 1) : std::max(pixel, 0);
+    }
+
+    // ニア平面 (z >= -w) の内側までの符号付き距離
+    inline float nearDistance(const glm::vec4& clip) {
+        return clip.z + clip.w;
+    }
+
+    // マスクの1行でビット first..last を立てたもの（0 <= first <= last < 32）
+    inline uint32_t rowBits(int first, int last) {
+        const uint32_t upToLast = last >= 31 ? kFullRow : (1u << (last + 1)) - 1u;
+        return upToLast & ~((1u << first) - 1u);
+    }
+}
+
+OcclusionCuller::OcclusionCuller()
+    : m_width(0)
+    , m_height(0)
+    , m_tilesX(0)
+    , m_tilesY(0)
+    , m_minOccluderArea(0.01f)
+    , m_triangleBudget(65536)
+    , m_validationEnabled(false)
+{
+    setResolution(256, 144);
+}
+
+void OcclusionCuller::setResolution(int width, int height) {
+    m_width = roundUp(width, kTileWidth);
+    m_height = roundUp(height, kTileHeight);
+    m_tilesX = m_width / kTileWidth;
+    m_tilesY = m_height / kTileHeight;
+    m_tiles.resize(static_cast<size_t>(m_tilesX) * m_tilesY);
+    if (m_validationEnabled) {
+        m_referenceDepth.assign(static_cast<size_t>(m_width) * m_height, 1.0f);
+    }
+}
+
+void OcclusionCuller::setValidationEnabled(bool enabled) {
+    m_validationEnabled = enabled;
+    if (enabled) {
+        m_referenceDepth.assign(static_cast<size_t>(m_width) * m_height, 1.0f);
+    } else {
+        std::vector<float>().swap(m_referenceDepth);
+    }
+}
+
+void OcclusionCuller::clear() {
+    m_occluderMeshes.clear();
+    m_rects.clear();
+    m_occluderTriangles.clear();
+    m_triangles.clear();
+    m_occludedFlags.clear();
+}
+
+bool OcclusionCuller::hasOccluders() const {
+    for (const auto& mesh : m_occluderMeshes) {
+        if (!mesh.m_indices.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OcclusionCuller::buildOccluderMeshes(const tinygltf::Model& model, size_t maxTrianglesPerMesh) {
+    m_occluderMeshes.assign(model.meshes.size(), OccluderMesh());
+
+    size_t occluderMeshCount = 0;
+    for (size_t meshIndex = 0; meshIndex < model.meshes.size(); ++meshIndex) {
+        OccluderMesh& occluder = m_occluderMeshes[meshIndex];
+
+        for (const auto& primitive : model.meshes[meshIndex].primitives) {
+            if (PrimitiveTopology::classify(primitive.mode) != PrimitiveClass::Triangles) {
+                continue;
+            }
+            auto positionIt = primitive.attributes.find("POSITION");
+            if (positionIt == primitive.attributes.end()) {
+                continue;
+            }
+
+            std::vector<float> positions;
+            if (!AccessorReader::readFloats(model, positionIt->second, positions, 3)) {
+                continue;
+            }
+            const size_t vertexCount = positions.size() / 3;
+
+            std::vector<unsigned int> sourceIndices;
+            unsigned int restartIndex = PrimitiveTopology::getRestartIndex(TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
+            if (primitive.indices >= 0) {
+                if (!AccessorReader::readUInts(model, primitive.indices, sourceIndices, 1)) {
+                    continue;
+                }
+                restartIndex = PrimitiveTopology::getRestartIndex(model.accessors[primitive.indices].componentType);
+            } else {
+                PrimitiveTopology::generateSequentialIndices(vertexCount, sourceIndices);
+            }
+
+            std::vector<unsigned int> indices;
+            PrimitiveTopology::normalize(primitive.mode, sourceIndices, restartIndex, indices);
+
+            const unsigned int baseVertex = static_cast<unsigned int>(occluder.m_positions.size());
+            for (size_t v = 0; v < vertexCount; ++v) {
+                occluder.m_positions.push_back(glm::vec3(positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2]));
+            }
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                // 範囲外の頂点を参照する三角形は除外
+                if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount) {
+                    continue;
+                }
+                occluder.m_indices.push_back(baseVertex + indices[i]);
+                occluder.m_indices.push_back(baseVertex + indices[i + 1]);
+                occluder.m_indices.push_back(baseVertex + indices[i + 2]);
+            }
+        }
+
+        // 三角形数の多いメッシュはラスタライズのコストに見合わないため使用しない
+        if (occluder.m_indices.size() / 3 > maxTrianglesPerMesh) {
+            occluder = OccluderMesh();
+        }
+        if (!occluder.m_indices.empty()) {
+            ++occluderMeshCount;
+        }
+    }
+
+    std::cout << "オクルーダーメッシュ: " << occluderMeshCount << " / " << model.meshes.size()
+        << " (被覆マスク: " << m_width << "x" << m_height << ", タイル " << kTileWidth << "x" << kTileHeight << ")" << std::endl;
+}
+
+// AABBの8頂点を投影して画面上の矩形と最も手前の深度を求める
+OcclusionCuller::ScreenRect OcclusionCuller::projectBounds(const BoundingBox& box, const glm::mat4& viewProjection) const {
+    ScreenRect rect;
+    rect.m_minX = rect.m_minY = std::numeric_limits<float>::max();
+    rect.m_maxX = rect.m_maxY = -std::numeric_limits<float>::max();
+    rect.m_minDepth = 1.0f;
+    rect.m_crossesNear = false;
+
+    if (!box.isValid()) {
+        rect.m_crossesNear = true;
+        return rect;
+    }
+
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec4 point(
+            (corner & 1) ? box.m_max.x : box.m_min.x,
+            (corner & 2) ? box.m_max.y : box.m_min.y,
+            (corner & 4) ? box.m_max.z : box.m_min.z,
+            1.0f);
+        const glm::vec4 clip = viewProjection * point;
+        if (nearDistance(clip) < 0.0f || clip.w <= 0.0f) {
+            rect.m_crossesNear = true;
+            return rect;
+        }
+
+        const float invW = 1.0f / clip.w;
+        const float x = (clip.x * invW * 0.5f + 0.5f) * m_width;
+        const float y = (clip.y * invW * 0.5f + 0.5f) * m_height;
+        rect.m_minX = std::min(rect.m_minX, x);
+        rect.m_maxX = std::max(rect.m_maxX, x);
+        rect.m_minY = std::min(rect.m_minY, y);
+        rect.m_maxY = std::max(rect.m_maxY, y);
+        rect.m_minDepth = std::min(rect.m_minDepth, clip.z * invW * 0.5f + 0.5f);
+    }
+    return rect;
+}
+
+// クリップ座標の三角形を画面座標へ変換し、エッジ関数と深度平面をセットアップ
+void OcclusionCuller::emitTriangle(const glm::vec4* clip, std::vector<ScreenTriangle>& out) const {
+    float x[3], y[3], z[3];
+    for (int i = 0; i < 3; ++i) {
+        const float invW = 1.0f / clip[i].w;
+        x[i] = (clip[i].x * invW * 0.5f + 0.5f) * m_width;
+        y[i] = (clip[i].y * invW * 0.5f + 0.5f) * m_height;
+        z[i] = clip[i].z * invW * 0.5f + 0.5f;
+    }
+
+    const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (std::fabs(area) < 1e-8f) {
+        return;
+    }
+
+    ScreenTriangle triangle;
+    triangle.m_minX = toPixel(std::min(x[0], std::min(x[1], x[2])), m_width, false);
+    triangle.m_maxX = toPixel(std::max(x[0], std::max(x[1], x[2])), m_width, true);
+    triangle.m_minY = toPixel(std::min(y[0], std::min(y[1], y[2])), m_height, false);
+    triangle.m_maxY = toPixel(std::max(y[0], std::max(y[1], y[2])), m_height, true);
+    if (triangle.m_minX > triangle.m_maxX || triangle.m_minY > triangle.m_maxY) {
+        return;
+    }
+
+    // エッジ i は頂点 i の対辺。値を面積で割ると頂点 i の重心座標になる
+    for (int i = 0; i < 3; ++i) {
+        const int a = (i + 1) % 3;
+        const int b = (i + 2) % 3;
+        triangle.m_edgeA[i] = y[a] - y[b];
+        triangle.m_edgeB[i] = x[b] - x[a];
+        triangle.m_edgeC[i] = x[a] * y[b] - x[b] * y[a];
+    }
+
+    const float invArea = 1.0f / area;
+    const float dz1 = (z[1] - z[0]) * invArea;
+    const float dz2 = (z[2] - z[0]) * invArea;
+    triangle.m_depthA = triangle.m_edgeA[1] * dz1 + triangle.m_edgeA[2] * dz2;
+    triangle.m_depthB = triangle.m_edgeB[1] * dz1 + triangle.m_edgeB[2] * dz2;
+    triangle.m_depthC = z[0] + triangle.m_edgeC[1] * dz1 + triangle.m_edgeC[2] * dz2;
+    triangle.m_maxDepth = std::max(z[0], std::max(z[1], z[2]));
+
+    // 裏向き（時計回り）でも内側が正になるようにエッジの符号をそろえる（両面をオクルーダーとして扱う）
+    if (area < 0.0f) {
+        for (int i = 0; i < 3; ++i) {
+            triangle.m_edgeA[i] = -triangle.m_edgeA[i];
+            triangle.m_edgeB[i] = -triangle.m_edgeB[i];
+            triangle.m_edgeC[i] = -triangle.m_edgeC[i];
+        }
+    }
+
+    out.push_back(triangle);
+}
+
+// オクルーダーの三角形をクリップ座標へ変換し、ニア平面でクリップして出力
+void OcclusionCuller::transformOccluder(const OccluderMesh& mesh, const glm::mat4& modelViewProjection, std::vector<ScreenTriangle>& out) const {
+    std::vector<glm::vec4> clipPositions(mesh.m_positions.size());
+    for (size_t i = 0; i < mesh.m_positions.size(); ++i) {
+        clipPositions[i] = modelViewProjection * glm::vec4(mesh.m_positions[i], 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < mesh.m_indices.size(); i += 3) {
+        const glm::vec4 triangle[3] = {
+            clipPositions[mesh.m_indices[i]],
+            clipPositions[mesh.m_indices[i + 1]],
+            clipPositions[mesh.m_indices[i + 2]]
+        };
+        const float distance[3] = { nearDistance(triangle[0]), nearDistance(triangle[1]), nearDistance(triangle[2]) };
+
+        const int insideCount = (distance[0] >= 0.0f) + (distance[1] >= 0.0f) + (distance[2] >= 0.0f);
+        if (insideCount == 3) {
+            emitTriangle(triangle, out);
+            continue;
+        }
+        if (insideCount == 0) {
+            continue;
+        }
+
+        // Sutherland-Hodgman でニア平面の内側を切り出し（最大4頂点）、扇状に分割する
+        glm::vec4 polygon[4];
+        int polygonSize = 0;
+        for (int v = 0; v < 3; ++v) {
+            const int next = (v + 1) % 3;
+            if (distance[v] >= 0.0f) {
+                polygon[polygonSize++] = triangle[v];
+            }
+            if ((distance[v] >= 0.0f) != (distance[next] >= 0.0f)) {
+                const float t = distance[v] / (distance[v] - distance[next]);
+                polygon[polygonSize++] = triangle[v] + (triangle[next] - triangle[v]) * t;
+            }
+        }
+        for (int v = 1; v + 1 < polygonSize; ++v) {
+            const glm::vec4 fan[3] = { polygon[0], polygon[v], polygon[v + 1] };
+            emitTriangle(fan, out);
+        }
+    }
+}
+
+// タイルの被覆マスクと2層の深度へ三角形を合わせる（depth は三角形のタイル内の最大深度）
+void OcclusionCuller::updateTile(Tile& tile, const uint32_t* coverage, float depth) {
+    // 基準層より奥の三角形では遮蔽が増えない
+    if (depth >= tile.m_zMax0) {
+        return;
+    }
+    // 作業層との深度差が作業層と基準層の差より大きい（十分手前）なら作業層を捨てて三角形で置き換える
+    const bool discard = tile.m_zMax1 - depth > tile.m_zMax0 - tile.m_zMax1;
+    tile.m_zMax1 = discard ? depth : std::max(tile.m_zMax1, depth);
+#ifdef GLTFVIEWER_SIMD_SSE
+    __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coverage));
+    if (!discard) {
+        mask = _mm_or_si128(mask, _mm_loadu_si128(reinterpret_cast<const __m128i*>(tile.m_mask)));
+    }
+    // タイルを覆い切ったら作業層を基準層へ移す
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(mask, _mm_set1_epi32(-1))) == 0xFFFF) {
+        tile.m_zMax0 = tile.m_zMax1;
+        tile.m_zMax1 = 0.0f;
+        mask = _mm_setzero_si128();
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(tile.m_mask), mask);
+#else
+    uint32_t full = kFullRow;
+    for (int row = 0; row < kTileHeight; ++row) {
+        tile.m_mask[row] = discard ? coverage[row] : (tile.m_mask[row] | coverage[row]);
+        full &= tile.m_mask[row];
+    }
+    // タイルを覆い切ったら作業層を基準層へ移す
+    if (full == kFullRow) {
+        tile.m_zMax0 = tile.m_zMax1;
+        tile.m_zMax1 = 0.0f;
+        std::fill(tile.m_mask, tile.m_mask + kTileHeight, 0u);
+    }
+#endif
+}
+
+// タイル1行（4ピクセル行）を初期化してすべての三角形を被覆マスクと深度へ反映
+void OcclusionCuller::rasterizeTileRow(int tileY) {
+    const int rowMinY = tileY * kTileHeight;
+    const int rowMaxY = rowMinY + kTileHeight - 1;
+    Tile* tiles = &m_tiles[static_cast<size_t>(tileY) * m_tilesX];
+    for (int tileX = 0; tileX < m_tilesX; ++tileX) {
+        std::fill(tiles[tileX].m_mask, tiles[tileX].m_mask + kTileHeight, 0u);
+        tiles[tileX].m_zMax0 = 1.0f;
+        tiles[tileX].m_zMax1 = 0.0f;
+    }
+
+    for (const ScreenTriangle& triangle : m_triangles) {
+        if (triangle.m_maxY < rowMinY || triangle.m_minY > rowMaxY) {
+            continue;
+        }
+
+        // 各行で三角形がピクセル中心を覆う範囲 [left, right]
+        // エッジ A*(x + 0.5) + (B*y + C) >= 0 は A > 0 なら左端、A < 0 なら右端を制限する
+        float left[kTileHeight], right[kTileHeight];
+#ifdef GLTFVIEWER_SIMD_SSE
+        const __m128 py = _mm_add_ps(_mm_set1_ps(static_cast<float>(rowMinY)), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+        __m128 spanLeft = _mm_set1_ps(static_cast<float>(triangle.m_minX));
+        __m128 spanRight = _mm_set1_ps(static_cast<float>(triangle.m_maxX));
+        for (int i = 0; i < 3; ++i) {
+            const __m128 rowValue = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.m_edgeB[i]), py), _mm_set1_ps(triangle.m_edgeC[i]));
+            if (triangle.m_edgeA[i] == 0.0f) {
+                // 水平なエッジは外側の行を空にする
+                const __m128 outside = _mm_cmplt_ps(rowValue, _mm_setzero_ps());
+                spanLeft = _mm_or_ps(_mm_andnot_ps(outside, spanLeft), _mm_and_ps(outside, _mm_set1_ps(static_cast<float>(m_width))));
+                continue;
+            }
+            const __m128 boundary = _mm_sub_ps(_mm_div_ps(rowValue, _mm_set1_ps(-triangle.m_edgeA[i])), _mm_set1_ps(0.5f));
+            if (triangle.m_edgeA[i] > 0.0f) {
+                spanLeft = _mm_max_ps(spanLeft, _mm_add_ps(boundary, _mm_set1_ps(kSpanEpsilon)));
+            } else {
+                spanRight = _mm_min_ps(spanRight, _mm_sub_ps(boundary, _mm_set1_ps(kSpanEpsilon)));
+            }
+        }
+        // int へ変換できる範囲に制限
+        _mm_storeu_ps(left, _mm_min_ps(spanLeft, _mm_set1_ps(static_cast<float>(m_width))));
+        _mm_storeu_ps(right, _mm_max_ps(spanRight, _mm_set1_ps(-1.0f)));
+#else
+        for (int row = 0; row < kTileHeight; ++row) {
+            const float py = rowMinY + row + 0.5f;
+            left[row] = static_cast<float>(triangle.m_minX);
+            right[row] = static_cast<float>(triangle.m_maxX);
+            for (int i = 0; i < 3; ++i) {
+                const float rowValue = triangle.m_edgeB[i] * py + triangle.m_edgeC[i];
+                if (triangle.m_edgeA[i] == 0.0f) {
+                    // 水平なエッジは外側の行を空にする
+                    if (rowValue < 0.0f) {
+                        left[row] = static_cast<float>(m_width);
+                    }
+                    continue;
+                }
+                const float boundary = rowValue / -triangle.m_edgeA[i] - 0.5f;
+                if (triangle.m_edgeA[i] > 0.0f) {
+                    left[row] = std::max(left[row], boundary + kSpanEpsilon);
+                } else {
+                    right[row] = std::min(right[row], boundary - kSpanEpsilon);
+                }
+            }
+            // int へ変換できる範囲に制限
+            left[row] = std::min(left[row], static_cast<float>(m_width));
+            right[row] = std::max(right[row], -1.0f);
+        }
+#endif
+
+        int spanMin[kTileHeight], spanMax[kTileHeight];
+        int coveredMinX = m_width, coveredMaxX = -1;
+        int coveredMinRow = kTileHeight, coveredMaxRow = -1;
+        for (int row = 0; row < kTileHeight; ++row) {
+            spanMin[row] = static_cast<int>(std::ceil(left[row]));
+            spanMax[row] = static_cast<int>(std::floor(right[row]));
+            if (spanMin[row] <= spanMax[row]) {
+                coveredMinX = std::min(coveredMinX, spanMin[row]);
+                coveredMaxX = std::max(coveredMaxX, spanMax[row]);
+                coveredMinRow = std::min(coveredMinRow, row);
+                coveredMaxRow = std::max(coveredMaxRow, row);
+            }
+        }
+        if (coveredMinX > coveredMaxX) {
+            continue;
+        }
+
+        // 深度平面は一次式なので、覆う範囲の最大深度は範囲の角のいずれかになる
+        const float depthY = std::max(triangle.m_depthB * (rowMinY + coveredMinRow + 0.5f), triangle.m_depthB * (rowMinY + coveredMaxRow + 0.5f));
+        for (int tileX = coveredMinX / kTileWidth; tileX <= coveredMaxX / kTileWidth; ++tileX) {
+            const int tileMinX = tileX * kTileWidth;
+            const int tileMaxX = tileMinX + kTileWidth - 1;
+            uint32_t coverage[kTileHeight];
+            uint32_t anyCoverage = 0;
+            for (int row = 0; row < kTileHeight; ++row) {
+                const int first = std::max(spanMin[row], tileMinX);
+                const int last = std::min(spanMax[row], tileMaxX);
+                coverage[row] = first <= last ? rowBits(first - tileMinX, last - tileMinX) : 0u;
+                anyCoverage |= coverage[row];
+            }
+            if (anyCoverage == 0) {
+                continue;
+            }
+
+            const float minPx = std::max(coveredMinX, tileMinX) + 0.5f;
+            const float maxPx = std::min(coveredMaxX, tileMaxX) + 0.5f;
+            const float planeMax = triangle.m_depthC + depthY + std::max(triangle.m_depthA * minPx, triangle.m_depthA * maxPx);
+            updateTile(tiles[tileX], coverage, std::min(planeMax, triangle.m_maxDepth));
+        }
+    }
+}
+
+// 矩形の覆うすべてのピクセルがオクルーディーの最も手前の深度より手前で覆われていれば遮蔽されている
+// タイルの基準層が手前ならタイル全体、そうでなければ作業層のマスクのピクセルだけが覆われている
+bool OcclusionCuller::isOccluded(const ScreenRect& rect) const {
+    if (rect.m_crossesNear) {
+        return false;
+    }
+
+    // 矩形が少しでも掛かるピクセルをすべて対象にする
+    const int minX = toPixel(rect.m_minX, m_width, false);
+    const int maxX = toPixel(rect.m_maxX, m_width, true);
+    const int minY = toPixel(rect.m_minY, m_height, false);
+    const int maxY = toPixel(rect.m_maxY, m_height, true);
+    if (minX > maxX || minY > maxY) {
+        return false;
+    }
+
+    const float depth = rect.m_minDepth;
+    for (int tileY = minY / kTileHeight; tileY <= maxY / kTileHeight; ++tileY) {
+        const int tileMinY = tileY * kTileHeight;
+        for (int tileX = minX / kTileWidth; tileX <= maxX / kTileWidth; ++tileX) {
+            const Tile& tile = m_tiles[static_cast<size_t>(tileY) * m_tilesX + tileX];
+            if (tile.m_zMax0 < depth) {
+                continue;
+            }
+            // マスクが空なら作業層は 0 なので、ここでは矩形のピクセルがマスクに収まるかで決まる
+            if (tile.m_zMax1 >= depth) {
+                return false;
+            }
+
+            const int tileMinX = tileX * kTileWidth;
+            const uint32_t columns = rowBits(std::max(minX, tileMinX) - tileMinX, std::min(maxX, tileMinX + kTileWidth - 1) - tileMinX);
+            uint32_t rectMask[kTileHeight];
+            for (int row = 0; row < kTileHeight; ++row) {
+                const int y = tileMinY + row;
+                rectMask[row] = y >= minY && y <= maxY ? columns : 0u;
+            }
+#ifdef GLTFVIEWER_SIMD_SSE
+            const __m128i uncovered = _mm_andnot_si128(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(tile.m_mask)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(rectMask)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(uncovered, _mm_setzero_si128())) != 0xFFFF) {
+                return false;
+            }
+#else
+            for (int row = 0; row < kTileHeight; ++row) {
+                if (rectMask[row] & ~tile.m_mask[row]) {
+                    return false;
+                }
+            }
+#endif
+        }
+    }
+    return true;
+}
+
+// 検証用: タイル1行分のピクセルごとの深度バッファーをクリアしてすべての三角形を描く
+void OcclusionCuller::rasterizeReferenceRow(int tileY) {
+    const int rowMinY = tileY * kTileHeight;
+    const int rowMaxY = rowMinY + kTileHeight - 1;
+    float* rows = &m_referenceDepth[static_cast<size_t>(rowMinY) * m_width];
+    std::fill(rows, rows + static_cast<size_t>(kTileHeight) * m_width, 1.0f);
+
+    for (const ScreenTriangle& triangle : m_triangles) {
+        if (triangle.m_maxY < rowMinY || triangle.m_minY > rowMaxY) {
+            continue;
+        }
+        for (int y = std::max(triangle.m_minY, rowMinY); y <= std::min(triangle.m_maxY, rowMaxY); ++y) {
+            const float py = y + 0.5f;
+            float* row = &m_referenceDepth[static_cast<size_t>(y) * m_width];
+            for (int x = triangle.m_minX; x <= triangle.m_maxX; ++x) {
+                const float px = x + 0.5f;
+                bool inside = true;
+                for (int i = 0; i < 3 && inside; ++i) {
+                    inside = triangle.m_edgeA[i] * px + triangle.m_edgeB[i] * py + triangle.m_edgeC[i] >= 0.0f;
+                }
+                if (inside) {
+                    row[x] = std::min(row[x], triangle.m_depthA * px + triangle.m_depthB * py + triangle.m_depthC);
+                }
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isOccludedReference(const ScreenRect& rect) const {
+    if (rect.m_crossesNear) {
+        return false;
+    }
+    const int minX = toPixel(rect.m_minX, m_width, false);
+    const int maxX = toPixel(rect.m_maxX, m_width, true);
+    const int minY = toPixel(rect.m_minY, m_height, false);
+    const int maxY = toPixel(rect.m_maxY, m_height, true);
+    if (minX > maxX || minY > maxY) {
+        return false;
+    }
+    for (int y = minY; y <= maxY; ++y) {
+        const float* row = &m_referenceDepth[static_cast<size_t>(y) * m_width];
+        for (int x = minX; x <= maxX; ++x) {
+            if (row[x] >= rect.m_minDepth) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 同じオクルーダーをピクセルごとの深度バッファーへ描いて判定し、マスクによる判定（m_occludedFlags）と比べる
+void OcclusionCuller::validate(size_t count, OcclusionStats& stats) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool& pool = ThreadPool::getInstance();
+    pool.parallelFor(static_cast<size_t>(m_tilesY), 1, [this](size_t begin, size_t end) {
+        for (size_t tileY = begin; tileY < end; ++tileY) {
+            rasterizeReferenceRow(static_cast<int>(tileY));
+        }
+    });
+
+    std::vector<unsigned char> referenceFlags(count, 0);
+    pool.parallelFor(count, 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            referenceFlags[i] = isOccludedReference(m_rects[i]) ? 1 : 0;
+        }
+    });
+
+    for (size_t i = 0; i < count; ++i) {
+        if (referenceFlags[i]) {
+            ++stats.m_referenceOccluded;
+            if (!m_occludedFlags[i]) {
+                ++stats.m_falseVisible;
+            }
+        } else if (m_occludedFlags[i]) {
+            ++stats.m_falseOccluded;
+        }
+    }
+    stats.m_validated = true;
+    stats.m_validationTimeMs = elapsedMs(start);
+}
+
+OcclusionStats OcclusionCuller::cull(
+    const glm::mat4& viewProjection,
+    const std::vector<BoundingBox>& instanceBounds,
+    const std::vector<glm::mat4>& instanceMatrices,
+    const std::vector<int>& instanceMeshes,
+    std::vector<int>& visible)
+{
+    OcclusionStats stats;
+    stats.m_tested = visible.size();
+    if (visible.empty()) {
+        return stats;
+    }
+
+    ThreadPool& pool = ThreadPool::getInstance();
+    const size_t count = visible.size();
+
+    // 候補のAABBを投影し、画面占有率の大きいものからオクルーダーを選ぶ
+    auto start = std::chrono::high_resolution_clock::now();
+    m_rects.resize(count);
+    pool.parallelFor(count, 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            m_rects[i] = projectBounds(instanceBounds[visible[i]], viewProjection);
+        }
+    });
+
+    const float screenArea = static_cast<float>(m_width) * m_height;
+    std::vector<std::pair<float, int>> candidates;
+    for (size_t i = 0; i < count; ++i) {
+        const int mesh = instanceMeshes[visible[i]];
+        if (mesh < 0 || mesh >= static_cast<int>(m_occluderMeshes.size()) || m_occluderMeshes[mesh].m_indices.empty()) {
+            continue;
+        }
+        const ScreenRect& rect = m_rects[i];
+        float coverage = 1.0f;
+        if (!rect.m_crossesNear) {
+            const float width = std::min(rect.m_maxX, static_cast<float>(m_width)) - std::max(rect.m_minX, 0.0f);
+            const float height = std::min(rect.m_maxY, static_cast<float>(m_height)) - std::max(rect.m_minY, 0.0f);
+            coverage = width > 0.0f && height > 0.0f ? width * height / screenArea : 0.0f;
+        }
+        if (coverage >= m_minOccluderArea) {
+            candidates.push_back(std::make_pair(coverage, visible[i]));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; });
+
+    std::vector<int> occluders;
+    size_t triangleCount = 0;
+    for (const auto& candidate : candidates) {
+        const size_t meshTriangles = m_occluderMeshes[instanceMeshes[candidate.second]].m_indices.size() / 3;
+        if (triangleCount + meshTriangles > m_triangleBudget) {
+            continue;
+        }
+        triangleCount += meshTriangles;
+        occluders.push_back(candidate.second);
+    }
+    stats.m_testTimeMs = elapsedMs(start);
+
+    // オクルーダーを並列に変換してから、タイル行ごとに並列にラスタライズ
+    start = std::chrono::high_resolution_clock::now();
+    m_occluderTriangles.resize(occluders.size());
+    pool.parallelFor(occluders.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const int instance = occluders[i];
+            m_occluderTriangles[i].clear();
+            transformOccluder(m_occluderMeshes[instanceMeshes[instance]], viewProjection * instanceMatrices[instance], m_occluderTriangles[i]);
+        }
+    });
+    m_triangles.clear();
+    for (size_t i = 0; i < occluders.size(); ++i) {
+        m_triangles.insert(m_triangles.end(), m_occluderTriangles[i].begin(), m_occluderTriangles[i].end());
+    }
+    pool.parallelFor(static_cast<size_t>(m_tilesY), 1, [this](size_t begin, size_t end) {
+        for (size_t tileY = begin; tileY < end; ++tileY) {
+            rasterizeTileRow(static_cast<int>(tileY));
+        }
+    });
+    stats.m_occluders = occluders.size();
+    stats.m_occluderTriangles = m_triangles.size();
+    stats.m_rasterTimeMs = elapsedMs(start);
+
+    // 遮蔽判定（順序を保ったまま遮蔽されたものを取り除く）
+    start = std::chrono::high_resolution_clock::now();
+    m_occludedFlags.assign(count, 0);
+    pool.parallelFor(count, 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            m_occludedFlags[i] = isOccluded(m_rects[i]) ? 1 : 0;
+        }
+    });
+    stats.m_testTimeMs += elapsedMs(start);
+
+    if (m_validationEnabled) {
+        validate(count, stats);
+    }
+
+    start = std::chrono::high_resolution_clock::now();
+
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!m_occludedFlags[i]) {
+            visible[kept++] = visible[i];
+        }
+    }
+    visible.resize(kept);
+    stats.m_occluded = count - kept;
+    stats.m_testTimeMs += elapsedMs(start);
+
+    return stats;
+}
@@ -0,0 +1,142 @@
+﻿#pragma once
+
+#include "BoundingVolume.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace tinygltf {
+    class Model;
+}
+
+// 1フレーム分のオクルージョンカリング統計
+struct OcclusionStats {
+    size_t m_tested;             // 判定したオブジェクト数（視錐台カリング後）
+    size_t m_occluded;           // 遮蔽されていると判定されたオブジェクト数
+    size_t m_occluders;          // オクルーダーとしてラスタライズしたオブジェクト数
+    size_t m_occluderTriangles;  // ラスタライズした三角形数（ニアクリップ後）
+    double m_rasterTimeMs;       // オクルーダーの変換・ラスタライズ（タイルのマスクと深度の更新）
+    double m_testTimeMs;         // オクルーダー選択・オクルーディーの判定
+
+    // 検証（setValidationEnabled）時のみ: 同じオクルーダーをピクセルごとの深度バッファーへ描いた判定との比較
+    bool m_validated;
+    size_t m_referenceOccluded;  // ピクセルごとの判定で遮蔽されているオブジェクト数
+    size_t m_falseVisible;       // ピクセルごとの判定では遮蔽されているが、描画に残したオブジェクト数
+    size_t m_falseOccluded;      // ピクセルごとの判定では見えているが、取り除いたオブジェクト数（保守的なので 0 になる）
+    double m_validationTimeMs;   // 検証にかかった時間（ラスタ・判定の時間には含めない）
+
+    OcclusionStats()
+        : m_tested(0), m_occluded(0), m_occluders(0), m_occluderTriangles(0)
+        , m_rasterTimeMs(0.0), m_testTimeMs(0.0)
+        , m_validated(false), m_referenceOccluded(0), m_falseVisible(0), m_falseOccluded(0), m_validationTimeMs(0.0) {}
+
+    double getOccludedPercent() const { return m_tested > 0 ? 100.0 * m_occluded / m_tested : 0.0; }
+    double getReferenceOccludedPercent() const { return m_tested > 0 ? 100.0 * m_referenceOccluded / m_tested : 0.0; }
+    // ピクセルごとの判定なら取り除けたもののうち、描画に残した割合
+    double getFalseVisiblePercent() const { return m_referenceOccluded > 0 ? 100.0 * m_falseVisible / m_referenceOccluded : 0.0; }
+    double getTotalTimeMs() const { return m_rasterTimeMs + m_testTimeMs; }
+};
+
+// CPUによるソフトウェアオクルージョンカリング（Masked Occlusion Culling）
+// 画面上で大きいオブジェクトをオクルーダーとして低解像度のバッファーへラスタライズし、各オブジェクトのAABBの
+// 画面上の矩形と最も手前の深度で遮蔽判定する。ラスタライズと判定はスレッドプールで並列に処理する
+// バッファーはピクセルごとの深度を持たず、32x4ピクセルのタイルごとに被覆マスク（1ピクセル1ビット）と2つの深度を持つ
+//   基準層 m_zMax0: タイル全体がこの深度より手前で覆われている
+//   作業層 m_zMax1: マスクのピクセルがこの深度より手前で覆われている（タイルを覆い切ったら基準層へ移す）
+// 三角形はタイルの行ごとの範囲からマスクを作り（4行を SSE で同時に求める）、作業層と合わせる。
+// 作業層より十分手前の三角形が来た場合は作業層を捨てて置き換える（奥の深度に引っ張られて遮蔽できなくなるのを防ぐ）
+// 深度はピクセルごとの深度バッファーより粗いため遮蔽されているのに残すものがあるが、ピクセルごとの判定で見えるものは取り除かない。
+// setValidationEnabled(true) でピクセルごとの深度バッファーによる判定も行い、その差を OcclusionStats に記録する
+class OcclusionCuller {
+public:
+    static const int kTileWidth = 32;   // マスクの1行（32ビット）
+    static const int kTileHeight = 4;   // SSE の4レーン
+
+private:
+    // オクルーダー用のメッシュ形状（三角形プリミティブのみを結合したもの）
+    struct OccluderMesh {
+        std::vector<glm::vec3> m_positions;
+        std::vector<unsigned int> m_indices;
+    };
+
+    // 画面座標（ピクセル）へ変換しセットアップ済みの三角形
+    // エッジ関数 A*x + B*y + C がすべて 0 以上なら内側、深度は平面 A*x + B*y + C で補間する
+    struct ScreenTriangle {
+        float m_edgeA[3], m_edgeB[3], m_edgeC[3];
+        float m_depthA, m_depthB, m_depthC;
+        float m_maxDepth;                   // 頂点の最大深度
+        int m_minX, m_maxX, m_minY, m_maxY;
+    };
+
+    // タイルの被覆マスクと2層の深度
+    struct Tile {
+        uint32_t m_mask[kTileHeight];       // 作業層のピクセル（行ごと、ビット i が左から i 番目）
+        float m_zMax0;                      // 基準層
+        float m_zMax1;                      // 作業層（マスクが空の場合は 0）
+    };
+
+    // AABBを投影した画面上の矩形
+    struct ScreenRect {
+        float m_minX, m_minY, m_maxX, m_maxY;
+        float m_minDepth;
+        bool m_crossesNear;  // ニア平面をまたぐ（カメラに非常に近い）
+    };
+
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    std::vector<Tile> m_tiles;
+
+    std::vector<OccluderMesh> m_occluderMeshes;
+    float m_minOccluderArea;        // オクルーダーとする画面占有率の下限
+    size_t m_triangleBudget;        // 1フレームにラスタライズする三角形数の上限
+    bool m_validationEnabled;
+    std::vector<float> m_referenceDepth;    // 検証用のピクセルごとの深度 [0, 1]（1がファー）
+
+    // フレームごとの作業領域
+    std::vector<ScreenRect> m_rects;
+    std::vector<std::vector<ScreenTriangle>> m_occluderTriangles;
+    std::vector<ScreenTriangle> m_triangles;
+    std::vector<unsigned char> m_occludedFlags;
+
+    ScreenRect projectBounds(const BoundingBox& box, const glm::mat4& viewProjection) const;
+    void transformOccluder(const OccluderMesh& mesh, const glm::mat4& modelViewProjection, std::vector<ScreenTriangle>& out) const;
+    void emitTriangle(const glm::vec4* clip, std::vector<ScreenTriangle>& out) const;
+    static void updateTile(Tile& tile, const uint32_t* coverage, float depth);
+    void rasterizeTileRow(int tileY);
+    bool isOccluded(const ScreenRect& rect) const;
+    void rasterizeReferenceRow(int tileY);
+    bool isOccludedReference(const ScreenRect& rect) const;
+    void validate(size_t count, OcclusionStats& stats);
+
+public:
+    OcclusionCuller();
+
+    // バッファーの解像度（幅は32、高さは4の倍数に切り上げ）
+    void setResolution(int width, int height);
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+    void setMinOccluderArea(float screenFraction) { m_minOccluderArea = screenFraction; }
+    void setTriangleBudget(size_t triangles) { m_triangleBudget = triangles; }
+
+    // ピクセルごとの深度バッファーでも判定し、遮蔽したものと見逃したものを記録する（ベンチマーク用、判定は変わらない）
+    void setValidationEnabled(bool enabled);
+    bool isValidationEnabled() const { return m_validationEnabled; }
+
+    // モデルの各メッシュからオクルーダー形状を作成（三角形数が maxTrianglesPerMesh を超えるメッシュは使用しない）
+    void buildOccluderMeshes(const tinygltf::Model& model, size_t maxTrianglesPerMesh = 16384);
+    bool hasOccluders() const;
+    void clear();
+
+    // visible（視錐台カリング済みのインスタンス番号）から遮蔽されたものを取り除く
+    // instanceMeshes はインスタンスの描画するメッシュ番号、instanceMatrices はワールド行列
+    OcclusionStats cull(
+        const glm::mat4& viewProjection,
+        const std::vector<BoundingBox>& instanceBounds,
+        const std::vector<glm::mat4>& instanceMatrices,
+        const std::vector<int>& instanceMeshes,
+        std::vector<int>& visible);
+};
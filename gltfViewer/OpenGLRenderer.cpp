@@ -1,22 +1,154 @@
 ﻿#include "OpenGLRenderer.h"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <tuple>
 #include <tiny_gltf.h>
 #include "Camera.h"
+#include "AccessorReader.h"
 
-OpenGLRenderer::OpenGLRenderer(HWND window) 
-    : m_hWnd(window)
-    , m_hDC(nullptr)
-    , m_hRC(nullptr)
+namespace {
+    // 関節パレットのテクスチャバッファーを割り当てるテクスチャユニット
+    const GLint kJointPaletteTextureUnit = 8;
+
+    // ベースカラーテクスチャを割り当てるテクスチャユニット
+    const GLint kBaseColorTextureUnit = 0;
+
+    // テクスチャ座標の範囲の下限（全頂点が同じ座標の場合に密度が無限大にならないようにする）
+    const float kMinTexcoordExtent = 1.0e-4f;
+
+    // カメラ行列の FrameData ブロックのバインディングポイント（UBO）
+    const GLuint kFrameDataBinding = 1;
+
+    // リンク済みプログラムのバイナリを保存するディレクトリ（作業ディレクトリからの相対パス）
+    const char* const kShaderCacheDirectory = "shadercache";
+
+    // glTFメッシュのシェーダーのソースファイル（作業ディレクトリからの相対パス、見つからない場合は初期化に失敗する）
+    const char* const kMeshVertexShaderPath = "shaders/mesh.vert";
+    const char* const kMeshFragmentShaderPath = "shaders/material.frag";
+
+    // シェーダーのソースファイルの更新日時を確認する間隔
+    const double kShaderPollIntervalMs = 500.0;
+
+    // 動的データのリングバッファーの1フレーム分の大きさ（溢れた場合は次のフレームで拡張）
+    const size_t kUploadRegionSize = 4u * 1024 * 1024;
+
+    // アラインメントを2のべき乗に切り上げる（リングの確保は2のべき乗を前提とする）
+    size_t toPowerOfTwoAlignment(GLint alignment) {
+        size_t result = 16;
+        while (result < static_cast<size_t>(std::max(alignment, 1))) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // 毎フレーム書き換えるバッファーへ転送（容量が足りない場合のみ再確保）
+    void uploadDynamicBuffer(GLenum target, GLuint buffer, const void* data, size_t byteSize, size_t& capacity) {
+        glBindBuffer(target, buffer);
+        if (byteSize > capacity) {
+            glBufferData(target, byteSize, data, GL_DYNAMIC_DRAW);
+            capacity = byteSize;
+        } else {
+            glBufferSubData(target, 0, byteSize, data);
+        }
+        glBindBuffer(target, 0);
+    }
+
+    // マテリアルテーブルの方式に応じたシェーダーの先頭（#version・#extension・#define）
+    std::string getMaterialShaderPrelude(bool storageBuffer, bool drawParameters, size_t uniformCapacity) {
+        std::string prelude;
+        if (storageBuffer) {
+            prelude = "#version 430 core\n";
+            if (drawParameters) {
+                prelude += "#extension GL_ARB_shader_draw_parameters : require\n#define DRAW_PARAMETERS\n";
+            }
+            prelude += "#define MATERIAL_STORAGE_BUFFER\n";
+        } else {
+            prelude = "#version 330 core\n#define MAX_MATERIALS " + std::to_string(uniformCapacity) + "\n";
+        }
+        return prelude;
+    }
+
+    // テクスチャ座標（頂点あたり2要素）の範囲の大きい方の辺
+    float computeTexcoordExtent(const std::vector<float>& texcoords) {
+        glm::vec2 minimum(std::numeric_limits<float>::max());
+        glm::vec2 maximum(-std::numeric_limits<float>::max());
+        for (size_t i = 0; i + 1 < texcoords.size(); i += 2) {
+            const glm::vec2 texcoord(texcoords[i], texcoords[i + 1]);
+            minimum = glm::min(minimum, texcoord);
+            maximum = glm::max(maximum, texcoord);
+        }
+        if (texcoords.size() < 2) {
+            return 1.0f;
+        }
+        const glm::vec2 size = maximum - minimum;
+        return std::max(std::max(size.x, size.y), kMinTexcoordExtent);
+    }
+
+    // ソートキーのパス番号（描画モードごとにまとめ、三角形 → ライン → ポイントの順に描く）
+    uint32_t getDrawPass(GLenum mode) {
+        switch (mode) {
+        case GL_LINES:
+            return 1;
+        case GL_POINTS:
+            return 2;
+        default:
+            return 0;
+        }
+    }
+}
+
+#ifdef _WIN32
+OpenGLRenderer::OpenGLRenderer(HWND window)
+    : OpenGLRenderer(GLContext::createForWindow(window))
+{
+}
+#endif
+
+OpenGLRenderer::OpenGLRenderer(std::unique_ptr<GLContext> context)
+    : m_context(std::move(context))
     , m_demoVAO(0)
     , m_demoVBO(0)
+    , m_currentModel(nullptr)
+    , m_hasLastFrameTime(false)
+    , m_paletteBuffer(0)
+    , m_paletteTexture(0)
+    , m_paletteCapacity(0)
+    , m_instanceSkinVBO(0)
+    , m_instanceSkinCapacity(0)
+    , m_paletteDirty(false)
+    , m_paletteInRing(false)
+    , m_frameUniformBuffer(0)
+    , m_uniformBufferAlignment(256)
+    , m_textureBufferAlignment(256)
+    , m_hasTextureBufferRange(false)
+    , m_instanceVBO(0)
+    , m_instanceCapacity(0)
+    , m_instancingEnabled(true)
+    , m_hasBaseInstance(false)
+    , m_formatVAO()
+    , m_indirectBuffer(0)
+    , m_indirectCapacity(0)
+    , m_multiDrawEnabled(true)
+    , m_hasMultiDraw(false)
+    , m_hasDrawParameters(false)
+    , m_drawMaterialBuffer(0)
+    , m_drawMaterialCapacity(0)
+    , m_renderQueueEnabled(true)
+    , m_frustumCullingEnabled(true)
+    , m_drawListDirty(true)
+    , m_lastCullViewProjection(1.0f)
+    , m_occlusionCullingEnabled(true)
+    , m_trustAccessorBounds(true)
+    , m_camera(nullptr)
     , m_rotationAngle(0.0f)
-    ,m_windowWidth(800)
+    , m_windowWidth(800)
     , m_windowHeight(600)
-    ,m_currentModel(nullptr)
     , m_isDemo(true)
     , m_isWireframeMode(true)
-    , m_camera(nullptr)
 {
 }
 
@@ -25,55 +157,30 @@ OpenGLRenderer::~OpenGLRenderer() {
 }
 
 bool OpenGLRenderer::initializeOpenGL() {
-    // デバイスコンテキストを取得
-    m_hDC = GetDC(m_hWnd);
-    if (!m_hDC) {
-        std::cerr << "デバイスコンテキストの取得に失敗しました" << std::endl;
-        return false;
-    }
-
-    // ピクセルフォーマットを設定
-    PIXELFORMATDESCRIPTOR pfd = {};
-    pfd.nSize = sizeof(PIXELFORMATDESCRIPTOR);
-    pfd.nVersion = 1;
-    pfd.dwFlags = PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER;
-    pfd.iPixelType = PFD_TYPE_RGBA;
-    pfd.cColorBits = 32;
-    pfd.cDepthBits = 24;
-    pfd.cStencilBits = 8;
-    pfd.iLayerType = PFD_MAIN_PLANE;
-
-    int pixelFormat = ChoosePixelFormat(m_hDC, &pfd);
-    if (!pixelFormat) {
-        std::cerr << "適切なピクセルフォーマットが見つかりません" << std::endl;
-        return false;
-    }
-
-    if (!SetPixelFormat(m_hDC, pixelFormat, &pfd)) {
-        std::cerr << "ピクセルフォーマットの設定に失敗しました" << std::endl;
+    if (!m_context) {
+        std::cerr << "OpenGLコンテキストがありません" << std::endl;
         return false;
     }
-
-    // OpenGLレンダリングコンテキストを作成
-    m_hRC = wglCreateContext(m_hDC);
-    if (!m_hRC) {
-        std::cerr << "OpenGLコンテキストの作成に失敗しました" << std::endl;
-        return false;
-    }
-
-    if (!wglMakeCurrent(m_hDC, m_hRC)) {
+    if (!m_context->makeCurrent()) {
         std::cerr << "OpenGLコンテキストの有効化に失敗しました" << std::endl;
         return false;
     }
 
     // GLEWを初期化
     GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLX 用にビルドした GLEW は EGL のコンテキストでは GLX の拡張の読み込みで失敗するが、OpenGLの関数は読み込めている
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY && m_context->isHeadless()) {
+        err = GLEW_OK;
+    }
+#endif
     if (err != GLEW_OK) {
         std::cerr << "GLEWの初期化に失敗しました: " << glewGetErrorString(err) << std::endl;
         return false;
     }
 
     // OpenGL情報を表示
+    std::cout << "OpenGL Context: " << m_context->getDescription() << std::endl;
     std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
     std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
     std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
@@ -138,18 +245,8 @@ void OpenGLRenderer::initializeMatrices() {
 }
 
 // 行列更新メソッドの更新版（カメラ対応）
-void OpenGLRenderer::updateMatrices() {
-    //// モデル行列の更新（アニメーション用回転）
-    //m_rotationAngle += 0.01f;  // 回転速度
-    //if (m_rotationAngle > 2.0f * 3.14159f) {
-    //    m_rotationAngle -= 2.0f * 3.14159f;
-    //}
-
-    //// glm::rotate()を使用してモデル行列を更新
-    //m_modelMatrix = glm::mat4(1.0f);
-    //m_modelMatrix = glm::rotate(m_modelMatrix, m_rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
-
-    // カメラが設定されている場合、ビューと投影行列を更新
+// ビュー行列と投影行列をカメラから求める（描画・ウィンドウサイズの変更・カメラの設定で共通）
+void OpenGLRenderer::updateViewProjection() {
     if (m_camera) {
         m_viewMatrix = m_camera->getViewMatrix();
         m_projectionMatrix = m_camera->getProjectionMatrix();
@@ -167,6 +264,21 @@ void OpenGLRenderer::updateMatrices() {
             100.0f
         );
     }
+}
+
+void OpenGLRenderer::updateMatrices() {
+    //// モデル行列の更新（アニメーション用回転）
+    //m_rotationAngle += 0.01f;  // 回転速度
+    //if (m_rotationAngle > 2.0f * 3.14159f) {
+    //    m_rotationAngle -= 2.0f * 3.14159f;
+    //}
+
+    //// glm::rotate()を使用してモデル行列を更新
+    //m_modelMatrix = glm::mat4(1.0f);
+    //m_modelMatrix = glm::rotate(m_modelMatrix, m_rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // カメラが設定されている場合、ビューと投影行列を更新
+    updateViewProjection();
 
     // シェーダーに行列を送信
     //m_shaderManager.setMVPMatrices(m_modelMatrix, m_viewMatrix, m_projectionMatrix);
@@ -185,6 +297,64 @@ bool OpenGLRenderer::initialize() {
         return false;
     }
 
+    // インスタンスごとの行列・パレット先頭のバッファー（VAO作成時に属性として関連付ける）
+    glGenBuffers(1, &m_instanceVBO);
+    glGenBuffers(1, &m_instanceSkinVBO);
+    glGenBuffers(1, &m_paletteBuffer);
+    glGenTextures(1, &m_paletteTexture);
+    m_hasBaseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+    std::cout << "  インスタンス描画: " << (m_hasBaseInstance ? "BaseInstance対応" : "属性オフセットで切り替え") << std::endl;
+
+    // 間接描画コマンドは baseInstance でインスタンス行列の範囲を指定するため BaseInstance も必要
+    glGenBuffers(1, &m_indirectBuffer);
+    m_hasMultiDraw = m_hasBaseInstance && (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect);
+    std::cout << "  マルチドロー: " << (m_hasMultiDraw ? "glMultiDrawElementsIndirect対応" : "非対応（プリミティブごとに描画）") << std::endl;
+
+    // マテリアルテーブル（GL 4.3 ではSSBO、それ以外はUBO）と、マルチドローの描画番号からのマテリアル参照
+    GLint maxUniformBlockSize = 0;
+    glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxUniformBlockSize);
+    const bool storageBuffer = GLEW_VERSION_4_3 != 0;
+    m_materialTable.initialize(storageBuffer, maxUniformBlockSize);
+    m_hasDrawParameters = storageBuffer && m_hasMultiDraw && GLEW_ARB_shader_draw_parameters;
+    glGenBuffers(1, &m_drawMaterialBuffer);
+
+    // フレームごとの動的データ（カメラ行列・関節パレット）のリングバッファー
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_uniformBufferAlignment);
+    glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &m_textureBufferAlignment);
+    m_hasTextureBufferRange = GLEW_VERSION_4_3 != 0;
+    glGenBuffers(1, &m_frameUniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    const bool ringEnabled = m_uploadRing.initialize(kUploadRegionSize);
+    std::cout << "  動的データ: " << (ringEnabled ? "永続マップのリングバッファー (3フレーム分、フェンス同期)" : "glBufferSubData で転送") << std::endl;
+    std::cout << "  マテリアルテーブル: " << (storageBuffer ? "SSBO" : "UBO (最大 " + std::to_string(m_materialTable.getCapacity()) + " 件)")
+        << (m_hasDrawParameters ? "、マルチドローはマテリアルをまたいで1回に統合" : "") << std::endl;
+
+    // ベースカラーテクスチャは粗いミップから常駐させ、画面上のテクセル密度に応じて詳細なミップを追加する
+    m_textureStreamer.initialize(m_textureStreamer.getSettings());
+    std::cout << "  テクスチャストリーミング: 予算 " << m_textureStreamer.getSettings().m_gpuBudgetBytes / (1024 * 1024) << " MB, 転送 "
+        << m_textureStreamer.getSettings().m_uploadBytesPerFrame / (1024 * 1024) << " MB/フレーム ("
+        << (PixelStagingPool::isSupported() && m_textureStreamer.getSettings().m_usePixelBuffers ? "PBO経由で非同期" : "直接") << ")" << std::endl;
+
+    // glTFメッシュのインスタンス描画用シェーダー（プリミティブとマテリアルが必要とする機能の組をロード時に作成）
+    // フラグメントシェーダーはテーブルを参照しないので gl_DrawIDARB の拡張は有効にしない
+    // コンパイルはバックグラウンドで行い、完了するまでそのバリアントの描画は省く
+    const bool programCache = m_programCache.initialize(kShaderCacheDirectory);
+    std::cout << "  シェーダーキャッシュ: " << (programCache ? std::string(kShaderCacheDirectory) : std::string("無効（毎回コンパイル）")) << std::endl;
+    m_shaderCompiler.initialize(*m_context);
+    std::cout << "  シェーダーのコンパイル: " << AsyncShaderCompiler::getModeName(m_shaderCompiler.getMode()) << std::endl;
+    std::string meshVertexSource;
+    std::string meshFragmentSource;
+    if (!loadMeshShaderSources(meshVertexSource, meshFragmentSource)) {
+        return false;
+    }
+    m_meshShaders.initialize(meshVertexSource, meshFragmentSource,
+        getMaterialShaderPrelude(storageBuffer, m_hasDrawParameters, m_materialTable.getCapacity()),
+        getMaterialShaderPrelude(storageBuffer, false, m_materialTable.getCapacity()),
+        &m_programCache, &m_shaderCompiler, [this](ShaderManager& shader) { setupMaterialShader(shader); });
+    m_lastShaderPoll = std::chrono::high_resolution_clock::now();
+
     // テスト関数を実行
     //testShaderCompilation();
     //testGLMIntegration();
@@ -223,49 +393,264 @@ void OpenGLRenderer::renderGLTF() {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
 
-    // 各メッシュを描画
-    for (const auto& mesh : m_meshData) {
-        m_shaderManager.setUniform("u_materialColor", mesh->m_color);
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    m_renderStats = RenderStats();
+
+    // アニメーションを進めてノードのTRSを更新（長い停止の後に大きく飛ばないよう経過時間を制限）
+    if (m_animationPlayer.hasChannels()) {
+        const float deltaSeconds = m_hasLastFrameTime
+            ? std::chrono::duration<float>(startTime - m_lastFrameTime).count() : 0.0f;
+        m_animationPlayer.update(std::min(deltaSeconds, 0.25f), m_sceneGraph);
+    }
+    m_lastFrameTime = startTime;
+    m_hasLastFrameTime = true;
+
+    // ウェイトが変わったノードのモーフ後の頂点を再計算して転送
+    bool morphChanged = false;
+    if (m_morphTargets.hasInstances() && m_morphTargets.update(m_sceneGraph) > 0) {
+        uploadMorphedPositions();
+        m_renderStats.m_morph = m_morphTargets.getLastStats();
+        morphChanged = true;
+    }
 
-        glBindVertexArray(mesh->m_VAO);
+    // 変更されたノードのワールド行列を更新し、インスタンス行列とAABBに反映
+    const bool transformsChanged = m_sceneGraph.updateWorldTransforms() > 0;
+    if (transformsChanged) {
+        m_instanceBatcher.updateMatrices(m_sceneGraph);
 
-        if (mesh->m_hasIndices) {
-            glDrawElements(mesh->m_mode, mesh->m_indexCount, GL_UNSIGNED_INT, 0);
-        } else {
-            glDrawArrays(mesh->m_mode, 0, mesh->m_vertexCount);
+        // スキンの関節が動いた場合はパレットを更新（スキンメッシュのAABBもパレットから求める）
+        if (m_skinning.hasSkins()) {
+            updateSkinPalettes();
+            m_renderStats.m_skinning = m_skinning.getLastStats();
         }
+    }
 
-        glBindVertexArray(0);
+    if (transformsChanged || morphChanged) {
+        // 構造は変わらないのでBVHは再構築せずAABBだけ更新
+        updateInstanceBounds();
+        m_sceneBVH.refit(m_instanceBounds);
+        m_frustumCuller.setBounds(m_instanceBounds);
+        m_drawListDirty = true;
     }
 
+    // カメラかインスタンスが変わった場合のみカリングして描画リストを作り直す
+    const glm::mat4 viewProjection = m_projectionMatrix * m_viewMatrix;
+    if (m_drawListDirty || viewProjection != m_lastCullViewProjection) {
+        buildDrawList(viewProjection);
+    }
+    m_renderStats.m_culling = m_lastCullingStats;
+    m_renderStats.m_occlusion = m_lastOcclusionStats;
+
+    // 描画リストで要求されたミップを予算内で転送（ワーカーでミップを作り終えたテクスチャの初期転送も行う）
+    m_textureStreamer.update();
+    m_renderStats.m_textures = m_textureStreamer.getStats();
+
+    // 全マテリアルのパラメーターはテーブルから読む（描画ごとにはマテリアル番号だけを指定）
+    m_materialTable.bind();
+
+    // フレームごとの動的データはリングの現在の領域へ書き込み、オフセットでバインドする
+    m_uploadRing.beginFrame();
+    uploadFrameData(viewProjection);
+    if (m_skinning.hasSkins()) {
+        bindSkinPalette();
+    }
+
+    // スキニングのバリアントはサンプラーを作成時に kJointPaletteTextureUnit に設定済み
+    if (m_skinning.hasSkins()) {
+        glActiveTexture(GL_TEXTURE0 + kJointPaletteTextureUnit);
+        glBindTexture(GL_TEXTURE_BUFFER, m_paletteTexture);
+    }
+    glActiveTexture(GL_TEXTURE0 + kBaseColorTextureUnit);
+
+    if (m_instancingEnabled) {
+        // メッシュを参照する全ノードを1回のドローコールで描画
+        // 描画キューの順にステートを切り替えながら発行
+        emitRenderQueue();
+
+        m_shaderManager.use();
+    } else {
+        // 比較用: インスタンスごとに行列を設定して個別に描画
+        glVertexAttrib3f(1, 1.0f, 1.0f, 1.0f);  // glTFのVAOは頂点カラーを持たないため白を使用
+
+        for (const auto& mesh : m_meshData) {
+            const InstanceRange& range = m_meshDrawRanges[mesh->m_meshIndex];
+            if (range.m_instanceCount == 0) {
+                continue;
+            }
+
+            glBindVertexArray(mesh->m_VAO);
+
+            if (mesh->m_isSkinned) {
+                // スキンメッシュはパレットが必要なのでスキニングのバリアントで1インスタンスずつ描画
+                ShaderManager* shader = m_meshShaders.getShader(mesh->m_shaderVariant);
+                if (!shader->isValid()) {
+                    continue;   // バックグラウンドでコンパイル中
+                }
+                shader->use();
+                shader->setUniform(Uniform::MaterialIndex, mesh->m_materialIndex);
+                shader->setUniform(Uniform::DrawOffset, -1);
+                if (mesh->m_baseColorTexture >= 0) {
+                    glBindTexture(GL_TEXTURE_2D, m_textureStreamer.getTexture(mesh->m_baseColorTexture));
+                }
+                for (int i = 0; i < range.m_instanceCount; ++i) {
+                    InstanceRange single;
+                    single.m_firstInstance = range.m_firstInstance + i;
+                    single.m_instanceCount = 1;
+                    if (mesh->m_hasMorphTargets) {
+                        glBindVertexArray(getDrawVAO(*mesh, single.m_firstInstance));
+                    }
+                    drawInstances(*mesh, single);
+                }
+                m_shaderManager.use();
+            } else {
+                m_shaderManager.setUniform(Uniform::MaterialColor, m_materialTable.getBaseColor(mesh->m_materialIndex));
+                for (int i = 0; i < range.m_instanceCount; ++i) {
+                    if (mesh->m_hasMorphTargets) {
+                        glBindVertexArray(getDrawVAO(*mesh, range.m_firstInstance + i));
+                    }
+                    m_shaderManager.setMVPMatrices(m_drawMatrices[range.m_firstInstance + i], m_viewMatrix, m_projectionMatrix);
+                    glDrawElements(mesh->m_mode, mesh->m_indexCount, GL_UNSIGNED_INT, mesh->getIndexOffset());
+                }
+            }
+
+            m_renderStats.m_drawCalls += range.m_instanceCount;
+            m_renderStats.m_instances += range.m_instanceCount;
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // このフレームでリングを参照する描画をすべて発行したので領域にフェンスを置く
+    m_uploadRing.endFrame();
+    m_renderStats.m_upload = m_uploadRing.getLastFrameStats();
+
+    const auto endTime = std::chrono::high_resolution_clock::now();
+    m_renderStats.m_cpuTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
     // ワイヤーフレームモードを元に戻す
     if (m_isWireframeMode) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
 }
 
+// ストリーミング描画（GPUに常駐している視錐台内のチャンクをマテリアル色のグループごとに描画）
+void OpenGLRenderer::renderStreaming() {
+    if (m_isWireframeMode) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        glLineWidth(1.0f);
+    } else {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    m_renderStats = RenderStats();
+
+    // 投影行列の [1][1] は 1 / tan(fovy / 2) なので、距離 1 の1単位は画面の高さの半分 × [1][1] ピクセル
+    const glm::vec3 cameraPosition = glm::vec3(glm::inverse(m_viewMatrix)[3]);
+    const float projectionScale = m_projectionMatrix[1][1] * 0.5f * static_cast<float>(m_windowHeight);
+    m_streamer.update(m_projectionMatrix * m_viewMatrix, cameraPosition, projectionScale);
+
+    // チャンクの頂点はワールド空間なのでモデル行列は単位行列
+    m_shaderManager.setMVPMatrices(glm::mat4(1.0f), m_viewMatrix, m_projectionMatrix);
+    glVertexAttrib3f(1, 1.0f, 1.0f, 1.0f);
+
+    for (int chunk : m_streamer.getDrawChunks()) {
+        glBindVertexArray(m_streamer.getChunkVAO(chunk));
+        for (const auto& group : m_streamer.getChunkGroups(chunk)) {
+            m_shaderManager.setUniform(Uniform::MaterialColor, group.m_color);
+            glDrawElements(GL_TRIANGLES, group.m_indexCount, GL_UNSIGNED_INT,
+                reinterpret_cast<const void*>(static_cast<size_t>(group.m_firstIndex) * sizeof(GLuint)));
+            ++m_renderStats.m_drawCalls;
+        }
+        ++m_renderStats.m_instances;
+    }
+    glBindVertexArray(0);
+
+    m_renderStats.m_streaming = m_streamer.getStats();
+    const auto endTime = std::chrono::high_resolution_clock::now();
+    m_renderStats.m_cpuTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+    if (m_isWireframeMode) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+}
+
 // glTFリソースのクリーンアップ
 void OpenGLRenderer::cleanupGLTFResources() {
     for (auto& mesh : m_meshData) {
-        if (mesh->m_EBO != 0) {
-            glDeleteBuffers(1, &mesh->m_EBO);
-        }
-        if (mesh->m_VBO != 0) {
-            glDeleteBuffers(1, &mesh->m_VBO);
-        }
         if (mesh->m_VAO != 0) {
             glDeleteVertexArrays(1, &mesh->m_VAO);
         }
     }
 
+    for (auto& mesh : m_morphMeshData) {
+        if (mesh && mesh->m_VAO != 0) {
+            glDeleteVertexArrays(1, &mesh->m_VAO);
+        }
+    }
+
+    for (GLuint& vao : m_formatVAO) {
+        if (vao != 0) {
+            glDeleteVertexArrays(1, &vao);
+            vao = 0;
+        }
+    }
+
+    // 共有バッファーは最後の参照が外れた時点で解放される
     m_meshData.clear();
+    m_morphMeshData.clear();
+    m_morphTargets.clear();
+    m_instanceBatcher.clear();
+    m_sceneGraph.clear();
+    m_animationPlayer.clear();
+    m_hasLastFrameTime = false;
+    m_skinning.clear();
+    m_drawPaletteOffsets.clear();
+    m_geometryPool.clear();
+    m_drawBuckets.clear();
+    m_indirectCommands.clear();
+    m_drawMaterials.clear();
+    m_materialTable.clear();
+    m_textureStreamer.clear();
+    m_texcoordExtents.clear();
+    m_queuedDraws.clear();
+    m_renderQueue.clear();
+    m_accessorBounds.clear();
+    m_meshBounds.clear();
+    m_nodeBounds.clear();
+    m_sceneBounds = BoundingBox();
+    m_sceneBoundingSphere = BoundingSphere();
+    m_instanceBounds.clear();
+    m_sceneBVH.clear();
+    m_picker.clear();
+    m_streamer.close();
+    m_frustumCuller.clear();
+    m_visibleInstances.clear();
+    m_drawMatrices.clear();
+    m_meshDrawRanges.clear();
+    m_lastCullingStats = CullingStats();
+    m_occlusionCuller.clear();
+    m_lastOcclusionStats = OcclusionStats();
+    m_drawListDirty = true;
     m_currentModel = nullptr;
 }
 
 // render()メソッドの更新版
 void OpenGLRenderer::render() {
+    renderFrame();
+
+    // バックバッファーをフロントバッファーに表示（オフスクリーンのコンテキストでは何もしない）
+    m_context->swapBuffers();
+}
+
+// 現在バインドされているフレームバッファーへ描画する（オフスクリーン描画ではFBOをバインドして呼ぶ）
+void OpenGLRenderer::renderFrame() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // バックグラウンドで完了したシェーダーへの差し替えと、ソースファイルの変更の確認
+    updateShaders();
+
     // 行列を更新
     updateMatrices();
 
@@ -278,12 +663,11 @@ void OpenGLRenderer::render() {
     // モードに応じて描画
     if (m_isDemo) {
         renderDemo();
+    } else if (m_streamer.isOpen()) {
+        renderStreaming();
     } else {
         renderGLTF();
     }
-
-    // バックバッファーをフロントバッファーに表示
-    SwapBuffers(m_hDC);
 }
 
 void OpenGLRenderer::onResize(int width, int height) {
@@ -293,9 +677,12 @@ void OpenGLRenderer::onResize(int width, int height) {
     // ビューポートを更新
     glViewport(0, 0, width, height);
 
-    // 投影行列を再計算（アスペクト比が変更された場合）
+    // カメラのアスペクト比を合わせ、投影行列を描画時と同じくカメラから再計算
     float aspectRatio = (float)width / (float)height;
-    m_projectionMatrix = glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 100.0f);
+    if (m_camera) {
+        m_camera->setAspectRatio(aspectRatio);
+    }
+    updateViewProjection();
 
     std::cout << "ウィンドウサイズ変更: " << width << "x" << height 
         << " (アスペクト比: " << aspectRatio << ")" << std::endl;
@@ -305,6 +692,42 @@ void OpenGLRenderer::cleanup() {
     // glTFリソースをクリーンアップ
     cleanupGLTFResources();
 
+    if (m_instanceVBO != 0) {
+        glDeleteBuffers(1, &m_instanceVBO);
+        m_instanceVBO = 0;
+        m_instanceCapacity = 0;
+    }
+    if (m_indirectBuffer != 0) {
+        glDeleteBuffers(1, &m_indirectBuffer);
+        m_indirectBuffer = 0;
+        m_indirectCapacity = 0;
+    }
+    if (m_drawMaterialBuffer != 0) {
+        glDeleteBuffers(1, &m_drawMaterialBuffer);
+        m_drawMaterialBuffer = 0;
+        m_drawMaterialCapacity = 0;
+    }
+    if (m_frameUniformBuffer != 0) {
+        glDeleteBuffers(1, &m_frameUniformBuffer);
+        m_frameUniformBuffer = 0;
+    }
+    m_uploadRing.cleanup();
+    m_textureStreamer.cleanup();
+    if (m_instanceSkinVBO != 0) {
+        glDeleteBuffers(1, &m_instanceSkinVBO);
+        m_instanceSkinVBO = 0;
+        m_instanceSkinCapacity = 0;
+    }
+    if (m_paletteTexture != 0) {
+        glDeleteTextures(1, &m_paletteTexture);
+        m_paletteTexture = 0;
+    }
+    if (m_paletteBuffer != 0) {
+        glDeleteBuffers(1, &m_paletteBuffer);
+        m_paletteBuffer = 0;
+        m_paletteCapacity = 0;
+    }
+
     // デモ用のVBO/VAOをクリーンアップ
     if (m_demoVBO != 0) {
         glDeleteBuffers(1, &m_demoVBO);
@@ -318,18 +741,12 @@ void OpenGLRenderer::cleanup() {
 
     // シェーダーをクリーンアップ
     m_shaderManager.cleanup();
+    m_meshShaders.cleanup();
+    m_shaderCompiler.cleanup();
+    m_shaderWatcher.clear();
 
     // OpenGLコンテキストをクリーンアップ
-    if (m_hRC) {
-        wglMakeCurrent(nullptr, nullptr);
-        wglDeleteContext(m_hRC);
-        m_hRC = nullptr;
-    }
-
-    if (m_hDC) {
-        ReleaseDC(m_hWnd, m_hDC);
-        m_hDC = nullptr;
-    }
+    m_context.reset();
 
     std::cout << "OpenGLレンダラーのクリーンアップが完了しました" << std::endl;
 }
@@ -357,6 +774,23 @@ bool OpenGLRenderer::loadGLTFModel(const tinygltf::Model& model) {
     return true;
 }
 
+// チャンクパックのストリーミングを開始
+bool OpenGLRenderer::openStreamingScene(const std::string& path, const StreamingSettings& settings) {
+    cleanupGLTFResources();
+
+    if (!m_streamer.open(path, settings)) {
+        std::cerr << "エラー: ストリーミングを開始できません: " << path << std::endl;
+        return false;
+    }
+
+    // カメラの自動フィットにはチャンク表のシーン全体のAABBを使う
+    m_sceneBounds = m_streamer.getSceneBounds();
+    m_sceneBoundingSphere = BoundingVolume::sphereFromBox(m_sceneBounds);
+
+    setDemoMode(false);
+    return true;
+}
+
 // glTFモデル全体の処理
 bool OpenGLRenderer::processGLTFModel(const tinygltf::Model& model) {
     std::cout << "glTFモデル処理中..." << std::endl;
@@ -364,24 +798,97 @@ bool OpenGLRenderer::processGLTFModel(const tinygltf::Model& model) {
     std::cout << "  ノード数: " << model.nodes.size() << std::endl;
     std::cout << "  シーン数: " << model.scenes.size() << std::endl;
 
+    // 全マテリアルを1つのバッファーに詰める（プリミティブはテーブルの番号で参照する）
+    if (!m_materialTable.build(model)) {
+        return false;
+    }
+
+    // テクスチャのミップチェーンの作成をワーカーで始める（転送は描画時に必要なレベルまで行う）
+    m_textureStreamer.build(model);
+
     // 各メッシュを処理
     for (size_t i = 0; i < model.meshes.size(); ++i) {
-        if (!processMesh(model.meshes[i], model)) {
+        if (!processMesh(model.meshes[i], static_cast<int>(i), model)) {
             std::cerr << "エラー: メッシュ " << i << " の処理に失敗しました" << std::endl;
             return false;
         }
     }
 
+    // 全プリミティブのジオメトリを共有バッファーへ転送し、共有バッファー内の範囲を指すVAOを作成
+    if (!m_geometryPool.upload()) {
+        return false;
+    }
+    for (auto& mesh : m_meshData) {
+        mesh->m_vertexBuffer = m_geometryPool.getPositionBuffer(mesh->m_format);
+        mesh->m_indexBuffer = m_geometryPool.getIndexBuffer();
+        mesh->m_jointBuffer = m_geometryPool.getJointBuffer(mesh->m_format);
+        mesh->m_weightBuffer = m_geometryPool.getWeightBuffer(mesh->m_format);
+        mesh->m_texcoordBuffer = m_geometryPool.getTexcoordBuffer(mesh->m_format);
+        mesh->m_positionOffset = static_cast<size_t>(mesh->m_baseVertex) * 3 * sizeof(float);
+        if (!createVAO(*mesh)) {
+            std::cerr << "エラー: VAOの作成に失敗しました" << std::endl;
+            return false;
+        }
+    }
+    if (!createPoolVAOs()) {
+        return false;
+    }
+
+    // 同じ分類のプリミティブが連続するように並べ替え（描画モードの切り替えを減らす）
+    std::stable_sort(m_meshData.begin(), m_meshData.end(),
+        [](const std::unique_ptr<GLTFMeshData>& a, const std::unique_ptr<GLTFMeshData>& b) {
+            if (a->m_primitiveClass != b->m_primitiveClass) {
+                return a->m_primitiveClass < b->m_primitiveClass;
+            }
+            return a->m_shaderVariant < b->m_shaderVariant;
+        });
+
+    // ノード階層をフラットなシーングラフとして構築し、同じメッシュを参照するノードをインスタンスとしてまとめる
+    m_sceneGraph.build(model);
+    m_animationPlayer.build(model, m_sceneGraph);
+    m_skinning.build(model, m_sceneGraph);
+    if (m_skinning.hasSkins()) {
+        updateSkinPalettes();
+    }
+    m_morphTargets.build(model, m_sceneGraph);
+    if (m_morphTargets.hasInstances()) {
+        m_morphTargets.update(m_sceneGraph);
+        createMorphMeshes();
+    }
+    m_instanceBatcher.build(model, m_sceneGraph);
+    m_occlusionCuller.buildOccluderMeshes(model);
+    m_picker.build(model);
+    buildDrawBuckets();
+    m_drawListDirty = true;
+
+    // ノード階層を通してシーン全体のバウンディングボリュームを計算
+    computeSceneBounds(model);
+    m_frustumCuller.setBounds(m_instanceBounds);
+
+    // バッファー共有の結果を報告
+    m_geometryPool.printStatistics();
+    std::cout << "  マルチドローのバケット数: " << m_drawBuckets.size() << std::endl;
+    std::cout << "  テクスチャ: " << m_textureStreamer.getTextureCount() << " 枚 (全ミップ常駐時 "
+        << m_textureStreamer.getStats().m_fullResidentBytes / 1024 << " KB, 初期は " << m_textureStreamer.getSettings().m_initialMaxSize
+        << " ピクセル以下のミップのみ)" << std::endl;
+    const ShaderBuildStats& shaderStats = m_meshShaders.getStats();
+    std::cout << "  シェーダーのバリアント: " << m_meshShaders.getVariantCount() << " 個 (コンパイル " << shaderStats.m_compiledPrograms
+        << " 個: コンパイル " << shaderStats.m_compileTimeMs << " ms / リンク " << shaderStats.m_linkTimeMs << " ms, キャッシュ "
+        << shaderStats.m_cachedPrograms << " 個: " << shaderStats.m_cacheLoadTimeMs << " ms, バックグラウンドでコンパイル中 "
+        << shaderStats.m_pendingPrograms << " 個)" << std::endl;
+
     return true;
 }
 
 // メッシュの処理
-bool OpenGLRenderer::processMesh(const tinygltf::Mesh& mesh, const tinygltf::Model& model) {
+bool OpenGLRenderer::processMesh(const tinygltf::Mesh& mesh, int meshIndex, const tinygltf::Model& model) {
     std::cout << "  メッシュ処理中: " << mesh.name << " (プリミティブ数: " << mesh.primitives.size() << ")" << std::endl;
 
     // 各プリミティブを処理
     for (size_t i = 0; i < mesh.primitives.size(); ++i) {
         auto meshData = std::make_unique<GLTFMeshData>();
+        meshData->m_meshIndex = meshIndex;
+        meshData->m_primitiveIndex = static_cast<int>(i);
 
         if (!processPrimitive(mesh.primitives[i], model, *meshData)) {
             std::cerr << "エラー: プリミティブ " << i << " の処理に失敗しました" << std::endl;
@@ -396,18 +903,9 @@ bool OpenGLRenderer::processMesh(const tinygltf::Mesh& mesh, const tinygltf::Mod
 
 // プリミティブの処理
 bool OpenGLRenderer::processPrimitive(const tinygltf::Primitive& primitive, const tinygltf::Model& model, GLTFMeshData& meshData) {
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-
-    // 描画モードの設定
-    meshData.m_mode = GL_TRIANGLES;
-    if (primitive.mode == TINYGLTF_MODE_TRIANGLES) {
-        meshData.m_mode = GL_TRIANGLES;
-    } else if (primitive.mode == TINYGLTF_MODE_TRIANGLE_STRIP) {
-        meshData.m_mode = GL_TRIANGLE_STRIP;
-    } else if (primitive.mode == TINYGLTF_MODE_TRIANGLE_FAN) {
-        meshData.m_mode = GL_TRIANGLE_FAN;
-    }
+    // 描画モードの設定（strip/fan/loop はリスト形式へ正規化する）
+    meshData.m_primitiveClass = PrimitiveTopology::classify(primitive.mode);
+    meshData.m_mode = PrimitiveTopology::toGLMode(meshData.m_primitiveClass);
 
     // 位置データの取得
     auto positionIt = primitive.attributes.find("POSITION");
@@ -415,37 +913,172 @@ bool OpenGLRenderer::processPrimitive(const tinygltf::Primitive& primitive, cons
         std::cerr << "エラー: POSITION属性が見つかりません" << std::endl;
         return false;
     }
-
-    if (!getAccessorData(model, positionIt->second, vertices)) {
-        std::cerr << "エラー: 位置データの取得に失敗しました" << std::endl;
+    const int positionAccessor = positionIt->second;
+    if (positionAccessor < 0 || positionAccessor >= static_cast<int>(model.accessors.size())) {
+        std::cerr << "エラー: 無効なアクセサーインデックス: " << positionAccessor << std::endl;
         return false;
     }
 
-    meshData.m_vertexCount = static_cast<GLsizei>(vertices.size() / 3);
+    // スキン属性（JOINTS_0 / WEIGHTS_0）の有無で頂点フォーマットを決める
+    const size_t vertexCount = model.accessors[positionAccessor].count;
+    auto jointIt = primitive.attributes.find("JOINTS_0");
+    auto weightIt = primitive.attributes.find("WEIGHTS_0");
+    const bool hasSkinAttributes = jointIt != primitive.attributes.end() && weightIt != primitive.attributes.end();
+
+    // TEXCOORD_0（ベースカラーテクスチャの参照に使い、範囲はテクセル密度の計算に使う）
+    auto texcoordIt = primitive.attributes.find("TEXCOORD_0");
+    int texcoordAccessor = texcoordIt != primitive.attributes.end() ? texcoordIt->second : -1;
+    std::vector<float> texcoords;
+    if (texcoordAccessor >= 0 && m_texcoordExtents.find(texcoordAccessor) == m_texcoordExtents.end()) {
+        if (!AccessorReader::readFloats(model, texcoordAccessor, texcoords, 2) || texcoords.size() != vertexCount * 2) {
+            std::cerr << "警告: TEXCOORD_0 を読み込めないためテクスチャなしで描画します" << std::endl;
+            texcoordAccessor = -1;
+            texcoords.clear();
+        } else {
+            m_texcoordExtents[texcoordAccessor] = computeTexcoordExtent(texcoords);
+        }
+    }
+    meshData.m_texcoordExtent = texcoordAccessor >= 0 ? m_texcoordExtents[texcoordAccessor] : 1.0f;
+
+    VertexKey vertexKey = {
+        positionAccessor,
+        hasSkinAttributes ? jointIt->second : -1,
+        hasSkinAttributes ? weightIt->second : -1,
+        texcoordAccessor
+    };
+    VertexFormat format = hasSkinAttributes ? VertexFormat::Skinned : VertexFormat::Position;
+
+    // 同じアクセサーの頂点データが既に共有バッファーにあれば再利用する
+    GLint baseVertex = m_geometryPool.findVertices(format, vertexKey);
+    auto boundsIt = m_accessorBounds.find(positionAccessor);
 
-    // インデックスデータの取得（オプション）
-    if (primitive.indices >= 0) {
-        if (!getIndexData(model, primitive.indices, indices)) {
-            std::cerr << "エラー: インデックスデータの取得に失敗しました" << std::endl;
+    if (baseVertex >= 0 && boundsIt != m_accessorBounds.end()) {
+        meshData.m_vertexCount = static_cast<GLsizei>(vertexCount);
+        meshData.m_bounds = boundsIt->second.first;
+        meshData.m_boundingSphere = boundsIt->second.second;
+    } else {
+        std::vector<float> vertices;
+        if (!getAccessorData(model, positionAccessor, vertices)) {
+            std::cerr << "エラー: 位置データの取得に失敗しました" << std::endl;
             return false;
         }
-        meshData.m_hasIndices = true;
+        meshData.m_vertexCount = static_cast<GLsizei>(vertices.size() / 3);
+
+        // バウンディングボリュームの計算
+        computePrimitiveBounds(model, positionAccessor, vertices, meshData);
+        m_accessorBounds[positionAccessor] = std::make_pair(meshData.m_bounds, meshData.m_boundingSphere);
+
+        if (baseVertex < 0) {
+            // スキン属性は4要素に展開する（読み込めない場合はスキンなしのフォーマットに格納）
+            std::vector<unsigned int> joints;
+            std::vector<float> weights;
+            if (hasSkinAttributes) {
+                const bool skinRead =
+                    AccessorReader::readUInts(model, jointIt->second, joints, 4) && joints.size() == vertices.size() / 3 * 4 &&
+                    AccessorReader::readFloats(model, weightIt->second, weights, 4) && weights.size() == vertices.size() / 3 * 4;
+                if (!skinRead) {
+                    std::cerr << "警告: JOINTS_0 / WEIGHTS_0 を読み込めないためスキンなしで描画します" << std::endl;
+                    format = VertexFormat::Position;
+                    vertexKey.m_jointAccessor = -1;
+                    vertexKey.m_weightAccessor = -1;
+                    baseVertex = m_geometryPool.findVertices(format, vertexKey);
+                }
+            }
+            if (baseVertex < 0) {
+                if (texcoordAccessor >= 0 && texcoords.empty()) {
+                    AccessorReader::readFloats(model, texcoordAccessor, texcoords, 2);
+                }
+                baseVertex = m_geometryPool.addVertices(format, vertexKey, vertices, joints, weights, texcoords);
+            }
+            if (baseVertex < 0) {
+                return false;
+            }
+        }
+    }
+    meshData.m_format = format;
+    meshData.m_isSkinned = format == VertexFormat::Skinned;
+    meshData.m_baseVertex = baseVertex;
+
+    // メッシュ単位のAABBに統合
+    if (m_meshBounds.size() <= static_cast<size_t>(meshData.m_meshIndex)) {
+        m_meshBounds.resize(meshData.m_meshIndex + 1);
+    }
+    m_meshBounds[meshData.m_meshIndex].expand(meshData.m_bounds);
+
+    // インデックス（正規化後のリストはアクセサーと変換元モードの組で共有できる）
+    BufferLayout indexLayout = BufferLayout::IndexTriangles;
+    if (meshData.m_primitiveClass == PrimitiveClass::Lines) {
+        indexLayout = BufferLayout::IndexLines;
+    } else if (meshData.m_primitiveClass == PrimitiveClass::Points) {
+        indexLayout = BufferLayout::IndexPoints;
+    }
+    BufferKey indexKey = {
+        primitive.indices,
+        static_cast<int>(indexLayout) * 16 + primitive.mode,
+        primitive.indices >= 0 ? 0 : static_cast<size_t>(meshData.m_vertexCount)
+    };
+
+    if (!m_geometryPool.findIndices(indexKey, meshData.m_firstIndex, meshData.m_indexCount)) {
+        std::vector<unsigned int> sourceIndices;
+        std::vector<unsigned int> indices;
+
+        // インデックスデータの取得（インデックスなしの場合は連番を生成）
+        unsigned int restartIndex = PrimitiveTopology::getRestartIndex(TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
+        if (primitive.indices >= 0) {
+            if (!getIndexData(model, primitive.indices, sourceIndices)) {
+                std::cerr << "エラー: インデックスデータの取得に失敗しました" << std::endl;
+                return false;
+            }
+            restartIndex = PrimitiveTopology::getRestartIndex(model.accessors[primitive.indices].componentType);
+        } else {
+            PrimitiveTopology::generateSequentialIndices(meshData.m_vertexCount, sourceIndices);
+        }
+
+        // インデックス付きリスト形式へ正規化
+        if (!PrimitiveTopology::normalize(primitive.mode, sourceIndices, restartIndex, indices)) {
+            std::cerr << "警告: 描画可能な要素がないプリミティブです ("
+                << PrimitiveTopology::getModeName(primitive.mode) << ")" << std::endl;
+        }
+
+        if (primitive.mode != TINYGLTF_MODE_TRIANGLES && primitive.mode != TINYGLTF_MODE_LINE && primitive.mode != TINYGLTF_MODE_POINTS) {
+            std::cout << "    トポロジー正規化: " << PrimitiveTopology::getModeName(primitive.mode)
+                << " -> " << PrimitiveTopology::getClassName(meshData.m_primitiveClass)
+                << " (インデックス数: " << sourceIndices.size() << " -> " << indices.size() << ")" << std::endl;
+        }
+
+        meshData.m_firstIndex = m_geometryPool.addIndices(indexKey, indices);
         meshData.m_indexCount = static_cast<GLsizei>(indices.size());
     }
+    meshData.m_hasIndices = true;
+
+    // マテリアルはロード時に作成したテーブルの番号で参照（マテリアルなし・範囲外は既定値）
+    meshData.m_materialIndex = m_materialTable.getMaterialIndex(primitive.material);
 
-    // マテリアルデータの取得（先ずはベースカラーのみ）
-    auto material = model.materials.at(primitive.material);
-    auto pbr = material.pbrMetallicRoughness;
-    auto color = pbr.baseColorFactor;
-    glm::vec3 materialColor(color[0], color[1], color[2]);
-    meshData.m_color = materialColor;
+    // 頂点フォーマットとマテリアルが必要とする機能の組のシェーダー（未作成ならここでコンパイルかキャッシュから読み込み）
+    ShaderFeatures features = 0;
+    if (meshData.m_isSkinned) {
+        features |= ShaderFeature::Skinning;
+    }
+    if (primitive.material >= 0 && primitive.material < static_cast<int>(model.materials.size())) {
+        const tinygltf::Material& material = model.materials[primitive.material];
+        if (material.alphaMode == "MASK") {
+            features |= ShaderFeature::AlphaMask;
+        }
 
-    // VAOの作成
-    if (!createVAO(vertices, indices, meshData)) {
-        std::cerr << "エラー: VAOの作成に失敗しました" << std::endl;
+        // ベースカラーテクスチャは TEXCOORD_0 を参照するものだけに対応
+        const tinygltf::TextureInfo& baseColorTexture = material.pbrMetallicRoughness.baseColorTexture;
+        if (baseColorTexture.index >= 0 && baseColorTexture.index < static_cast<int>(model.textures.size()) &&
+            baseColorTexture.texCoord == 0 && texcoordAccessor >= 0) {
+            features |= ShaderFeature::BaseColorTexture;
+            meshData.m_baseColorTexture = baseColorTexture.index;
+        }
+    }
+    meshData.m_shaderVariant = m_meshShaders.getVariant(features);
+    if (meshData.m_shaderVariant < 0) {
         return false;
     }
 
+    // VAOは全プリミティブを共有バッファーに転送した後に作成する
     std::cout << "    プリミティブ処理完了 (頂点数: " << meshData.m_vertexCount;
     if (meshData.m_hasIndices) {
         std::cout << ", インデックス数: " << meshData.m_indexCount;
@@ -455,105 +1088,364 @@ bool OpenGLRenderer::processPrimitive(const tinygltf::Primitive& primitive, cons
     return true;
 }
 
-// アクセサーからデータを取得
-bool OpenGLRenderer::getAccessorData(const tinygltf::Model& model, int accessorIndex, std::vector<float>& data) {
-    if (accessorIndex < 0 || accessorIndex >= static_cast<int>(model.accessors.size())) {
-        std::cerr << "エラー: 無効なアクセサーインデックス: " << accessorIndex << std::endl;
-        return false;
+// プリミティブのバウンディングボリューム計算
+void OpenGLRenderer::computePrimitiveBounds(
+    const tinygltf::Model& model,
+    int positionAccessor,
+    const std::vector<float>& vertices,
+    GLTFMeshData& meshData)
+{
+    const tinygltf::Accessor& accessor = model.accessors[positionAccessor];
+
+    // アクセサーの min/max が有効ならそれを使用し、無い・不正・スパースの場合は頂点から再計算
+    bool fromAccessor = false;
+    if (m_trustAccessorBounds && !accessor.sparse.isSparse &&
+        accessor.minValues.size() >= 3 && accessor.maxValues.size() >= 3) {
+        fromAccessor = BoundingVolume::fromMinMax(accessor.minValues.data(), accessor.maxValues.data(), meshData.m_bounds);
+    }
+    if (!fromAccessor) {
+        meshData.m_bounds = BoundingVolume::computeAABB(vertices.data(), vertices.size() / 3);
     }
 
-    const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
-    const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-    const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+    // スフィアはAABB中心からの最大距離（外接球より小さくなる）
+    meshData.m_boundingSphere = BoundingVolume::computeSphere(
+        vertices.data(), vertices.size() / 3, meshData.m_bounds.getCenter());
+}
 
-    // 現在は位置データ（POSITION）のみ対応（3要素のfloat）
-    if (accessor.type != TINYGLTF_TYPE_VEC3 || accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
-        std::cerr << "エラー: 未対応のアクセサータイプ" << std::endl;
-        return false;
+// 視錐台カリングを通過したインスタンスを、メッシュごとに連続するよう詰めて描画リストを作成
+void OpenGLRenderer::buildDrawList(const glm::mat4& viewProjection) {
+    const std::vector<glm::mat4>& instanceMatrices = m_instanceBatcher.getInstanceMatrices();
+
+    if (m_frustumCullingEnabled) {
+        m_lastCullingStats = m_frustumCuller.cull(BoundingVolume::extractFrustum(viewProjection), m_visibleInstances);
+    } else {
+        m_visibleInstances.resize(instanceMatrices.size());
+        for (size_t i = 0; i < instanceMatrices.size(); ++i) {
+            m_visibleInstances[i] = static_cast<int>(i);
+        }
+        m_lastCullingStats = CullingStats();
+        m_lastCullingStats.m_total = instanceMatrices.size();
+        m_lastCullingStats.m_visible = instanceMatrices.size();
     }
 
-    data.resize(accessor.count * 3);
+    // 視錐台内に残ったものから、大きなオクルーダーに隠れているものを取り除く
+    m_lastOcclusionStats = OcclusionStats();
+    if (m_occlusionCullingEnabled && m_occlusionCuller.hasOccluders()) {
+        m_lastOcclusionStats = m_occlusionCuller.cull(
+            viewProjection, m_instanceBounds, instanceMatrices, m_instanceBatcher.getInstanceMeshes(), m_visibleInstances);
+    }
 
-    const unsigned char* src = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
-    const float* floatData = reinterpret_cast<const float*>(src);
+    // インスタンスはメッシュ順に並んでおり、可視リストも昇順なので詰めてもメッシュごとに連続する
+    m_meshDrawRanges.assign(m_currentModel ? m_currentModel->meshes.size() : 0, InstanceRange());
+    m_drawMatrices.clear();
+    m_drawMatrices.reserve(m_visibleInstances.size());
+    m_drawPaletteOffsets.clear();
+    for (int instance : m_visibleInstances) {
+        InstanceRange& range = m_meshDrawRanges[m_instanceBatcher.getInstanceMesh(instance)];
+        if (range.m_instanceCount == 0) {
+            range.m_firstInstance = static_cast<int>(m_drawMatrices.size());
+        }
+        ++range.m_instanceCount;
+        m_drawMatrices.push_back(instanceMatrices[instance]);
 
-    for (size_t i = 0; i < accessor.count * 3; ++i) {
-        data[i] = floatData[i];
+        // スキンメッシュ用のパレット先頭（スキンを持たないノードは -1 でインスタンス行列を使う）
+        const int skin = m_skinning.getNodeSkin(m_instanceBatcher.getInstanceNode(instance));
+        m_drawPaletteOffsets.push_back(skin >= 0 ? m_skinning.getPaletteOffset(skin) : -1);
     }
 
-    return true;
+    uploadInstanceMatrices(m_drawMatrices);
+    if (m_instanceSkinVBO != 0 && !m_drawPaletteOffsets.empty()) {
+        uploadDynamicBuffer(GL_ARRAY_BUFFER, m_instanceSkinVBO, m_drawPaletteOffsets.data(),
+            m_drawPaletteOffsets.size() * sizeof(int), m_instanceSkinCapacity);
+    }
+    if (isMultiDrawActive()) {
+        buildIndirectCommands();
+    }
+    requestTextureResidency(viewProjection);
+    buildRenderQueue(viewProjection);
+    m_lastCullViewProjection = viewProjection;
+    m_drawListDirty = false;
 }
 
-// インデックスデータの取得
-bool OpenGLRenderer::getIndexData(const tinygltf::Model& model, int accessorIndex, std::vector<unsigned int>& indices) {
-    if (accessorIndex < 0 || accessorIndex >= static_cast<int>(model.accessors.size())) {
-        std::cerr << "エラー: 無効なアクセサーインデックス: " << accessorIndex << std::endl;
-        return false;
+// インスタンス行列をGPUへ転送（容量が足りない場合のみ再確保）
+void OpenGLRenderer::uploadInstanceMatrices(const std::vector<glm::mat4>& matrices) {
+    if (m_instanceVBO == 0 || matrices.empty()) {
+        return;
     }
 
-    const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
-    const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-    const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+    uploadDynamicBuffer(GL_ARRAY_BUFFER, m_instanceVBO, matrices.data(), matrices.size() * sizeof(glm::mat4), m_instanceCapacity);
+}
 
-    indices.resize(accessor.count);
+// 全スキンの関節パレットを計算する（テクスチャバッファーへの転送は描画前の bindSkinPalette() で行う）
+void OpenGLRenderer::updateSkinPalettes() {
+    m_skinning.updatePalettes(m_sceneGraph);
+    m_paletteDirty = true;
+}
 
-    const unsigned char* src = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+// 関節パレットをテクスチャバッファー（RGBA32F、1行列 = 4テクセル）に関連付ける
+// リングが使える場合は毎フレーム現在の領域へ書き込んで glTexBufferRange でその範囲を参照し、
+// 使えない・溢れた場合は変更があったときだけ m_paletteBuffer へ転送して参照する
+void OpenGLRenderer::bindSkinPalette() {
+    const std::vector<glm::mat4>& palette = m_skinning.getPalette();
+    if (m_paletteBuffer == 0 || palette.empty()) {
+        return;
+    }
+
+    const size_t byteSize = palette.size() * sizeof(glm::mat4);
+    DynamicUploadRing::Allocation allocation;
+    if (m_hasTextureBufferRange && m_uploadRing.upload(palette.data(), byteSize, toPowerOfTwoAlignment(m_textureBufferAlignment), allocation)) {
+        glBindTexture(GL_TEXTURE_BUFFER, m_paletteTexture);
+        glTexBufferRange(GL_TEXTURE_BUFFER, GL_RGBA32F, m_uploadRing.getBuffer(), allocation.m_offset, static_cast<GLsizeiptr>(byteSize));
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        m_paletteInRing = true;
+        return;
+    }
 
-    // コンポーネントタイプに応じてインデックスを読み取り
-    if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-        const unsigned short* shortData = reinterpret_cast<const unsigned short*>(src);
-        for (size_t i = 0; i < accessor.count; ++i) {
-            indices[i] = static_cast<unsigned int>(shortData[i]);
+    if (!m_paletteDirty && !m_paletteInRing) {
+        return;
+    }
+    const size_t previousCapacity = m_paletteCapacity;
+    uploadDynamicBuffer(GL_TEXTURE_BUFFER, m_paletteBuffer, palette.data(), byteSize, m_paletteCapacity);
+
+    // バッファーを再確保した場合・リングを参照していた場合はテクスチャとの関連付けをやり直す
+    if (m_paletteCapacity != previousCapacity || m_paletteInRing) {
+        glBindTexture(GL_TEXTURE_BUFFER, m_paletteTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_paletteBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    m_paletteDirty = false;
+    m_paletteInRing = false;
+}
+
+// カメラ行列を FrameData ブロックへ転送する
+// リングから確保できればその範囲をバインドし、できなければ固定のUBOを書き換える
+void OpenGLRenderer::uploadFrameData(const glm::mat4& viewProjection) {
+    DynamicUploadRing::Allocation allocation;
+    if (m_uploadRing.upload(glm::value_ptr(viewProjection), sizeof(glm::mat4), toPowerOfTwoAlignment(m_uniformBufferAlignment), allocation)) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, kFrameDataBinding, m_uploadRing.getBuffer(), allocation.m_offset, sizeof(glm::mat4));
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUniformBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(viewProjection));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kFrameDataBinding, m_frameUniformBuffer);
+}
+
+// 現在バインドされているVAOにインスタンス行列の属性を設定（mat4 は location 2〜5 の4列）
+// スキンメッシュのVAOはパレット先頭（location 8）も同じインスタンス位置から読む
+void OpenGLRenderer::setInstanceAttributes(size_t firstInstance, bool skinned) {
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    const size_t baseOffset = firstInstance * sizeof(glm::mat4);
+    for (GLuint column = 0; column < 4; ++column) {
+        const GLuint location = 2 + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+            (void*)(baseOffset + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+
+    if (skinned) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceSkinVBO);
+        glVertexAttribIPointer(8, 1, GL_INT, sizeof(int), (void*)(firstInstance * sizeof(int)));
+    }
+}
+
+// 描画リストの範囲をインスタンス描画（BaseInstance が使えない環境では属性の開始位置をずらす）
+void OpenGLRenderer::drawInstances(const GLTFMeshData& mesh, const InstanceRange& range) {
+    if (m_hasBaseInstance) {
+        glDrawElementsInstancedBaseInstance(mesh.m_mode, mesh.m_indexCount, GL_UNSIGNED_INT, mesh.getIndexOffset(),
+            range.m_instanceCount, static_cast<GLuint>(range.m_firstInstance));
+    } else {
+        setInstanceAttributes(range.m_firstInstance, mesh.m_isSkinned);
+        glDrawElementsInstanced(mesh.m_mode, mesh.m_indexCount, GL_UNSIGNED_INT, mesh.getIndexOffset(), range.m_instanceCount);
+    }
+}
+
+// モーフインスタンスごとに、頂点バッファーだけを動的バッファーに差し替えたメッシュデータとVAOを作成
+void OpenGLRenderer::createMorphMeshes() {
+    std::unordered_map<long long, GLTFMeshData*> primitiveMeshes;
+    for (const auto& mesh : m_meshData) {
+        primitiveMeshes[(static_cast<long long>(mesh->m_meshIndex) << 32) | static_cast<unsigned int>(mesh->m_primitiveIndex)] = mesh.get();
+    }
+
+    m_morphMeshData.resize(m_morphTargets.getInstanceCount());
+    for (size_t instance = 0; instance < m_morphTargets.getInstanceCount(); ++instance) {
+        const int morphInstance = static_cast<int>(instance);
+        auto it = primitiveMeshes.find((static_cast<long long>(m_morphTargets.getInstanceMesh(morphInstance)) << 32) |
+            static_cast<unsigned int>(m_morphTargets.getInstancePrimitiveIndex(morphInstance)));
+        if (it == primitiveMeshes.end() || it->second->m_vertexCount != m_morphTargets.getInstanceVertexCount(morphInstance)) {
+            continue;
         }
-    } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
-        const unsigned int* intData = reinterpret_cast<const unsigned int*>(src);
-        for (size_t i = 0; i < accessor.count; ++i) {
-            indices[i] = intData[i];
+        it->second->m_hasMorphTargets = true;
+
+        auto morphMesh = std::make_unique<GLTFMeshData>(*it->second);
+        morphMesh->m_VAO = 0;
+        morphMesh->m_positionOffset = 0;
+        morphMesh->m_vertexBuffer = std::make_shared<GPUBuffer>(GL_ARRAY_BUFFER, m_morphTargets.getInstancePositions(morphInstance),
+            m_morphTargets.getInstanceVertexCount(morphInstance) * 3 * sizeof(float), GL_DYNAMIC_DRAW);
+        if (!createVAO(*morphMesh)) {
+            std::cerr << "警告: モーフインスタンス " << instance << " のVAOを作成できません" << std::endl;
+            continue;
         }
-    } else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-        const unsigned char* byteData = src;
-        for (size_t i = 0; i < accessor.count; ++i) {
-            indices[i] = static_cast<unsigned int>(byteData[i]);
+        m_morphMeshData[instance] = std::move(morphMesh);
+    }
+}
+
+// 直近の update() で再計算したモーフインスタンスの頂点を転送
+void OpenGLRenderer::uploadMorphedPositions() {
+    for (int instance : m_morphTargets.getUpdatedInstances()) {
+        const GLTFMeshData* morphMesh = m_morphMeshData[instance].get();
+        if (!morphMesh) {
+            continue;
         }
-    } else {
-        std::cerr << "エラー: 未対応のインデックスコンポーネントタイプ" << std::endl;
-        return false;
+        glBindBuffer(GL_ARRAY_BUFFER, morphMesh->m_vertexBuffer->getID());
+        glBufferSubData(GL_ARRAY_BUFFER, 0, morphMesh->m_vertexBuffer->getByteSize(), m_morphTargets.getInstancePositions(instance));
     }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    return true;
+// 描画リストの位置（m_visibleInstances と同じ順）のノードに対応するモーフインスタンスのVAO
+GLuint OpenGLRenderer::getDrawVAO(const GLTFMeshData& mesh, int drawIndex) const {
+    const int node = m_instanceBatcher.getInstanceNode(m_visibleInstances[drawIndex]);
+    const int morphInstance = m_morphTargets.findInstance(node, mesh.m_primitiveIndex);
+    if (morphInstance >= 0 && m_morphMeshData[morphInstance]) {
+        return m_morphMeshData[morphInstance]->m_VAO;
+    }
+    return mesh.m_VAO;
 }
 
-// VAOの作成
-bool OpenGLRenderer::createVAO(
-    const std::vector<float>& vertices, 
-    const std::vector<unsigned int>& indices, 
-    GLTFMeshData& meshData) 
-{
-    // VAOとVBOを生成
-    glGenVertexArrays(1, &meshData.m_VAO);
-    glGenBuffers(1, &meshData.m_VBO);
+// インスタンスごとのワールド空間AABB（メッシュのローカルAABBをインスタンス行列で変換）
+void OpenGLRenderer::updateInstanceBounds() {
+    const std::vector<glm::mat4>& instanceMatrices = m_instanceBatcher.getInstanceMatrices();
+    m_instanceBounds.resize(instanceMatrices.size());
+
+    for (size_t instance = 0; instance < instanceMatrices.size(); ++instance) {
+        int node = m_instanceBatcher.getInstanceNode(instance);
+        int mesh = (node >= 0) ? m_sceneGraph.getMesh(node) : static_cast<int>(instance);
+        const int skin = m_skinning.getNodeSkin(node);
+        if (skin >= 0) {
+            // スキンメッシュは関節の姿勢で形が変わるため、関節ごとのAABBをパレットで変換して統合
+            m_instanceBounds[instance] = m_skinning.computeSkinBounds(skin);
+        } else if (m_morphTargets.hasNodeInstances(node)) {
+            // モーフターゲットは現在のウェイトで広がる範囲をローカル空間で求めて変換
+            m_instanceBounds[instance] = BoundingVolume::transform(
+                m_morphTargets.computeNodeBounds(node, m_sceneGraph), instanceMatrices[instance]);
+        } else if (mesh >= 0 && mesh < static_cast<int>(m_meshBounds.size())) {
+            m_instanceBounds[instance] = BoundingVolume::transform(m_meshBounds[mesh], instanceMatrices[instance]);
+        } else {
+            m_instanceBounds[instance] = BoundingBox();
+        }
+    }
+}
 
-    if (meshData.m_hasIndices) {
-        glGenBuffers(1, &meshData.m_EBO);
+// シーングラフのワールド行列でノード・シーンのワールド空間バウンディングボリュームを計算
+void OpenGLRenderer::computeSceneBounds(const tinygltf::Model& model) {
+    m_nodeBounds.assign(model.nodes.size(), BoundingBox());
+    m_sceneBounds = BoundingBox();
+
+    const int nodeCount = static_cast<int>(m_sceneGraph.getNodeCount());
+    std::vector<BoundingBox> subtreeBounds(nodeCount);
+
+    // インスタンス単位で変換する（EXT_mesh_gpu_instancing のノードは全インスタンスを含む）
+    updateInstanceBounds();
+    for (size_t instance = 0; instance < m_instanceBounds.size(); ++instance) {
+        int node = m_instanceBatcher.getInstanceNode(instance);
+        if (node >= 0) {
+            subtreeBounds[node].expand(m_instanceBounds[instance]);
+        }
     }
 
+    // 子から親へサブツリーのAABBを伝播（シーングラフは前順なので逆順に走査すれば子が先）
+    for (int i = nodeCount - 1; i >= 0; --i) {
+        int parent = m_sceneGraph.getParent(i);
+        if (parent >= 0) {
+            subtreeBounds[parent].expand(subtreeBounds[i]);
+        } else {
+            m_sceneBounds.expand(subtreeBounds[i]);
+        }
+        m_nodeBounds[m_sceneGraph.getGLTFNode(i)] = subtreeBounds[i];
+    }
+
+    // ノードが無いモデルはメッシュをそのまま配置したものとみなす
+    if (nodeCount == 0) {
+        for (const auto& meshBounds : m_meshBounds) {
+            m_sceneBounds.expand(meshBounds);
+        }
+    }
+
+    m_sceneBoundingSphere = BoundingVolume::sphereFromBox(m_sceneBounds);
+
+    // インスタンスのAABBから空間クエリ用のBVHを構築
+    const auto buildStart = std::chrono::high_resolution_clock::now();
+    m_sceneBVH.build(m_instanceBounds);
+    const auto buildEnd = std::chrono::high_resolution_clock::now();
+    std::cout << "  シーンBVH: " << m_sceneBVH.getNodeCount() << " ノード (オブジェクト数: " << m_sceneBVH.getObjectCount()
+        << ", 深さ: " << m_sceneBVH.getDepth() << ", 構築: "
+        << std::chrono::duration<double, std::milli>(buildEnd - buildStart).count() << " ms)" << std::endl;
+
+    if (m_sceneBounds.isValid()) {
+        std::cout << "  シーンAABB: min(" << m_sceneBounds.m_min.x << ", " << m_sceneBounds.m_min.y << ", " << m_sceneBounds.m_min.z
+            << ") max(" << m_sceneBounds.m_max.x << ", " << m_sceneBounds.m_max.y << ", " << m_sceneBounds.m_max.z
+            << "), 半径: " << m_sceneBoundingSphere.m_radius << std::endl;
+    } else {
+        std::cout << "  シーンAABB: なし（描画対象のジオメトリがありません）" << std::endl;
+    }
+}
+
+// アクセサーから位置データを取得（VEC3 として float 配列に展開）
+bool OpenGLRenderer::getAccessorData(const tinygltf::Model& model, int accessorIndex, std::vector<float>& data) {
+    return AccessorReader::readFloats(model, accessorIndex, data, 3);
+}
+
+// インデックスデータの取得
+bool OpenGLRenderer::getIndexData(const tinygltf::Model& model, int accessorIndex, std::vector<unsigned int>& indices) {
+    return AccessorReader::readUInts(model, accessorIndex, indices, 1);
+}
+
+// VAOの作成（頂点・インデックスバッファーは共有バッファーを参照する）
+bool OpenGLRenderer::createVAO(GLTFMeshData& meshData) {
+    glGenVertexArrays(1, &meshData.m_VAO);
     glBindVertexArray(meshData.m_VAO);
 
     // 頂点バッファーの設定
-    glBindBuffer(GL_ARRAY_BUFFER, meshData.m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, meshData.m_vertexBuffer->getID());
 
     // 位置属性の設定 (location = 0)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), reinterpret_cast<const void*>(meshData.m_positionOffset));
     glEnableVertexAttribArray(0);
 
-    // インデックスバッファーの設定（存在する場合）
-    if (meshData.m_hasIndices) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshData.m_EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    // インデックスバッファーの設定（VAOに記録される）
+    if (meshData.m_hasIndices && meshData.m_indexBuffer) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshData.m_indexBuffer->getID());
     }
 
+    // スキン属性: 関節番号は整数のまま渡す (location 6, 7) とインスタンスごとのパレット先頭 (location 8)
+    if (meshData.m_isSkinned) {
+        const size_t skinOffset = static_cast<size_t>(meshData.m_baseVertex) * 4 * sizeof(unsigned int);
+        glBindBuffer(GL_ARRAY_BUFFER, meshData.m_jointBuffer->getID());
+        glVertexAttribIPointer(6, 4, GL_UNSIGNED_INT, 4 * sizeof(unsigned int), reinterpret_cast<const void*>(skinOffset));
+        glEnableVertexAttribArray(6);
+        glBindBuffer(GL_ARRAY_BUFFER, meshData.m_weightBuffer->getID());
+        glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), reinterpret_cast<const void*>(skinOffset));
+        glEnableVertexAttribArray(7);
+        glEnableVertexAttribArray(8);
+        glVertexAttribDivisor(8, 1);
+    }
+
+    // テクスチャ座標 (location 9): モーフインスタンスも位置以外は共有バッファーを参照する
+    if (meshData.m_texcoordBuffer) {
+        const size_t texcoordOffset = static_cast<size_t>(meshData.m_baseVertex) * 2 * sizeof(float);
+        glBindBuffer(GL_ARRAY_BUFFER, meshData.m_texcoordBuffer->getID());
+        glVertexAttribPointer(9, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), reinterpret_cast<const void*>(texcoordOffset));
+        glEnableVertexAttribArray(9);
+    }
+
+    // インスタンスごとのモデル行列
+    setInstanceAttributes(0, meshData.m_isSkinned);
+
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     // OpenGLエラーチェック
     GLenum error = glGetError();
@@ -565,8 +1457,406 @@ bool OpenGLRenderer::createVAO(
     return true;
 }
 
+// 頂点フォーマットごとに共有バッファーの先頭を指すVAOを作成（マルチドローは baseVertex で範囲を指定する）
+bool OpenGLRenderer::createPoolVAOs() {
+    for (int format = 0; format < kVertexFormatCount; ++format) {
+        const VertexFormat vertexFormat = static_cast<VertexFormat>(format);
+        if (!m_geometryPool.getPositionBuffer(vertexFormat) || !m_geometryPool.getIndexBuffer()) {
+            continue;
+        }
+
+        GLTFMeshData poolMesh;
+        poolMesh.m_format = vertexFormat;
+        poolMesh.m_isSkinned = vertexFormat == VertexFormat::Skinned;
+        poolMesh.m_hasIndices = true;
+        poolMesh.m_vertexBuffer = m_geometryPool.getPositionBuffer(vertexFormat);
+        poolMesh.m_indexBuffer = m_geometryPool.getIndexBuffer();
+        poolMesh.m_jointBuffer = m_geometryPool.getJointBuffer(vertexFormat);
+        poolMesh.m_weightBuffer = m_geometryPool.getWeightBuffer(vertexFormat);
+        poolMesh.m_texcoordBuffer = m_geometryPool.getTexcoordBuffer(vertexFormat);
+        if (!createVAO(poolMesh)) {
+            std::cerr << "エラー: 共有バッファーのVAOの作成に失敗しました" << std::endl;
+            return false;
+        }
+        m_formatVAO[format] = poolMesh.m_VAO;
+    }
+    return true;
+}
+
+// マテリアルテーブルを参照するシェーダーのバリアントを作成した直後に、テーブル・FrameData のバインディングとサンプラーを指定
+// （プログラムバイナリから読み込んだ場合もリンク直後の状態なので毎回設定する）
+void OpenGLRenderer::setupMaterialShader(ShaderManager& shader) {
+    const bool storageBuffer = m_materialTable.isStorageBuffer();
+    const GLuint program = shader.getProgramID();
+    if (!storageBuffer) {
+        // GLSL 3.30 では binding 修飾子が使えないのでブロックのバインディングをここで指定
+        const GLuint blockIndex = glGetUniformBlockIndex(program, "MaterialTable");
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, blockIndex, kMaterialTableBinding);
+        }
+    }
+    const GLuint frameBlockIndex = glGetUniformBlockIndex(program, "FrameData");
+    if (frameBlockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, frameBlockIndex, kFrameDataBinding);
+    }
+
+    // マルチドロー以外の描画ではテーブルの番号を u_materialIndex で指定する
+    shader.use();
+    shader.setUniform(Uniform::MaterialIndex, 0);
+    shader.setUniform(Uniform::DrawOffset, -1);
+    shader.setUniform(Uniform::JointPalette, kJointPaletteTextureUnit);
+    shader.setUniform(Uniform::BaseColorTexture, kBaseColorTextureUnit);
+    shader.unuse();
+}
+
+// glTFメッシュのシェーダーのソースを shaders/ から読み込み、読み込んだファイルを監視する
+// ソースは shaders/ だけに置き、実行ファイルに別の版を持たない（ファイルが無い場合は初期化に失敗する）
+bool OpenGLRenderer::loadMeshShaderSources(std::string& vertexSource, std::string& fragmentSource) {
+    std::vector<std::string> dependencies;
+    if (!ShaderManager::loadSourceFile(kMeshVertexShaderPath, vertexSource, &dependencies) ||
+        !ShaderManager::loadSourceFile(kMeshFragmentShaderPath, fragmentSource, &dependencies)) {
+        std::cerr << "エラー: glTFメッシュのシェーダーを読み込めません (" << kMeshVertexShaderPath << ", " << kMeshFragmentShaderPath
+            << ")。shaders/ のあるディレクトリを作業ディレクトリにして実行してください" << std::endl;
+        return false;
+    }
+    m_shaderWatcher.setFiles(dependencies);
+    std::cout << "  シェーダーのソース: " << kMeshVertexShaderPath << ", " << kMeshFragmentShaderPath
+        << "（変更を監視して再コンパイル）" << std::endl;
+    return true;
+}
+
+// 完了したバックグラウンドのコンパイルを反映し、一定間隔でソースファイルの変更を確認する
+// 変更があれば全バリアントをバックグラウンドで作り直し、完了するまで以前のプログラムで描画を続ける
+void OpenGLRenderer::updateShaders() {
+    m_shaderCompiler.update();
+    m_meshShaders.update();
+
+    if (m_shaderWatcher.empty()) {
+        return;
+    }
+    const auto now = std::chrono::high_resolution_clock::now();
+    if (std::chrono::duration<double, std::milli>(now - m_lastShaderPoll).count() < kShaderPollIntervalMs) {
+        return;
+    }
+    m_lastShaderPoll = now;
+    if (!m_shaderWatcher.poll()) {
+        return;
+    }
+
+    std::string vertexSource;
+    std::string fragmentSource;
+    std::vector<std::string> dependencies;
+    if (!ShaderManager::loadSourceFile(kMeshVertexShaderPath, vertexSource, &dependencies) ||
+        !ShaderManager::loadSourceFile(kMeshFragmentShaderPath, fragmentSource, &dependencies)) {
+        // 保存途中などで読めない場合は次の変更を待つ
+        return;
+    }
+    m_shaderWatcher.setFiles(dependencies);
+    std::cout << "シェーダーの変更を検出: " << m_meshShaders.getVariantCount() << " 個のバリアントを再コンパイルします" << std::endl;
+    m_meshShaders.reloadSources(vertexSource, fragmentSource);
+}
+
+// 同じシェーダーのバリアント・VAO・描画モードで描けるプリミティブをバケットにまとめる
+// gl_DrawIDARB が使える場合はマテリアルを間接描画コマンドごとに指定できるのでマテリアルをまたいでまとめ、
+// 使えない場合はマテリアルごとにも分ける
+// ベースカラーテクスチャを持つプリミティブはバケットごとにテクスチャをバインドするため常にマテリアルごとに分ける
+// （モーフインスタンスはノードごとに頂点バッファーが異なるため個別に描画する）
+void OpenGLRenderer::buildDrawBuckets() {
+    typedef std::tuple<int, int, GLenum, int> BucketKey;
+    const bool mergeMaterials = m_hasDrawParameters;
+    auto makeKey = [mergeMaterials](const GLTFMeshData& mesh) {
+        const bool merge = mergeMaterials && mesh.m_baseColorTexture < 0;
+        return BucketKey(mesh.m_shaderVariant, static_cast<int>(mesh.m_format), mesh.m_mode, merge ? -1 : mesh.m_materialIndex);
+    };
+    std::map<BucketKey, int> bucketIndices;
+    for (const auto& mesh : m_meshData) {
+        if (!mesh->m_hasMorphTargets && mesh->m_indexCount > 0) {
+            bucketIndices[makeKey(*mesh)] = -1;
+        }
+    }
+
+    m_drawBuckets.clear();
+    for (auto& entry : bucketIndices) {
+        entry.second = static_cast<int>(m_drawBuckets.size());
+        DrawBucket bucket;
+        bucket.m_shaderVariant = std::get<0>(entry.first);
+        bucket.m_format = static_cast<VertexFormat>(std::get<1>(entry.first));
+        bucket.m_mode = std::get<2>(entry.first);
+        bucket.m_materialIndex = std::get<3>(entry.first);
+        m_drawBuckets.push_back(bucket);
+    }
+
+    for (auto& mesh : m_meshData) {
+        mesh->m_drawBucket = -1;
+        if (!mesh->m_hasMorphTargets && mesh->m_indexCount > 0) {
+            mesh->m_drawBucket = bucketIndices[makeKey(*mesh)];
+            m_drawBuckets[mesh->m_drawBucket].m_baseColorTexture = mesh->m_baseColorTexture;
+        }
+    }
+}
+
+// 描画リストのメッシュごとの範囲から、バケットごとに連続する間接描画コマンドを作成して転送
+void OpenGLRenderer::buildIndirectCommands() {
+    for (DrawBucket& bucket : m_drawBuckets) {
+        bucket.m_commandCount = 0;
+        bucket.m_instanceCount = 0;
+    }
+
+    // バケットごとのコマンド数を数えてから先頭位置を決めて詰める
+    for (const auto& mesh : m_meshData) {
+        if (mesh->m_drawBucket >= 0 && m_meshDrawRanges[mesh->m_meshIndex].m_instanceCount > 0) {
+            ++m_drawBuckets[mesh->m_drawBucket].m_commandCount;
+        }
+    }
+    size_t commandCount = 0;
+    for (DrawBucket& bucket : m_drawBuckets) {
+        bucket.m_firstCommand = commandCount;
+        commandCount += bucket.m_commandCount;
+        bucket.m_commandCount = 0;
+    }
+
+    m_indirectCommands.resize(commandCount);
+    m_drawMaterials.resize(commandCount);
+    for (const auto& mesh : m_meshData) {
+        const InstanceRange& range = m_meshDrawRanges[mesh->m_meshIndex];
+        if (mesh->m_drawBucket < 0 || range.m_instanceCount == 0) {
+            continue;
+        }
+        DrawBucket& bucket = m_drawBuckets[mesh->m_drawBucket];
+        DrawElementsIndirectCommand& command = m_indirectCommands[bucket.m_firstCommand + bucket.m_commandCount];
+        command.m_count = static_cast<GLuint>(mesh->m_indexCount);
+        command.m_instanceCount = static_cast<GLuint>(range.m_instanceCount);
+        command.m_firstIndex = mesh->m_firstIndex;
+        command.m_baseVertex = mesh->m_baseVertex;
+        command.m_baseInstance = static_cast<GLuint>(range.m_firstInstance);
+        m_drawMaterials[bucket.m_firstCommand + bucket.m_commandCount] = mesh->m_materialIndex;
+        ++bucket.m_commandCount;
+        bucket.m_instanceCount += range.m_instanceCount;
+    }
+
+    if (!m_indirectCommands.empty()) {
+        uploadDynamicBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer, m_indirectCommands.data(),
+            m_indirectCommands.size() * sizeof(DrawElementsIndirectCommand), m_indirectCapacity);
+        if (m_hasDrawParameters) {
+            uploadDynamicBuffer(GL_SHADER_STORAGE_BUFFER, m_drawMaterialBuffer, m_drawMaterials.data(),
+                m_drawMaterials.size() * sizeof(GLint), m_drawMaterialCapacity);
+        }
+    }
+}
+
+// 描画リストのベースカラーテクスチャを持つプリミティブごとに、テクスチャ座標の 0〜1 が画面上で占める大きさを求めてミップを要求する
+// 大きさはインスタンスのバウンディングスフィアの画面上の直径 / テクスチャ座標の範囲（同じテクスチャでは最大の値を使う）
+void OpenGLRenderer::requestTextureResidency(const glm::mat4& viewProjection) {
+    m_textureStreamer.beginRequests();
+    if (m_textureStreamer.getTextureCount() == 0) {
+        return;
+    }
+
+    const glm::vec4 depthRow(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    const float projectionScale = m_projectionMatrix[1][1] * 0.5f * static_cast<float>(m_windowHeight);
+    for (const auto& mesh : m_meshData) {
+        const InstanceRange& range = m_meshDrawRanges[mesh->m_meshIndex];
+        if (mesh->m_baseColorTexture < 0 || range.m_instanceCount == 0) {
+            continue;
+        }
+
+        float maxDiameter = 0.0f;
+        for (int i = 0; i < range.m_instanceCount; ++i) {
+            const glm::mat4& matrix = m_drawMatrices[range.m_firstInstance + i];
+            const float scale = std::sqrt(std::max(std::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+                glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))), glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+            const glm::vec4 center = matrix * glm::vec4(mesh->m_boundingSphere.m_center, 1.0f);
+            // 視点がスフィアに近い・内側にある場合は奥行きを下限で抑える（最も詳細なミップを要求する）
+            const float depth = std::max(glm::dot(depthRow, center), 1.0e-3f);
+            maxDiameter = std::max(maxDiameter, 2.0f * mesh->m_boundingSphere.m_radius * scale * projectionScale / depth);
+        }
+        m_textureStreamer.request(mesh->m_baseColorTexture, maxDiameter / mesh->m_texcoordExtent);
+    }
+}
+
+// 描画リストの各描画（バケット・プリミティブ・モーフインスタンス）にソートキーを付けて描画キューを作る
+// 深度はインスタンスのAABB中心のクリップ空間 w（視点からの奥行き）の最小値で、同じステート内を手前から描く
+// （描画キューが無効の場合はソートせず、描画リストの順のまま発行する）
+void OpenGLRenderer::buildRenderQueue(const glm::mat4& viewProjection) {
+    const bool multiDraw = isMultiDrawActive();
+    const glm::vec4 depthRow(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    auto getDepth = [&](int drawIndex) {
+        const int instance = m_visibleInstances[drawIndex];
+        if (instance < 0 || static_cast<size_t>(instance) >= m_instanceBounds.size()) {
+            return 0.0f;
+        }
+        return glm::dot(depthRow, glm::vec4(m_instanceBounds[instance].getCenter(), 1.0f));
+    };
+
+    m_queuedDraws.clear();
+    std::vector<int> bucketDraws(m_drawBuckets.size(), -1);
+    for (size_t meshIndex = 0; meshIndex < m_meshData.size(); ++meshIndex) {
+        const GLTFMeshData& mesh = *m_meshData[meshIndex];
+        const InstanceRange& range = m_meshDrawRanges[mesh.m_meshIndex];
+        if (range.m_instanceCount == 0) {
+            continue;
+        }
+
+        // モーフインスタンスはインスタンスごとにVAOが異なるので個別の描画にする
+        if (mesh.m_hasMorphTargets) {
+            for (int i = 0; i < range.m_instanceCount; ++i) {
+                const int drawIndex = range.m_firstInstance + i;
+                m_queuedDraws.push_back(QueuedDraw{ -1, static_cast<int>(meshIndex), drawIndex, getDepth(drawIndex) });
+            }
+            continue;
+        }
+
+        float depth = getDepth(range.m_firstInstance);
+        for (int i = 1; i < range.m_instanceCount; ++i) {
+            depth = std::min(depth, getDepth(range.m_firstInstance + i));
+        }
+
+        if (multiDraw && mesh.m_drawBucket >= 0) {
+            int& bucketDraw = bucketDraws[mesh.m_drawBucket];
+            if (bucketDraw < 0) {
+                bucketDraw = static_cast<int>(m_queuedDraws.size());
+                m_queuedDraws.push_back(QueuedDraw{ mesh.m_drawBucket, -1, -1, depth });
+            } else {
+                m_queuedDraws[bucketDraw].m_depth = std::min(m_queuedDraws[bucketDraw].m_depth, depth);
+            }
+            continue;
+        }
+        m_queuedDraws.push_back(QueuedDraw{ -1, static_cast<int>(meshIndex), -1, depth });
+    }
+
+    float maxDepth = 0.0f;
+    for (const QueuedDraw& draw : m_queuedDraws) {
+        maxDepth = std::max(maxDepth, draw.m_depth);
+    }
+
+    m_renderQueue.clear();
+    m_renderQueue.reserve(m_queuedDraws.size());
+    for (size_t i = 0; i < m_queuedDraws.size(); ++i) {
+        const QueuedDraw& draw = m_queuedDraws[i];
+        uint32_t pass, program, material, geometry;
+        if (draw.m_bucket >= 0) {
+            const DrawBucket& bucket = m_drawBuckets[draw.m_bucket];
+            pass = getDrawPass(bucket.m_mode);
+            program = static_cast<uint32_t>(bucket.m_shaderVariant);
+            material = static_cast<uint32_t>(std::max(bucket.m_materialIndex, 0));
+            geometry = m_formatVAO[static_cast<int>(bucket.m_format)];
+        } else {
+            const GLTFMeshData& mesh = *m_meshData[draw.m_mesh];
+            pass = getDrawPass(mesh.m_mode);
+            program = static_cast<uint32_t>(mesh.m_shaderVariant);
+            material = static_cast<uint32_t>(mesh.m_materialIndex);
+            geometry = draw.m_drawIndex >= 0 ? getDrawVAO(mesh, draw.m_drawIndex) : mesh.m_VAO;
+        }
+        m_renderQueue.push(RenderQueue::makeKey(pass, program, material, geometry, RenderQueue::quantizeDepth(draw.m_depth, maxDepth)),
+            static_cast<uint32_t>(i));
+    }
+
+    if (m_renderQueueEnabled) {
+        m_renderQueue.sort();
+    }
+}
+
+// 描画キューの順に発行する。直前と同じプログラム・マテリアル番号・VAOの設定は省く
+// （uniform はプログラムごとの状態なので、マテリアル番号はプログラムごとに直前の値と比べる）
+void OpenGLRenderer::emitRenderQueue() {
+    StateChangeStats& changes = m_renderStats.m_stateChanges;
+    changes.m_drawItems = m_renderQueue.size();
+    if (m_renderQueue.empty()) {
+        return;
+    }
+
+    const bool skipRedundant = m_renderQueueEnabled;
+    ShaderManager* currentShader = nullptr;
+    GLuint currentVAO = 0;
+    GLuint currentTexture = 0;
+    const GLint kUnknown = -2;
+    std::vector<GLint> materialIndices(m_meshShaders.getVariantCount(), kUnknown);
+    std::vector<GLint> drawOffsets(m_meshShaders.getVariantCount(), kUnknown);
+
+    const bool multiDraw = isMultiDrawActive();
+    if (multiDraw) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        if (m_hasDrawParameters) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kDrawMaterialBinding, m_drawMaterialBuffer);
+        }
+    }
+
+    for (size_t i = 0; i < m_renderQueue.size(); ++i) {
+        const QueuedDraw& draw = m_queuedDraws[m_renderQueue.getItem(i)];
+        const DrawBucket* bucket = draw.m_bucket >= 0 ? &m_drawBuckets[draw.m_bucket] : nullptr;
+        const GLTFMeshData* mesh = draw.m_mesh >= 0 ? m_meshData[draw.m_mesh].get() : nullptr;
+
+        const int variant = bucket ? bucket->m_shaderVariant : mesh->m_shaderVariant;
+        const GLint materialIndex = bucket ? bucket->m_materialIndex : mesh->m_materialIndex;
+        // マテリアルをまたぐバケットは間接描画コマンドごとの番号を m_drawMaterials から引く
+        const GLint drawOffset = bucket && materialIndex < 0 ? static_cast<GLint>(bucket->m_firstCommand) : -1;
+        const GLuint vao = bucket ? m_formatVAO[static_cast<int>(bucket->m_format)]
+            : (draw.m_drawIndex >= 0 ? getDrawVAO(*mesh, draw.m_drawIndex) : mesh->m_VAO);
+        const int baseColorTexture = bucket ? bucket->m_baseColorTexture : mesh->m_baseColorTexture;
+
+        // バックグラウンドでコンパイル中のバリアントは完了するまで描かない
+        ShaderManager* shader = m_meshShaders.getShader(variant);
+        if (!shader->isValid()) {
+            continue;
+        }
+        if (shader != currentShader) {
+            shader->use();
+            currentShader = shader;
+            ++changes.m_programChanges;
+        }
+
+        if (m_hasDrawParameters && (!skipRedundant || drawOffsets[variant] != drawOffset)) {
+            shader->setUniform(Uniform::DrawOffset, drawOffset);
+            drawOffsets[variant] = drawOffset;
+            ++changes.m_materialChanges;
+        }
+        if (materialIndex >= 0 && (!skipRedundant || materialIndices[variant] != materialIndex)) {
+            shader->setUniform(Uniform::MaterialIndex, materialIndex);
+            materialIndices[variant] = materialIndex;
+            ++changes.m_materialChanges;
+        }
+
+        if (!skipRedundant || vao != currentVAO) {
+            glBindVertexArray(vao);
+            currentVAO = vao;
+            ++changes.m_vertexArrayChanges;
+        }
+
+        // 常駐レベルが変わるとテクスチャが作り直されるので、番号ではなくその時点のテクスチャで比べる
+        if (baseColorTexture >= 0) {
+            const GLuint texture = m_textureStreamer.getTexture(baseColorTexture);
+            if (!skipRedundant || texture != currentTexture) {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                currentTexture = texture;
+                ++changes.m_textureChanges;
+            }
+        }
+
+        if (bucket) {
+            // バケットの全プリミティブ・全インスタンスを1回の間接描画で発行
+            glMultiDrawElementsIndirect(bucket->m_mode, GL_UNSIGNED_INT,
+                reinterpret_cast<const void*>(bucket->m_firstCommand * sizeof(DrawElementsIndirectCommand)), bucket->m_commandCount, 0);
+            m_renderStats.m_indirectCommands += bucket->m_commandCount;
+            m_renderStats.m_instances += bucket->m_instanceCount;
+        } else {
+            InstanceRange range = m_meshDrawRanges[mesh->m_meshIndex];
+            if (draw.m_drawIndex >= 0) {
+                range.m_firstInstance = draw.m_drawIndex;
+                range.m_instanceCount = 1;
+            }
+            drawInstances(*mesh, range);
+            m_renderStats.m_instances += range.m_instanceCount;
+        }
+        ++m_renderStats.m_drawCalls;
+    }
+
+    if (multiDraw) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+}
+
 // フェーズ5.2: カメラ更新メソッドの実装
-void OpenGLRenderer::updateCamera(const Camera* camera) {
+void OpenGLRenderer::updateCamera(Camera* camera) {
     if (!camera) {
         std::cerr << "警告: カメラがnullptrです" << std::endl;
         return;
@@ -576,8 +1866,7 @@ void OpenGLRenderer::updateCamera(const Camera* camera) {
     m_camera = camera;
 
     // カメラからビュー行列と投影行列を取得
-    m_viewMatrix = camera->getViewMatrix();
-    m_projectionMatrix = camera->getProjectionMatrix();
+    updateViewProjection();
 
     // デバッグ出力（glm行列の確認）
 #ifdef _DEBUG
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <glm/glm.hpp>
@@ -8,7 +10,32 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
 #include <memory>
+#include "GLContext.h"
 #include "ShaderManager.h"
+#include "ShaderPermutations.h"
+#include "ProgramBinaryCache.h"
+#include "AsyncShaderCompiler.h"
+#include "FileWatcher.h"
+#include "PrimitiveTopology.h"
+#include "BoundingVolume.h"
+#include "GPUBufferCache.h"
+#include "GeometryPool.h"
+#include "SceneGraph.h"
+#include "InstanceBatcher.h"
+#include "SceneBVH.h"
+#include "FrustumCulling.h"
+#include "OcclusionCulling.h"
+#include "AnimationPlayer.h"
+#include "Skinning.h"
+#include "MorphTargets.h"
+#include "Picking.h"
+#include "GeometryStreaming.h"
+#include "RenderQueue.h"
+#include "MaterialTable.h"
+#include "DynamicUploadRing.h"
+#include "TextureStreaming.h"
+#include <chrono>
+#include <unordered_map>
 
 // 前方宣言
 namespace tinygltf {
@@ -21,33 +48,103 @@ class Camera;  // Camera クラスの前方宣言
 
 // glTFメッシュデータを保持する構造体
 struct GLTFMeshData {
-    GLuint m_VAO;
-    GLuint m_VBO;
-    GLuint m_EBO;
-    GLenum m_mode;         // GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.
+    GLuint m_VAO;          // プリミティブ個別のVAO（共有バッファー内の範囲を指す。マルチドローでは使わない）
+    std::shared_ptr<GPUBuffer> m_vertexBuffer;  // 位置（通常は GeometryPool の共有バッファー、モーフインスタンスは個別）
+    std::shared_ptr<GPUBuffer> m_indexBuffer;   // GeometryPool の共有インデックスバッファー
+    std::shared_ptr<GPUBuffer> m_jointBuffer;   // JOINTS_0（スキンメッシュのみ、共有バッファー）
+    std::shared_ptr<GPUBuffer> m_weightBuffer;  // WEIGHTS_0（スキンメッシュのみ、共有バッファー）
+    std::shared_ptr<GPUBuffer> m_texcoordBuffer; // TEXCOORD_0（共有バッファー、無いプリミティブは 0）
+    VertexFormat m_format;
+    GLint m_baseVertex;    // 共有頂点バッファー内の先頭頂点
+    GLuint m_firstIndex;   // 共有インデックスバッファー内の先頭
+    size_t m_positionOffset; // m_vertexBuffer 内の位置の先頭バイト（モーフインスタンスの個別バッファーは 0）
+    int m_drawBucket;      // マルチドローの描画バケット（-1 はプリミティブ個別に描画）
+    GLenum m_mode;         // 正規化後の描画モード (GL_TRIANGLES / GL_LINES / GL_POINTS)
+    PrimitiveClass m_primitiveClass; // 正規化後のプリミティブ分類
     GLsizei m_indexCount;  // インデックス数
     GLsizei m_vertexCount; // 頂点数
     bool m_hasIndices;     // インデックスがあるかどうか
-    glm::vec3 m_color;     // メッシュの色（デフォルトは白）
+    bool m_isSkinned;      // JOINTS_0 / WEIGHTS_0 を持ちスキニングシェーダーで描画するか
+    bool m_hasMorphTargets; // ノードごとのモーフ後の頂点バッファーで描画するか
+    int m_materialIndex;   // MaterialTable の番号（0 はマテリアルなしの既定値）
+    int m_shaderVariant;   // m_meshShaders のバリアント番号（スキン・マテリアルの機能の組で決まる）
+    int m_baseColorTexture; // ベースカラーのglTFテクスチャ番号（-1 はテクスチャなし）
+    float m_texcoordExtent; // TEXCOORD_0 の範囲の大きい方の辺（テクセル密度の計算に使用）
+    int m_meshIndex;       // 元のglTFメッシュのインデックス
+    int m_primitiveIndex;  // メッシュ内のプリミティブインデックス
+    BoundingBox m_bounds;              // ローカル空間のAABB
+    BoundingSphere m_boundingSphere;   // ローカル空間のバウンディングスフィア
 
     GLTFMeshData()
         : m_VAO(0)
-        , m_VBO(0)
-        , m_EBO(0)
+        , m_format(VertexFormat::Position)
+        , m_baseVertex(0)
+        , m_firstIndex(0)
+        , m_positionOffset(0)
+        , m_drawBucket(-1)
         , m_mode(GL_TRIANGLES)
+        , m_primitiveClass(PrimitiveClass::Triangles)
         , m_indexCount(0)
         , m_vertexCount(0)
         , m_hasIndices(false) 
-        , m_color(1.0f, 1.0f, 1.0f)
+        , m_isSkinned(false)
+        , m_hasMorphTargets(false)
+        , m_materialIndex(0)
+        , m_shaderVariant(0)
+        , m_baseColorTexture(-1)
+        , m_texcoordExtent(1.0f)
+        , m_meshIndex(-1)
+        , m_primitiveIndex(-1)
     {
     }
+
+    const void* getIndexOffset() const { return reinterpret_cast<const void*>(static_cast<size_t>(m_firstIndex) * sizeof(GLuint)); }
+};
+
+// マルチドローの描画バケット（同じシェーダーのバリアント・頂点フォーマット・描画モードの描画を1回の glMultiDrawElementsIndirect にまとめる）
+// 描画番号からマテリアルを引けない環境ではマテリアルごとにも分ける
+struct DrawBucket {
+    VertexFormat m_format;
+    GLenum m_mode;
+    int m_shaderVariant;
+    int m_materialIndex;     // MaterialTable の番号（-1 は間接描画コマンドごとに異なる）
+    int m_baseColorTexture;  // ベースカラーのglTFテクスチャ番号（-1 はテクスチャなし）
+    size_t m_firstCommand;   // m_indirectCommands 内の先頭
+    GLsizei m_commandCount;  // 直近の描画リストでのコマンド数
+    size_t m_instanceCount;
+
+    DrawBucket() : m_format(VertexFormat::Position), m_mode(GL_TRIANGLES), m_shaderVariant(0), m_materialIndex(-1), m_baseColorTexture(-1), m_firstCommand(0), m_commandCount(0), m_instanceCount(0) {}
+};
+
+// 描画キューに積む1回分の描画（バケット、プリミティブの描画範囲、モーフインスタンスのいずれか）
+struct QueuedDraw {
+    int m_bucket;      // m_drawBuckets の番号（-1 はプリミティブ個別）
+    int m_mesh;        // m_meshData の番号（バケットの場合は -1）
+    int m_drawIndex;   // モーフインスタンスの描画リスト上の位置（-1 はメッシュの描画範囲全体）
+    float m_depth;     // バウンディングの中心の視点からの奥行きの最小値
+};
+
+// 1フレーム分の描画統計
+struct RenderStats {
+    size_t m_drawCalls;   // 発行したドローコール数（マルチドローは1回と数える）
+    size_t m_indirectCommands;  // マルチドローで発行した間接描画コマンド数
+    size_t m_instances;   // 描画したインスタンス数（プリミティブ単位）
+    double m_cpuTimeMs;   // renderGLTF() に要したCPU時間
+    CullingStats m_culling;  // 視錐台カリングの結果（インスタンス単位）
+    OcclusionStats m_occlusion;  // 視錐台カリング後のオクルージョンカリングの結果
+    SkinningStats m_skinning;    // 関節パレットの更新（更新しなかったフレームは 0）
+    MorphStats m_morph;          // モーフターゲットの評価（ウェイトが変わらなかったフレームは 0）
+    StreamingStats m_streaming;  // チャンクパックのストリーミング（ストリーミング描画時のみ）
+    StateChangeStats m_stateChanges;  // インスタンス描画でのプログラム・マテリアル・VAOの切り替え
+    DynamicUploadStats m_upload;      // リングバッファー経由の動的データ（カメラ行列・関節パレット）の転送
+    TextureStreamingStats m_textures; // テクスチャのミップの常駐と転送
+
+    RenderStats() : m_drawCalls(0), m_indirectCommands(0), m_instances(0), m_cpuTimeMs(0.0) {}
 };
 
 class OpenGLRenderer {
 private:
-    HWND m_hWnd;
-    HDC m_hDC;
-    HGLRC m_hRC;
+    std::unique_ptr<GLContext> m_context;   // ウィンドウのコンテキスト、またはオフスクリーンのコンテキスト
 
     // デモ用三角形のリソース
     GLuint m_demoVAO, m_demoVBO;
@@ -58,8 +155,108 @@ private:
     // 現在ロードされているglTFモデルへの参照
     const tinygltf::Model* m_currentModel;
 
+    // ノード階層とワールド行列
+    SceneGraph m_sceneGraph;
+
+    // アニメーション（前フレームからの経過時間で進める）
+    AnimationPlayer m_animationPlayer;
+    std::chrono::high_resolution_clock::time_point m_lastFrameTime;
+    bool m_hasLastFrameTime;
+
+    // スキンの関節パレット（テクスチャバッファーとしてシェーダーから参照）
+    SkinningSystem m_skinning;
+    GLuint m_paletteBuffer;
+    GLuint m_paletteTexture;
+    size_t m_paletteCapacity;      // m_paletteBuffer の確保済みバイト数
+    GLuint m_instanceSkinVBO;      // 描画リストのインスタンスごとのパレット先頭（location 8、スキンなしは -1）
+    size_t m_instanceSkinCapacity;
+    std::vector<int> m_drawPaletteOffsets;
+    bool m_paletteDirty;           // m_paletteBuffer へ未転送のパレットの変更があるか（リングを使わない場合）
+    bool m_paletteInRing;          // パレットのテクスチャが直近にリングの範囲を参照したか
+
+    // フレームごとの動的データ（カメラ行列・関節パレット）を永続マップしたリングの現在の領域へ書き込む
+    DynamicUploadRing m_uploadRing;
+    GLuint m_frameUniformBuffer;   // リングが使えない・溢れた場合の FrameData ブロック
+    GLint m_uniformBufferAlignment;
+    GLint m_textureBufferAlignment;
+    bool m_hasTextureBufferRange;  // glTexBufferRange が使用可能か（パレットをリングから参照する）
+
+    // モーフターゲット（モーフインスタンスごとに頂点バッファーだけを差し替えたメッシュデータ）
+    MorphTargetSystem m_morphTargets;
+    std::vector<std::unique_ptr<GLTFMeshData>> m_morphMeshData;
+
+    // 同じメッシュを参照するノードをまとめたインスタンス描画用の行列
+    InstanceBatcher m_instanceBatcher;
+    GLuint m_instanceVBO;          // 描画リストのモデル行列（location 2〜5）
+    size_t m_instanceCapacity;     // m_instanceVBO の確保済みバイト数
+    bool m_instancingEnabled;      // false の場合はインスタンスごとに個別のドローコールを発行（比較用）
+    bool m_hasBaseInstance;        // glDrawElementsInstancedBaseInstance が使用可能か
+    RenderStats m_renderStats;
+
+    // 全プリミティブのジオメトリを頂点フォーマットごとの大きなバッファーに詰めたもの
+    GeometryPool m_geometryPool;
+    GLuint m_formatVAO[kVertexFormatCount];     // フォーマットごとの共有VAO（マルチドロー用）
+
+    // マルチドロー（描画リストからバケットごとの間接描画コマンドを作成）
+    std::vector<DrawBucket> m_drawBuckets;
+    std::vector<DrawElementsIndirectCommand> m_indirectCommands;
+    GLuint m_indirectBuffer;
+    size_t m_indirectCapacity;
+    bool m_multiDrawEnabled;       // false の場合はプリミティブごとにVAOを切り替えて描画（比較用）
+    bool m_hasMultiDraw;           // glMultiDrawElementsIndirect が使用可能か
+    std::unordered_map<int, std::pair<BoundingBox, BoundingSphere>> m_accessorBounds;  // 位置アクセサーごとのバウンディング
+
+    // 全マテリアルのパラメーター（描画はマテリアル番号だけを指定する）
+    MaterialTable m_materialTable;
+    bool m_hasDrawParameters;      // gl_DrawIDARB で間接描画コマンドごとのマテリアル番号を引けるか
+    std::vector<GLint> m_drawMaterials;  // m_indirectCommands と同じ並びのマテリアル番号
+    GLuint m_drawMaterialBuffer;
+    size_t m_drawMaterialCapacity;
+
+    // ベースカラーテクスチャ（画面上のテクセル密度に応じてミップを常駐させる）
+    TextureStreamer m_textureStreamer;
+    std::unordered_map<int, float> m_texcoordExtents;   // TEXCOORD_0 のアクセサーごとの範囲
+
+    // 描画キュー（描画リストの描画をステートのソートキー順に並べ、重複するステート変更を省いて発行）
+    std::vector<QueuedDraw> m_queuedDraws;
+    RenderQueue m_renderQueue;
+    bool m_renderQueueEnabled;     // false の場合は描画リストの順で毎回ステートを設定（比較用）
+
+    // バウンディングボリューム（メッシュ単位はローカル空間、ノード・シーンはワールド空間）
+    std::vector<BoundingBox> m_meshBounds;
+    std::vector<BoundingBox> m_nodeBounds;   // ノード以下のサブツリー全体を包むAABB
+    BoundingBox m_sceneBounds;
+    BoundingSphere m_sceneBoundingSphere;
+    std::vector<BoundingBox> m_instanceBounds;  // インスタンスごとのワールド空間AABB（インスタンス番号順）
+    SceneBVH m_sceneBVH;                        // m_instanceBounds に対するBVH（カリング・ピッキング用）
+    Picker m_picker;                            // プリミティブごとの三角形BVH（ピッキング用）
+
+    // チャンクパックのストリーミング（開いている間はglTFモデルの代わりに描画）
+    GeometryStreamer m_streamer;
+
+    // 視錐台カリングと描画リスト（カリングを通過したインスタンスをメッシュごとに詰めたもの）
+    FrustumCuller m_frustumCuller;
+    bool m_frustumCullingEnabled;
+    bool m_drawListDirty;                       // インスタンス行列が変わり描画リストの再作成が必要か
+    glm::mat4 m_lastCullViewProjection;         // 描画リストを作成したときのビュー投影行列
+    CullingStats m_lastCullingStats;
+
+    // 視錐台カリング後のオクルージョンカリング
+    OcclusionCuller m_occlusionCuller;
+    bool m_occlusionCullingEnabled;
+    OcclusionStats m_lastOcclusionStats;
+    std::vector<int> m_visibleInstances;
+    std::vector<glm::mat4> m_drawMatrices;      // m_instanceVBO の内容
+    std::vector<InstanceRange> m_meshDrawRanges;  // メッシュ → m_drawMatrices 内の範囲
+    bool m_trustAccessorBounds;  // アクセサーの min/max を信頼するか（false の場合は常に再計算）
+
     // ShaderManagerを使用した新しいシェーダーシステム
     ShaderManager m_shaderManager;
+    ProgramBinaryCache m_programCache;   // リンク済みプログラムのバイナリ（次回起動時はコンパイルを省く）
+    ShaderPermutations m_meshShaders;    // glTFメッシュのインスタンス描画用（機能の組ごとのバリアント）
+    AsyncShaderCompiler m_shaderCompiler;  // バリアントのコンパイル・リンクを描画スレッドで待たずに行う
+    FileWatcher m_shaderWatcher;         // shaders/ のソース（インクルードを含む）の変更を検出して再コンパイル
+    std::chrono::high_resolution_clock::time_point m_lastShaderPoll;
 
     // glm行列変換のテスト用変数
     glm::mat4 m_modelMatrix;
@@ -67,7 +264,7 @@ private:
     glm::mat4 m_projectionMatrix;
 
     // カメラ関連
-    const Camera* m_camera;  // カメラへの参照（所有権は外部）
+    Camera* m_camera;  // カメラへの参照（所有権は外部、ウィンドウサイズの変更時はアスペクト比を合わせる）
 
     // レンダリングテスト用
     float m_rotationAngle;
@@ -76,45 +273,129 @@ private:
     bool m_isWireframeMode; // ワイヤーフレーム表示かメッシュ表示かを判定
 
     bool initializeOpenGL();
+    void updateViewProjection();
     void setupTriangle();
 
     // glTF関連の初期化・処理関数
     bool processGLTFModel(const tinygltf::Model& model);
-    bool processMesh(const tinygltf::Mesh& mesh, const tinygltf::Model& model);
+    bool processMesh(const tinygltf::Mesh& mesh, int meshIndex, const tinygltf::Model& model);
     bool processPrimitive(const tinygltf::Primitive& primitive, const tinygltf::Model& model, GLTFMeshData& meshData);
 
+    // バウンディングボリュームの計算
+    void computePrimitiveBounds(const tinygltf::Model& model, int positionAccessor, const std::vector<float>& vertices, GLTFMeshData& meshData);
+    void computeSceneBounds(const tinygltf::Model& model);
+    void updateInstanceBounds();
+
+    // 描画リストの作成、インスタンス行列のGPUへの転送と頂点属性の設定
+    void buildDrawList(const glm::mat4& viewProjection);
+    void uploadInstanceMatrices(const std::vector<glm::mat4>& matrices);
+    void setInstanceAttributes(size_t firstInstance, bool skinned);
+    void drawInstances(const GLTFMeshData& mesh, const InstanceRange& range);
+    void buildRenderQueue(const glm::mat4& viewProjection);
+    void requestTextureResidency(const glm::mat4& viewProjection);
+    void emitRenderQueue();
+
+    // 関節パレットの再計算と、テクスチャバッファーへの転送・関連付け
+    void updateSkinPalettes();
+    void bindSkinPalette();
+
+    // カメラ行列を FrameData ブロックへ転送してバインド
+    void uploadFrameData(const glm::mat4& viewProjection);
+
+    // モーフインスタンスの頂点バッファーの作成・更新と、描画リストの位置に対応するVAO
+    void createMorphMeshes();
+    void uploadMorphedPositions();
+    GLuint getDrawVAO(const GLTFMeshData& mesh, int drawIndex) const;
+
     // アクセサーからバッファデータを取得する関数
     bool getAccessorData(const tinygltf::Model& model, int accessorIndex, std::vector<float>& data);
     bool getIndexData(const tinygltf::Model& model, int accessorIndex, std::vector<unsigned int>& indices);
 
     // OpenGLリソースの作成
-    bool createVAO(
-        const std::vector<float>& vertices, 
-        const std::vector<unsigned int>& indices, 
-        GLTFMeshData& meshData);
+    bool createVAO(GLTFMeshData& meshData);
+    bool createPoolVAOs();
+    void setupMaterialShader(ShaderManager& shader);
+    bool loadMeshShaderSources(std::string& vertexSource, std::string& fragmentSource);
+    void updateShaders();
+    void buildDrawBuckets();
+    void buildIndirectCommands();
+    bool isMultiDrawActive() const { return m_multiDrawEnabled && m_hasMultiDraw && m_geometryPool.isUploaded(); }
 
     // glm行列の初期化関数
     void initializeMatrices();
     void updateMatrices();
 
 public:
+#ifdef _WIN32
     OpenGLRenderer(HWND window);
+#endif
+    // 作成済みのコンテキストで描画する（GLContext::createHeadless() の場合は既定のフレームバッファーが無いので、
+    // FBOをバインドして renderFrame() を呼ぶ）
+    explicit OpenGLRenderer(std::unique_ptr<GLContext> context);
     ~OpenGLRenderer();
 
     bool initialize();
     void render();
+    void renderFrame();   // SwapBuffers を行わない render()
     void onResize(int width, int height);
     void cleanup();
 
     // glTFモデルをロードして描画準備をする
     bool loadGLTFModel(const tinygltf::Model& model);
 
+    // チャンクパックを開き、カメラに応じてストリーミングしながら描画する（ロード済みのglTFリソースは解放）
+    bool openStreamingScene(const std::string& path, const StreamingSettings& settings = StreamingSettings());
+    bool isStreaming() const { return m_streamer.isOpen(); }
+    const GeometryStreamer& getStreamer() const { return m_streamer; }
+
     // カメラ更新関数（フェーズ5.2で実装）
-    void updateCamera(const Camera* camera);
+    void updateCamera(Camera* camera);
 
     // レンダリングモードの設定
     void setDemoMode(bool demo) { m_isDemo = demo; }
 
+    // バウンディングボリュームの取得（カメラの自動フィットに使用）
+    const BoundingBox& getSceneBounds() const { return m_sceneBounds; }
+    const BoundingSphere& getSceneBoundingSphere() const { return m_sceneBoundingSphere; }
+    void setTrustAccessorBounds(bool trust) { m_trustAccessorBounds = trust; }
+
+    // インスタンス単位の空間クエリ（オブジェクト番号はインスタンス番号）
+    const SceneBVH& getSceneBVH() const { return m_sceneBVH; }
+    const std::vector<BoundingBox>& getInstanceBounds() const { return m_instanceBounds; }
+
+    // ワールド空間のレイと最初に交差する三角形（マウスピッキング用）
+    bool pick(const Ray& ray, PickResult& result) const { return m_picker.pick(ray, m_sceneBVH, m_instanceBatcher, m_sceneGraph, result); }
+    const Picker& getPicker() const { return m_picker; }
+
+    // シーングラフ（ノード変換の更新に使用）
+    SceneGraph& getSceneGraph() { return m_sceneGraph; }
+    AnimationPlayer& getAnimationPlayer() { return m_animationPlayer; }
+    SkinningSystem& getSkinning() { return m_skinning; }
+    MorphTargetSystem& getMorphTargets() { return m_morphTargets; }
+
+    // インスタンス描画の切り替えと直近フレームの描画統計
+    void setInstancingEnabled(bool enabled) { m_instancingEnabled = enabled; }
+    bool isInstancingEnabled() const { return m_instancingEnabled; }
+    void setMultiDrawEnabled(bool enabled) { m_multiDrawEnabled = enabled; m_drawListDirty = true; }
+    bool isMultiDrawEnabled() const { return m_multiDrawEnabled; }
+    bool hasMultiDraw() const { return m_hasMultiDraw; }
+    void setRenderQueueEnabled(bool enabled) { m_renderQueueEnabled = enabled; m_drawListDirty = true; }
+    bool isRenderQueueEnabled() const { return m_renderQueueEnabled; }
+    void setFrustumCullingEnabled(bool enabled) { m_frustumCullingEnabled = enabled; m_drawListDirty = true; }
+    bool isFrustumCullingEnabled() const { return m_frustumCullingEnabled; }
+    void setOcclusionCullingEnabled(bool enabled) { m_occlusionCullingEnabled = enabled; m_drawListDirty = true; }
+    bool isOcclusionCullingEnabled() const { return m_occlusionCullingEnabled; }
+    OcclusionCuller& getOcclusionCuller() { return m_occlusionCuller; }
+    const RenderStats& getRenderStats() const { return m_renderStats; }
+    const ShaderBuildStats& getShaderBuildStats() const { return m_meshShaders.getStats(); }
+
+    // テクスチャストリーミングの予算・転送量の上限と、テクスチャごとの常駐状態
+    void setTextureStreamingSettings(const TextureStreamingSettings& settings) { m_textureStreamer.setSettings(settings); }
+    const TextureStreamer& getTextureStreamer() const { return m_textureStreamer; }
+
+    // ロード済みのglTFリソースを解放（別のモデルをロードする前にも呼ばれる）
+    void cleanupGLTFResources();
+
     // テスト用の公開メソッド
     //void testShaderCompilation();
     //void testGLMIntegration();
@@ -123,5 +404,5 @@ private:
     // 内部ヘルパー関数
     void renderDemo();
     void renderGLTF();
-    void cleanupGLTFResources();
+    void renderStreaming();
 };
\ No newline at end of file
@@ -0,0 +1,501 @@
+﻿#include "Picking.h"
+#include "InstanceBatcher.h"
+#include "PrimitiveTopology.h"
+#include "SceneGraph.h"
+#include "SimdMath.h"
+#include "ThreadPool.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    const size_t kStackReserve = 64;
+    const int kBlockSize = 4;
+
+    // これより行列式が小さい三角形はレイと平行（または縮退）とみなす
+    const float kDeterminantEpsilon = 1e-12f;
+
+    // ブロック内の1つの三角形とのレイ交差（Möller–Trumbore、両面）
+    bool intersectTriangle(const TriangleBlock& block, int lane, const Ray& ray, float maxDistance, float& t, float& u, float& v) {
+        if (block.m_triangle[lane] < 0) {
+            return false;
+        }
+        const glm::vec3 v0(block.m_v0[0][lane], block.m_v0[1][lane], block.m_v0[2][lane]);
+        const glm::vec3 edge1(block.m_edge1[0][lane], block.m_edge1[1][lane], block.m_edge1[2][lane]);
+        const glm::vec3 edge2(block.m_edge2[0][lane], block.m_edge2[1][lane], block.m_edge2[2][lane]);
+
+        const glm::vec3 p = glm::cross(ray.m_direction, edge2);
+        const float determinant = glm::dot(edge1, p);
+        if (std::abs(determinant) <= kDeterminantEpsilon) {
+            return false;
+        }
+        const float inverseDeterminant = 1.0f / determinant;
+
+        const glm::vec3 s = ray.m_origin - v0;
+        u = glm::dot(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f) {
+            return false;
+        }
+        const glm::vec3 q = glm::cross(s, edge1);
+        v = glm::dot(ray.m_direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f) {
+            return false;
+        }
+        t = glm::dot(edge2, q) * inverseDeterminant;
+        return t >= 0.0f && t < maxDistance;
+    }
+
+#ifdef GLTFVIEWER_SIMD_SSE
+    // レイの成分を4要素に複製したもの
+    struct SimdRay {
+        __m128 m_origin[3];
+        __m128 m_direction[3];
+        __m128 m_boxOrigin;             // (x, y, z, 0)
+        __m128 m_inverseDirection;      // (1/x, 1/y, 1/z, 0)
+
+        explicit SimdRay(const Ray& ray) {
+            for (int axis = 0; axis < 3; ++axis) {
+                m_origin[axis] = _mm_set1_ps(ray.m_origin[axis]);
+                m_direction[axis] = _mm_set1_ps(ray.m_direction[axis]);
+            }
+            m_boxOrigin = _mm_set_ps(0.0f, ray.m_origin.z, ray.m_origin.y, ray.m_origin.x);
+            m_inverseDirection = _mm_set_ps(0.0f, 1.0f / ray.m_direction.z, 1.0f / ray.m_direction.y, 1.0f / ray.m_direction.x);
+        }
+    };
+
+    // ノードのAABBとの交差（スラブ法、3軸を同時に計算）
+    inline bool intersectNode(const BVHNode& node, const SimdRay& ray, float maxDistance, float& entry) {
+        // m_min / m_max に続く int も読み込まれるため、4番目の要素は x の値で置き換えてから集約する
+        const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&node.m_min.x), ray.m_boxOrigin), ray.m_inverseDirection);
+        const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&node.m_max.x), ray.m_boxOrigin), ray.m_inverseDirection);
+        __m128 nearT = _mm_min_ps(t1, t2);
+        __m128 farT = _mm_max_ps(t1, t2);
+        nearT = _mm_shuffle_ps(nearT, nearT, _MM_SHUFFLE(0, 2, 1, 0));
+        farT = _mm_shuffle_ps(farT, farT, _MM_SHUFFLE(0, 2, 1, 0));
+
+        const float tNear = std::max(SimdMath::horizontalMax(nearT), 0.0f);
+        const float tFar = std::min(SimdMath::horizontalMin(farT), maxDistance);
+        entry = tNear;
+        return tNear <= tFar;
+    }
+
+    inline __m128 dot3(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+    }
+
+    // ブロックの4三角形とのレイ交差を同時に計算し、closest より手前で最も近いものを返す
+    bool intersectBlock(const TriangleBlock& block, const SimdRay& ray, float& closest, TriangleHit& hit) {
+        const __m128 e1x = _mm_loadu_ps(block.m_edge1[0]);
+        const __m128 e1y = _mm_loadu_ps(block.m_edge1[1]);
+        const __m128 e1z = _mm_loadu_ps(block.m_edge1[2]);
+        const __m128 e2x = _mm_loadu_ps(block.m_edge2[0]);
+        const __m128 e2y = _mm_loadu_ps(block.m_edge2[1]);
+        const __m128 e2z = _mm_loadu_ps(block.m_edge2[2]);
+        const __m128 dx = ray.m_direction[0];
+        const __m128 dy = ray.m_direction[1];
+        const __m128 dz = ray.m_direction[2];
+
+        // p = d × edge2
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        const __m128 determinant = dot3(e1x, e1y, e1z, px, py, pz);
+        const __m128 absDeterminant = _mm_andnot_ps(_mm_set1_ps(-0.0f), determinant);
+        const __m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+        // s = o - v0
+        const __m128 sx = _mm_sub_ps(ray.m_origin[0], _mm_loadu_ps(block.m_v0[0]));
+        const __m128 sy = _mm_sub_ps(ray.m_origin[1], _mm_loadu_ps(block.m_v0[1]));
+        const __m128 sz = _mm_sub_ps(ray.m_origin[2], _mm_loadu_ps(block.m_v0[2]));
+        const __m128 u = _mm_mul_ps(dot3(sx, sy, sz, px, py, pz), inverseDeterminant);
+
+        // q = s × edge1
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        const __m128 v = _mm_mul_ps(dot3(dx, dy, dz, qx, qy, qz), inverseDeterminant);
+        const __m128 t = _mm_mul_ps(dot3(e2x, e2y, e2z, qx, qy, qz), inverseDeterminant);
+
+        // 空きの要素は辺が 0 なので行列式の判定で除外される
+        const __m128 zero = _mm_setzero_ps();
+        __m128 valid = _mm_cmpgt_ps(absDeterminant, _mm_set1_ps(kDeterminantEpsilon));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(t, zero));
+        valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(closest)));
+
+        int mask = _mm_movemask_ps(valid);
+        if (mask == 0) {
+            return false;
+        }
+
+        float tValues[4], uValues[4], vValues[4];
+        _mm_storeu_ps(tValues, t);
+        _mm_storeu_ps(uValues, u);
+        _mm_storeu_ps(vValues, v);
+        for (int lane = 0; lane < kBlockSize; ++lane) {
+            if ((mask & (1 << lane)) && tValues[lane] < closest) {
+                closest = tValues[lane];
+                hit.m_triangle = block.m_triangle[lane];
+                hit.m_distance = tValues[lane];
+                hit.m_u = uValues[lane];
+                hit.m_v = vValues[lane];
+            }
+        }
+        return true;
+    }
+#endif
+
+    // インスタンス行列の逆行列でレイをローカル空間へ変換する
+    // 方向は正規化しないため、ローカル空間のレイ上の距離はワールド空間のものと一致する
+    Ray toLocalRay(const Ray& ray, const glm::mat4& instanceMatrix) {
+        const glm::mat4 inverseMatrix = glm::inverse(instanceMatrix);
+        return Ray(glm::vec3(inverseMatrix * glm::vec4(ray.m_origin, 1.0f)),
+            glm::vec3(inverseMatrix * glm::vec4(ray.m_direction, 0.0f)));
+    }
+}
+
+// === TriangleBVH ===
+
+TriangleBVH::TriangleBVH()
+    : m_triangleCount(0)
+{
+}
+
+void TriangleBVH::clear() {
+    m_nodes.clear();
+    m_blocks.clear();
+    m_triangleCount = 0;
+}
+
+void TriangleBVH::build(const std::vector<float>& positions, const std::vector<unsigned int>& indices, bool parallel) {
+    clear();
+
+    const size_t vertexCount = positions.size() / 3;
+    const size_t triangleCount = indices.size() / 3;
+    auto vertexAt = [&positions](unsigned int index) {
+        return glm::vec3(positions[index * 3 + 0], positions[index * 3 + 1], positions[index * 3 + 2]);
+    };
+
+    // 範囲外の頂点を参照する三角形は無効なAABBのままにしてBVHから除外する
+    std::vector<BoundingBox> triangleBounds(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        const unsigned int* corner = &indices[triangle * 3];
+        if (corner[0] >= vertexCount || corner[1] >= vertexCount || corner[2] >= vertexCount) {
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            triangleBounds[triangle].expand(vertexAt(corner[k]));
+        }
+    }
+
+    SceneBVH bvh;
+    bvh.setMaxLeafSize(kBlockSize);
+    bvh.build(triangleBounds, parallel);
+    if (bvh.isEmpty()) {
+        return;
+    }
+
+    // 葉の三角形を4つずつブロックに詰め、葉が参照する先をブロック番号に置き換える
+    m_nodes = bvh.getNodes();
+    const std::vector<int>& triangles = bvh.getObjectIndices();
+    m_blocks.reserve((triangles.size() + kBlockSize - 1) / kBlockSize + m_nodes.size() / 2);
+
+    for (BVHNode& node : m_nodes) {
+        if (!node.isLeaf()) {
+            continue;
+        }
+        const int firstBlock = static_cast<int>(m_blocks.size());
+        for (int first = 0; first < node.m_count; first += kBlockSize) {
+            TriangleBlock block = {};
+            for (int lane = 0; lane < kBlockSize; ++lane) {
+                block.m_triangle[lane] = -1;
+                if (first + lane >= node.m_count) {
+                    continue;
+                }
+                const int triangle = triangles[node.m_leftOrFirst + first + lane];
+                const unsigned int* corner = &indices[triangle * 3];
+                const glm::vec3 v0 = vertexAt(corner[0]);
+                const glm::vec3 edge1 = vertexAt(corner[1]) - v0;
+                const glm::vec3 edge2 = vertexAt(corner[2]) - v0;
+                for (int axis = 0; axis < 3; ++axis) {
+                    block.m_v0[axis][lane] = v0[axis];
+                    block.m_edge1[axis][lane] = edge1[axis];
+                    block.m_edge2[axis][lane] = edge2[axis];
+                }
+                block.m_triangle[lane] = triangle;
+            }
+            m_blocks.push_back(block);
+        }
+        node.m_leftOrFirst = firstBlock;
+        node.m_count = static_cast<int>(m_blocks.size()) - firstBlock;
+    }
+    m_triangleCount = triangles.size();
+}
+
+bool TriangleBVH::raycast(const Ray& ray, float maxDistance, TriangleHit& hit) const {
+    hit = TriangleHit();
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    float closest = maxDistance;
+    float entry;
+#ifdef GLTFVIEWER_SIMD_SSE
+    const SimdRay simdRay(ray);
+    auto testNode = [&simdRay](const BVHNode& node, float maxT, float& t) {
+        return intersectNode(node, simdRay, maxT, t);
+    };
+#else
+    const glm::vec3 inverseDirection(1.0f / ray.m_direction.x, 1.0f / ray.m_direction.y, 1.0f / ray.m_direction.z);
+    auto testNode = [&ray, &inverseDirection](const BVHNode& node, float maxT, float& t) {
+        return BoundingVolume::intersectRay(BoundingBox(node.m_min, node.m_max), ray.m_origin, inverseDirection, maxT, t);
+    };
+#endif
+
+    if (!testNode(m_nodes[0], closest, entry)) {
+        return false;
+    }
+    std::vector<int> stack;
+    stack.reserve(kStackReserve);
+    stack.push_back(0);
+
+    while (!stack.empty()) {
+        const BVHNode& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.isLeaf()) {
+            for (int b = 0; b < node.m_count; ++b) {
+                const TriangleBlock& block = m_blocks[node.m_leftOrFirst + b];
+#ifdef GLTFVIEWER_SIMD_SSE
+                intersectBlock(block, simdRay, closest, hit);
+#else
+                for (int lane = 0; lane < kBlockSize; ++lane) {
+                    float t, u, v;
+                    if (intersectTriangle(block, lane, ray, closest, t, u, v)) {
+                        closest = t;
+                        hit.m_triangle = block.m_triangle[lane];
+                        hit.m_distance = t;
+                        hit.m_u = u;
+                        hit.m_v = v;
+                    }
+                }
+#endif
+            }
+            continue;
+        }
+
+        // 近い子を先に処理するため、遠い子を先にスタックへ積む
+        const int leftIndex = node.m_leftOrFirst;
+        const int rightIndex = leftIndex + 1;
+        float leftDistance, rightDistance;
+        const bool hitLeft = testNode(m_nodes[leftIndex], closest, leftDistance);
+        const bool hitRight = testNode(m_nodes[rightIndex], closest, rightDistance);
+
+        if (hitLeft && hitRight) {
+            if (leftDistance <= rightDistance) {
+                stack.push_back(rightIndex);
+                stack.push_back(leftIndex);
+            } else {
+                stack.push_back(leftIndex);
+                stack.push_back(rightIndex);
+            }
+        } else if (hitLeft) {
+            stack.push_back(leftIndex);
+        } else if (hitRight) {
+            stack.push_back(rightIndex);
+        }
+    }
+
+    return hit.m_triangle >= 0;
+}
+
+bool TriangleBVH::raycastBruteForce(const Ray& ray, float maxDistance, TriangleHit& hit) const {
+    hit = TriangleHit();
+    float closest = maxDistance;
+    for (const TriangleBlock& block : m_blocks) {
+        for (int lane = 0; lane < kBlockSize; ++lane) {
+            float t, u, v;
+            if (intersectTriangle(block, lane, ray, closest, t, u, v)) {
+                closest = t;
+                hit.m_triangle = block.m_triangle[lane];
+                hit.m_distance = t;
+                hit.m_u = u;
+                hit.m_v = v;
+            }
+        }
+    }
+    return hit.m_triangle >= 0;
+}
+
+// === Picker ===
+
+Picker::Picker()
+    : m_triangleCount(0)
+    , m_buildTimeMs(0.0)
+{
+}
+
+void Picker::clear() {
+    m_primitiveBVHs.clear();
+    m_meshFirstPrimitive.clear();
+    m_meshPrimitiveCount.clear();
+    m_triangleCount = 0;
+    m_buildTimeMs = 0.0;
+}
+
+size_t Picker::getMemoryBytes() const {
+    size_t bytes = 0;
+    for (const auto& bvh : m_primitiveBVHs) {
+        bytes += bvh.getMemoryBytes();
+    }
+    return bytes;
+}
+
+bool Picker::build(const tinygltf::Model& model, bool parallel) {
+    clear();
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<const tinygltf::Primitive*> primitives;
+    for (const auto& mesh : model.meshes) {
+        m_meshFirstPrimitive.push_back(static_cast<int>(primitives.size()));
+        m_meshPrimitiveCount.push_back(static_cast<int>(mesh.primitives.size()));
+        for (const auto& primitive : mesh.primitives) {
+            primitives.push_back(&primitive);
+        }
+    }
+    m_primitiveBVHs.resize(primitives.size());
+
+    // プリミティブ単位で並列化し、大きなプリミティブはBVH構築自体も並列化する
+    auto buildRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            std::vector<float> positions;
+            std::vector<unsigned int> indices;
+            if (PrimitiveTopology::readTriangleList(model, *primitives[i], positions, indices)) {
+                m_primitiveBVHs[i].build(positions, indices, parallel);
+            }
+        }
+    };
+
+    if (parallel) {
+        ThreadPool::getInstance().parallelFor(primitives.size(), 1, buildRange);
+    } else {
+        buildRange(0, primitives.size());
+    }
+
+    size_t nodeCount = 0;
+    for (const auto& bvh : m_primitiveBVHs) {
+        m_triangleCount += bvh.getTriangleCount();
+        nodeCount += bvh.getNodeCount();
+    }
+    m_buildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << "ピッキング用BVH: " << m_triangleCount << " 三角形 (ノード数: " << nodeCount
+        << ", メモリ: " << getMemoryBytes() / (1024 * 1024) << " MB, 構築: " << m_buildTimeMs << " ms)" << std::endl;
+    return true;
+}
+
+bool Picker::raycastMesh(int mesh, const Ray& localRay, float maxDistance, bool bruteForce, int& primitive, TriangleHit& hit) const {
+    if (mesh < 0 || mesh >= static_cast<int>(m_meshFirstPrimitive.size())) {
+        return false;
+    }
+
+    bool found = false;
+    float closest = maxDistance;
+    const int first = m_meshFirstPrimitive[mesh];
+    for (int p = 0; p < m_meshPrimitiveCount[mesh]; ++p) {
+        const TriangleBVH& bvh = m_primitiveBVHs[first + p];
+        TriangleHit primitiveHit;
+        const bool hitPrimitive = bruteForce
+            ? bvh.raycastBruteForce(localRay, closest, primitiveHit)
+            : bvh.raycast(localRay, closest, primitiveHit);
+        if (hitPrimitive) {
+            closest = primitiveHit.m_distance;
+            primitive = p;
+            hit = primitiveHit;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void Picker::fillResult(const Ray& ray, int instance, int primitive, const TriangleHit& hit,
+    const InstanceBatcher& instanceBatcher, const SceneGraph& sceneGraph, PickResult& result) const
+{
+    const int sceneNode = instanceBatcher.getInstanceNode(instance);
+    result.m_node = sceneNode >= 0 ? sceneGraph.getGLTFNode(sceneNode) : -1;
+    result.m_mesh = instanceBatcher.getInstanceMesh(instance);
+    result.m_primitive = primitive;
+    result.m_triangle = hit.m_triangle;
+    result.m_instance = instance;
+    result.m_distance = hit.m_distance;
+    result.m_position = ray.m_origin + ray.m_direction * hit.m_distance;
+    result.m_barycentric = glm::vec2(hit.m_u, hit.m_v);
+}
+
+bool Picker::pick(const Ray& ray, const SceneBVH& sceneBVH, const InstanceBatcher& instanceBatcher, const SceneGraph& sceneGraph,
+    PickResult& result, float maxDistance) const
+{
+    result = PickResult();
+    if (isEmpty()) {
+        return false;
+    }
+
+    const std::vector<glm::mat4>& instanceMatrices = instanceBatcher.getInstanceMatrices();
+    int hitPrimitive = -1;
+    TriangleHit hitTriangle;
+
+    // シーンBVHは intersector が true を返した距離が最も近い場合だけ採用する
+    // maxDistance に現在の最短距離が渡されるため、ヒットした時点で常に最も近い
+    auto intersector = [&](int instance, const Ray& worldRay, float closest, float& distance) {
+        int primitive = -1;
+        TriangleHit hit;
+        if (!raycastMesh(instanceBatcher.getInstanceMesh(instance), toLocalRay(worldRay, instanceMatrices[instance]),
+            closest, false, primitive, hit)) {
+            return false;
+        }
+        distance = hit.m_distance;
+        hitPrimitive = primitive;
+        hitTriangle = hit;
+        return true;
+    };
+
+    BVHRayHit bvhHit;
+    if (!sceneBVH.raycast(ray, maxDistance, bvhHit, intersector)) {
+        return false;
+    }
+    fillResult(ray, bvhHit.m_object, hitPrimitive, hitTriangle, instanceBatcher, sceneGraph, result);
+    return true;
+}
+
+bool Picker::pickBruteForce(const Ray& ray, const InstanceBatcher& instanceBatcher, const SceneGraph& sceneGraph,
+    PickResult& result, float maxDistance) const
+{
+    result = PickResult();
+    const std::vector<glm::mat4>& instanceMatrices = instanceBatcher.getInstanceMatrices();
+
+    int hitInstance = -1;
+    int hitPrimitive = -1;
+    TriangleHit hitTriangle;
+    float closest = maxDistance;
+    for (size_t instance = 0; instance < instanceBatcher.getInstanceCount(); ++instance) {
+        int primitive = -1;
+        TriangleHit hit;
+        if (raycastMesh(instanceBatcher.getInstanceMesh(instance), toLocalRay(ray, instanceMatrices[instance]),
+            closest, true, primitive, hit)) {
+            closest = hit.m_distance;
+            hitInstance = static_cast<int>(instance);
+            hitPrimitive = primitive;
+            hitTriangle = hit;
+        }
+    }
+
+    if (hitInstance < 0) {
+        return false;
+    }
+    fillResult(ray, hitInstance, hitPrimitive, hitTriangle, instanceBatcher, sceneGraph, result);
+    return true;
+}
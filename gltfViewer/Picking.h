@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include "BoundingVolume.h"
+#include "SceneBVH.h"
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+#include <cstddef>
+
+namespace tinygltf {
+    class Model;
+}
+
+class SceneGraph;
+class InstanceBatcher;
+
+// 4つの三角形をSoAに詰めたもの（SIMDで4三角形を同時に判定する）
+struct TriangleBlock {
+    float m_v0[3][4];       // 頂点0 の x, y, z
+    float m_edge1[3][4];    // 頂点1 - 頂点0
+    float m_edge2[3][4];    // 頂点2 - 頂点0
+    int m_triangle[4];      // プリミティブ内の三角形番号（-1 は空き）
+};
+
+// 三角形とのレイ交差の結果
+struct TriangleHit {
+    int m_triangle;     // -1 はヒットなし
+    float m_distance;   // レイ上の距離
+    float m_u;          // 重心座標（頂点1 の重み）
+    float m_v;          // 重心座標（頂点2 の重み）
+
+    TriangleHit() : m_triangle(-1), m_distance(0.0f), m_u(0.0f), m_v(0.0f) {}
+};
+
+// プリミティブのローカル空間の三角形に対するBVH
+// SceneBVH（ビン分割SAH）で三角形のAABBから構築し、葉の三角形を TriangleBlock に詰め替える
+// 葉ノードの m_leftOrFirst は m_blocks 内の先頭ブロック、m_count はブロック数
+class TriangleBVH {
+private:
+    std::vector<BVHNode> m_nodes;
+    std::vector<TriangleBlock> m_blocks;
+    size_t m_triangleCount;
+
+public:
+    TriangleBVH();
+
+    // positions は xyz、indices はリスト形式の三角形（範囲外の頂点を参照する三角形は除外）
+    void build(const std::vector<float>& positions, const std::vector<unsigned int>& indices, bool parallel = true);
+    void clear();
+
+    // maxDistance より手前で最初に交差する三角形（両面）
+    bool raycast(const Ray& ray, float maxDistance, TriangleHit& hit) const;
+
+    // BVHを使わずに全三角形を判定する（検証用）
+    bool raycastBruteForce(const Ray& ray, float maxDistance, TriangleHit& hit) const;
+
+    bool isEmpty() const { return m_nodes.empty(); }
+    size_t getTriangleCount() const { return m_triangleCount; }
+    size_t getNodeCount() const { return m_nodes.size(); }
+    size_t getMemoryBytes() const { return m_nodes.size() * sizeof(BVHNode) + m_blocks.size() * sizeof(TriangleBlock); }
+};
+
+// ピッキングの結果
+struct PickResult {
+    int m_node;                 // glTFノード番号（ノードを持たないインスタンスは -1）
+    int m_mesh;
+    int m_primitive;            // メッシュ内のプリミティブ番号
+    int m_triangle;             // プリミティブ内の三角形番号（strip/fan はリスト形式へ変換した後の番号）
+    int m_instance;             // InstanceBatcher のインスタンス番号
+    float m_distance;           // レイ上の距離（方向が正規化されていればワールド空間の距離）
+    glm::vec3 m_position;       // ワールド空間のヒット位置
+    glm::vec2 m_barycentric;    // 重心座標 (u, v)
+
+    PickResult()
+        : m_node(-1), m_mesh(-1), m_primitive(-1), m_triangle(-1), m_instance(-1)
+        , m_distance(0.0f), m_position(0.0f), m_barycentric(0.0f)
+    {
+    }
+};
+
+// 読み込んだ形状に対するレイクエリ（マウスピッキングなど）
+// インスタンスのAABBに対するシーンBVHで候補を絞り、レイをインスタンスのローカル空間へ変換して
+// (メッシュ, プリミティブ) ごとの三角形BVHを辿る。三角形BVHはインスタンス間で共有する
+// スキン・モーフターゲットを持つメッシュは変形前の形状で判定する
+class Picker {
+private:
+    std::vector<TriangleBVH> m_primitiveBVHs;   // (メッシュ, プリミティブ) ごと（三角形以外は空）
+    std::vector<int> m_meshFirstPrimitive;      // メッシュ → m_primitiveBVHs 内の先頭
+    std::vector<int> m_meshPrimitiveCount;
+    size_t m_triangleCount;
+    double m_buildTimeMs;
+
+    // インスタンスのローカル空間でメッシュの全プリミティブを判定
+    bool raycastMesh(int mesh, const Ray& localRay, float maxDistance, bool bruteForce, int& primitive, TriangleHit& hit) const;
+    void fillResult(const Ray& ray, int instance, int primitive, const TriangleHit& hit,
+        const InstanceBatcher& instanceBatcher, const SceneGraph& sceneGraph, PickResult& result) const;
+
+public:
+    Picker();
+
+    // モデルの全プリミティブ（三角形）のBVHを構築
+    bool build(const tinygltf::Model& model, bool parallel = true);
+    void clear();
+
+    // ワールド空間のレイと最初に交差する三角形
+    // sceneBVH は instanceBatcher のインスタンス番号をオブジェクトとするBVH
+    bool pick(const Ray& ray, const SceneBVH& sceneBVH, const InstanceBatcher& instanceBatcher, const SceneGraph& sceneGraph,
+        PickResult& result, float maxDistance = std::numeric_limits<float>::max()) const;
+
+    // BVHを使わずに全インスタンスの全三角形を判定する（検証用）
+    bool pickBruteForce(const Ray& ray, const InstanceBatcher& instanceBatcher, const SceneGraph& sceneGraph,
+        PickResult& result, float maxDistance = std::numeric_limits<float>::max()) const;
+
+    bool isEmpty() const { return m_triangleCount == 0; }
+    size_t getTriangleCount() const { return m_triangleCount; }
+    size_t getMemoryBytes() const;
+    double getBuildTimeMs() const { return m_buildTimeMs; }
+};
@@ -0,0 +1,177 @@
+﻿#include "PixelStagingPool.h"
+#include <iostream>
+
+PixelStagingPool::PixelStagingPool()
+    : m_capacity(0)
+    , m_usedBytes(0)
+    , m_allocatedBytes(0)
+{
+}
+
+PixelStagingPool::~PixelStagingPool() {
+    // OpenGLリソースは cleanup() で解放する（コンテキスト破棄後の呼び出しを避ける）
+}
+
+bool PixelStagingPool::isSupported() {
+    return GLEW_VERSION_3_2 || (GLEW_ARB_pixel_buffer_object && GLEW_ARB_map_buffer_range && GLEW_ARB_sync);
+}
+
+void PixelStagingPool::destroyStaging(Staging& staging) {
+    if (staging.m_fence) {
+        glDeleteSync(staging.m_fence);
+        staging.m_fence = nullptr;
+    }
+    if (staging.m_buffer != 0) {
+        if (staging.m_state == State::Mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.m_buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &staging.m_buffer);
+        staging.m_buffer = 0;
+    }
+    if (staging.m_state != State::Free) {
+        m_usedBytes -= staging.m_size;
+    }
+    m_allocatedBytes -= staging.m_capacity;
+    staging.m_capacity = 0;
+    staging.m_size = 0;
+    staging.m_state = State::Free;
+}
+
+void PixelStagingPool::cleanup() {
+    for (Staging& staging : m_stagings) {
+        destroyStaging(staging);
+    }
+    m_stagings.clear();
+    m_usedBytes = 0;
+    m_allocatedBytes = 0;
+}
+
+// 大きさの足りる空きのうち最小のものを使い、無ければ空きのうち最大のものを作り直す（空きが無ければ追加する）
+int PixelStagingPool::acquire(size_t size, void** data) {
+    *data = nullptr;
+    if (size == 0 || (m_usedBytes > 0 && m_usedBytes + size > m_capacity)) {
+        return -1;
+    }
+
+    int fitting = -1;
+    int largest = -1;
+    for (size_t i = 0; i < m_stagings.size(); ++i) {
+        const Staging& staging = m_stagings[i];
+        if (staging.m_state != State::Free) {
+            continue;
+        }
+        if (staging.m_capacity >= size && (fitting < 0 || staging.m_capacity < m_stagings[fitting].m_capacity)) {
+            fitting = static_cast<int>(i);
+        }
+        if (largest < 0 || staging.m_capacity > m_stagings[largest].m_capacity) {
+            largest = static_cast<int>(i);
+        }
+    }
+
+    int index = fitting;
+    if (index < 0) {
+        if (largest >= 0) {
+            index = largest;
+        } else {
+            m_stagings.push_back(Staging{ 0, 0, 0, State::Free, nullptr });
+            index = static_cast<int>(m_stagings.size()) - 1;
+        }
+    }
+
+    Staging& staging = m_stagings[index];
+    if (staging.m_buffer == 0) {
+        glGenBuffers(1, &staging.m_buffer);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.m_buffer);
+    if (staging.m_capacity < size) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+        m_allocatedBytes = m_allocatedBytes - staging.m_capacity + size;
+        staging.m_capacity = size;
+    }
+    // 再利用するのはフェンスを通過したバッファーなので、以前の内容を捨ててマップしても待たされない
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!mapped) {
+        std::cerr << "警告: テクスチャ転送用のPBOをマップできません (" << size << " バイト)" << std::endl;
+        return -1;
+    }
+
+    staging.m_size = size;
+    staging.m_state = State::Mapped;
+    m_usedBytes += size;
+    *data = mapped;
+    return index;
+}
+
+bool PixelStagingPool::bind(int staging) {
+    Staging& target = m_stagings[staging];
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, target.m_buffer);
+    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        std::cerr << "警告: PBOの内容が失われたため転送をやり直します" << std::endl;
+        target.m_state = State::Free;
+        m_usedBytes -= target.m_size;
+        return false;
+    }
+    // アンマップ後はフェンスを置くまで転送中として扱う
+    target.m_state = State::InFlight;
+    return true;
+}
+
+void PixelStagingPool::submit(int staging) {
+    Staging& target = m_stagings[staging];
+    target.m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    target.m_state = State::InFlight;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void PixelStagingPool::discard(int staging) {
+    Staging& target = m_stagings[staging];
+    if (target.m_state == State::Mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, target.m_buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    // 転送中のものは次にマップするときにドライバーが同期するので、フェンスは待たずに捨てる
+    if (target.m_fence) {
+        glDeleteSync(target.m_fence);
+        target.m_fence = nullptr;
+    }
+    if (target.m_state != State::Free) {
+        m_usedBytes -= target.m_size;
+        target.m_state = State::Free;
+    }
+}
+
+bool PixelStagingPool::isComplete(int staging) {
+    Staging& target = m_stagings[staging];
+    if (target.m_state != State::InFlight || !target.m_fence) {
+        return target.m_state == State::Free;
+    }
+    const GLenum result = glClientWaitSync(target.m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    if (result == GL_WAIT_FAILED) {
+        std::cerr << "警告: PBOのフェンスの確認に失敗しました" << std::endl;
+    }
+    glDeleteSync(target.m_fence);
+    target.m_fence = nullptr;
+    target.m_state = State::Free;
+    m_usedBytes -= target.m_size;
+    return true;
+}
+
+// 番号は使用中の転送が参照しているので、解放したバッファーの枠は詰めずに残す
+void PixelStagingPool::trim() {
+    for (Staging& staging : m_stagings) {
+        if (m_allocatedBytes <= m_capacity) {
+            break;
+        }
+        if (staging.m_state == State::Free && staging.m_buffer != 0) {
+            destroyStaging(staging);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+// テクスチャ転送用のPBO（GL_PIXEL_UNPACK_BUFFER）の置き場
+// 描画スレッドが acquire() でマップした領域にワーカースレッドが画素を書き込み、
+// 描画スレッドが bind() → glTexSubImage2D（データはPBO先頭からのオフセット）→ submit() で転送を発行する
+// submit() で置いたフェンスをGPUが通過するまでPBOは再利用しない（転送の完了は isComplete() で確認する）
+// マップ中・転送中の合計は容量までに抑える（ただし何も使っていない場合は容量を超える1件を許す）
+class PixelStagingPool {
+private:
+    enum class State { Free, Mapped, InFlight };
+
+    struct Staging {
+        GLuint m_buffer;
+        size_t m_capacity;      // 確保済みのバッファーの大きさ
+        size_t m_size;          // 使用中の大きさ
+        State m_state;
+        GLsync m_fence;
+    };
+
+    std::vector<Staging> m_stagings;
+    size_t m_capacity;
+    size_t m_usedBytes;         // Mapped / InFlight の合計
+    size_t m_allocatedBytes;    // 全バッファーの合計
+
+    void destroyStaging(Staging& staging);
+
+public:
+    PixelStagingPool();
+    ~PixelStagingPool();
+
+    PixelStagingPool(const PixelStagingPool&) = delete;
+    PixelStagingPool& operator=(const PixelStagingPool&) = delete;
+
+    // PBO・glMapBufferRange・フェンスが使えるか
+    static bool isSupported();
+
+    void setCapacity(size_t capacity) { m_capacity = capacity; }
+    void cleanup();   // OpenGLコンテキストが有効なうちに呼ぶこと（マップ中の領域に書き込むワーカーは完了していること）
+
+    // size バイトの領域をマップし、番号と書き込み先を返す（容量が足りない場合やマップできない場合は -1）
+    int acquire(size_t size, void** data);
+
+    // 書き込みが終わった領域をアンマップしてバインドする（マップ中に内容が失われた場合は false でバインドしない）
+    bool bind(int staging);
+    // 転送コマンドの発行後に呼び、フェンスを置いてバインドを解除する
+    void submit(int staging);
+    // 転送を発行しない場合（アンマップして空きへ戻す）
+    void discard(int staging);
+
+    // submit() した転送をGPUが終えたか（終えていれば空きへ戻す）
+    bool isComplete(int staging);
+
+    // 空きのバッファーが容量を超えて残っている場合に解放する（毎フレーム呼ぶ）
+    void trim();
+
+    size_t getCapacity() const { return m_capacity; }
+    size_t getUsedBytes() const { return m_usedBytes; }
+    size_t getAllocatedBytes() const { return m_allocatedBytes; }
+};
@@ -0,0 +1,190 @@
+﻿#include "PrimitiveTopology.h"
+#include "AccessorReader.h"
+#include <tiny_gltf.h>
+
+namespace {
+
+    // 三角形を追加（縮退三角形は除外）
+    inline void emitTriangle(std::vector<unsigned int>& dst, unsigned int a, unsigned int b, unsigned int c) {
+        if (a == b || b == c || a == c) {
+            return;
+        }
+        dst.push_back(a);
+        dst.push_back(b);
+        dst.push_back(c);
+    }
+
+    // ラインを追加（長さゼロのラインは除外）
+    inline void emitLine(std::vector<unsigned int>& dst, unsigned int a, unsigned int b) {
+        if (a == b) {
+            return;
+        }
+        dst.push_back(a);
+        dst.push_back(b);
+    }
+
+    // リスタートで区切られた1区間をリスト形式へ変換
+    void convertSegment(int gltfMode, const unsigned int* s, size_t n, std::vector<unsigned int>& dst) {
+        switch (gltfMode) {
+        case TINYGLTF_MODE_POINTS:
+            dst.insert(dst.end(), s, s + n);
+            break;
+
+        case TINYGLTF_MODE_LINE:
+            for (size_t i = 0; i + 1 < n; i += 2) {
+                emitLine(dst, s[i], s[i + 1]);
+            }
+            break;
+
+        case TINYGLTF_MODE_LINE_STRIP:
+        case TINYGLTF_MODE_LINE_LOOP:
+            for (size_t i = 0; i + 1 < n; ++i) {
+                emitLine(dst, s[i], s[i + 1]);
+            }
+            // ループは最後の頂点から最初の頂点へ閉じる
+            if (gltfMode == TINYGLTF_MODE_LINE_LOOP && n > 2) {
+                emitLine(dst, s[n - 1], s[0]);
+            }
+            break;
+
+        case TINYGLTF_MODE_TRIANGLE_STRIP:
+            // glTF仕様: p_i = {v_i, v_(i+(1+i%2)), v_(i+(2-i%2))}
+            for (size_t i = 0; i + 2 < n; ++i) {
+                if ((i & 1) == 0) {
+                    emitTriangle(dst, s[i], s[i + 1], s[i + 2]);
+                } else {
+                    emitTriangle(dst, s[i], s[i + 2], s[i + 1]);
+                }
+            }
+            break;
+
+        case TINYGLTF_MODE_TRIANGLE_FAN:
+            // glTF仕様: p_i = {v_(i+1), v_(i+2), v_0}
+            for (size_t i = 0; i + 2 < n; ++i) {
+                emitTriangle(dst, s[i + 1], s[i + 2], s[0]);
+            }
+            break;
+
+        case TINYGLTF_MODE_TRIANGLES:
+        default:
+            for (size_t i = 0; i + 2 < n; i += 3) {
+                emitTriangle(dst, s[i], s[i + 1], s[i + 2]);
+            }
+            break;
+        }
+    }
+}
+
+PrimitiveClass PrimitiveTopology::classify(int gltfMode) {
+    switch (gltfMode) {
+    case TINYGLTF_MODE_POINTS:
+        return PrimitiveClass::Points;
+    case TINYGLTF_MODE_LINE:
+    case TINYGLTF_MODE_LINE_LOOP:
+    case TINYGLTF_MODE_LINE_STRIP:
+        return PrimitiveClass::Lines;
+    default:
+        return PrimitiveClass::Triangles;
+    }
+}
+
+GLenum PrimitiveTopology::toGLMode(PrimitiveClass primitiveClass) {
+    switch (primitiveClass) {
+    case PrimitiveClass::Points: return GL_POINTS;
+    case PrimitiveClass::Lines: return GL_LINES;
+    default: return GL_TRIANGLES;
+    }
+}
+
+const char* PrimitiveTopology::getClassName(PrimitiveClass primitiveClass) {
+    switch (primitiveClass) {
+    case PrimitiveClass::Points: return "POINTS";
+    case PrimitiveClass::Lines: return "LINES";
+    default: return "TRIANGLES";
+    }
+}
+
+const char* PrimitiveTopology::getModeName(int gltfMode) {
+    switch (gltfMode) {
+    case TINYGLTF_MODE_POINTS: return "POINTS";
+    case TINYGLTF_MODE_LINE: return "LINES";
+    case TINYGLTF_MODE_LINE_LOOP: return "LINE_LOOP";
+    case TINYGLTF_MODE_LINE_STRIP: return "LINE_STRIP";
+    case TINYGLTF_MODE_TRIANGLES: return "TRIANGLES";
+    case TINYGLTF_MODE_TRIANGLE_STRIP: return "TRIANGLE_STRIP";
+    case TINYGLTF_MODE_TRIANGLE_FAN: return "TRIANGLE_FAN";
+    default: return "不明";
+    }
+}
+
+unsigned int PrimitiveTopology::getRestartIndex(int componentType) {
+    switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return 0xFFu;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return 0xFFFFu;
+    default: return 0xFFFFFFFFu;
+    }
+}
+
+void PrimitiveTopology::generateSequentialIndices(size_t vertexCount, std::vector<unsigned int>& indices) {
+    indices.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        indices[i] = static_cast<unsigned int>(i);
+    }
+}
+
+bool PrimitiveTopology::normalize(
+    int gltfMode,
+    const std::vector<unsigned int>& srcIndices,
+    unsigned int restartIndex,
+    std::vector<unsigned int>& dstIndices)
+{
+    dstIndices.clear();
+
+    // リスト形式に変換後の要素数はおおよそ 3 * (n - 2) 以下
+    if (classify(gltfMode) == PrimitiveClass::Triangles && gltfMode != TINYGLTF_MODE_TRIANGLES) {
+        dstIndices.reserve(srcIndices.size() * 3);
+    } else {
+        dstIndices.reserve(srcIndices.size() * 2);
+    }
+
+    // リスタートインデックスで区間を分割して変換
+    size_t segmentBegin = 0;
+    for (size_t i = 0; i <= srcIndices.size(); ++i) {
+        if (i == srcIndices.size() || srcIndices[i] == restartIndex) {
+            if (i > segmentBegin) {
+                convertSegment(gltfMode, srcIndices.data() + segmentBegin, i - segmentBegin, dstIndices);
+            }
+            segmentBegin = i + 1;
+        }
+    }
+
+    return !dstIndices.empty();
+}
+
+bool PrimitiveTopology::readTriangleList(
+    const tinygltf::Model& model,
+    const tinygltf::Primitive& primitive,
+    std::vector<float>& positions,
+    std::vector<unsigned int>& indices)
+{
+    if (classify(primitive.mode) != PrimitiveClass::Triangles) {
+        return false;
+    }
+    auto positionIt = primitive.attributes.find("POSITION");
+    if (positionIt == primitive.attributes.end() ||
+        !AccessorReader::readFloats(model, positionIt->second, positions, 3)) {
+        return false;
+    }
+
+    std::vector<unsigned int> sourceIndices;
+    unsigned int restartIndex = getRestartIndex(TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
+    if (primitive.indices >= 0) {
+        if (!AccessorReader::readUInts(model, primitive.indices, sourceIndices, 1)) {
+            return false;
+        }
+        restartIndex = getRestartIndex(model.accessors[primitive.indices].componentType);
+    } else {
+        generateSequentialIndices(positions.size() / 3, sourceIndices);
+    }
+    return normalize(primitive.mode, sourceIndices, restartIndex, indices);
+}
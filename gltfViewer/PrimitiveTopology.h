@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+#include <cstddef>
+
+namespace tinygltf {
+    class Model;
+    struct Primitive;
+}
+
+// 正規化後のプリミティブ分類
+// 同じ分類のプリミティブは同じ描画モード(GL_TRIANGLES/GL_LINES/GL_POINTS)を共有するため、
+// バッファーやマルチドローをまとめることができる
+enum class PrimitiveClass {
+    Triangles,  // TRIANGLES / TRIANGLE_STRIP / TRIANGLE_FAN
+    Lines,      // LINES / LINE_LOOP / LINE_STRIP
+    Points      // POINTS
+};
+
+// glTFの描画モードをインデックス付きリスト形式へ正規化する
+namespace PrimitiveTopology {
+
+    // glTFの描画モードから分類を取得（未知のモードはTrianglesとして扱う）
+    PrimitiveClass classify(int gltfMode);
+
+    // 分類に対応するOpenGL描画モード
+    GLenum toGLMode(PrimitiveClass primitiveClass);
+
+    // 分類名（ログ出力用）
+    const char* getClassName(PrimitiveClass primitiveClass);
+
+    // glTFモード名（ログ出力用）
+    const char* getModeName(int gltfMode);
+
+    // インデックスのコンポーネントタイプに対応するプリミティブリスタート値
+    unsigned int getRestartIndex(int componentType);
+
+    // インデックスなしプリミティブ用の連番インデックスを生成
+    void generateSequentialIndices(size_t vertexCount, std::vector<unsigned int>& indices);
+
+    // strip/fan/loop をリスト形式へ変換する
+    // restartIndex に一致するインデックスで strip/fan を分割し、
+    // 縮退三角形（同一頂点を含む三角形）は除去する
+    bool normalize(
+        int gltfMode,
+        const std::vector<unsigned int>& srcIndices,
+        unsigned int restartIndex,
+        std::vector<unsigned int>& dstIndices);
+
+    // 三角形のプリミティブの POSITION (xyz) とリスト形式へ正規化したインデックスを読み込む
+    // （三角形以外のモード・POSITION が無い場合は false。範囲外の頂点を参照するインデックスは検証しない）
+    bool readTriangleList(
+        const tinygltf::Model& model,
+        const tinygltf::Primitive& primitive,
+        std::vector<float>& positions,
+        std::vector<unsigned int>& indices);
+}
@@ -0,0 +1,128 @@
+﻿#include "ProgramBinaryCache.h"
+#include "ShaderManager.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+    // キャッシュファイルの先頭（形式が変わったら kCacheVersion を上げて古いファイルを無視する）
+    const uint32_t kCacheMagic = 0x42504C47;   // "GLPB"
+    const uint32_t kCacheVersion = 1;
+
+    struct CacheHeader {
+        uint32_t m_magic;
+        uint32_t m_version;
+        uint64_t m_sourceHash;
+        uint64_t m_driverHash;
+        uint32_t m_format;   // glGetProgramBinary が返したバイナリ形式
+        uint32_t m_length;
+    };
+
+    std::string getGLString(GLenum name) {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+
+    std::string toHex(uint64_t value) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+}
+
+ProgramBinaryCache::ProgramBinaryCache()
+    : m_driverHash(0)
+    , m_enabled(false)
+{
+}
+
+bool ProgramBinaryCache::isSupported() {
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        return false;
+    }
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+bool ProgramBinaryCache::initialize(const std::string& directory) {
+    m_enabled = false;
+    if (!isSupported()) {
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cerr << "警告: シェーダーキャッシュのディレクトリを作成できません: " << directory << std::endl;
+        return false;
+    }
+
+    m_directory = directory;
+    m_driver = getGLString(GL_VENDOR) + " / " + getGLString(GL_RENDERER) + " / " + getGLString(GL_VERSION);
+    m_driverHash = hash(m_driver);
+    m_enabled = true;
+    return true;
+}
+
+std::string ProgramBinaryCache::getPath(uint64_t sourceHash) const {
+    return m_directory + "/" + toHex(sourceHash) + "-" + toHex(m_driverHash) + ".bin";
+}
+
+bool ProgramBinaryCache::load(uint64_t sourceHash, ShaderManager& shader) const {
+    if (!m_enabled) {
+        return false;
+    }
+    std::ifstream file(getPath(sourceHash), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // 書き込み途中で終了したファイルや別の形式のファイルは使わない
+    CacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.m_magic != kCacheMagic ||
+        header.m_version != kCacheVersion || header.m_sourceHash != sourceHash || header.m_driverHash != m_driverHash ||
+        header.m_length == 0) {
+        return false;
+    }
+    std::vector<unsigned char> binary(header.m_length);
+    if (!file.read(reinterpret_cast<char*>(binary.data()), binary.size())) {
+        return false;
+    }
+
+    // ドライバーが受け付けない場合（同じ文字列のまま内部形式が変わった場合など）はリンク失敗になる
+    return shader.createFromBinary(static_cast<GLenum>(header.m_format), binary.data(), static_cast<GLsizei>(binary.size()));
+}
+
+bool ProgramBinaryCache::store(uint64_t sourceHash, const ShaderManager& shader) const {
+    if (!m_enabled) {
+        return false;
+    }
+    GLenum format = 0;
+    std::vector<unsigned char> binary;
+    if (!shader.getProgramBinary(format, binary)) {
+        return false;
+    }
+
+    const std::string path = getPath(sourceHash);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "警告: シェーダーキャッシュを書き込めません: " << path << std::endl;
+        return false;
+    }
+    CacheHeader header = { kCacheMagic, kCacheVersion, sourceHash, m_driverHash,
+        static_cast<uint32_t>(format), static_cast<uint32_t>(binary.size()) };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+    return file.good();
+}
+
+uint64_t ProgramBinaryCache::hash(const std::string& text, uint64_t seed) {
+    uint64_t result = seed;
+    for (unsigned char c : text) {
+        result ^= c;
+        result *= 1099511628211ull;
+    }
+    return result;
+}
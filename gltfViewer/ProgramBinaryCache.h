@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+class ShaderManager;
+
+// リンク済みプログラムのバイナリ（glGetProgramBinary）をディレクトリに保存し、次回起動時にコンパイルせずに読み込む
+// ファイル名はシェーダーソースのハッシュとドライバー文字列（GL_VENDOR / GL_RENDERER / GL_VERSION）のハッシュの組で、
+// ドライバーが更新された場合は別のファイルになる（読み込みに失敗した場合は呼び出し側でコンパイルし直して上書きする）
+class ProgramBinaryCache {
+private:
+    std::string m_directory;
+    std::string m_driver;
+    uint64_t m_driverHash;
+    bool m_enabled;
+
+    std::string getPath(uint64_t sourceHash) const;
+
+public:
+    ProgramBinaryCache();
+
+    // GL 4.1 / ARB_get_program_binary があり、ドライバーが1つ以上のバイナリ形式に対応しているか
+    static bool isSupported();
+
+    // 保存先ディレクトリを作成して有効にする（非対応・作成失敗の場合は false で、load/store は何もしない）
+    bool initialize(const std::string& directory);
+    bool isEnabled() const { return m_enabled; }
+
+    // シェーダーソースのハッシュに対応するバイナリからプログラムを作成
+    bool load(uint64_t sourceHash, ShaderManager& shader) const;
+    // リンク済みプログラムのバイナリを保存（ShaderManager::setBinaryRetrievable(true) でリンクしたもの）
+    bool store(uint64_t sourceHash, const ShaderManager& shader) const;
+
+    // FNV-1a 64bit（seed に直前の結果を渡すと連結した文字列のハッシュになる）
+    static uint64_t hash(const std::string& text, uint64_t seed = 14695981039346656037ull);
+};
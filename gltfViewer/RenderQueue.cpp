@@ -0,0 +1,101 @@
+﻿#include "RenderQueue.h"
+
+namespace {
+    const int kRadixBits = 8;
+    const int kRadixSize = 1 << kRadixBits;
+    const int kDigitCount = 64 / kRadixBits;
+
+    uint64_t truncateField(uint32_t value, int bits) {
+        return static_cast<uint64_t>(value) & ((static_cast<uint64_t>(1) << bits) - 1);
+    }
+}
+
+RenderQueue::RenderQueue()
+    : m_sorted(true)
+{
+}
+
+uint64_t RenderQueue::makeKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t geometry, uint32_t depth) {
+    uint64_t key = truncateField(pass, kPassBits);
+    key = (key << kProgramBits) | truncateField(program, kProgramBits);
+    key = (key << kMaterialBits) | truncateField(material, kMaterialBits);
+    key = (key << kGeometryBits) | truncateField(geometry, kGeometryBits);
+    key = (key << kDepthBits) | truncateField(depth, kDepthBits);
+    return key;
+}
+
+uint32_t RenderQueue::quantizeDepth(float depth, float maxDepth) {
+    const uint32_t maxValue = (1u << kDepthBits) - 1;
+    if (!(depth > 0.0f) || !(maxDepth > 0.0f)) {
+        return 0;
+    }
+    if (depth >= maxDepth) {
+        return maxValue;
+    }
+    return static_cast<uint32_t>(depth / maxDepth * static_cast<float>(maxValue));
+}
+
+void RenderQueue::clear() {
+    m_keys.clear();
+    m_items.clear();
+    m_sorted = true;
+}
+
+void RenderQueue::reserve(size_t count) {
+    m_keys.reserve(count);
+    m_items.reserve(count);
+}
+
+void RenderQueue::push(uint64_t key, uint32_t item) {
+    if (!m_keys.empty() && key < m_keys.back()) {
+        m_sorted = false;
+    }
+    m_keys.push_back(key);
+    m_items.push_back(item);
+}
+
+void RenderQueue::sort() {
+    const size_t count = m_keys.size();
+    if (m_sorted || count < 2) {
+        m_sorted = true;
+        return;
+    }
+
+    // 全桁のヒストグラムを1回の走査で作る
+    std::vector<size_t> histogram(kDigitCount * kRadixSize, 0);
+    for (uint64_t key : m_keys) {
+        for (int digit = 0; digit < kDigitCount; ++digit) {
+            ++histogram[digit * kRadixSize + ((key >> (digit * kRadixBits)) & (kRadixSize - 1))];
+        }
+    }
+
+    m_tempKeys.resize(count);
+    m_tempItems.resize(count);
+    for (int digit = 0; digit < kDigitCount; ++digit) {
+        size_t* counts = &histogram[digit * kRadixSize];
+
+        // 全キーでこの桁が同じなら並びは変わらない（未使用の上位フィールドや一定のパス番号）
+        const uint64_t firstValue = (m_keys[0] >> (digit * kRadixBits)) & (kRadixSize - 1);
+        if (counts[firstValue] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (int value = 0; value < kRadixSize; ++value) {
+            const size_t bucketSize = counts[value];
+            counts[value] = offset;
+            offset += bucketSize;
+        }
+
+        const int shift = digit * kRadixBits;
+        for (size_t i = 0; i < count; ++i) {
+            const size_t destination = counts[(m_keys[i] >> shift) & (kRadixSize - 1)]++;
+            m_tempKeys[destination] = m_keys[i];
+            m_tempItems[destination] = m_items[i];
+        }
+        m_keys.swap(m_tempKeys);
+        m_items.swap(m_tempItems);
+    }
+
+    m_sorted = true;
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 描画の切り替えに伴うステート変更の回数（1フレーム分）
+struct StateChangeStats {
+    size_t m_programChanges;    // glUseProgram
+    size_t m_materialChanges;   // マテリアルのuniform設定
+    size_t m_vertexArrayChanges; // glBindVertexArray
+    size_t m_textureChanges;    // ベースカラーテクスチャの glBindTexture
+    size_t m_drawItems;         // キューに積んだ描画の数
+
+    StateChangeStats() : m_programChanges(0), m_materialChanges(0), m_vertexArrayChanges(0), m_textureChanges(0), m_drawItems(0) {}
+
+    size_t getTotal() const { return m_programChanges + m_materialChanges + m_vertexArrayChanges + m_textureChanges; }
+};
+
+// 64ビットのソートキーと描画番号の組を基数ソートで並べる描画キュー
+// キーは上位ビットから パス(4) | プログラム(4) | マテリアル(16) | ジオメトリ(24) | 深度(16) で、
+// 昇順に並べると切り替えコストの高いステートほど変更回数が少なくなり、同じステート内は手前から描画される
+// （キーの各フィールドは呼び出し側が割り当てた小さな番号で、幅を超える値は切り詰める）
+class RenderQueue {
+private:
+    std::vector<uint64_t> m_keys;
+    std::vector<uint32_t> m_items;
+    std::vector<uint64_t> m_tempKeys;   // ソートの作業領域（フレーム間で使い回す）
+    std::vector<uint32_t> m_tempItems;
+    bool m_sorted;
+
+public:
+    static const int kPassBits = 4;
+    static const int kProgramBits = 4;
+    static const int kMaterialBits = 16;
+    static const int kGeometryBits = 24;
+    static const int kDepthBits = 16;
+
+    RenderQueue();
+
+    static uint64_t makeKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t geometry, uint32_t depth);
+
+    // 視点からの距離 [0, maxDepth] を深度フィールドの値に量子化
+    static uint32_t quantizeDepth(float depth, float maxDepth);
+
+    void clear();
+    void reserve(size_t count);
+    void push(uint64_t key, uint32_t item);
+
+    // LSD基数ソート（8ビットずつ8パス、全キーで同じ値の桁は飛ばす）。同じキーは積んだ順を保つ
+    void sort();
+
+    size_t size() const { return m_items.size(); }
+    bool empty() const { return m_items.empty(); }
+    bool isSorted() const { return m_sorted; }
+    uint64_t getKey(size_t index) const { return m_keys[index]; }
+    uint32_t getItem(size_t index) const { return m_items[index]; }
+};
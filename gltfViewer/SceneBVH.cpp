@@ -0,0 +1,552 @@
+﻿#include "SceneBVH.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+    const int kBinCount = 16;
+    const int kParallelBinningThreshold = 65536;  // これ以上の区間はビン集計自体を並列化
+    const int kSubtreeThreshold = 2048;           // これ以下の区間は1スレッドでサブツリー全体を構築
+    const int kBinningGrainSize = 16384;
+    const float kTraversalCost = 1.0f;            // SAHのノード走査コスト（交差判定コストを1とする）
+    const size_t kStackReserve = 64;
+
+    struct Bin {
+        BoundingBox m_bounds;
+        int m_count;
+
+        Bin() : m_count(0) {}
+    };
+
+    // 3軸分のビン
+    struct BinSet {
+        Bin m_bins[3][kBinCount];
+
+        void merge(const BinSet& other) {
+            for (int axis = 0; axis < 3; ++axis) {
+                for (int b = 0; b < kBinCount; ++b) {
+                    m_bins[axis][b].m_bounds.expand(other.m_bins[axis][b].m_bounds);
+                    m_bins[axis][b].m_count += other.m_bins[axis][b].m_count;
+                }
+            }
+        }
+    };
+
+    float surfaceArea(const BoundingBox& box) {
+        if (!box.isValid()) {
+            return 0.0f;
+        }
+        glm::vec3 size = box.getSize();
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    int binIndex(float centroid, float minValue, float scale) {
+        int bin = static_cast<int>((centroid - minValue) * scale);
+        return std::min(std::max(bin, 0), kBinCount - 1);
+    }
+
+    // 視錐台とAABBの関係（0: 外, 1: 交差, 2: 内側）
+    int classifyFrustum(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+        int result = 2;
+        for (int i = 0; i < Frustum::PlaneCount; ++i) {
+            const glm::vec4& plane = frustum.m_planes[i];
+            const glm::vec3 normal(plane);
+            const glm::vec3 positive(
+                plane.x >= 0.0f ? boxMax.x : boxMin.x,
+                plane.y >= 0.0f ? boxMax.y : boxMin.y,
+                plane.z >= 0.0f ? boxMax.z : boxMin.z);
+            if (glm::dot(normal, positive) + plane.w < 0.0f) {
+                return 0;
+            }
+            const glm::vec3 negative(
+                plane.x >= 0.0f ? boxMin.x : boxMax.x,
+                plane.y >= 0.0f ? boxMin.y : boxMax.y,
+                plane.z >= 0.0f ? boxMin.z : boxMax.z);
+            if (glm::dot(normal, negative) + plane.w < 0.0f) {
+                result = 1;
+            }
+        }
+        return result;
+    }
+}
+
+SceneBVH::SceneBVH()
+    : m_maxLeafSize(4)
+{
+}
+
+void SceneBVH::clear() {
+    m_nodes.clear();
+    m_objectIndices.clear();
+    m_objectBounds.clear();
+}
+
+void SceneBVH::computeNodeBounds(BVHNode& node) const {
+    BoundingBox bounds;
+    for (int i = 0; i < node.m_count; ++i) {
+        bounds.expand(m_objectBounds[m_objectIndices[node.m_leftOrFirst + i]]);
+    }
+    node.m_min = bounds.m_min;
+    node.m_max = bounds.m_max;
+}
+
+bool SceneBVH::splitNode(const BuildTask& task, const std::vector<glm::vec3>& centroids, bool parallelBinning,
+    std::atomic<int>& nodeCounter, BuildTask children[2])
+{
+    BVHNode& node = m_nodes[task.m_node];
+    int* indices = m_objectIndices.data() + task.m_first;
+
+    // ノードのAABBと重心のAABB
+    BoundingBox nodeBounds, centroidBounds;
+    if (parallelBinning) {
+        const size_t chunkCount = (task.m_count + kBinningGrainSize - 1) / kBinningGrainSize;
+        std::vector<BoundingBox> chunkNode(chunkCount), chunkCentroid(chunkCount);
+        ThreadPool::getInstance().parallelFor(task.m_count, kBinningGrainSize, [&](size_t begin, size_t end) {
+            const size_t chunk = begin / kBinningGrainSize;
+            for (size_t i = begin; i < end; ++i) {
+                chunkNode[chunk].expand(m_objectBounds[indices[i]]);
+                chunkCentroid[chunk].expand(centroids[indices[i]]);
+            }
+        });
+        for (size_t c = 0; c < chunkCount; ++c) {
+            nodeBounds.expand(chunkNode[c]);
+            centroidBounds.expand(chunkCentroid[c]);
+        }
+    } else {
+        for (int i = 0; i < task.m_count; ++i) {
+            nodeBounds.expand(m_objectBounds[indices[i]]);
+            centroidBounds.expand(centroids[indices[i]]);
+        }
+    }
+    node.m_min = nodeBounds.m_min;
+    node.m_max = nodeBounds.m_max;
+
+    auto makeLeaf = [&]() {
+        node.m_leftOrFirst = task.m_first;
+        node.m_count = task.m_count;
+        return false;
+    };
+
+    if (task.m_count <= m_maxLeafSize) {
+        return makeLeaf();
+    }
+
+    const glm::vec3 extent = centroidBounds.getSize();
+    glm::vec3 scale(0.0f);
+    for (int axis = 0; axis < 3; ++axis) {
+        scale[axis] = extent[axis] > 0.0f ? kBinCount / extent[axis] : 0.0f;
+    }
+
+    // ビン集計
+    BinSet bins;
+    auto binRange = [&](size_t begin, size_t end, BinSet& out) {
+        for (size_t i = begin; i < end; ++i) {
+            const int object = indices[i];
+            const glm::vec3& c = centroids[object];
+            for (int axis = 0; axis < 3; ++axis) {
+                Bin& bin = out.m_bins[axis][binIndex(c[axis], centroidBounds.m_min[axis], scale[axis])];
+                bin.m_bounds.expand(m_objectBounds[object]);
+                ++bin.m_count;
+            }
+        }
+    };
+    if (parallelBinning) {
+        const size_t chunkCount = (task.m_count + kBinningGrainSize - 1) / kBinningGrainSize;
+        std::vector<BinSet> chunkBins(chunkCount);
+        ThreadPool::getInstance().parallelFor(task.m_count, kBinningGrainSize, [&](size_t begin, size_t end) {
+            binRange(begin, end, chunkBins[begin / kBinningGrainSize]);
+        });
+        for (const auto& chunk : chunkBins) {
+            bins.merge(chunk);
+        }
+    } else {
+        binRange(0, task.m_count, bins);
+    }
+
+    // 各軸・各分割位置のSAHコストを左右からの累積で評価
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    int bestSplit = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (extent[axis] <= 0.0f) {
+            continue;
+        }
+        float leftArea[kBinCount - 1];
+        int leftCount[kBinCount - 1];
+        BoundingBox accumulated;
+        int count = 0;
+        for (int b = 0; b < kBinCount - 1; ++b) {
+            accumulated.expand(bins.m_bins[axis][b].m_bounds);
+            count += bins.m_bins[axis][b].m_count;
+            leftArea[b] = surfaceArea(accumulated);
+            leftCount[b] = count;
+        }
+        accumulated = BoundingBox();
+        count = 0;
+        for (int b = kBinCount - 1; b > 0; --b) {
+            accumulated.expand(bins.m_bins[axis][b].m_bounds);
+            count += bins.m_bins[axis][b].m_count;
+            float cost = leftArea[b - 1] * leftCount[b - 1] + surfaceArea(accumulated) * count;
+            if (leftCount[b - 1] > 0 && count > 0 && cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    int leftCount = 0;
+    if (bestAxis >= 0) {
+        // 分割しない方が安い場合は葉にする（大きすぎる葉は作らない）
+        const float parentArea = surfaceArea(nodeBounds);
+        const float splitCost = kTraversalCost + (parentArea > 0.0f ? bestCost / parentArea : 0.0f);
+        if (splitCost >= static_cast<float>(task.m_count) && task.m_count <= m_maxLeafSize * 4) {
+            return makeLeaf();
+        }
+
+        const float minValue = centroidBounds.m_min[bestAxis];
+        const float axisScale = scale[bestAxis];
+        int* middle = std::partition(indices, indices + task.m_count, [&](int object) {
+            return binIndex(centroids[object][bestAxis], minValue, axisScale) < bestSplit;
+        });
+        leftCount = static_cast<int>(middle - indices);
+    }
+
+    // 重心がすべて一致する場合などは中央で分割
+    if (leftCount == 0 || leftCount == task.m_count) {
+        leftCount = task.m_count / 2;
+    }
+
+    const int left = nodeCounter.fetch_add(2);
+    node.m_leftOrFirst = left;
+    node.m_count = 0;
+
+    children[0].m_node = left;
+    children[0].m_first = task.m_first;
+    children[0].m_count = leftCount;
+    children[1].m_node = left + 1;
+    children[1].m_first = task.m_first + leftCount;
+    children[1].m_count = task.m_count - leftCount;
+    return true;
+}
+
+void SceneBVH::buildSubtree(const BuildTask& root, const std::vector<glm::vec3>& centroids, std::atomic<int>& nodeCounter) {
+    std::vector<BuildTask> stack;
+    stack.push_back(root);
+    BuildTask children[2];
+
+    while (!stack.empty()) {
+        BuildTask task = stack.back();
+        stack.pop_back();
+        if (splitNode(task, centroids, false, nodeCounter, children)) {
+            stack.push_back(children[1]);
+            stack.push_back(children[0]);
+        }
+    }
+}
+
+void SceneBVH::build(const std::vector<BoundingBox>& objectBounds, bool parallel) {
+    clear();
+    m_objectBounds = objectBounds;
+
+    const int objectCount = static_cast<int>(objectBounds.size());
+    std::vector<glm::vec3> centroids(objectCount);
+    m_objectIndices.reserve(objectCount);
+    for (int i = 0; i < objectCount; ++i) {
+        if (objectBounds[i].isValid()) {
+            centroids[i] = objectBounds[i].getCenter();
+            m_objectIndices.push_back(i);
+        }
+    }
+
+    const int count = static_cast<int>(m_objectIndices.size());
+    if (count == 0) {
+        return;
+    }
+
+    // ノード数は最大で 2N - 1
+    m_nodes.resize(2 * count - 1);
+    std::atomic<int> nodeCounter(1);
+
+    BuildTask root = { 0, 0, count };
+    if (!parallel) {
+        buildSubtree(root, centroids, nodeCounter);
+    } else {
+        // 上位レベルは幅優先で分割し、十分小さくなった区間はサブツリーごとにワーカーへ割り当てる
+        std::vector<BuildTask> pending(1, root);
+        std::vector<BuildTask> subtrees;
+        while (!pending.empty()) {
+            std::vector<BuildTask> next;
+            std::vector<BuildTask> smallTasks;
+            BuildTask children[2];
+
+            for (const auto& task : pending) {
+                if (task.m_count <= kSubtreeThreshold) {
+                    subtrees.push_back(task);
+                } else if (task.m_count >= kParallelBinningThreshold) {
+                    if (splitNode(task, centroids, true, nodeCounter, children)) {
+                        next.push_back(children[0]);
+                        next.push_back(children[1]);
+                    }
+                } else {
+                    smallTasks.push_back(task);
+                }
+            }
+
+            // 中規模の区間はノード単位で並列に分割
+            std::vector<BuildTask> split(smallTasks.size() * 2);
+            std::vector<char> didSplit(smallTasks.size(), 0);
+            ThreadPool::getInstance().parallelFor(smallTasks.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    didSplit[i] = splitNode(smallTasks[i], centroids, false, nodeCounter, &split[i * 2]) ? 1 : 0;
+                }
+            });
+            for (size_t i = 0; i < smallTasks.size(); ++i) {
+                if (didSplit[i]) {
+                    next.push_back(split[i * 2]);
+                    next.push_back(split[i * 2 + 1]);
+                }
+            }
+
+            pending.swap(next);
+        }
+
+        ThreadPool::getInstance().parallelFor(subtrees.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                buildSubtree(subtrees[i], centroids, nodeCounter);
+            }
+        });
+    }
+
+    m_nodes.resize(nodeCounter.load());
+}
+
+void SceneBVH::refit(const std::vector<BoundingBox>& objectBounds) {
+    if (objectBounds.size() != m_objectBounds.size()) {
+        // オブジェクト数が変わった場合は再構築
+        build(objectBounds);
+        return;
+    }
+    m_objectBounds = objectBounds;
+
+    // 子は常に親より後ろにあるので逆順に更新すれば子が先に確定する
+    for (size_t i = m_nodes.size(); i-- > 0;) {
+        BVHNode& node = m_nodes[i];
+        if (node.isLeaf()) {
+            computeNodeBounds(node);
+        } else {
+            const BVHNode& left = m_nodes[node.m_leftOrFirst];
+            const BVHNode& right = m_nodes[node.m_leftOrFirst + 1];
+            node.m_min = glm::min(left.m_min, right.m_min);
+            node.m_max = glm::max(left.m_max, right.m_max);
+        }
+    }
+}
+
+void SceneBVH::queryFrustum(const Frustum& frustum, std::vector<int>& objects) const {
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    // 完全に内側のノードは以降の平面判定を省略（スタックには ノード * 2 + 内側フラグ を積む）
+    std::vector<int> stack;
+    stack.reserve(kStackReserve);
+    stack.push_back(0);
+
+    while (!stack.empty()) {
+        const int entry = stack.back();
+        stack.pop_back();
+        const BVHNode& node = m_nodes[entry >> 1];
+        bool fullyInside = (entry & 1) != 0;
+
+        if (!fullyInside) {
+            int result = classifyFrustum(frustum, node.m_min, node.m_max);
+            if (result == 0) {
+                continue;
+            }
+            fullyInside = (result == 2);
+        }
+
+        if (node.isLeaf()) {
+            for (int i = 0; i < node.m_count; ++i) {
+                int object = m_objectIndices[node.m_leftOrFirst + i];
+                if (fullyInside || BoundingVolume::intersectsFrustum(m_objectBounds[object], frustum)) {
+                    objects.push_back(object);
+                }
+            }
+        } else {
+            stack.push_back(((node.m_leftOrFirst + 1) << 1) | (fullyInside ? 1 : 0));
+            stack.push_back((node.m_leftOrFirst << 1) | (fullyInside ? 1 : 0));
+        }
+    }
+}
+
+bool SceneBVH::raycast(const Ray& ray, float maxDistance, BVHRayHit& hit, const RayIntersector& intersector) const {
+    hit = BVHRayHit();
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    const glm::vec3 inverseDirection(1.0f / ray.m_direction.x, 1.0f / ray.m_direction.y, 1.0f / ray.m_direction.z);
+    float closest = maxDistance;
+    float entry;
+
+    if (!BoundingVolume::intersectRay(BoundingBox(m_nodes[0].m_min, m_nodes[0].m_max), ray.m_origin, inverseDirection, closest, entry)) {
+        return false;
+    }
+    std::vector<int> stack;
+    stack.reserve(kStackReserve);
+    stack.push_back(0);
+
+    while (!stack.empty()) {
+        const BVHNode& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.isLeaf()) {
+            for (int i = 0; i < node.m_count; ++i) {
+                const int object = m_objectIndices[node.m_leftOrFirst + i];
+                float distance;
+                if (!BoundingVolume::intersectRay(m_objectBounds[object], ray.m_origin, inverseDirection, closest, distance)) {
+                    continue;
+                }
+                if (intersector && !intersector(object, ray, closest, distance)) {
+                    continue;
+                }
+                if (distance <= closest) {
+                    closest = distance;
+                    hit.m_object = object;
+                    hit.m_distance = distance;
+                }
+            }
+            continue;
+        }
+
+        // 近い子を先に処理するため、遠い子を先にスタックへ積む
+        const int leftIndex = node.m_leftOrFirst;
+        const int rightIndex = leftIndex + 1;
+        float leftDistance, rightDistance;
+        const bool hitLeft = BoundingVolume::intersectRay(
+            BoundingBox(m_nodes[leftIndex].m_min, m_nodes[leftIndex].m_max), ray.m_origin, inverseDirection, closest, leftDistance);
+        const bool hitRight = BoundingVolume::intersectRay(
+            BoundingBox(m_nodes[rightIndex].m_min, m_nodes[rightIndex].m_max), ray.m_origin, inverseDirection, closest, rightDistance);
+
+        if (hitLeft && hitRight) {
+            if (leftDistance <= rightDistance) {
+                stack.push_back(rightIndex);
+                stack.push_back(leftIndex);
+            } else {
+                stack.push_back(leftIndex);
+                stack.push_back(rightIndex);
+            }
+        } else if (hitLeft) {
+            stack.push_back(leftIndex);
+        } else if (hitRight) {
+            stack.push_back(rightIndex);
+        }
+    }
+
+    return hit.m_object >= 0;
+}
+
+void SceneBVH::queryDistance(const glm::vec3& point, float radius, std::vector<int>& objects) const {
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    const float radiusSquared = radius * radius;
+    std::vector<int> stack;
+    stack.reserve(kStackReserve);
+    stack.push_back(0);
+
+    while (!stack.empty()) {
+        const BVHNode& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (BoundingVolume::distanceSquared(BoundingBox(node.m_min, node.m_max), point) > radiusSquared) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            for (int i = 0; i < node.m_count; ++i) {
+                const int object = m_objectIndices[node.m_leftOrFirst + i];
+                if (BoundingVolume::distanceSquared(m_objectBounds[object], point) <= radiusSquared) {
+                    objects.push_back(object);
+                }
+            }
+        } else {
+            stack.push_back(node.m_leftOrFirst + 1);
+            stack.push_back(node.m_leftOrFirst);
+        }
+    }
+}
+
+int SceneBVH::findNearest(const glm::vec3& point, float maxDistance, float& distance) const {
+    if (m_nodes.empty()) {
+        return -1;
+    }
+
+    float bestSquared = maxDistance * maxDistance;
+    int best = -1;
+
+    std::vector<int> stack;
+    stack.reserve(kStackReserve);
+    stack.push_back(0);
+
+    while (!stack.empty()) {
+        const BVHNode& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (BoundingVolume::distanceSquared(BoundingBox(node.m_min, node.m_max), point) > bestSquared) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            for (int i = 0; i < node.m_count; ++i) {
+                const int object = m_objectIndices[node.m_leftOrFirst + i];
+                float d = BoundingVolume::distanceSquared(m_objectBounds[object], point);
+                if (d <= bestSquared) {
+                    bestSquared = d;
+                    best = object;
+                }
+            }
+            continue;
+        }
+
+        // 近い子を先に処理して探索範囲を早く狭める
+        const int leftIndex = node.m_leftOrFirst;
+        const int rightIndex = leftIndex + 1;
+        const float leftDistance = BoundingVolume::distanceSquared(BoundingBox(m_nodes[leftIndex].m_min, m_nodes[leftIndex].m_max), point);
+        const float rightDistance = BoundingVolume::distanceSquared(BoundingBox(m_nodes[rightIndex].m_min, m_nodes[rightIndex].m_max), point);
+        if (leftDistance <= rightDistance) {
+            if (rightDistance <= bestSquared) stack.push_back(rightIndex);
+            if (leftDistance <= bestSquared) stack.push_back(leftIndex);
+        } else {
+            if (leftDistance <= bestSquared) stack.push_back(leftIndex);
+            if (rightDistance <= bestSquared) stack.push_back(rightIndex);
+        }
+    }
+
+    if (best >= 0) {
+        distance = std::sqrt(bestSquared);
+    }
+    return best;
+}
+
+int SceneBVH::getDepth() const {
+    if (m_nodes.empty()) {
+        return 0;
+    }
+
+    // 親は常に子より前にあるので前から深さを伝播できる
+    std::vector<int> depth(m_nodes.size(), 1);
+    int maxDepth = 1;
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        const BVHNode& node = m_nodes[i];
+        if (!node.isLeaf()) {
+            depth[node.m_leftOrFirst] = depth[i] + 1;
+            depth[node.m_leftOrFirst + 1] = depth[i] + 1;
+            maxDepth = std::max(maxDepth, depth[i] + 1);
+        }
+    }
+    return maxDepth;
+}
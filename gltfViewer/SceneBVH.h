@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include "BoundingVolume.h"
+#include <glm/glm.hpp>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <cstddef>
+
+// BVHノード（32バイト）
+// m_count > 0 の場合は葉で、m_leftOrFirst はオブジェクト番号配列の先頭
+// m_count == 0 の場合は内部ノードで、子は m_leftOrFirst と m_leftOrFirst + 1（常に親より後ろ）
+struct BVHNode {
+    glm::vec3 m_min;
+    int m_leftOrFirst;
+    glm::vec3 m_max;
+    int m_count;
+
+    bool isLeaf() const { return m_count > 0; }
+};
+
+// レイクエリの結果
+struct BVHRayHit {
+    int m_object;       // ヒットしたオブジェクト（-1 はヒットなし）
+    float m_distance;   // レイ上の距離
+
+    BVHRayHit() : m_object(-1), m_distance(0.0f) {}
+};
+
+// ワールド空間のオブジェクト（インスタンス × メッシュ）のAABBに対するBVH
+// 構築はビン分割SAHで、大きな区間はビン集計を、小さな区間はノード単位で並列化する
+class SceneBVH {
+public:
+    // 正確な交差判定（三角形など）。ヒットした場合は distance を更新して true を返す
+    typedef std::function<bool(int object, const Ray& ray, float maxDistance, float& distance)> RayIntersector;
+
+private:
+    std::vector<BVHNode> m_nodes;
+    std::vector<int> m_objectIndices;         // 葉が参照するオブジェクト番号（葉ごとに連続）
+    std::vector<BoundingBox> m_objectBounds;  // オブジェクトごとのAABB（refit で更新）
+    int m_maxLeafSize;
+
+    struct BuildTask {
+        int m_node;
+        int m_first;
+        int m_count;
+    };
+
+    // 区間を分割して子ノードを作成する（葉にした場合は false）
+    bool splitNode(const BuildTask& task, const std::vector<glm::vec3>& centroids, bool parallelBinning,
+        std::atomic<int>& nodeCounter, BuildTask children[2]);
+    void buildSubtree(const BuildTask& root, const std::vector<glm::vec3>& centroids, std::atomic<int>& nodeCounter);
+    void computeNodeBounds(BVHNode& node) const;
+
+public:
+    SceneBVH();
+
+    // オブジェクトのAABB配列からBVHを構築（無効なAABBのオブジェクトは含まれない）
+    void build(const std::vector<BoundingBox>& objectBounds, bool parallel = true);
+    void clear();
+
+    // 形状を保ったままAABBだけを更新（移動するノード用）
+    void refit(const std::vector<BoundingBox>& objectBounds);
+
+    // 視錐台と交差するオブジェクトを列挙
+    void queryFrustum(const Frustum& frustum, std::vector<int>& objects) const;
+
+    // レイと最初に交差するオブジェクト（intersector が無い場合はAABBとの交差で判定）
+    bool raycast(const Ray& ray, float maxDistance, BVHRayHit& hit, const RayIntersector& intersector = RayIntersector()) const;
+
+    // 点から radius 以内にあるオブジェクトを列挙
+    void queryDistance(const glm::vec3& point, float radius, std::vector<int>& objects) const;
+
+    // 点に最も近いオブジェクト（AABBまでの距離）。見つからなければ -1
+    int findNearest(const glm::vec3& point, float maxDistance, float& distance) const;
+
+    const std::vector<BVHNode>& getNodes() const { return m_nodes; }
+    const std::vector<int>& getObjectIndices() const { return m_objectIndices; }
+    size_t getNodeCount() const { return m_nodes.size(); }
+    size_t getObjectCount() const { return m_objectIndices.size(); }
+    bool isEmpty() const { return m_nodes.empty(); }
+    int getDepth() const;
+    void setMaxLeafSize(int size) { m_maxLeafSize = size > 0 ? size : 1; }
+};
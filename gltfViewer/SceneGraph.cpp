@@ -0,0 +1,288 @@
+﻿#include "SceneGraph.h"
+#include "SimdMath.h"
+#include <tiny_gltf.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <iostream>
+
+SceneGraph::SceneGraph()
+    : m_lastUpdatedCount(0)
+{
+}
+
+void SceneGraph::clear() {
+    m_parent.clear();
+    m_subtreeSize.clear();
+    m_gltfNode.clear();
+    m_mesh.clear();
+    m_translation.clear();
+    m_rotation.clear();
+    m_scale.clear();
+    m_useMatrix.clear();
+    m_localMatrix.clear();
+    m_worldMatrix.clear();
+    m_weightOffset.clear();
+    m_weightCount.clear();
+    m_weights.clear();
+    m_weightsDirty.clear();
+    m_dirtyWeightNodes.clear();
+    m_localDirty.clear();
+    m_dirtyNodes.clear();
+    m_nodeToIndex.clear();
+    m_lastUpdatedCount = 0;
+}
+
+bool SceneGraph::build(const tinygltf::Model& model, int sceneIndex) {
+    clear();
+
+    const int gltfNodeCount = static_cast<int>(model.nodes.size());
+    m_nodeToIndex.assign(gltfNodeCount, -1);
+
+    // ルートノードの決定
+    std::vector<int> roots;
+    if (!model.scenes.empty()) {
+        if (sceneIndex < 0 || sceneIndex >= static_cast<int>(model.scenes.size())) {
+            sceneIndex = (model.defaultScene >= 0 && model.defaultScene < static_cast<int>(model.scenes.size()))
+                ? model.defaultScene : 0;
+        }
+        roots = model.scenes[sceneIndex].nodes;
+    } else {
+        std::vector<uint8_t> hasParent(gltfNodeCount, 0);
+        for (const auto& node : model.nodes) {
+            for (int child : node.children) {
+                if (child >= 0 && child < gltfNodeCount) {
+                    hasParent[child] = 1;
+                }
+            }
+        }
+        for (int i = 0; i < gltfNodeCount; ++i) {
+            if (!hasParent[i]) {
+                roots.push_back(i);
+            }
+        }
+    }
+
+    // 明示的なスタックで前順に並べる（子は親の直後に連続して配置される）
+    std::vector<std::pair<int, int>> stack;  // (glTFノード, 親のシーングラフ内インデックス)
+    stack.reserve(64);
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it) {
+        stack.emplace_back(*it, -1);
+    }
+
+    m_parent.reserve(gltfNodeCount);
+    m_gltfNode.reserve(gltfNodeCount);
+
+    while (!stack.empty()) {
+        const int gltfIndex = stack.back().first;
+        const int parent = stack.back().second;
+        stack.pop_back();
+
+        if (gltfIndex < 0 || gltfIndex >= gltfNodeCount || m_nodeToIndex[gltfIndex] >= 0) {
+            // 不正なインデックス、または複数の親を持つ不正な階層
+            continue;
+        }
+
+        const int index = static_cast<int>(m_parent.size());
+        m_nodeToIndex[gltfIndex] = index;
+        m_parent.push_back(parent);
+        m_gltfNode.push_back(gltfIndex);
+
+        const auto& children = model.nodes[gltfIndex].children;
+        for (auto child = children.rbegin(); child != children.rend(); ++child) {
+            stack.emplace_back(*child, index);
+        }
+    }
+
+    const size_t count = m_parent.size();
+
+    // サブツリーサイズ（子は必ず親より後ろにあるので逆順に加算）
+    m_subtreeSize.assign(count, 1);
+    for (size_t i = count; i-- > 1;) {
+        if (m_parent[i] >= 0) {
+            m_subtreeSize[m_parent[i]] += m_subtreeSize[i];
+        }
+    }
+
+    // ローカル変換の読み込み
+    m_mesh.resize(count);
+    m_translation.assign(count, glm::vec3(0.0f));
+    m_rotation.assign(count, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    m_scale.assign(count, glm::vec3(1.0f));
+    m_useMatrix.assign(count, 0);
+    m_localMatrix.assign(count, glm::mat4(1.0f));
+    m_worldMatrix.assign(count, glm::mat4(1.0f));
+    m_localDirty.assign(count, 1);
+    m_weightOffset.assign(count, 0);
+    m_weightCount.assign(count, 0);
+    m_weightsDirty.assign(count, 0);
+
+    for (size_t i = 0; i < count; ++i) {
+        const tinygltf::Node& node = model.nodes[m_gltfNode[i]];
+        m_mesh[i] = node.mesh;
+
+        // モーフターゲットを持つメッシュのノードはウェイトを持つ（初回の評価のため変更扱いにする）
+        if (node.mesh >= 0 && node.mesh < static_cast<int>(model.meshes.size())) {
+            const tinygltf::Mesh& mesh = model.meshes[node.mesh];
+            const size_t targetCount = mesh.primitives.empty() ? 0 : mesh.primitives[0].targets.size();
+            if (targetCount > 0) {
+                const std::vector<double>& initial = node.weights.size() == targetCount ? node.weights : mesh.weights;
+                m_weightOffset[i] = static_cast<int>(m_weights.size());
+                m_weightCount[i] = static_cast<int>(targetCount);
+                for (size_t target = 0; target < targetCount; ++target) {
+                    m_weights.push_back(initial.size() == targetCount ? static_cast<float>(initial[target]) : 0.0f);
+                }
+                m_weightsDirty[i] = 1;
+                m_dirtyWeightNodes.push_back(static_cast<int>(i));
+            }
+        }
+
+        if (node.matrix.size() == 16) {
+            m_localMatrix[i] = glm::make_mat4(node.matrix.data());
+            m_useMatrix[i] = 1;
+            continue;
+        }
+        if (node.translation.size() == 3) {
+            m_translation[i] = glm::vec3(
+                static_cast<float>(node.translation[0]),
+                static_cast<float>(node.translation[1]),
+                static_cast<float>(node.translation[2]));
+        }
+        if (node.rotation.size() == 4) {
+            m_rotation[i] = glm::vec4(
+                static_cast<float>(node.rotation[0]),
+                static_cast<float>(node.rotation[1]),
+                static_cast<float>(node.rotation[2]),
+                static_cast<float>(node.rotation[3]));
+        }
+        if (node.scale.size() == 3) {
+            m_scale[i] = glm::vec3(
+                static_cast<float>(node.scale[0]),
+                static_cast<float>(node.scale[1]),
+                static_cast<float>(node.scale[2]));
+        }
+    }
+
+    // 初回は全ルートを変更扱いにして全ノードを計算
+    for (size_t i = 0; i < count; ++i) {
+        if (m_parent[i] < 0) {
+            m_dirtyNodes.push_back(static_cast<int>(i));
+        }
+    }
+    updateWorldTransforms();
+
+    std::cout << "  シーングラフ構築: " << count << " ノード (glTFノード数: " << gltfNodeCount
+        << ", ルート数: " << roots.size() << ")" << std::endl;
+    return true;
+}
+
+int SceneGraph::getIndexOfNode(int gltfNodeIndex) const {
+    if (gltfNodeIndex < 0 || gltfNodeIndex >= static_cast<int>(m_nodeToIndex.size())) {
+        return -1;
+    }
+    return m_nodeToIndex[gltfNodeIndex];
+}
+
+void SceneGraph::markDirty(int index) {
+    if (!m_localDirty[index]) {
+        m_localDirty[index] = 1;
+        m_dirtyNodes.push_back(index);
+    }
+}
+
+void SceneGraph::setTranslation(int index, const glm::vec3& translation) {
+    m_translation[index] = translation;
+    m_useMatrix[index] = 0;
+    markDirty(index);
+}
+
+void SceneGraph::setRotation(int index, const glm::vec4& rotationXYZW) {
+    m_rotation[index] = rotationXYZW;
+    m_useMatrix[index] = 0;
+    markDirty(index);
+}
+
+void SceneGraph::setScale(int index, const glm::vec3& scale) {
+    m_scale[index] = scale;
+    m_useMatrix[index] = 0;
+    markDirty(index);
+}
+
+void SceneGraph::setLocalMatrix(int index, const glm::mat4& matrix) {
+    m_localMatrix[index] = matrix;
+    m_useMatrix[index] = 1;
+    markDirty(index);
+}
+
+size_t SceneGraph::updateWorldTransforms() {
+    m_lastUpdatedCount = 0;
+    if (m_dirtyNodes.empty()) {
+        return 0;
+    }
+
+    // 変更ノードを昇順に処理し、既に処理したサブツリー区間に含まれるものは飛ばす
+    std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end());
+
+    int coveredEnd = 0;
+    for (int dirty : m_dirtyNodes) {
+        if (dirty < coveredEnd) {
+            continue;
+        }
+
+        const int end = dirty + m_subtreeSize[dirty];
+        for (int i = dirty; i < end; ++i) {
+            if (m_localDirty[i]) {
+                if (!m_useMatrix[i]) {
+                    SimdMath::composeTRS(
+                        &m_translation[i].x, &m_rotation[i].x, &m_scale[i].x,
+                        glm::value_ptr(m_localMatrix[i]));
+                }
+                m_localDirty[i] = 0;
+            }
+
+            const int parent = m_parent[i];
+            if (parent < 0) {
+                m_worldMatrix[i] = m_localMatrix[i];
+            } else {
+                SimdMath::multiplyMatrix4(
+                    glm::value_ptr(m_worldMatrix[parent]),
+                    glm::value_ptr(m_localMatrix[i]),
+                    glm::value_ptr(m_worldMatrix[i]));
+            }
+        }
+
+        m_lastUpdatedCount += static_cast<size_t>(end - dirty);
+        coveredEnd = end;
+    }
+
+    m_dirtyNodes.clear();
+    return m_lastUpdatedCount;
+}
+
+void SceneGraph::setMorphWeights(int index, int firstTarget, const float* weights, int count) {
+    const int end = std::min(firstTarget + count, m_weightCount[index]);
+    if (firstTarget < 0 || firstTarget >= end) {
+        return;
+    }
+
+    float* destination = m_weights.data() + m_weightOffset[index];
+    bool changed = false;
+    for (int target = firstTarget; target < end; ++target) {
+        if (destination[target] != weights[target - firstTarget]) {
+            destination[target] = weights[target - firstTarget];
+            changed = true;
+        }
+    }
+
+    // 値が変わらない場合は頂点の再計算を避けるため変更扱いにしない
+    if (changed && !m_weightsDirty[index]) {
+        m_weightsDirty[index] = 1;
+        m_dirtyWeightNodes.push_back(index);
+    }
+}
+
+void SceneGraph::clearDirtyMorphWeights() {
+    for (int index : m_dirtyWeightNodes) {
+        m_weightsDirty[index] = 0;
+    }
+    m_dirtyWeightNodes.clear();
+}
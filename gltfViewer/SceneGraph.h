@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace tinygltf {
+    class Model;
+}
+
+// glTFノード階層をフラットなSoA配列として保持するシーングラフ
+//
+// ノードは深さ優先の前順（pre-order）で並べ替えて格納するため、
+//   - 親のインデックスは常に子より小さい（トポロジカル順）
+//   - 各ノードのサブツリーは [i, i + subtreeSize) の連続区間になる
+// ワールド行列の更新は変更（dirty）されたノードのサブツリー区間だけを線形に処理し、
+// 再帰を使わないため100万ノード規模の階層でもスタックを消費しない
+class SceneGraph {
+private:
+    // === SoA配列（インデックスはシーングラフ内の順序） ===
+    std::vector<int> m_parent;              // 親ノード（ルートは -1）
+    std::vector<int> m_subtreeSize;         // 自身を含むサブツリーのノード数
+    std::vector<int> m_gltfNode;            // 元のglTFノードインデックス
+    std::vector<int> m_mesh;                // 参照するメッシュ（無ければ -1）
+
+    std::vector<glm::vec3> m_translation;   // ローカル平行移動
+    std::vector<glm::vec4> m_rotation;      // ローカル回転（クォータニオン x, y, z, w）
+    std::vector<glm::vec3> m_scale;         // ローカルスケール
+    std::vector<uint8_t> m_useMatrix;       // glTFの matrix 指定ノード（TRSを使わない）
+
+    std::vector<glm::mat4> m_localMatrix;
+    std::vector<glm::mat4> m_worldMatrix;
+
+    // モーフターゲットのウェイト（メッシュのターゲット数だけノードごとに持つフラット配列）
+    std::vector<int> m_weightOffset;
+    std::vector<int> m_weightCount;
+    std::vector<float> m_weights;
+    std::vector<uint8_t> m_weightsDirty;
+    std::vector<int> m_dirtyWeightNodes;    // ウェイトが変更されたノード
+
+    // 変更追跡
+    std::vector<uint8_t> m_localDirty;
+    std::vector<int> m_dirtyNodes;          // ローカル変換が変更されたノード
+
+    // glTFノードインデックス → シーングラフ内インデックス（シーンに含まれない場合は -1）
+    std::vector<int> m_nodeToIndex;
+
+    // 直近の更新で再計算した行列数
+    size_t m_lastUpdatedCount;
+
+    void markDirty(int index);
+
+public:
+    SceneGraph();
+
+    // glTFモデルのシーンからシーングラフを構築
+    // sceneIndex が負の場合はデフォルトシーン（無ければ先頭シーン、シーンが無ければ親を持たない全ノード）
+    bool build(const tinygltf::Model& model, int sceneIndex = -1);
+
+    void clear();
+
+    // 変更されたサブツリーのワールド行列だけを再計算し、再計算した行列数を返す
+    size_t updateWorldTransforms();
+
+    // === ノード数・インデックス変換 ===
+    size_t getNodeCount() const { return m_parent.size(); }
+    int getIndexOfNode(int gltfNodeIndex) const;
+    int getGLTFNode(int index) const { return m_gltfNode[index]; }
+    int getParent(int index) const { return m_parent[index]; }
+    int getSubtreeSize(int index) const { return m_subtreeSize[index]; }
+    int getMesh(int index) const { return m_mesh[index]; }
+
+    // === ローカル変換の設定（ワールド行列は次回の updateWorldTransforms で更新） ===
+    void setTranslation(int index, const glm::vec3& translation);
+    void setRotation(int index, const glm::vec4& rotationXYZW);
+    void setScale(int index, const glm::vec3& scale);
+    void setLocalMatrix(int index, const glm::mat4& matrix);
+
+    const glm::vec3& getTranslation(int index) const { return m_translation[index]; }
+    const glm::vec4& getRotation(int index) const { return m_rotation[index]; }
+    const glm::vec3& getScale(int index) const { return m_scale[index]; }
+
+    // === ワールド行列 ===
+    const glm::mat4& getWorldMatrix(int index) const { return m_worldMatrix[index]; }
+    const std::vector<glm::mat4>& getWorldMatrices() const { return m_worldMatrix; }
+
+    // === モーフターゲットのウェイト（初期値は node.weights、無ければ mesh.weights） ===
+    int getMorphWeightCount(int index) const { return m_weightCount[index]; }
+    const float* getMorphWeights(int index) const { return m_weights.data() + m_weightOffset[index]; }
+    void setMorphWeights(int index, int firstTarget, const float* weights, int count);
+    const std::vector<int>& getDirtyMorphWeightNodes() const { return m_dirtyWeightNodes; }
+    void clearDirtyMorphWeights();
+
+    bool hasPendingChanges() const { return !m_dirtyNodes.empty(); }
+    size_t getLastUpdatedCount() const { return m_lastUpdatedCount; }
+};
@@ -1,11 +1,75 @@
 ﻿#include "ShaderManager.h"
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    // Uniform の並びと同じ順のuniform名
+    const char* const kUniformNames[] = {
+        "u_model",
+        "u_view",
+        "u_projection",
+        "u_mvp",
+        "u_color",
+        "u_materialColor",
+        "u_materialIndex",
+        "u_drawOffset",
+        "u_jointPalette",
+        "u_baseColorTexture"
+    };
+    static_assert(sizeof(kUniformNames) / sizeof(kUniformNames[0]) == static_cast<size_t>(Uniform::Count),
+        "kUniformNames と Uniform の要素数が一致しません");
+
+    // インクルードの入れ子の上限（循環したインクルードで止まらなくなるのを防ぐ）
+    const int kMaxIncludeDepth = 8;
+
+    bool readSourceFile(const std::string& path, std::string& source, std::vector<std::string>* dependencies, int depth) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            std::cerr << "シェーダーファイルが開けません: " << path << std::endl;
+            return false;
+        }
+        if (dependencies) {
+            dependencies->push_back(path);
+        }
+
+        const size_t separator = path.find_last_of("/\\");
+        const std::string directory = separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+
+        std::string line;
+        bool firstLine = true;
+        while (std::getline(file, line)) {
+            // Windows のエディターが付けるUTF-8のBOMは #version より前に置けないので除く
+            if (firstLine && line.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+                line.erase(0, 3);
+            }
+            firstLine = false;
+
+            const size_t directive = line.find_first_not_of(" \t");
+            if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0) {
+                const size_t nameStart = line.find('"', directive);
+                const size_t nameEnd = nameStart == std::string::npos ? std::string::npos : line.find('"', nameStart + 1);
+                if (nameEnd == std::string::npos || depth >= kMaxIncludeDepth) {
+                    std::cerr << "シェーダーファイルの #include を解決できません: " << path << ": " << line << std::endl;
+                    return false;
+                }
+                if (!readSourceFile(directory + line.substr(nameStart + 1, nameEnd - nameStart - 1), source, dependencies, depth + 1)) {
+                    return false;
+                }
+                continue;
+            }
+            source += line;
+            source += '\n';
+        }
+        return true;
+    }
+}
 
 ShaderManager::ShaderManager() 
-    : m_programID(0), m_isCompiled(false) {
+    : m_programID(0), m_isCompiled(false), m_binaryRetrievable(false), m_compileTimeMs(0.0), m_linkTimeMs(0.0) {
+    std::fill(m_uniformSlots, m_uniformSlots + static_cast<int>(Uniform::Count), -1);
 }
 
 ShaderManager::~ShaderManager() {
@@ -46,6 +110,9 @@ bool ShaderManager::linkProgram(GLuint vertexShader, GLuint fragmentShader) {
 
     glAttachShader(m_programID, vertexShader);
     glAttachShader(m_programID, fragmentShader);
+    if (m_binaryRetrievable) {
+        glProgramParameteri(m_programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(m_programID);
 
     checkLinkErrors(m_programID);
@@ -104,7 +171,8 @@ GLint ShaderManager::getUniformLocation(const std::string& name) {
 bool ShaderManager::createShader(const std::string& vertexSource, const std::string& fragmentSource) {
     cleanup(); // 既存のシェーダーをクリーンアップ
 
-    // 頂点シェーダーをコンパイル
+    // 頂点シェーダーをコンパイル（コンパイル・リンクの時間はステータスの取得まで含めて測る）
+    auto startTime = std::chrono::high_resolution_clock::now();
     GLuint vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER);
     if (vertexShader == 0) {
         std::cerr << "頂点シェーダーのコンパイルに失敗しました" << std::endl;
@@ -120,40 +188,112 @@ bool ShaderManager::createShader(const std::string& vertexSource, const std::str
     }
 
     // プログラムをリンク
+    auto linkTime = std::chrono::high_resolution_clock::now();
+    m_compileTimeMs = std::chrono::duration<double, std::milli>(linkTime - startTime).count();
     if (!linkProgram(vertexShader, fragmentShader)) {
         std::cerr << "シェーダープログラムのリンクに失敗しました" << std::endl;
         return false;
     }
+    m_linkTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - linkTime).count();
 
     m_isCompiled = true;
-    std::cout << "シェーダーが正常にコンパイル・リンクされました (Program ID: " << m_programID << ")" << std::endl;
+    resolveUniformSlots();
+    std::cout << "シェーダーが正常にコンパイル・リンクされました (Program ID: " << m_programID
+        << ", コンパイル " << m_compileTimeMs << " ms, リンク " << m_linkTimeMs << " ms)" << std::endl;
     return true;
 }
 
-bool ShaderManager::createShaderFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
-    // ファイルから頂点シェーダーを読み込み
-    std::ifstream vertexFile(vertexPath);
-    if (!vertexFile.is_open()) {
-        std::cerr << "頂点シェーダーファイルが開けません: " << vertexPath << std::endl;
+// glGetProgramBinary で取得したバイナリからプログラムを作成（失敗してもエラーは出さず、呼び出し側でコンパイルし直す）
+bool ShaderManager::createFromBinary(GLenum format, const void* binary, GLsizei length) {
+    cleanup();
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    m_programID = glCreateProgram();
+    if (m_programID == 0) {
+        return false;
+    }
+    glProgramBinary(m_programID, format, binary, length);
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(m_programID, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(m_programID);
+        m_programID = 0;
+        return false;
+    }
+    m_compileTimeMs = 0.0;
+    m_linkTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    m_isCompiled = true;
+    resolveUniformSlots();
+    return true;
+}
+
+void ShaderManager::adoptProgram(GLuint programID) {
+    cleanup();
+    m_programID = programID;
+    m_isCompiled = programID != 0;
+    m_compileTimeMs = 0.0;
+    m_linkTimeMs = 0.0;
+    if (m_isCompiled) {
+        resolveUniformSlots();
+    }
+}
+
+bool ShaderManager::getProgramBinary(GLenum& format, std::vector<unsigned char>& binary) const {
+    if (!isValid()) {
+        return false;
+    }
+    GLint length = 0;
+    glGetProgramiv(m_programID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
         return false;
     }
-    std::stringstream vertexStream;
-    vertexStream << vertexFile.rdbuf();
-    std::string vertexSource = vertexStream.str();
+    binary.resize(static_cast<size_t>(length));
+    GLsizei written = 0;
+    glGetProgramBinary(m_programID, length, &written, &format, binary.data());
+    binary.resize(static_cast<size_t>(written));
+    return written > 0;
+}
+
+// インターフェースの全uniformの位置をリンク直後に解決（シェーダーに無いものは -1）
+void ShaderManager::resolveUniformSlots() {
+    for (int i = 0; i < static_cast<int>(Uniform::Count); ++i) {
+        m_uniformSlots[i] = glGetUniformLocation(m_programID, kUniformNames[i]);
+    }
+}
+
+const char* ShaderManager::getUniformName(Uniform uniform) {
+    return kUniformNames[static_cast<int>(uniform)];
+}
+
+UniformHandle ShaderManager::getUniformHandle(const std::string& name) const {
+    if (m_programID == 0) {
+        return UniformHandle();
+    }
+    const GLint location = glGetUniformLocation(m_programID, name.c_str());
+    if (location == -1) {
+        std::cerr << "警告: Uniform変数 '" << name << "' が見つかりません" << std::endl;
+    }
+    return UniformHandle(location);
+}
 
-    // ファイルからフラグメントシェーダーを読み込み
-    std::ifstream fragmentFile(fragmentPath);
-    if (!fragmentFile.is_open()) {
-        std::cerr << "フラグメントシェーダーファイルが開けません: " << fragmentPath << std::endl;
+bool ShaderManager::createShaderFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
+    // ファイルから頂点シェーダー・フラグメントシェーダーを読み込み
+    std::string vertexSource;
+    std::string fragmentSource;
+    if (!loadSourceFile(vertexPath, vertexSource) || !loadSourceFile(fragmentPath, fragmentSource)) {
         return false;
     }
-    std::stringstream fragmentStream;
-    fragmentStream << fragmentFile.rdbuf();
-    std::string fragmentSource = fragmentStream.str();
 
     return createShader(vertexSource, fragmentSource);
 }
 
+bool ShaderManager::loadSourceFile(const std::string& path, std::string& source, std::vector<std::string>* dependencies) {
+    source.clear();
+    return readSourceFile(path, source, dependencies, 0);
+}
+
 void ShaderManager::use() {
     if (m_isCompiled && m_programID != 0) {
         glUseProgram(m_programID);
@@ -225,25 +365,25 @@ void ShaderManager::setUniform(const std::string& name, bool value) {
 
 // ? MVP行列設定用の便利関数 - Phase 4.3で重要
 void ShaderManager::setMVPMatrices(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) {
-    setUniform("u_model", model);
-    setUniform("u_view", view);
-    setUniform("u_projection", projection);
+    setUniform(Uniform::Model, model);
+    setUniform(Uniform::View, view);
+    setUniform(Uniform::Projection, projection);
 
     // MVP行列の積も計算して設定（パフォーマンス最適化）
     glm::mat4 mvp = projection * view * model;
-    setUniform("u_mvp", mvp);
+    setUniform(Uniform::MVP, mvp);
 }
 
 void ShaderManager::setModelMatrix(const glm::mat4& model) {
-    setUniform("u_model", model);
+    setUniform(Uniform::Model, model);
 }
 
 void ShaderManager::setViewMatrix(const glm::mat4& view) {
-    setUniform("u_view", view);
+    setUniform(Uniform::View, view);
 }
 
 void ShaderManager::setProjectionMatrix(const glm::mat4& projection) {
-    setUniform("u_projection", projection);
+    setUniform(Uniform::Projection, projection);
 }
 
 void ShaderManager::cleanup() {
@@ -252,6 +392,7 @@ void ShaderManager::cleanup() {
         m_programID = 0;
     }
     m_uniformLocations.clear();
+    std::fill(m_uniformSlots, m_uniformSlots + static_cast<int>(Uniform::Count), -1);
     m_isCompiled = false;
 }
 
@@ -366,4 +507,14 @@ void main() {
     FragColor = vec4(u_materialColor * v_color, 1.0);
 }
 )";
-}
\ No newline at end of file
+}
+
+// 先頭の #version 行を prelude（#version・#extension・#define）で置き換える
+std::string ShaderManager::applyPrelude(const std::string& source, const std::string& prelude) {
+    const size_t versionStart = source.find("#version");
+    if (versionStart == std::string::npos) {
+        return prelude + source;
+    }
+    const size_t versionEnd = source.find('\n', versionStart);
+    return source.substr(0, versionStart) + prelude + (versionEnd == std::string::npos ? std::string() : source.substr(versionEnd + 1));
+}
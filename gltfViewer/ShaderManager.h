@@ -5,12 +5,55 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+// シェーダーインターフェース（このアプリのシェーダーが使うuniformの一覧）
+// リンク直後に全スロットの位置を解決しておき、設定は配列の参照と glUniform だけで行う
+// （名前は ShaderManager::getUniformName、シェーダーに無いuniformの位置は -1 で設定しても何もしない）
+enum class Uniform : int {
+    Model = 0,        // u_model
+    View,             // u_view
+    Projection,       // u_projection
+    MVP,              // u_mvp
+    Color,            // u_color
+    MaterialColor,    // u_materialColor
+    MaterialIndex,    // u_materialIndex
+    DrawOffset,       // u_drawOffset
+    JointPalette,     // u_jointPalette
+    BaseColorTexture, // u_baseColorTexture
+    Count
+};
+
+// インターフェース外のuniformを名前で一度だけ解決したもの
+struct UniformHandle {
+    GLint m_location;
+
+    UniformHandle() : m_location(-1) {}
+    explicit UniformHandle(GLint location) : m_location(location) {}
+    bool isValid() const { return m_location != -1; }
+};
 
 class ShaderManager {
 private:
     GLuint m_programID;
     std::unordered_map<std::string, GLint> m_uniformLocations;
+    GLint m_uniformSlots[static_cast<int>(Uniform::Count)];
     bool m_isCompiled;
+    bool m_binaryRetrievable;   // リンク時に GL_PROGRAM_BINARY_RETRIEVABLE_HINT を指定するか
+    double m_compileTimeMs;     // 直近の createShader() のコンパイル時間（頂点 + フラグメント）
+    double m_linkTimeMs;
+
+    void resolveUniformSlots();
+
+    // 位置を指定したuniformの設定（位置 -1 は glUniform が無視する）
+    static void uploadUniform(GLint location, const glm::mat4& matrix) { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix)); }
+    static void uploadUniform(GLint location, const glm::mat3& matrix) { glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(matrix)); }
+    static void uploadUniform(GLint location, const glm::vec4& vector) { glUniform4fv(location, 1, glm::value_ptr(vector)); }
+    static void uploadUniform(GLint location, const glm::vec3& vector) { glUniform3fv(location, 1, glm::value_ptr(vector)); }
+    static void uploadUniform(GLint location, const glm::vec2& vector) { glUniform2fv(location, 1, glm::value_ptr(vector)); }
+    static void uploadUniform(GLint location, float value) { glUniform1f(location, value); }
+    static void uploadUniform(GLint location, int value) { glUniform1i(location, value); }
+    static void uploadUniform(GLint location, bool value) { glUniform1i(location, value ? 1 : 0); }
 
     // シェーダーコンパイル用の内部関数
     GLuint compileShader(const std::string& source, GLenum shaderType);
@@ -29,6 +72,14 @@ public:
     bool createShader(const std::string& vertexSource, const std::string& fragmentSource);
     bool createShaderFromFiles(const std::string& vertexPath, const std::string& fragmentPath);
 
+    // プログラムバイナリ（ProgramBinaryCache で保存・読み込み）
+    void setBinaryRetrievable(bool retrievable) { m_binaryRetrievable = retrievable; }
+    bool createFromBinary(GLenum format, const void* binary, GLsizei length);
+
+    // 別の場所（AsyncShaderCompiler）でリンクしたプログラムを引き取る（以前のプログラムは削除）
+    void adoptProgram(GLuint programID);
+    bool getProgramBinary(GLenum& format, std::vector<unsigned char>& binary) const;
+
     // シェーダーの使用開始・終了
     void use();
     void unuse();
@@ -43,6 +94,17 @@ public:
     void setUniform(const std::string& name, int value);
     void setUniform(const std::string& name, bool value);
 
+    // 型付きハンドルによるUniform変数設定（文字列の検索をせず、配列の参照と glUniform だけで設定）
+    template <typename T>
+    void setUniform(Uniform uniform, const T& value) { uploadUniform(m_uniformSlots[static_cast<int>(uniform)], value); }
+    template <typename T>
+    void setUniform(UniformHandle handle, const T& value) { uploadUniform(handle.m_location, value); }
+
+    // インターフェース外のuniformのハンドル（リンク後に一度だけ呼んで保持する）
+    UniformHandle getUniformHandle(const std::string& name) const;
+    GLint getUniformLocation(Uniform uniform) const { return m_uniformSlots[static_cast<int>(uniform)]; }
+    static const char* getUniformName(Uniform uniform);
+
     // MVP行列設定用の便利関数 (Phase 4.3で重要)
     void setMVPMatrices(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection);
     void setModelMatrix(const glm::mat4& model);
@@ -52,6 +114,8 @@ public:
     // 状態取得
     bool isValid() const { return m_isCompiled && m_programID != 0; }
     GLuint getProgramID() const { return m_programID; }
+    double getCompileTimeMs() const { return m_compileTimeMs; }
+    double getLinkTimeMs() const { return m_linkTimeMs; }
 
     // リソース管理
     void cleanup();
@@ -65,4 +129,11 @@ public:
     static std::string getBasicFragmentShader();
     static std::string getColoredVertexShader();
     static std::string getColoredFragmentShader();
+
+    // シェーダーファイルの読み込み（#include "ファイル名" は同じディレクトリからの相対パスで展開）
+    // dependencies には読み込んだ全ファイル（インクルードを含む）を追加する
+    static bool loadSourceFile(const std::string& path, std::string& source, std::vector<std::string>* dependencies = nullptr);
+
+    // 先頭の #version 行を置き換える（マテリアルテーブルの方式に応じた #version・#define の指定に使う）
+    static std::string applyPrelude(const std::string& source, const std::string& prelude);
 };
\ No newline at end of file
@@ -0,0 +1,217 @@
+﻿#include "ShaderPermutations.h"
+#include "ProgramBinaryCache.h"
+#include "AsyncShaderCompiler.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+    // ShaderFeature のビット順の #define 名
+    const char* const kFeatureDefines[] = {
+        "SKINNING",
+        "ALPHA_MASK",
+        "BASE_COLOR_TEXTURE"
+    };
+    static_assert(sizeof(kFeatureDefines) / sizeof(kFeatureDefines[0]) == ShaderFeature::kCount,
+        "kFeatureDefines と ShaderFeature の要素数が一致しません");
+}
+
+ShaderPermutations::ShaderPermutations()
+    : m_cache(nullptr)
+    , m_compiler(nullptr)
+{
+}
+
+void ShaderPermutations::initialize(const std::string& vertexSource, const std::string& fragmentSource,
+    const std::string& vertexPrelude, const std::string& fragmentPrelude,
+    const ProgramBinaryCache* cache, AsyncShaderCompiler* compiler, const SetupFunction& setup)
+{
+    cleanup();
+    m_vertexSource = vertexSource;
+    m_fragmentSource = fragmentSource;
+    m_vertexPrelude = vertexPrelude;
+    m_fragmentPrelude = fragmentPrelude;
+    m_cache = cache;
+    m_compiler = compiler;
+    m_setup = setup;
+}
+
+void ShaderPermutations::cleanup() {
+    for (Variant& variant : m_variants) {
+        if (variant.m_job && m_compiler) {
+            m_compiler->release(variant.m_job);
+        }
+        variant.m_shader->cleanup();
+    }
+    m_variants.clear();
+    m_variantIndices.clear();
+    m_stats = ShaderBuildStats();
+}
+
+bool ShaderPermutations::isCacheEnabled() const {
+    return m_cache && m_cache->isEnabled();
+}
+
+// キャッシュのキーは機能の #define を含めた最終的なソース全体のハッシュ（テンプレートや環境の変更も区別する）
+void ShaderPermutations::getVariantSources(ShaderFeatures features, std::string& vertexSource, std::string& fragmentSource, uint64_t& sourceHash) const {
+    const std::string defines = getDefines(features);
+    vertexSource = ShaderManager::applyPrelude(m_vertexSource, m_vertexPrelude + defines);
+    fragmentSource = ShaderManager::applyPrelude(m_fragmentSource, m_fragmentPrelude + defines);
+    sourceHash = ProgramBinaryCache::hash(fragmentSource, ProgramBinaryCache::hash(vertexSource));
+}
+
+int ShaderPermutations::getVariant(ShaderFeatures features) {
+    auto it = m_variantIndices.find(features);
+    if (it != m_variantIndices.end()) {
+        return it->second;
+    }
+
+    Variant variant;
+    variant.m_features = features;
+    variant.m_shader = std::make_unique<ShaderManager>();
+    variant.m_jobSourceHash = 0;
+    if (!buildVariant(variant, true)) {
+        std::cerr << "エラー: シェーダーのバリアント [" << getFeatureNames(features) << "] を作成できません" << std::endl;
+        ++m_stats.m_failedPrograms;
+        m_variantIndices[features] = -1;
+        return -1;
+    }
+
+    const int index = static_cast<int>(m_variants.size());
+    m_variants.push_back(std::move(variant));
+    m_variantIndices[features] = index;
+    return index;
+}
+
+// キャッシュにあれば読み込み、無ければコンパイラーに要求する（コンパイラーが無い場合はここでコンパイル）
+// 以前のプログラムは新しいプログラムができるまで残す
+bool ShaderPermutations::buildVariant(Variant& variant, bool useCache) {
+    std::string vertexSource;
+    std::string fragmentSource;
+    uint64_t sourceHash = 0;
+    getVariantSources(variant.m_features, vertexSource, fragmentSource, sourceHash);
+
+    if (useCache && isCacheEnabled()) {
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        if (m_cache->load(sourceHash, *variant.m_shader)) {
+            const double loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+            m_stats.m_cacheLoadTimeMs += loadTimeMs;
+            ++m_stats.m_cachedPrograms;
+            std::cout << "  シェーダー [" << getFeatureNames(variant.m_features) << "]: キャッシュから読み込み (" << loadTimeMs << " ms)" << std::endl;
+            if (m_setup) {
+                m_setup(*variant.m_shader);
+            }
+            return true;
+        }
+    }
+
+    if (m_compiler) {
+        if (variant.m_job) {
+            m_compiler->release(variant.m_job);
+            --m_stats.m_pendingPrograms;
+        }
+        variant.m_job = m_compiler->submit(vertexSource, fragmentSource, isCacheEnabled());
+        variant.m_jobSourceHash = sourceHash;
+        ++m_stats.m_pendingPrograms;
+        // 同期モードのコンパイラーは submit() の中で完了している
+        collectJob(variant);
+        return true;
+    }
+
+    // 失敗した場合に以前のプログラムを残すよう、新しい ShaderManager でコンパイルしてから差し替える
+    auto shader = std::make_unique<ShaderManager>();
+    shader->setBinaryRetrievable(isCacheEnabled());
+    if (!shader->createShader(vertexSource, fragmentSource)) {
+        return false;
+    }
+    m_stats.m_compileTimeMs += shader->getCompileTimeMs();
+    m_stats.m_linkTimeMs += shader->getLinkTimeMs();
+    ++m_stats.m_compiledPrograms;
+    std::cout << "  シェーダー [" << getFeatureNames(variant.m_features) << "]: コンパイル " << shader->getCompileTimeMs()
+        << " ms, リンク " << shader->getLinkTimeMs() << " ms" << std::endl;
+    if (isCacheEnabled() && !m_cache->store(sourceHash, *shader)) {
+        std::cerr << "警告: シェーダー [" << getFeatureNames(variant.m_features) << "] のバイナリを保存できませんでした" << std::endl;
+    }
+
+    if (m_setup) {
+        m_setup(*shader);
+    }
+    if (variant.m_shader) {
+        variant.m_shader->cleanup();
+    }
+    variant.m_shader = std::move(shader);
+    return true;
+}
+
+// 完了した要求のプログラムをバリアントに引き取る（失敗した場合は以前のプログラムのまま）
+bool ShaderPermutations::collectJob(Variant& variant) {
+    if (!variant.m_job || variant.m_job->m_state == ShaderCompileJob::State::Pending) {
+        return false;
+    }
+    std::shared_ptr<ShaderCompileJob> job = std::move(variant.m_job);
+    variant.m_job.reset();
+    --m_stats.m_pendingPrograms;
+
+    const std::string names = getFeatureNames(variant.m_features);
+    if (job->m_state == ShaderCompileJob::State::Failed) {
+        std::cerr << "エラー: シェーダー [" << names << "] のコンパイルに失敗しました"
+            << (variant.m_shader->isValid() ? "（以前のプログラムで描画を続けます）" : "") << "\n" << job->m_log << std::endl;
+        ++m_stats.m_failedPrograms;
+        return false;
+    }
+
+    variant.m_shader->adoptProgram(job->m_program);
+    job->m_program = 0;
+    m_stats.m_asyncBuildTimeMs += job->m_timeMs;
+    ++m_stats.m_compiledPrograms;
+    std::cout << "  シェーダー [" << names << "]: コンパイル・リンク完了 (" << job->m_timeMs << " ms)" << std::endl;
+    if (isCacheEnabled() && !m_cache->store(variant.m_jobSourceHash, *variant.m_shader)) {
+        std::cerr << "警告: シェーダー [" << names << "] のバイナリを保存できませんでした" << std::endl;
+    }
+
+    if (m_setup) {
+        m_setup(*variant.m_shader);
+    }
+    return true;
+}
+
+size_t ShaderPermutations::update() {
+    size_t swapped = 0;
+    for (Variant& variant : m_variants) {
+        if (collectJob(variant)) {
+            ++swapped;
+        }
+    }
+    return swapped;
+}
+
+void ShaderPermutations::reloadSources(const std::string& vertexSource, const std::string& fragmentSource) {
+    m_vertexSource = vertexSource;
+    m_fragmentSource = fragmentSource;
+    for (Variant& variant : m_variants) {
+        if (!buildVariant(variant, false)) {
+            std::cerr << "エラー: シェーダー [" << getFeatureNames(variant.m_features) << "] を再読み込みできません"
+                << (variant.m_shader->isValid() ? "（以前のプログラムで描画を続けます）" : "") << std::endl;
+            ++m_stats.m_failedPrograms;
+        }
+    }
+}
+
+std::string ShaderPermutations::getDefines(ShaderFeatures features) {
+    std::string defines;
+    for (int bit = 0; bit < ShaderFeature::kCount; ++bit) {
+        if (features & (1u << bit)) {
+            defines += std::string("#define ") + kFeatureDefines[bit] + "\n";
+        }
+    }
+    return defines;
+}
+
+std::string ShaderPermutations::getFeatureNames(ShaderFeatures features) {
+    std::string names;
+    for (int bit = 0; bit < ShaderFeature::kCount; ++bit) {
+        if (features & (1u << bit)) {
+            names += (names.empty() ? "" : "+") + std::string(kFeatureDefines[bit]);
+        }
+    }
+    return names.empty() ? "BASE" : names;
+}
@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include "ShaderManager.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ProgramBinaryCache;
+class AsyncShaderCompiler;
+struct ShaderCompileJob;
+
+// シェーダーの機能の組（ビットごとに #define を1つ追加する）
+typedef uint32_t ShaderFeatures;
+
+namespace ShaderFeature {
+    enum : uint32_t {
+        Skinning = 1u << 0,    // SKINNING: JOINTS_0 / WEIGHTS_0 と関節パレットで変形
+        AlphaMask = 1u << 1,   // ALPHA_MASK: alphaMode が MASK のマテリアル（alphaCutoff 未満を破棄）
+        BaseColorTexture = 1u << 2,   // BASE_COLOR_TEXTURE: TEXCOORD_0 でベースカラーテクスチャを掛ける
+    };
+    const int kCount = 3;
+}
+
+// バリアントの作成にかかった時間と件数
+struct ShaderBuildStats {
+    size_t m_compiledPrograms;    // ソースからコンパイル・リンクした数
+    size_t m_cachedPrograms;      // プログラムバイナリのキャッシュから読み込んだ数
+    size_t m_failedPrograms;
+    size_t m_pendingPrograms;     // バックグラウンドでコンパイル中の数
+    double m_compileTimeMs;
+    double m_linkTimeMs;
+    double m_asyncBuildTimeMs;    // バックグラウンドのコンパイル・リンク（要求から完了まで。描画スレッドは待たない）
+    double m_cacheLoadTimeMs;     // キャッシュの読み込み（ファイル + glProgramBinary）
+
+    ShaderBuildStats()
+        : m_compiledPrograms(0), m_cachedPrograms(0), m_failedPrograms(0), m_pendingPrograms(0)
+        , m_compileTimeMs(0.0), m_linkTimeMs(0.0), m_asyncBuildTimeMs(0.0), m_cacheLoadTimeMs(0.0) {}
+};
+
+// 1組の頂点・フラグメントシェーダーのソースから、機能の組ごとのバリアントを必要になった時点で作成する
+// 各バリアントは先頭の prelude（#version・#extension・環境の #define）に機能の #define を加えたソースで、
+// キャッシュがあればリンク済みのバイナリを読み込み、無ければコンパイルしてバイナリを保存する
+// コンパイラーを指定した場合はバックグラウンドでコンパイルし、完了するまでバリアントは無効（isValid() が false）のまま、
+// ソースの再読み込みでは完了するまで以前のプログラムで描画を続ける（update() で完了したものを差し替える）
+// バリアント番号は作成順の連番（描画キューのプログラム番号に使う）
+class ShaderPermutations {
+public:
+    // 作成直後（コンパイル・キャッシュ読み込みのどちらでも）に呼ぶ、ブロックのバインディングやサンプラーの設定
+    typedef std::function<void(ShaderManager&)> SetupFunction;
+
+private:
+    struct Variant {
+        ShaderFeatures m_features;
+        std::unique_ptr<ShaderManager> m_shader;
+        std::shared_ptr<ShaderCompileJob> m_job;   // バックグラウンドでコンパイル中の新しいプログラム
+        uint64_t m_jobSourceHash;                  // m_job のソースのハッシュ（完了後にキャッシュへ保存する）
+    };
+
+    std::string m_vertexSource;
+    std::string m_fragmentSource;
+    std::string m_vertexPrelude;
+    std::string m_fragmentPrelude;
+    const ProgramBinaryCache* m_cache;   // nullptr の場合は毎回コンパイル
+    AsyncShaderCompiler* m_compiler;     // nullptr の場合は描画スレッドでコンパイル
+    SetupFunction m_setup;
+
+    std::vector<Variant> m_variants;
+    std::unordered_map<ShaderFeatures, int> m_variantIndices;   // 作成に失敗した組は -1
+    ShaderBuildStats m_stats;
+
+    bool buildVariant(Variant& variant, bool useCache);
+    bool collectJob(Variant& variant);
+    void getVariantSources(ShaderFeatures features, std::string& vertexSource, std::string& fragmentSource, uint64_t& sourceHash) const;
+    bool isCacheEnabled() const;
+
+public:
+    ShaderPermutations();
+
+    void initialize(const std::string& vertexSource, const std::string& fragmentSource,
+        const std::string& vertexPrelude, const std::string& fragmentPrelude,
+        const ProgramBinaryCache* cache, AsyncShaderCompiler* compiler, const SetupFunction& setup);
+    void cleanup();   // OpenGLコンテキストが有効なうちに呼ぶこと
+
+    // ソースを差し替えて作成済みの全バリアントを作り直す（ホットリロード）
+    void reloadSources(const std::string& vertexSource, const std::string& fragmentSource);
+
+    // バックグラウンドのコンパイルが完了したバリアントのプログラムを差し替える（毎フレーム呼ぶ）。差し替えた数を返す
+    size_t update();
+
+    // 機能の組のバリアント番号（未作成なら作成する。失敗した場合は -1）
+    // バックグラウンドでコンパイルする場合は番号をすぐに返し、完了するまでシェーダーは無効のまま
+    int getVariant(ShaderFeatures features);
+
+    ShaderManager* getShader(int variant) const { return m_variants[variant].m_shader.get(); }
+    ShaderFeatures getFeatures(int variant) const { return m_variants[variant].m_features; }
+    size_t getVariantCount() const { return m_variants.size(); }
+    const ShaderBuildStats& getStats() const { return m_stats; }
+
+    // 機能の組に対応する #define 行と、ログ用の名前（例: "SKINNING+ALPHA_MASK"）
+    static std::string getDefines(ShaderFeatures features);
+    static std::string getFeatureNames(ShaderFeatures features);
+};
@@ -0,0 +1,118 @@
+﻿#pragma once
+
+// SIMD命令セットの検出と共通ヘルパー
+// x64 (MSVC) / SSE2以上が有効な環境ではSSE実装を使用し、それ以外はスカラー実装にフォールバックする
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLTFVIEWER_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define GLTFVIEWER_SIMD_AVX 1
+#include <immintrin.h>
+#endif
+
+namespace SimdMath {
+
+#ifdef GLTFVIEWER_SIMD_SSE
+    // 連続する4頂点 (xyz × 4 = 12 float) をSoA形式 (x[4], y[4], z[4]) に変換する
+    inline void loadPoints4(const float* p, __m128& x, __m128& y, __m128& z) {
+        __m128 v0 = _mm_loadu_ps(p);      // x0 y0 z0 x1
+        __m128 v1 = _mm_loadu_ps(p + 4);  // y1 z1 x2 y2
+        __m128 v2 = _mm_loadu_ps(p + 8);  // z2 x3 y3 z3
+
+        __m128 t1 = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1, 1, 2, 2));
+        x = _mm_shuffle_ps(v0, t1, _MM_SHUFFLE(2, 0, 3, 0));
+
+        __m128 t2 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(0, 0, 1, 1));
+        __m128 t3 = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 2, 3, 3));
+        y = _mm_shuffle_ps(t2, t3, _MM_SHUFFLE(2, 0, 2, 0));
+
+        __m128 t4 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 1, 2, 2));
+        __m128 t5 = _mm_shuffle_ps(v2, v2, _MM_SHUFFLE(3, 3, 0, 0));
+        z = _mm_shuffle_ps(t4, t5, _MM_SHUFFLE(2, 0, 2, 0));
+    }
+
+    // 4レーンの最小値・最大値・合計
+    inline float horizontalMin(__m128 v) {
+        v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+
+    inline float horizontalMax(__m128 v) {
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+
+    inline float horizontalSum(__m128 v) {
+        v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+#endif
+
+    // 列優先4x4行列の積 out = a * b（out は a, b と重なってもよい）
+    inline void multiplyMatrix4(const float* a, const float* b, float* out) {
+#ifdef GLTFVIEWER_SIMD_SSE
+        const __m128 a0 = _mm_loadu_ps(a);
+        const __m128 a1 = _mm_loadu_ps(a + 4);
+        const __m128 a2 = _mm_loadu_ps(a + 8);
+        const __m128 a3 = _mm_loadu_ps(a + 12);
+        __m128 r[4];
+        for (int col = 0; col < 4; ++col) {
+            const float* bc = b + col * 4;
+            r[col] = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(bc[0])), _mm_mul_ps(a1, _mm_set1_ps(bc[1]))),
+                _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(bc[2])), _mm_mul_ps(a3, _mm_set1_ps(bc[3]))));
+        }
+        for (int col = 0; col < 4; ++col) {
+            _mm_storeu_ps(out + col * 4, r[col]);
+        }
+#else
+        float r[16];
+        for (int col = 0; col < 4; ++col) {
+            for (int row = 0; row < 4; ++row) {
+                r[col * 4 + row] =
+                    a[0 * 4 + row] * b[col * 4 + 0] +
+                    a[1 * 4 + row] * b[col * 4 + 1] +
+                    a[2 * 4 + row] * b[col * 4 + 2] +
+                    a[3 * 4 + row] * b[col * 4 + 3];
+            }
+        }
+        for (int i = 0; i < 16; ++i) {
+            out[i] = r[i];
+        }
+#endif
+    }
+
+    // 平行移動・回転(クォータニオン x,y,z,w)・スケールから列優先4x4行列を作成
+    inline void composeTRS(const float* t, const float* q, const float* s, float* out) {
+        const float x = q[0], y = q[1], z = q[2], w = q[3];
+        const float xx = x * x, yy = y * y, zz = z * z;
+        const float xy = x * y, xz = x * z, yz = y * z;
+        const float wx = w * x, wy = w * y, wz = w * z;
+
+        out[0] = (1.0f - 2.0f * (yy + zz)) * s[0];
+        out[1] = (2.0f * (xy + wz)) * s[0];
+        out[2] = (2.0f * (xz - wy)) * s[0];
+        out[3] = 0.0f;
+
+        out[4] = (2.0f * (xy - wz)) * s[1];
+        out[5] = (1.0f - 2.0f * (xx + zz)) * s[1];
+        out[6] = (2.0f * (yz + wx)) * s[1];
+        out[7] = 0.0f;
+
+        out[8] = (2.0f * (xz + wy)) * s[2];
+        out[9] = (2.0f * (yz - wx)) * s[2];
+        out[10] = (1.0f - 2.0f * (xx + yy)) * s[2];
+        out[11] = 0.0f;
+
+        out[12] = t[0];
+        out[13] = t[1];
+        out[14] = t[2];
+        out[15] = 1.0f;
+    }
+}
@@ -0,0 +1,231 @@
+﻿#include "Skinning.h"
+#include "AccessorReader.h"
+#include "SceneGraph.h"
+#include "SimdMath.h"
+#include "ThreadPool.h"
+#include <tiny_gltf.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <utility>
+
+SkinningSystem::SkinningSystem()
+    : m_parallel(true)
+{
+}
+
+void SkinningSystem::clear() {
+    m_skinJointOffset.clear();
+    m_skinJointCount.clear();
+    m_jointNode.clear();
+    m_inverseBindMatrices.clear();
+    m_jointBounds.clear();
+    m_palette.clear();
+    m_nodeSkin.clear();
+    m_lastStats = SkinningStats();
+}
+
+int SkinningSystem::getNodeSkin(int sceneNode) const {
+    if (sceneNode < 0 || sceneNode >= static_cast<int>(m_nodeSkin.size())) {
+        return -1;
+    }
+    return m_nodeSkin[sceneNode];
+}
+
+bool SkinningSystem::readSkinnedVertices(const tinygltf::Model& model, const tinygltf::Primitive& primitive, SkinnedVertices& out) {
+    auto positionIt = primitive.attributes.find("POSITION");
+    auto jointIt = primitive.attributes.find("JOINTS_0");
+    auto weightIt = primitive.attributes.find("WEIGHTS_0");
+    if (positionIt == primitive.attributes.end() || jointIt == primitive.attributes.end() || weightIt == primitive.attributes.end()) {
+        return false;
+    }
+
+    if (!AccessorReader::readFloats(model, positionIt->second, out.m_positions, 3) ||
+        !AccessorReader::readUInts(model, jointIt->second, out.m_joints, 4) ||
+        !AccessorReader::readFloats(model, weightIt->second, out.m_weights, 4)) {
+        return false;
+    }
+
+    const size_t vertexCount = out.getVertexCount();
+    if (out.m_joints.size() != vertexCount * 4 || out.m_weights.size() != vertexCount * 4) {
+        std::cerr << "警告: JOINTS_0 / WEIGHTS_0 の要素数が頂点数と一致しません" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SkinningSystem::build(const tinygltf::Model& model, const SceneGraph& sceneGraph) {
+    clear();
+    if (model.skins.empty()) {
+        return true;
+    }
+
+    for (const auto& skin : model.skins) {
+        const int offset = static_cast<int>(m_jointNode.size());
+        const int jointCount = static_cast<int>(skin.joints.size());
+        m_skinJointOffset.push_back(offset);
+        m_skinJointCount.push_back(jointCount);
+
+        // 逆バインド行列（省略時は単位行列）
+        std::vector<float> inverseBind;
+        if (skin.inverseBindMatrices >= 0) {
+            if (!AccessorReader::readFloats(model, skin.inverseBindMatrices, inverseBind, 16) ||
+                inverseBind.size() < static_cast<size_t>(jointCount) * 16) {
+                std::cerr << "警告: スキン \"" << skin.name << "\" の逆バインド行列を読み込めません（単位行列を使用）" << std::endl;
+                inverseBind.clear();
+            }
+        }
+
+        for (int joint = 0; joint < jointCount; ++joint) {
+            m_jointNode.push_back(sceneGraph.getIndexOfNode(skin.joints[joint]));
+            m_inverseBindMatrices.push_back(inverseBind.empty() ? glm::mat4(1.0f) : glm::make_mat4(&inverseBind[joint * 16]));
+        }
+    }
+    m_jointBounds.assign(m_jointNode.size(), BoundingBox());
+    m_palette.assign(m_jointNode.size(), glm::mat4(1.0f));
+
+    // スキンを持つノードを記録し、(スキン, メッシュ) の組ごとに一度だけ関節のAABBを作る
+    m_nodeSkin.assign(sceneGraph.getNodeCount(), -1);
+    std::set<std::pair<int, int>> processed;
+    size_t skinnedNodeCount = 0;
+    for (size_t index = 0; index < sceneGraph.getNodeCount(); ++index) {
+        const tinygltf::Node& node = model.nodes[sceneGraph.getGLTFNode(static_cast<int>(index))];
+        if (node.skin < 0 || node.skin >= static_cast<int>(model.skins.size())) {
+            continue;
+        }
+        m_nodeSkin[index] = node.skin;
+        ++skinnedNodeCount;
+
+        if (node.mesh < 0 || node.mesh >= static_cast<int>(model.meshes.size()) ||
+            !processed.insert(std::make_pair(node.skin, node.mesh)).second) {
+            continue;
+        }
+        for (const auto& primitive : model.meshes[node.mesh].primitives) {
+            SkinnedVertices vertices;
+            if (readSkinnedVertices(model, primitive, vertices)) {
+                accumulateJointBounds(node.skin, vertices);
+            }
+        }
+    }
+
+    std::cout << "スキン: " << m_skinJointCount.size() << " (関節数: " << m_jointNode.size()
+        << ", スキンを持つノード: " << skinnedNodeCount << ")" << std::endl;
+    return true;
+}
+
+// 頂点をウェイトを持つ関節ごとのAABB（メッシュ空間）に加える
+// スキニング後の頂点は各関節のパレットで変換した位置の凸結合なので、変換したAABBの和集合に必ず含まれる
+void SkinningSystem::accumulateJointBounds(int skin, const SkinnedVertices& vertices) {
+    const int offset = m_skinJointOffset[skin];
+    const unsigned int jointCount = static_cast<unsigned int>(m_skinJointCount[skin]);
+
+    for (size_t v = 0; v < vertices.getVertexCount(); ++v) {
+        const glm::vec3 position(vertices.m_positions[v * 3 + 0], vertices.m_positions[v * 3 + 1], vertices.m_positions[v * 3 + 2]);
+        for (int k = 0; k < 4; ++k) {
+            const unsigned int joint = vertices.m_joints[v * 4 + k];
+            if (vertices.m_weights[v * 4 + k] > 0.0f && joint < jointCount) {
+                m_jointBounds[offset + joint].expand(position);
+            }
+        }
+    }
+}
+
+void SkinningSystem::updatePalettes(const SceneGraph& sceneGraph) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    auto computeRange = [this, &sceneGraph](size_t begin, size_t end) {
+        for (size_t joint = begin; joint < end; ++joint) {
+            const int node = m_jointNode[joint];
+            if (node < 0) {
+                // シーンに含まれない関節は原点に置かれているものとして扱う
+                m_palette[joint] = m_inverseBindMatrices[joint];
+                continue;
+            }
+            SimdMath::multiplyMatrix4(
+                glm::value_ptr(sceneGraph.getWorldMatrix(node)),
+                glm::value_ptr(m_inverseBindMatrices[joint]),
+                glm::value_ptr(m_palette[joint]));
+        }
+    };
+
+    if (m_parallel) {
+        ThreadPool::getInstance().parallelFor(m_jointNode.size(), 512, computeRange);
+    } else {
+        computeRange(0, m_jointNode.size());
+    }
+
+    m_lastStats.m_skins = m_skinJointCount.size();
+    m_lastStats.m_joints = m_jointNode.size();
+    m_lastStats.m_paletteTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+BoundingBox SkinningSystem::computeSkinBounds(int skin) const {
+    BoundingBox bounds;
+    const int offset = m_skinJointOffset[skin];
+    for (int joint = offset; joint < offset + m_skinJointCount[skin]; ++joint) {
+        if (m_jointBounds[joint].isValid()) {
+            bounds.expand(BoundingVolume::transform(m_jointBounds[joint], m_palette[joint]));
+        }
+    }
+    return bounds;
+}
+
+void SkinningSystem::skinPositions(const SkinnedVertices& vertices, const glm::mat4* palette, size_t paletteSize,
+    std::vector<float>& outPositions, bool parallel)
+{
+    const size_t vertexCount = vertices.getVertexCount();
+    outPositions.resize(vertexCount * 3);
+
+    auto skinRange = [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            const float* position = &vertices.m_positions[v * 3];
+            const unsigned int* joints = &vertices.m_joints[v * 4];
+            const float* weights = &vertices.m_weights[v * 4];
+
+#ifdef GLTFVIEWER_SIMD_SSE
+            // 関節行列の列をウェイトで合成してから1回だけ頂点を変換する
+            __m128 column0 = _mm_setzero_ps();
+            __m128 column1 = _mm_setzero_ps();
+            __m128 column2 = _mm_setzero_ps();
+            __m128 column3 = _mm_setzero_ps();
+            for (int k = 0; k < 4; ++k) {
+                if (weights[k] == 0.0f || joints[k] >= paletteSize) {
+                    continue;
+                }
+                const float* matrix = glm::value_ptr(palette[joints[k]]);
+                const __m128 weight = _mm_set1_ps(weights[k]);
+                column0 = _mm_add_ps(column0, _mm_mul_ps(weight, _mm_loadu_ps(matrix)));
+                column1 = _mm_add_ps(column1, _mm_mul_ps(weight, _mm_loadu_ps(matrix + 4)));
+                column2 = _mm_add_ps(column2, _mm_mul_ps(weight, _mm_loadu_ps(matrix + 8)));
+                column3 = _mm_add_ps(column3, _mm_mul_ps(weight, _mm_loadu_ps(matrix + 12)));
+            }
+            const __m128 result = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(position[0])), _mm_mul_ps(column1, _mm_set1_ps(position[1]))),
+                _mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(position[2])), column3));
+            float skinned[4];
+            _mm_storeu_ps(skinned, result);
+#else
+            glm::mat4 skinMatrix(0.0f);
+            for (int k = 0; k < 4; ++k) {
+                if (weights[k] == 0.0f || joints[k] >= paletteSize) {
+                    continue;
+                }
+                for (int column = 0; column < 4; ++column) {
+                    skinMatrix[column] += palette[joints[k]][column] * weights[k];
+                }
+            }
+            const glm::vec4 skinned = skinMatrix * glm::vec4(position[0], position[1], position[2], 1.0f);
+#endif
+            outPositions[v * 3 + 0] = skinned[0];
+            outPositions[v * 3 + 1] = skinned[1];
+            outPositions[v * 3 + 2] = skinned[2];
+        }
+    };
+
+    if (parallel) {
+        ThreadPool::getInstance().parallelFor(vertexCount, 4096, skinRange);
+    } else {
+        skinRange(0, vertexCount);
+    }
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include "BoundingVolume.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace tinygltf {
+    class Model;
+    struct Primitive;
+}
+
+class SceneGraph;
+
+// スキニング用の頂点データ（JOINTS_0 / WEIGHTS_0 を4要素に展開したもの）
+struct SkinnedVertices {
+    std::vector<float> m_positions;       // xyz
+    std::vector<unsigned int> m_joints;   // 4要素（スキンの joints 配列内の番号）
+    std::vector<float> m_weights;         // 4要素
+
+    size_t getVertexCount() const { return m_positions.size() / 3; }
+};
+
+// 1回の updatePalettes() の統計
+struct SkinningStats {
+    size_t m_skins;
+    size_t m_joints;
+    double m_paletteTimeMs;
+
+    SkinningStats() : m_skins(0), m_joints(0), m_paletteTimeMs(0.0) {}
+};
+
+// glTFスキンの関節行列パレットを管理する
+// 全スキンの関節をフラットな配列に並べ、ワールド行列 × 逆バインド行列を並列に計算する
+// パレットはワールド空間なので、スキンメッシュを描画するノード自身の変換は使用しない（glTF仕様）
+class SkinningSystem {
+private:
+    // スキンごとの関節範囲
+    std::vector<int> m_skinJointOffset;
+    std::vector<int> m_skinJointCount;
+
+    // 関節ごとのデータ（フラット配列）
+    std::vector<int> m_jointNode;                 // シーングラフ内インデックス（シーンに無ければ -1）
+    std::vector<glm::mat4> m_inverseBindMatrices;
+    std::vector<BoundingBox> m_jointBounds;       // 関節の影響を受ける頂点のメッシュ空間AABB（境界の更新用）
+    std::vector<glm::mat4> m_palette;
+
+    // シーングラフ内ノード → スキン（スキンを持たなければ -1）
+    std::vector<int> m_nodeSkin;
+
+    bool m_parallel;
+    SkinningStats m_lastStats;
+
+    void accumulateJointBounds(int skin, const SkinnedVertices& vertices);
+
+public:
+    SkinningSystem();
+
+    // モデルのスキンを読み込み、スキンメッシュの頂点から関節ごとのAABBを作成する
+    bool build(const tinygltf::Model& model, const SceneGraph& sceneGraph);
+    void clear();
+
+    // シーングラフのワールド行列から全スキンのパレットを再計算
+    void updatePalettes(const SceneGraph& sceneGraph);
+
+    // スキンの現在の姿勢でのワールド空間AABB（関節ごとのAABBを変換して統合）
+    BoundingBox computeSkinBounds(int skin) const;
+
+    bool hasSkins() const { return !m_skinJointCount.empty(); }
+    size_t getSkinCount() const { return m_skinJointCount.size(); }
+    size_t getJointCount() const { return m_jointNode.size(); }
+    int getNodeSkin(int sceneNode) const;
+    int getPaletteOffset(int skin) const { return m_skinJointOffset[skin]; }
+    int getPaletteSize(int skin) const { return m_skinJointCount[skin]; }
+    const std::vector<glm::mat4>& getPalette() const { return m_palette; }
+
+    void setParallel(bool parallel) { m_parallel = parallel; }
+    const SkinningStats& getLastStats() const { return m_lastStats; }
+
+    // プリミティブの POSITION / JOINTS_0 / WEIGHTS_0 を読み込む（スキン属性が無ければ false）
+    static bool readSkinnedVertices(const tinygltf::Model& model, const tinygltf::Primitive& primitive, SkinnedVertices& out);
+
+    // CPUスキニング（ヘッドレス描画・ソフトウェアラスタライザー・正確な境界計算用）
+    // palette はスキンの先頭関節の行列、outPositions は xyz で vertices と同じ頂点数
+    static void skinPositions(const SkinnedVertices& vertices, const glm::mat4* palette, size_t paletteSize,
+        std::vector<float>& outPositions, bool parallel = true);
+};
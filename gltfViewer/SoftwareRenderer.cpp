@@ -0,0 +1,566 @@
+﻿#include "SoftwareRenderer.h"
+#include "AccessorReader.h"
+#include "Camera.h"
+#include "PrimitiveTopology.h"
+#include "SimdMath.h"
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+namespace {
+    const int kTileSize = 64;
+    const size_t kItemTriangles = 16384;    // ワーカーへ配る三角形の区間の大きさ
+    const size_t kBatchesPerThread = 4;     // 区間の偏りを均すため、スレッド数より多めに分ける
+    const float kAmbient = 0.25f;
+
+    double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // 画面座標をピクセル番号へ変換（画面外の大きな値も int へ安全に変換できるよう先に範囲を制限する）
+    // 範囲外の場合は最小側が size、最大側が -1 になり、min > max となる
+    inline int toPixel(float coordinate, int size, bool roundUp) {
+        coordinate = std::max(-1.0f, std::min(coordinate, static_cast<float>(size)));
+        const int pixel = roundUp ? static_cast<int>(std::ceil(coordinate)) - 1 : static_cast<int>(std::floor(coordinate));
+        return roundUp ? std::min(pixel, size - 1) : std::max(pixel, 0);
+    }
+
+    // ニア平面 (z >= -w) の内側までの符号付き距離
+    inline float nearDistance(const glm::vec4& clip) {
+        return clip.z + clip.w;
+    }
+
+    inline uint32_t packColor(const glm::vec3& color) {
+        const glm::vec3 c = glm::clamp(color, glm::vec3(0.0f), glm::vec3(1.0f)) * 255.0f + 0.5f;
+        return 0xFF000000u | (static_cast<uint32_t>(c.x) << 16) | (static_cast<uint32_t>(c.y) << 8) | static_cast<uint32_t>(c.z);
+    }
+}
+
+#ifdef _WIN32
+SoftwareRenderer::SoftwareRenderer(HWND window)
+    : m_hWnd(window)
+    , m_width(0)
+#else
+SoftwareRenderer::SoftwareRenderer()
+    : m_width(0)
+#endif
+    , m_height(0)
+    , m_tilesX(0)
+    , m_tilesY(0)
+    , m_stride(0)
+    , m_clearColor(packColor(glm::vec3(0.2f, 0.3f, 0.4f)))
+    , m_loaded(false)
+    , m_viewProjection(1.0f)
+    , m_viewDirection(0.0f, 0.0f, -1.0f)
+    , m_threadCount(0)
+{
+    setThreadCount(0);
+    onResize(800, 600);
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+    cleanupGLTFResources();
+}
+
+bool SoftwareRenderer::initialize() {
+#ifdef GLTFVIEWER_SIMD_SSE
+    const char* rasterPath = "SSE (4ピクセル)";
+#else
+    const char* rasterPath = "スカラー";
+#endif
+    std::cout << "ソフトウェアレンダラー: " << m_threadCount << " スレッド, タイル " << kTileSize << "x" << kTileSize
+        << ", ラスタライズ " << rasterPath << std::endl;
+    return true;
+}
+
+void SoftwareRenderer::setThreadCount(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    if (threadCount == m_threadCount) {
+        return;
+    }
+    m_threadCount = threadCount;
+    m_pool.reset(threadCount > 1 ? new ThreadPool(static_cast<size_t>(threadCount - 1)) : nullptr);
+}
+
+void SoftwareRenderer::parallelFor(size_t count, const std::function<void(size_t, size_t)>& body) {
+    if (m_pool) {
+        m_pool->parallelFor(count, 1, body);
+    } else if (count > 0) {
+        body(0, count);
+    }
+}
+
+void SoftwareRenderer::onResize(int width, int height) {
+    m_width = std::max(width, 1);
+    m_height = std::max(height, 1);
+    m_tilesX = (m_width + kTileSize - 1) / kTileSize;
+    m_tilesY = (m_height + kTileSize - 1) / kTileSize;
+    m_stride = m_tilesX * kTileSize;
+    const size_t pixelCount = static_cast<size_t>(m_stride) * m_tilesY * kTileSize;
+    m_color.assign(pixelCount, m_clearColor);
+    m_depth.assign(pixelCount, 1.0f);
+}
+
+void SoftwareRenderer::updateCamera(const Camera* camera) {
+    if (camera) {
+        m_viewProjection = camera->getViewProjectionMatrix();
+        m_viewDirection = camera->getForward();
+    }
+}
+
+bool SoftwareRenderer::loadGLTFModel(const tinygltf::Model& model) {
+    cleanupGLTFResources();
+
+    m_materials.reserve(model.materials.size() + 1);
+    for (const auto& material : model.materials) {
+        Material color = { glm::vec3(1.0f), material.doubleSided };
+        const auto& factor = material.pbrMetallicRoughness.baseColorFactor;
+        for (size_t i = 0; i < std::min<size_t>(factor.size(), 3); ++i) {
+            color.m_baseColor[static_cast<int>(i)] = static_cast<float>(factor[i]);
+        }
+        m_materials.push_back(color);
+    }
+    const int defaultMaterial = static_cast<int>(m_materials.size());
+    m_materials.push_back(Material{ glm::vec3(1.0f), false });
+
+    size_t triangleCount = 0;
+    m_meshes.assign(model.meshes.size(), Mesh());
+    for (size_t meshIndex = 0; meshIndex < model.meshes.size(); ++meshIndex) {
+        Mesh& mesh = m_meshes[meshIndex];
+
+        for (const auto& primitive : model.meshes[meshIndex].primitives) {
+            if (PrimitiveTopology::classify(primitive.mode) != PrimitiveClass::Triangles) {
+                continue;
+            }
+            auto positionIt = primitive.attributes.find("POSITION");
+            if (positionIt == primitive.attributes.end()) {
+                continue;
+            }
+
+            std::vector<float> positions;
+            if (!AccessorReader::readFloats(model, positionIt->second, positions, 3)) {
+                continue;
+            }
+            const size_t vertexCount = positions.size() / 3;
+
+            std::vector<unsigned int> sourceIndices;
+            unsigned int restartIndex = PrimitiveTopology::getRestartIndex(TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
+            if (primitive.indices >= 0) {
+                if (!AccessorReader::readUInts(model, primitive.indices, sourceIndices, 1)) {
+                    continue;
+                }
+                restartIndex = PrimitiveTopology::getRestartIndex(model.accessors[primitive.indices].componentType);
+            } else {
+                PrimitiveTopology::generateSequentialIndices(vertexCount, sourceIndices);
+            }
+
+            std::vector<unsigned int> indices;
+            PrimitiveTopology::normalize(primitive.mode, sourceIndices, restartIndex, indices);
+
+            const int material = primitive.material >= 0 && primitive.material < defaultMaterial ? primitive.material : defaultMaterial;
+            const unsigned int baseVertex = static_cast<unsigned int>(mesh.m_positions.size());
+            for (size_t v = 0; v < vertexCount; ++v) {
+                mesh.m_positions.push_back(glm::vec3(positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2]));
+            }
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                // 範囲外の頂点を参照する三角形は除外
+                if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount) {
+                    continue;
+                }
+                mesh.m_indices.push_back(baseVertex + indices[i]);
+                mesh.m_indices.push_back(baseVertex + indices[i + 1]);
+                mesh.m_indices.push_back(baseVertex + indices[i + 2]);
+                mesh.m_triangleMaterials.push_back(material);
+            }
+        }
+
+        if (!mesh.m_positions.empty()) {
+            mesh.m_bounds = BoundingVolume::computeAABB(&mesh.m_positions[0].x, mesh.m_positions.size());
+        }
+    }
+
+    if (!m_sceneGraph.build(model)) {
+        std::cerr << "エラー: シーングラフを構築できません" << std::endl;
+        cleanupGLTFResources();
+        return false;
+    }
+    m_sceneGraph.updateWorldTransforms();
+
+    for (size_t node = 0; node < m_sceneGraph.getNodeCount(); ++node) {
+        const int meshIndex = m_sceneGraph.getMesh(static_cast<int>(node));
+        if (meshIndex < 0 || meshIndex >= static_cast<int>(m_meshes.size()) || m_meshes[meshIndex].m_indices.empty()) {
+            continue;
+        }
+        m_instanceNodes.push_back(static_cast<int>(node));
+        m_instanceMeshes.push_back(meshIndex);
+        m_sceneBounds.expand(BoundingVolume::transform(m_meshes[meshIndex].m_bounds, m_sceneGraph.getWorldMatrix(static_cast<int>(node))));
+        triangleCount += m_meshes[meshIndex].m_indices.size() / 3;
+    }
+    m_sceneBoundingSphere = BoundingVolume::sphereFromBox(m_sceneBounds);
+    m_loaded = true;
+
+    std::cout << "ソフトウェアレンダラー: メッシュ " << m_meshes.size() << ", インスタンス " << m_instanceNodes.size()
+        << ", 三角形 " << triangleCount << std::endl;
+    return true;
+}
+
+void SoftwareRenderer::cleanupGLTFResources() {
+    m_meshes.clear();
+    m_materials.clear();
+    m_sceneGraph.clear();
+    m_instanceNodes.clear();
+    m_instanceMeshes.clear();
+    m_sceneBounds = BoundingBox();
+    m_sceneBoundingSphere = BoundingSphere();
+    m_items.clear();
+    m_batches.clear();
+    m_loaded = false;
+}
+
+// 視錐台内のインスタンスの三角形を WorkItem に分け、三角形数が均等になるように区間（Batch）へ割り当てる
+void SoftwareRenderer::buildWorkItems() {
+    m_items.clear();
+    m_stats.m_instances = 0;
+    if (!m_loaded) {
+        m_batches.clear();
+        return;
+    }
+
+    const Frustum frustum = BoundingVolume::extractFrustum(m_viewProjection);
+    size_t totalTriangles = 0;
+    for (size_t instance = 0; instance < m_instanceNodes.size(); ++instance) {
+        const Mesh& mesh = m_meshes[m_instanceMeshes[instance]];
+        const BoundingBox bounds = BoundingVolume::transform(mesh.m_bounds, m_sceneGraph.getWorldMatrix(m_instanceNodes[instance]));
+        if (!BoundingVolume::intersectsFrustum(bounds, frustum)) {
+            continue;
+        }
+        ++m_stats.m_instances;
+        const size_t triangleCount = mesh.m_indices.size() / 3;
+        for (size_t first = 0; first < triangleCount; first += kItemTriangles) {
+            m_items.push_back(WorkItem{ static_cast<int>(instance), first, std::min(kItemTriangles, triangleCount - first) });
+        }
+        totalTriangles += triangleCount;
+    }
+
+    const size_t batchCount = std::min(m_items.size(), static_cast<size_t>(m_threadCount) * kBatchesPerThread);
+    m_batches.resize(batchCount);
+    const size_t trianglesPerBatch = batchCount > 0 ? (totalTriangles + batchCount - 1) / batchCount : 0;
+    size_t item = 0;
+    for (size_t b = 0; b < batchCount; ++b) {
+        Batch& batch = m_batches[b];
+        batch.m_firstItem = item;
+        size_t triangles = 0;
+        // 残りの区間に最低1つずつ残るようにしながら、目安の三角形数まで詰める
+        while (item < m_items.size() && m_items.size() - item > batchCount - b - 1 &&
+            (triangles == 0 || triangles + m_items[item].m_triangleCount <= trianglesPerBatch || b + 1 == batchCount)) {
+            triangles += m_items[item].m_triangleCount;
+            ++item;
+        }
+        batch.m_itemCount = item - batch.m_firstItem;
+    }
+}
+
+// クリップ座標の三角形を画面座標へ変換し、エッジ関数と深度平面をセットアップしてタイルのビンへ登録
+// frontFaceSign は表面とする画面上の面積の符号（0 は両面）
+void SoftwareRenderer::emitTriangle(const glm::vec4* clip, uint32_t color, int frontFaceSign, Batch& batch) const {
+    float x[3], y[3], z[3];
+    for (int i = 0; i < 3; ++i) {
+        const float invW = 1.0f / clip[i].w;
+        x[i] = (clip[i].x * invW * 0.5f + 0.5f) * m_width;
+        y[i] = (clip[i].y * invW * 0.5f + 0.5f) * m_height;
+        z[i] = clip[i].z * invW * 0.5f + 0.5f;
+    }
+    // ファー平面より奥
+    if (z[0] > 1.0f && z[1] > 1.0f && z[2] > 1.0f) {
+        return;
+    }
+
+    const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (std::fabs(area) < 1e-8f || area * frontFaceSign < 0.0f) {
+        return;
+    }
+
+    ScreenTriangle triangle;
+    triangle.m_minX = toPixel(std::min(x[0], std::min(x[1], x[2])), m_width, false);
+    triangle.m_maxX = toPixel(std::max(x[0], std::max(x[1], x[2])), m_width, true);
+    triangle.m_minY = toPixel(std::min(y[0], std::min(y[1], y[2])), m_height, false);
+    triangle.m_maxY = toPixel(std::max(y[0], std::max(y[1], y[2])), m_height, true);
+    if (triangle.m_minX > triangle.m_maxX || triangle.m_minY > triangle.m_maxY) {
+        return;
+    }
+
+    // エッジ i は頂点 i の対辺。値を面積で割ると頂点 i の重心座標になる
+    for (int i = 0; i < 3; ++i) {
+        const int a = (i + 1) % 3;
+        const int b = (i + 2) % 3;
+        triangle.m_edgeA[i] = y[a] - y[b];
+        triangle.m_edgeB[i] = x[b] - x[a];
+        triangle.m_edgeC[i] = x[a] * y[b] - x[b] * y[a];
+    }
+
+    const float invArea = 1.0f / area;
+    const float dz1 = (z[1] - z[0]) * invArea;
+    const float dz2 = (z[2] - z[0]) * invArea;
+    triangle.m_depthA = triangle.m_edgeA[1] * dz1 + triangle.m_edgeA[2] * dz2;
+    triangle.m_depthB = triangle.m_edgeB[1] * dz1 + triangle.m_edgeB[2] * dz2;
+    triangle.m_depthC = z[0] + triangle.m_edgeC[1] * dz1 + triangle.m_edgeC[2] * dz2;
+
+    // 時計回りでも内側が正になるようにエッジの符号をそろえる
+    if (area < 0.0f) {
+        for (int i = 0; i < 3; ++i) {
+            triangle.m_edgeA[i] = -triangle.m_edgeA[i];
+            triangle.m_edgeB[i] = -triangle.m_edgeB[i];
+            triangle.m_edgeC[i] = -triangle.m_edgeC[i];
+        }
+    }
+    triangle.m_color = color;
+
+    const uint32_t index = static_cast<uint32_t>(batch.m_triangles.size());
+    batch.m_triangles.push_back(triangle);
+    for (int tileY = triangle.m_minY / kTileSize; tileY <= triangle.m_maxY / kTileSize; ++tileY) {
+        for (int tileX = triangle.m_minX / kTileSize; tileX <= triangle.m_maxX / kTileSize; ++tileX) {
+            batch.m_bins[static_cast<size_t>(tileY) * m_tilesX + tileX].push_back(index);
+            ++batch.m_binEntries;
+        }
+    }
+}
+
+// 区間の三角形を変換・クリップ・陰影付けしてビンへ登録（ワーカースレッドで実行）
+void SoftwareRenderer::setupBatch(Batch& batch) {
+    const size_t tileCount = static_cast<size_t>(m_tilesX) * m_tilesY;
+    if (batch.m_bins.size() != tileCount) {
+        batch.m_bins.assign(tileCount, std::vector<uint32_t>());
+    }
+    for (auto& bin : batch.m_bins) {
+        bin.clear();
+    }
+    batch.m_triangles.clear();
+    batch.m_inputTriangles = 0;
+    batch.m_binEntries = 0;
+
+    for (size_t itemIndex = batch.m_firstItem; itemIndex < batch.m_firstItem + batch.m_itemCount; ++itemIndex) {
+        const WorkItem& item = m_items[itemIndex];
+        const Mesh& mesh = m_meshes[m_instanceMeshes[item.m_instance]];
+        const glm::mat4& world = m_sceneGraph.getWorldMatrix(m_instanceNodes[item.m_instance]);
+        const glm::mat3 linear(world);
+        const float determinant = glm::determinant(linear);
+        if (determinant == 0.0f) {
+            continue;
+        }
+        const glm::mat4 modelViewProjection = m_viewProjection * world;
+        // 面法線はローカルの辺の外積を逆転置行列で変換する（非一様スケールでも向きが正しい。陰影は向きだけを使う）
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+        // 行列式が負（鏡映）の場合は表面の巻き順が逆になる
+        const int mirroredSign = determinant < 0.0f ? -1 : 1;
+        batch.m_inputTriangles += item.m_triangleCount;
+
+        for (size_t t = item.m_firstTriangle; t < item.m_firstTriangle + item.m_triangleCount; ++t) {
+            const glm::vec3& p0 = mesh.m_positions[mesh.m_indices[t * 3 + 0]];
+            const glm::vec3& p1 = mesh.m_positions[mesh.m_indices[t * 3 + 1]];
+            const glm::vec3& p2 = mesh.m_positions[mesh.m_indices[t * 3 + 2]];
+            const glm::vec4 triangle[3] = {
+                modelViewProjection * glm::vec4(p0, 1.0f),
+                modelViewProjection * glm::vec4(p1, 1.0f),
+                modelViewProjection * glm::vec4(p2, 1.0f)
+            };
+            const float distance[3] = { nearDistance(triangle[0]), nearDistance(triangle[1]), nearDistance(triangle[2]) };
+            const int insideCount = (distance[0] >= 0.0f) + (distance[1] >= 0.0f) + (distance[2] >= 0.0f);
+            if (insideCount == 0) {
+                continue;
+            }
+
+            const Material& material = m_materials[mesh.m_triangleMaterials[t]];
+            const glm::vec3 normal = normalMatrix * glm::cross(p1 - p0, p2 - p0);
+            const float length = glm::length(normal);
+            const float diffuse = length > 0.0f ? std::fabs(glm::dot(normal, m_viewDirection)) / length : 0.0f;
+            const uint32_t color = packColor(material.m_baseColor * (kAmbient + (1.0f - kAmbient) * diffuse));
+            const int frontFaceSign = material.m_doubleSided ? 0 : mirroredSign;
+
+            if (insideCount == 3) {
+                emitTriangle(triangle, color, frontFaceSign, batch);
+                continue;
+            }
+
+            // Sutherland-Hodgman でニア平面の内側を切り出し（最大4頂点）、扇状に分割する（巻き順は保たれる）
+            glm::vec4 polygon[4];
+            int polygonSize = 0;
+            for (int v = 0; v < 3; ++v) {
+                const int next = (v + 1) % 3;
+                if (distance[v] >= 0.0f) {
+                    polygon[polygonSize++] = triangle[v];
+                }
+                if ((distance[v] >= 0.0f) != (distance[next] >= 0.0f)) {
+                    const float s = distance[v] / (distance[v] - distance[next]);
+                    polygon[polygonSize++] = triangle[v] + (triangle[next] - triangle[v]) * s;
+                }
+            }
+            for (int v = 1; v + 1 < polygonSize; ++v) {
+                const glm::vec4 fan[3] = { polygon[0], polygon[v], polygon[v + 1] };
+                emitTriangle(fan, color, frontFaceSign, batch);
+            }
+        }
+    }
+}
+
+// タイルをクリアし、全区間のビンの三角形を区間の順にラスタライズ（ワーカースレッドで実行）
+void SoftwareRenderer::rasterizeTile(int tile) {
+    const int tileMinX = (tile % m_tilesX) * kTileSize;
+    const int tileMinY = (tile / m_tilesX) * kTileSize;
+    const int tileMaxX = tileMinX + kTileSize - 1;
+    const int tileMaxY = tileMinY + kTileSize - 1;
+
+    for (int y = tileMinY; y <= tileMaxY; ++y) {
+        const size_t offset = static_cast<size_t>(y) * m_stride + tileMinX;
+        std::fill(m_color.begin() + offset, m_color.begin() + offset + kTileSize, m_clearColor);
+        std::fill(m_depth.begin() + offset, m_depth.begin() + offset + kTileSize, 1.0f);
+    }
+
+    for (const Batch& batch : m_batches) {
+        for (uint32_t index : batch.m_bins[tile]) {
+            const ScreenTriangle& triangle = batch.m_triangles[index];
+            const int minY = std::max(triangle.m_minY, tileMinY);
+            const int maxY = std::min(triangle.m_maxY, tileMaxY);
+            const int maxX = std::min(triangle.m_maxX, tileMaxX);
+            // 4ピクセル単位で処理するため左端を4の倍数に切り下げる（タイル幅は4の倍数なので右端ははみ出さない）
+            const int minX = std::max(triangle.m_minX, tileMinX) & ~3;
+
+            for (int y = minY; y <= maxY; ++y) {
+                const float py = y + 0.5f;
+                float* depthRow = &m_depth[static_cast<size_t>(y) * m_stride];
+                uint32_t* colorRow = &m_color[static_cast<size_t>(y) * m_stride];
+#ifdef GLTFVIEWER_SIMD_SSE
+                const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+                const __m128 zero = _mm_setzero_ps();
+                const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(minX)), laneOffsets);
+                __m128 edge[3], edgeStep[3];
+                for (int i = 0; i < 3; ++i) {
+                    edge[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.m_edgeA[i]), px),
+                        _mm_set1_ps(triangle.m_edgeB[i] * py + triangle.m_edgeC[i]));
+                    edgeStep[i] = _mm_set1_ps(triangle.m_edgeA[i] * 4.0f);
+                }
+                __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.m_depthA), px),
+                    _mm_set1_ps(triangle.m_depthB * py + triangle.m_depthC));
+                const __m128 depthStep = _mm_set1_ps(triangle.m_depthA * 4.0f);
+                const __m128i color = _mm_set1_epi32(static_cast<int>(triangle.m_color));
+
+                for (int x = minX; x <= maxX; x += 4) {
+                    const __m128 inside = _mm_and_ps(
+                        _mm_and_ps(_mm_cmpge_ps(edge[0], zero), _mm_cmpge_ps(edge[1], zero)),
+                        _mm_cmpge_ps(edge[2], zero));
+                    if (_mm_movemask_ps(inside) != 0) {
+                        const __m128 current = _mm_loadu_ps(depthRow + x);
+                        const __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(depth, current));
+                        if (_mm_movemask_ps(pass) != 0) {
+                            _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, depth), _mm_andnot_ps(pass, current)));
+                            const __m128i passMask = _mm_castps_si128(pass);
+                            __m128i* pixels = reinterpret_cast<__m128i*>(colorRow + x);
+                            _mm_storeu_si128(pixels, _mm_or_si128(_mm_and_si128(passMask, color), _mm_andnot_si128(passMask, _mm_loadu_si128(pixels))));
+                        }
+                    }
+                    for (int i = 0; i < 3; ++i) {
+                        edge[i] = _mm_add_ps(edge[i], edgeStep[i]);
+                    }
+                    depth = _mm_add_ps(depth, depthStep);
+                }
+#else
+                for (int x = std::max(triangle.m_minX, tileMinX); x <= maxX; ++x) {
+                    const float px = x + 0.5f;
+                    bool inside = true;
+                    for (int i = 0; i < 3 && inside; ++i) {
+                        inside = triangle.m_edgeA[i] * px + triangle.m_edgeB[i] * py + triangle.m_edgeC[i] >= 0.0f;
+                    }
+                    if (inside) {
+                        const float depth = triangle.m_depthA * px + triangle.m_depthB * py + triangle.m_depthC;
+                        if (depth < depthRow[x]) {
+                            depthRow[x] = depth;
+                            colorRow[x] = triangle.m_color;
+                        }
+                    }
+                }
+#endif
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::renderFrame() {
+    const auto frameStart = std::chrono::high_resolution_clock::now();
+    m_stats.m_threads = m_threadCount;
+
+    buildWorkItems();
+    parallelFor(m_batches.size(), [this](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            setupBatch(m_batches[b]);
+        }
+    });
+    m_stats.m_triangles = 0;
+    m_stats.m_rasterTriangles = 0;
+    m_stats.m_binEntries = 0;
+    for (const Batch& batch : m_batches) {
+        m_stats.m_triangles += batch.m_inputTriangles;
+        m_stats.m_rasterTriangles += batch.m_triangles.size();
+        m_stats.m_binEntries += batch.m_binEntries;
+    }
+    m_stats.m_setupMs = elapsedMs(frameStart);
+
+    const auto rasterStart = std::chrono::high_resolution_clock::now();
+    parallelFor(static_cast<size_t>(m_tilesX) * m_tilesY, [this](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; ++tile) {
+            rasterizeTile(static_cast<int>(tile));
+        }
+    });
+    m_stats.m_rasterMs = elapsedMs(rasterStart);
+    m_stats.m_presentMs = 0.0;
+    m_stats.m_frameMs = elapsedMs(frameStart);
+}
+
+void SoftwareRenderer::render() {
+    renderFrame();
+    const auto presentStart = std::chrono::high_resolution_clock::now();
+    present();
+    m_stats.m_presentMs = elapsedMs(presentStart);
+    m_stats.m_frameMs += m_stats.m_presentMs;
+}
+
+// フレームバッファーはボトムアップのDIBと同じ並びなので、そのままウィンドウへ転送できる
+// （Windows 以外ではウィンドウを持たないので、readPixels() で取り出す）
+void SoftwareRenderer::present() {
+#ifdef _WIN32
+    if (!m_hWnd) {
+        return;
+    }
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = m_stride;
+    info.bmiHeader.biHeight = m_height;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    HDC hDC = GetDC(m_hWnd);
+    SetDIBitsToDevice(hDC, 0, 0, m_width, m_height, 0, 0, 0, m_height, m_color.data(), &info, DIB_RGB_COLORS);
+    ReleaseDC(m_hWnd, hDC);
+#endif
+}
+
+void SoftwareRenderer::readPixels(ReadbackImage& image) const {
+    image.m_width = m_width;
+    image.m_height = m_height;
+    image.m_pixels.resize(static_cast<size_t>(m_width) * m_height * 4);
+    image.m_valid = true;
+    for (int y = 0; y < m_height; ++y) {
+        const uint32_t* row = &m_color[static_cast<size_t>(y) * m_stride];
+        unsigned char* out = &image.m_pixels[static_cast<size_t>(y) * m_width * 4];
+        for (int x = 0; x < m_width; ++x) {
+            out[x * 4 + 0] = static_cast<unsigned char>(row[x] >> 16);
+            out[x * 4 + 1] = static_cast<unsigned char>(row[x] >> 8);
+            out[x * 4 + 2] = static_cast<unsigned char>(row[x]);
+            out[x * 4 + 3] = static_cast<unsigned char>(row[x] >> 24);
+        }
+    }
+}
@@ -0,0 +1,156 @@
+﻿#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "BoundingVolume.h"
+#include "ImageReadback.h"
+#include "SceneGraph.h"
+#include "ThreadPool.h"
+
+namespace tinygltf {
+    class Model;
+}
+
+class Camera;
+
+// 1フレーム分のソフトウェア描画の統計
+struct SoftwareRenderStats {
+    int m_threads;
+    size_t m_instances;         // 視錐台内のインスタンス数
+    size_t m_triangles;         // 変換した三角形数
+    size_t m_rasterTriangles;   // ニアクリップ・背面カリング・画面外の除外後にビニングした三角形数
+    size_t m_binEntries;        // タイルへの登録数の合計（複数のタイルにまたがる三角形は重複して数える）
+    double m_setupMs;           // 頂点変換・三角形のセットアップ・ビニング
+    double m_rasterMs;          // タイルごとのクリア・ラスタライズ
+    double m_presentMs;         // ウィンドウへの転送（Windows のみ）
+    double m_frameMs;
+
+    SoftwareRenderStats()
+        : m_threads(0), m_instances(0), m_triangles(0), m_rasterTriangles(0), m_binEntries(0)
+        , m_setupMs(0.0), m_rasterMs(0.0), m_presentMs(0.0), m_frameMs(0.0) {}
+};
+
+// GPUを使わずCPUだけで描画するレンダラー（OpenGLRenderer と同じ initialize / loadGLTFModel / render / onResize で使う）
+// 1. 視錐台内のインスタンスの三角形を区間に分け、ワーカーが頂点の変換・ニアクリップ・背面カリング・エッジ関数のセットアップを行い、
+//    区間ごとに持つタイル（64x64ピクセル）のビンへ登録する（区間ごとなのでロックは使わない）
+// 2. タイルごとにワーカーが全区間のビンを区間の順に読み、エッジ関数と深度テストを4ピクセルずつSIMDで評価してフレームバッファーへ書く
+//    タイルは1つのワーカーだけが書くため同期は不要で、三角形の順序はスレッド数によらず同じになる（結果も同じ）
+// シェーディングはマテリアルの baseColorFactor をカメラ方向の光源で面ごとに陰影付けするフラットシェーディング（テクスチャ・半透明は扱わない）
+class SoftwareRenderer {
+private:
+    struct Mesh {
+        std::vector<glm::vec3> m_positions;
+        std::vector<unsigned int> m_indices;
+        std::vector<int> m_triangleMaterials;   // 三角形ごとのマテリアル（m_materials の番号）
+        BoundingBox m_bounds;
+    };
+
+    struct Material {
+        glm::vec3 m_baseColor;
+        bool m_doubleSided;
+    };
+
+    // 画面座標（ピクセル、下の行から）へ変換しセットアップ済みの三角形
+    // エッジ関数 A*x + B*y + C がすべて 0 以上なら内側、深度は平面 A*x + B*y + C で補間する
+    struct ScreenTriangle {
+        float m_edgeA[3], m_edgeB[3], m_edgeC[3];
+        float m_depthA, m_depthB, m_depthC;
+        int m_minX, m_maxX, m_minY, m_maxY;
+        uint32_t m_color;                       // BGRA
+    };
+
+    // 1つのインスタンスの三角形の区間（大きなメッシュは分割してワーカーへ配る）
+    struct WorkItem {
+        int m_instance;
+        size_t m_firstTriangle;
+        size_t m_triangleCount;
+    };
+
+    // ワーカーが処理する WorkItem の区間ごとの出力
+    struct Batch {
+        size_t m_firstItem;
+        size_t m_itemCount;
+        std::vector<ScreenTriangle> m_triangles;
+        std::vector<std::vector<uint32_t>> m_bins;  // タイルごとの m_triangles の番号
+        size_t m_inputTriangles;
+        size_t m_binEntries;
+    };
+
+#ifdef _WIN32
+    HWND m_hWnd;
+#endif
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    int m_stride;                           // 1行のピクセル数（タイル幅の倍数）
+    std::vector<uint32_t> m_color;          // BGRA、下の行から（DIB と同じ並び）
+    std::vector<float> m_depth;             // [0, 1]（1がファー）
+    uint32_t m_clearColor;
+
+    std::vector<Mesh> m_meshes;
+    std::vector<Material> m_materials;      // 末尾はマテリアル指定の無いプリミティブ用
+    SceneGraph m_sceneGraph;
+    std::vector<int> m_instanceNodes;       // メッシュを持つシーングラフのノード
+    std::vector<int> m_instanceMeshes;
+    BoundingBox m_sceneBounds;
+    BoundingSphere m_sceneBoundingSphere;
+    bool m_loaded;
+
+    glm::mat4 m_viewProjection;
+    glm::vec3 m_viewDirection;
+
+    int m_threadCount;
+    std::unique_ptr<ThreadPool> m_pool;     // 呼び出しスレッドも処理に参加するので threadCount - 1 個（1スレッドの場合は作らない）
+
+    std::vector<WorkItem> m_items;
+    std::vector<Batch> m_batches;
+    SoftwareRenderStats m_stats;
+
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& body);
+    void buildWorkItems();
+    void setupBatch(Batch& batch);
+    void emitTriangle(const glm::vec4* clip, uint32_t color, int frontFaceSign, Batch& batch) const;
+    void rasterizeTile(int tile);
+    void present();
+
+public:
+#ifdef _WIN32
+    explicit SoftwareRenderer(HWND window = nullptr);
+#else
+    SoftwareRenderer();
+#endif
+    ~SoftwareRenderer();
+
+    SoftwareRenderer(const SoftwareRenderer&) = delete;
+    SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+    bool initialize();
+    void render();
+    void renderFrame();   // ウィンドウへ転送しない render()
+    void onResize(int width, int height);
+
+    bool loadGLTFModel(const tinygltf::Model& model);
+    void cleanupGLTFResources();
+    void updateCamera(const Camera* camera);
+
+    // 描画に使うスレッド数（呼び出しスレッドを含む、0 はハードウェアスレッド数）
+    void setThreadCount(int threadCount);
+    int getThreadCount() const { return m_threadCount; }
+
+    const BoundingBox& getSceneBounds() const { return m_sceneBounds; }
+    const BoundingSphere& getSceneBoundingSphere() const { return m_sceneBoundingSphere; }
+    const SoftwareRenderStats& getStats() const { return m_stats; }
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+    // フレームバッファーを RGBA8（下の行から）で取り出す（ImageReadback::writeImage で書き出せる）
+    void readPixels(ReadbackImage& image) const;
+};
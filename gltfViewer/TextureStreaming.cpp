@@ -0,0 +1,683 @@
+﻿#include "TextureStreaming.h"
+#include "ThreadPool.h"
+#include <tiny_gltf.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    int getLevelCount(int width, int height) {
+        int levels = 1;
+        while ((std::max(width, height) >> levels) > 0) {
+            ++levels;
+        }
+        return levels;
+    }
+
+    int getLevelSize(int size, int level) {
+        return std::max(size >> level, 1);
+    }
+
+    // glTFのサンプラーの値（未指定は -1）をテクスチャのパラメーターへ
+    GLint getFilter(int filter, GLint defaultFilter) {
+        return filter >= 0 ? static_cast<GLint>(filter) : defaultFilter;
+    }
+
+    // 1〜4要素・8/16ビットの画素を RGBA8 へ（16ビットは上位バイト、グレースケールはRGBへ複製）
+    void convertToRGBA8(const tinygltf::Image& image, std::vector<unsigned char>& rgba) {
+        const size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+        const int component = image.component;
+        const int byteStride = image.bits / 8;
+        const int msb = byteStride - 1;     // リトルエンディアンの上位バイト
+        rgba.resize(pixelCount * 4);
+        for (size_t pixel = 0; pixel < pixelCount; ++pixel) {
+            const unsigned char* source = image.image.data() + pixel * component * byteStride;
+            unsigned char* destination = rgba.data() + pixel * 4;
+            if (component >= 3) {
+                destination[0] = source[0 * byteStride + msb];
+                destination[1] = source[1 * byteStride + msb];
+                destination[2] = source[2 * byteStride + msb];
+                destination[3] = component == 4 ? source[3 * byteStride + msb] : 255;
+            } else {
+                const unsigned char gray = source[msb];
+                destination[0] = gray;
+                destination[1] = gray;
+                destination[2] = gray;
+                destination[3] = component == 2 ? source[byteStride + msb] : 255;
+            }
+        }
+    }
+
+    // 2x2 の平均で1つ粗いミップを作る（奇数の辺は端の画素を繰り返す）
+    void downsample(const unsigned char* source, int sourceWidth, int sourceHeight,
+        unsigned char* destination, int width, int height)
+    {
+        for (int y = 0; y < height; ++y) {
+            const int y0 = std::min(y * 2, sourceHeight - 1);
+            const int y1 = std::min(y * 2 + 1, sourceHeight - 1);
+            for (int x = 0; x < width; ++x) {
+                const int x0 = std::min(x * 2, sourceWidth - 1);
+                const int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+                const unsigned char* p00 = source + (static_cast<size_t>(y0) * sourceWidth + x0) * 4;
+                const unsigned char* p01 = source + (static_cast<size_t>(y0) * sourceWidth + x1) * 4;
+                const unsigned char* p10 = source + (static_cast<size_t>(y1) * sourceWidth + x0) * 4;
+                const unsigned char* p11 = source + (static_cast<size_t>(y1) * sourceWidth + x1) * 4;
+                unsigned char* out = destination + (static_cast<size_t>(y) * width + x) * 4;
+                for (int c = 0; c < 4; ++c) {
+                    out[c] = static_cast<unsigned char>((p00[c] + p01[c] + p10[c] + p11[c] + 2) >> 2);
+                }
+            }
+        }
+    }
+}
+
+TextureStreamer::TextureStreamer()
+    : m_defaultTexture(0)
+    , m_hasTextureStorage(false)
+    , m_hasCopyImage(false)
+    , m_hasPixelBuffers(false)
+    , m_pendingBytes(0)
+    , m_uploadSequence(0)
+    , m_requestFrame(0)
+{
+}
+
+TextureStreamer::~TextureStreamer() {
+    // ワーカーはモデルの画像とマップ中のPBOを参照しているので完了を待つ（OpenGLリソースは cleanup() で解放する）
+    for (Texture& texture : m_textures) {
+        if (texture.m_prepare.valid()) {
+            texture.m_prepare.wait();
+        }
+        if (texture.m_stage.valid()) {
+            texture.m_stage.wait();
+        }
+    }
+}
+
+void TextureStreamer::initialize(const TextureStreamingSettings& settings) {
+    cleanup();
+    m_settings = settings;
+    m_hasTextureStorage = GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+    m_hasCopyImage = m_hasTextureStorage && (GLEW_VERSION_4_3 || GLEW_ARB_copy_image);
+    m_hasPixelBuffers = PixelStagingPool::isSupported();
+
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+    glGenTextures(1, &m_defaultTexture);
+    glBindTexture(GL_TEXTURE_2D, m_defaultTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextureStreamer::cleanup() {
+    clear();
+    if (m_defaultTexture != 0) {
+        glDeleteTextures(1, &m_defaultTexture);
+        m_defaultTexture = 0;
+    }
+}
+
+void TextureStreamer::build(const tinygltf::Model& model) {
+    clear();
+    m_textures.resize(model.textures.size());
+    m_stats.m_textureCount = model.textures.size();
+
+    for (size_t i = 0; i < model.textures.size(); ++i) {
+        const tinygltf::Texture& source = model.textures[i];
+        Texture& texture = m_textures[i];
+        if (source.source < 0 || source.source >= static_cast<int>(model.images.size())) {
+            continue;
+        }
+        const tinygltf::Image& image = model.images[source.source];
+        // エンコードされたままの画像はヘッダーの値だけを確認し、デコードはワーカーで行う
+        const size_t expectedBytes = image.as_is ? 1 : static_cast<size_t>(std::max(image.width, 0)) * std::max(image.height, 0) *
+            std::max(image.component, 0) * std::max(image.bits / 8, 0);
+        if (image.width <= 0 || image.height <= 0 || image.component < 1 || image.component > 4 ||
+            (image.bits != 8 && image.bits != 16) || image.image.size() < expectedBytes) {
+            std::cerr << "警告: テクスチャ " << i << " の画像 (" << image.uri << ") を読み込めないため白で描画します" << std::endl;
+            continue;
+        }
+
+        if (source.sampler >= 0 && source.sampler < static_cast<int>(model.samplers.size())) {
+            const tinygltf::Sampler& sampler = model.samplers[source.sampler];
+            texture.m_minFilter = getFilter(sampler.minFilter, GL_LINEAR_MIPMAP_LINEAR);
+            texture.m_magFilter = getFilter(sampler.magFilter, GL_LINEAR);
+            texture.m_wrapS = static_cast<GLint>(sampler.wrapS);
+            texture.m_wrapT = static_cast<GLint>(sampler.wrapT);
+        }
+
+        TextureResidency& residency = texture.m_residency;
+        residency.m_width = image.width;
+        residency.m_height = image.height;
+        residency.m_levelCount = getLevelCount(image.width, image.height);
+        texture.m_initialLevel = residency.m_levelCount - 1;
+        for (int level = 0; level < residency.m_levelCount; ++level) {
+            if (std::max(getLevelSize(image.width, level), getLevelSize(image.height, level)) <= m_settings.m_initialMaxSize) {
+                texture.m_initialLevel = level;
+                break;
+            }
+        }
+        residency.m_wantedLevel = texture.m_initialLevel;
+        m_stats.m_fullResidentBytes += getResidentBytes(texture, 0);
+
+        // ミップチェーンの作成はワーカーで行い、完了は update() で確認する
+        texture.m_image = &image;
+        std::shared_ptr<MipChain> mips = std::make_shared<MipChain>();
+        texture.m_mips = mips;
+        const int levelCount = residency.m_levelCount;
+        texture.m_prepare = ThreadPool::getInstance().submit([&image, levelCount, mips]() {
+            buildMipChain(image, levelCount, *mips);
+        });
+    }
+}
+
+void TextureStreamer::clear() {
+    for (Texture& texture : m_textures) {
+        if (texture.m_prepare.valid()) {
+            texture.m_prepare.wait();
+        }
+        if (texture.m_uploadLevel >= 0) {
+            cancelUpload(texture);
+        }
+        if (texture.m_texture != 0) {
+            glDeleteTextures(1, &texture.m_texture);
+        }
+    }
+    m_textures.clear();
+    m_stagingPool.cleanup();
+    m_pendingBytes = 0;
+    m_uploadSequence = 0;
+    m_requestFrame = 0;
+    m_stats = TextureStreamingStats();
+}
+
+// 元画像（レベル 0）から粗い順にミップを作る（ワーカースレッドで実行）
+void TextureStreamer::buildMipChain(const tinygltf::Image& image, int levelCount, MipChain& mips) {
+    mips.m_levels.assign(static_cast<size_t>(levelCount), std::vector<unsigned char>());
+    mips.m_sourceLevel = nullptr;
+    mips.m_valid = true;
+    if (image.as_is) {
+        // 16ビットや要素数の少ない画像も RGBA8 でデコードする
+        int width = 0;
+        int height = 0;
+        int component = 0;
+        stbi_uc* decoded = stbi_load_from_memory(image.image.data(), static_cast<int>(image.image.size()), &width, &height, &component, 4);
+        if (!decoded || width != image.width || height != image.height) {
+            if (decoded) {
+                stbi_image_free(decoded);
+            }
+            mips.m_valid = false;
+            return;
+        }
+        mips.m_levels[0].assign(decoded, decoded + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(decoded);
+    } else if (image.component == 4 && image.bits == 8) {
+        mips.m_sourceLevel = image.image.data();
+    } else {
+        convertToRGBA8(image, mips.m_levels[0]);
+    }
+
+    const unsigned char* previous = mips.m_sourceLevel ? mips.m_sourceLevel : mips.m_levels[0].data();
+    for (int level = 1; level < levelCount; ++level) {
+        const int width = getLevelSize(image.width, level);
+        const int height = getLevelSize(image.height, level);
+        mips.m_levels[level].resize(static_cast<size_t>(width) * height * 4);
+        downsample(previous, getLevelSize(image.width, level - 1), getLevelSize(image.height, level - 1),
+            mips.m_levels[level].data(), width, height);
+        previous = mips.m_levels[level].data();
+    }
+}
+
+size_t TextureStreamer::getLevelBytes(const Texture& texture, int level) {
+    return static_cast<size_t>(getLevelSize(texture.m_residency.m_width, level)) *
+        getLevelSize(texture.m_residency.m_height, level) * 4;
+}
+
+size_t TextureStreamer::getResidentBytes(const Texture& texture, int level) const {
+    size_t bytes = 0;
+    for (int l = std::max(level, 0); l < texture.m_residency.m_levelCount; ++l) {
+        bytes += getLevelBytes(texture, l);
+    }
+    return bytes;
+}
+
+int TextureStreamer::getUploadEndLevel(const Texture& texture) const {
+    const int residentLevel = texture.m_residency.m_residentLevel;
+    if (m_hasCopyImage && texture.m_texture != 0 && residentLevel >= 0) {
+        return residentLevel;
+    }
+    return texture.m_residency.m_levelCount;
+}
+
+size_t TextureStreamer::getUploadBytes(const Texture& texture, int level) const {
+    size_t bytes = 0;
+    const int end = getUploadEndLevel(texture);
+    for (int l = std::max(level, 0); l < end; ++l) {
+        bytes += getLevelBytes(texture, l);
+    }
+    return bytes;
+}
+
+void TextureStreamer::beginRequests() {
+    ++m_requestFrame;
+    for (Texture& texture : m_textures) {
+        texture.m_residency.m_wantedLevel = texture.m_initialLevel;
+    }
+}
+
+// テクスチャの辺の長さ / 画面上の大きさ が 2^n なら、レベル n のミップで1テクセルが約1ピクセルになる
+void TextureStreamer::request(int texture, float screenTexels) {
+    if (texture < 0 || texture >= static_cast<int>(m_textures.size())) {
+        return;
+    }
+    Texture& target = m_textures[texture];
+    TextureResidency& residency = target.m_residency;
+    if (residency.m_levelCount == 0) {
+        return;
+    }
+
+    const float size = static_cast<float>(std::max(residency.m_width, residency.m_height));
+    const float level = std::log2(size / std::max(screenTexels, 1.0f)) + m_settings.m_lodBias;
+    const int wanted = std::min(std::max(static_cast<int>(std::floor(level)), 0), target.m_initialLevel);
+    residency.m_wantedLevel = std::min(residency.m_wantedLevel, wanted);
+    target.m_lastUsedFrame = m_requestFrame;
+}
+
+// ワーカーがミップチェーンを作り終えたテクスチャの粗いミップを転送する
+// 直接転送する場合は小さいので1フレームの上限は適用しない（PBOを経由する場合は他の転送と同じく発行時に適用する）
+void TextureStreamer::receivePreparedTextures() {
+    for (Texture& texture : m_textures) {
+        if (!texture.m_prepared) {
+            if (!texture.m_prepare.valid()) {
+                continue;
+            }
+            if (texture.m_prepare.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++m_stats.m_pendingTextures;
+                continue;
+            }
+            texture.m_prepare.get();
+            if (!texture.m_mips->m_valid) {
+                std::cerr << "警告: 画像 (" << texture.m_image->uri << ") をデコードできないため白で描画します" << std::endl;
+                texture.m_mips.reset();
+                continue;
+            }
+            texture.m_prepared = true;
+        }
+
+        // PBOに空きが無く初期転送を始められなかったものは次のフレームで再び試す
+        if (texture.m_residency.m_residentLevel >= 0 || texture.m_uploadLevel >= 0) {
+            continue;
+        }
+        if (usePixelBuffers()) {
+            if (!beginUpload(texture, texture.m_initialLevel)) {
+                ++m_stats.m_deferredUploads;
+            }
+        } else {
+            setResidentLevel(texture, texture.m_initialLevel);
+        }
+    }
+}
+
+// level 以下のミップを持つテクスチャを作る
+// 以前のテクスチャにあるミップはGPU内でコピーし、無いミップだけを転送する（PBOからの場合は書き込んだ順のオフセットで指定する）
+GLuint TextureStreamer::createLevelTexture(const Texture& texture, int level, bool fromStaging) {
+    const TextureResidency& residency = texture.m_residency;
+    const int previousLevel = residency.m_residentLevel;
+    const int levelCount = residency.m_levelCount;
+    const int uploadEnd = getUploadEndLevel(texture);
+
+    // 転送前のエラーを転送のエラーと区別する
+    while (glGetError() != GL_NO_ERROR) {
+    }
+
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    if (m_hasTextureStorage) {
+        glTexStorage2D(GL_TEXTURE_2D, levelCount - level, GL_RGBA8,
+            getLevelSize(residency.m_width, level), getLevelSize(residency.m_height, level));
+    }
+
+    size_t uploadedBytes = 0;
+    size_t copiedBytes = 0;
+    for (int l = level; l < levelCount; ++l) {
+        const int width = getLevelSize(residency.m_width, l);
+        const int height = getLevelSize(residency.m_height, l);
+        if (l >= uploadEnd) {
+            glCopyImageSubData(texture.m_texture, GL_TEXTURE_2D, l - previousLevel, 0, 0, 0,
+                id, GL_TEXTURE_2D, l - level, 0, 0, 0, width, height, 1);
+            copiedBytes += getLevelBytes(texture, l);
+            continue;
+        }
+
+        const void* pixels = nullptr;
+        if (fromStaging) {
+            pixels = reinterpret_cast<const void*>(uploadedBytes);
+        } else {
+            pixels = (l == 0 && texture.m_mips->m_sourceLevel) ? texture.m_mips->m_sourceLevel : texture.m_mips->m_levels[l].data();
+        }
+        if (m_hasTextureStorage) {
+            glTexSubImage2D(GL_TEXTURE_2D, l - level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, l - level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        }
+        uploadedBytes += getLevelBytes(texture, l);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - level - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.m_minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture.m_magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.m_wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.m_wrapT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // VRAMが足りない場合は以前の常駐レベルのまま描画を続ける
+    const GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        std::cerr << "警告: テクスチャのミップを転送できません (レベル " << level << ", エラー " << error << ")" << std::endl;
+        glDeleteTextures(1, &id);
+        return 0;
+    }
+
+    m_stats.m_frameUploadedBytes += uploadedBytes;
+    m_stats.m_frameCopiedBytes += copiedBytes;
+    ++m_stats.m_frameUploads;
+    return id;
+}
+
+void TextureStreamer::adoptTexture(Texture& texture, GLuint id, int level, size_t uploadedBytes) {
+    if (texture.m_texture != 0) {
+        glDeleteTextures(1, &texture.m_texture);
+    }
+    texture.m_texture = id;
+
+    TextureResidency& residency = texture.m_residency;
+    const size_t residentBytes = getResidentBytes(texture, level);
+    m_stats.m_residentBytes = m_stats.m_residentBytes - residency.m_residentBytes + residentBytes;
+    residency.m_residentLevel = level;
+    residency.m_residentBytes = residentBytes;
+    residency.m_uploadedBytes += uploadedBytes;
+    ++residency.m_uploads;
+    m_stats.m_totalUploadedBytes += uploadedBytes;
+}
+
+// 常駐レベルを変えたテクスチャを描画スレッドから直接転送して作り直す
+bool TextureStreamer::setResidentLevel(Texture& texture, int level) {
+    const size_t uploadBytes = getUploadBytes(texture, level);
+    const GLuint id = createLevelTexture(texture, level, false);
+    if (id == 0) {
+        return false;
+    }
+    adoptTexture(texture, id, level, uploadBytes);
+    return true;
+}
+
+// 転送するミップをPBOへ書き込む処理をワーカーへ渡す（PBOに空きが無い場合は false）
+bool TextureStreamer::beginUpload(Texture& texture, int level) {
+    const size_t uploadBytes = getUploadBytes(texture, level);
+    void* data = nullptr;
+    const int staging = m_stagingPool.acquire(uploadBytes, &data);
+    if (staging < 0) {
+        return false;
+    }
+
+    const TextureResidency& residency = texture.m_residency;
+    const int end = getUploadEndLevel(texture);
+    const int width = residency.m_width;
+    const int height = residency.m_height;
+    const std::shared_ptr<MipChain> mips = texture.m_mips;
+    unsigned char* destination = static_cast<unsigned char*>(data);
+    texture.m_stage = ThreadPool::getInstance().submit([mips, destination, level, end, width, height]() {
+        size_t offset = 0;
+        for (int l = level; l < end; ++l) {
+            const size_t bytes = static_cast<size_t>(getLevelSize(width, l)) * getLevelSize(height, l) * 4;
+            const unsigned char* pixels = (l == 0 && mips->m_sourceLevel) ? mips->m_sourceLevel : mips->m_levels[l].data();
+            std::memcpy(destination + offset, pixels, bytes);
+            offset += bytes;
+        }
+    });
+
+    const size_t residentBytes = getResidentBytes(texture, level);
+    texture.m_uploadLevel = level;
+    texture.m_staging = staging;
+    texture.m_uploadBytes = uploadBytes;
+    texture.m_reservedBytes = residentBytes > residency.m_residentBytes ? residentBytes - residency.m_residentBytes : 0;
+    texture.m_uploadSequence = ++m_uploadSequence;
+    m_pendingBytes += texture.m_reservedBytes;
+    return true;
+}
+
+// 書き込みの終わった変更を始めた順に、1フレームの転送量の上限まで発行する（最低1件は発行する）
+void TextureStreamer::issueUploads() {
+    std::vector<Texture*> ready;
+    for (Texture& texture : m_textures) {
+        if (texture.m_uploadLevel >= 0 && texture.m_uploadTexture == 0 && texture.m_stage.valid() &&
+            texture.m_stage.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            ready.push_back(&texture);
+        }
+    }
+    std::sort(ready.begin(), ready.end(), [](const Texture* a, const Texture* b) {
+        return a->m_uploadSequence < b->m_uploadSequence;
+    });
+
+    size_t frameBytes = 0;
+    for (Texture* texture : ready) {
+        if (frameBytes > 0 && frameBytes + texture->m_uploadBytes > m_settings.m_uploadBytesPerFrame) {
+            ++m_stats.m_deferredUploads;
+            continue;
+        }
+        texture->m_stage.get();
+
+        // PBOの内容が失われた場合は、次のフレームで書き込みからやり直す
+        if (!m_stagingPool.bind(texture->m_staging)) {
+            texture->m_staging = -1;
+            cancelUpload(*texture);
+            continue;
+        }
+        const GLuint id = createLevelTexture(*texture, texture->m_uploadLevel, true);
+        m_stagingPool.submit(texture->m_staging);
+        if (id == 0) {
+            cancelUpload(*texture);
+            continue;
+        }
+        texture->m_uploadTexture = id;
+        frameBytes += texture->m_uploadBytes;
+    }
+}
+
+// GPUが転送を終えた変更のテクスチャを差し替える
+void TextureStreamer::receiveUploads() {
+    for (Texture& texture : m_textures) {
+        if (texture.m_uploadTexture == 0 || !m_stagingPool.isComplete(texture.m_staging)) {
+            continue;
+        }
+        const GLuint id = texture.m_uploadTexture;
+        const int level = texture.m_uploadLevel;
+        const size_t uploadBytes = texture.m_uploadBytes;
+        m_pendingBytes -= texture.m_reservedBytes;
+        texture.m_uploadLevel = -1;
+        texture.m_staging = -1;
+        texture.m_uploadTexture = 0;
+        texture.m_reservedBytes = 0;
+        adoptTexture(texture, id, level, uploadBytes);
+    }
+}
+
+void TextureStreamer::cancelUpload(Texture& texture) {
+    if (texture.m_stage.valid()) {
+        texture.m_stage.wait();
+        texture.m_stage = std::future<void>();
+    }
+    if (texture.m_staging >= 0) {
+        m_stagingPool.discard(texture.m_staging);
+    }
+    if (texture.m_uploadTexture != 0) {
+        glDeleteTextures(1, &texture.m_uploadTexture);
+    }
+    m_pendingBytes -= texture.m_reservedBytes;
+    texture.m_uploadLevel = -1;
+    texture.m_staging = -1;
+    texture.m_uploadTexture = 0;
+    texture.m_reservedBytes = 0;
+}
+
+// 予算に requiredBytes の空きができるまで、必要なレベルより詳細に常駐しているテクスチャを
+// 最後に使われた描画リストが古い順に必要なレベルまで戻す
+void TextureStreamer::evict(size_t requiredBytes, const Texture* requester) {
+    std::vector<Texture*> candidates;
+    for (Texture& texture : m_textures) {
+        const TextureResidency& residency = texture.m_residency;
+        if (&texture != requester && texture.m_prepared && texture.m_uploadLevel < 0 && residency.m_residentLevel >= 0 &&
+            residency.m_residentLevel < residency.m_wantedLevel) {
+            candidates.push_back(&texture);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Texture* a, const Texture* b) {
+        if (a->m_lastUsedFrame != b->m_lastUsedFrame) {
+            return a->m_lastUsedFrame < b->m_lastUsedFrame;
+        }
+        return a->m_residency.m_residentBytes > b->m_residency.m_residentBytes;
+    });
+
+    for (Texture* texture : candidates) {
+        if (getCommittedBytes() + requiredBytes <= m_settings.m_gpuBudgetBytes) {
+            break;
+        }
+        if (setResidentLevel(*texture, texture->m_residency.m_wantedLevel)) {
+            ++texture->m_residency.m_evictions;
+            ++m_stats.m_frameEvictions;
+            ++m_stats.m_totalEvictions;
+        }
+    }
+}
+
+// 必要なレベルとの差が大きいテクスチャから、予算と1フレームの転送量の上限の範囲で詳細なミップを追加する
+// 予算が足りない場合は破棄で空きを作り、それでも足りなければ予算に収まる最も詳細なレベルまでにとどめる
+// 転送中の変更は完了後の常駐量で予算を判定し、完了するまで破棄・追加の対象にしない
+void TextureStreamer::update() {
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    m_stats.m_pendingTextures = 0;
+    m_stats.m_wantedTextures = 0;
+    m_stats.m_frameUploadedBytes = 0;
+    m_stats.m_frameUploads = 0;
+    m_stats.m_frameCopiedBytes = 0;
+    m_stats.m_frameEvictions = 0;
+    m_stats.m_deferredUploads = 0;
+    m_stats.m_budgetBytes = m_settings.m_gpuBudgetBytes;
+    m_stagingPool.setCapacity(m_settings.m_stagingBytes);
+
+    receiveUploads();
+    issueUploads();
+    receivePreparedTextures();
+    if (getCommittedBytes() > m_settings.m_gpuBudgetBytes) {
+        evict(0, nullptr);
+    }
+
+    std::vector<int> order;
+    for (size_t i = 0; i < m_textures.size(); ++i) {
+        const TextureResidency& residency = m_textures[i].m_residency;
+        if (m_textures[i].m_prepared && m_textures[i].m_uploadLevel < 0 && residency.m_residentLevel > residency.m_wantedLevel) {
+            order.push_back(static_cast<int>(i));
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        const TextureResidency& ra = m_textures[a].m_residency;
+        const TextureResidency& rb = m_textures[b].m_residency;
+        const int deficitA = ra.m_residentLevel - ra.m_wantedLevel;
+        const int deficitB = rb.m_residentLevel - rb.m_wantedLevel;
+        if (deficitA != deficitB) {
+            return deficitA > deficitB;
+        }
+        return a < b;
+    });
+
+    const bool staged = usePixelBuffers();
+    size_t frameBytes = 0;
+    for (int index : order) {
+        if (!staged && frameBytes >= m_settings.m_uploadBytesPerFrame) {
+            ++m_stats.m_deferredUploads;
+            continue;
+        }
+        Texture& texture = m_textures[index];
+        const TextureResidency& residency = texture.m_residency;
+        const int residentLevel = residency.m_residentLevel;
+
+        int level = residency.m_wantedLevel;
+        for (; level < residentLevel; ++level) {
+            const size_t requiredBytes = getResidentBytes(texture, level) - residency.m_residentBytes;
+            if (getCommittedBytes() + requiredBytes > m_settings.m_gpuBudgetBytes) {
+                evict(requiredBytes, &texture);
+            }
+            if (getCommittedBytes() + requiredBytes <= m_settings.m_gpuBudgetBytes) {
+                break;
+            }
+        }
+        if (level >= residentLevel) {
+            continue;
+        }
+
+        // PBOを経由する場合、転送量の上限は発行時に適用する（ここではPBOの空きだけを確認する）
+        if (staged) {
+            if (!beginUpload(texture, level)) {
+                ++m_stats.m_deferredUploads;
+            }
+            continue;
+        }
+
+        // GPU内でコピーできるミップは転送量に数えない
+        const size_t uploadBytes = getUploadBytes(texture, level);
+        if (frameBytes > 0 && frameBytes + uploadBytes > m_settings.m_uploadBytesPerFrame) {
+            ++m_stats.m_deferredUploads;
+            continue;
+        }
+        if (setResidentLevel(texture, level)) {
+            frameBytes += uploadBytes;
+        }
+    }
+
+    m_stats.m_pendingUploads = 0;
+    for (const Texture& texture : m_textures) {
+        if (texture.m_prepared && texture.m_residency.m_residentLevel > texture.m_residency.m_wantedLevel) {
+            ++m_stats.m_wantedTextures;
+        }
+        if (texture.m_uploadLevel >= 0) {
+            ++m_stats.m_pendingUploads;
+        }
+    }
+    m_stagingPool.trim();
+    m_stats.m_stagingBytes = m_stagingPool.getUsedBytes();
+    m_stats.m_updateTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    m_stats.m_maxUpdateTimeMs = std::max(m_stats.m_maxUpdateTimeMs, m_stats.m_updateTimeMs);
+}
+
+GLuint TextureStreamer::getTexture(int texture) const {
+    if (texture < 0 || texture >= static_cast<int>(m_textures.size()) || m_textures[texture].m_texture == 0) {
+        return m_defaultTexture;
+    }
+    return m_textures[texture].m_texture;
+}
+
+void TextureStreamer::printResidency() const {
+    std::cout << "  テクスチャ: " << m_textures.size() << " 枚, 常駐 " << m_stats.m_residentBytes / 1024 << " / 予算 "
+        << m_settings.m_gpuBudgetBytes / 1024 << " KB (全ミップ常駐時 " << m_stats.m_fullResidentBytes / 1024 << " KB), 転送累計 "
+        << m_stats.m_totalUploadedBytes / 1024 << " KB, 破棄 " << m_stats.m_totalEvictions << " 回" << std::endl;
+    for (size_t i = 0; i < m_textures.size(); ++i) {
+        const TextureResidency& residency = m_textures[i].m_residency;
+        if (residency.m_levelCount == 0) {
+            continue;
+        }
+        std::cout << "    [" << i << "] " << residency.m_width << "x" << residency.m_height << ": 常駐レベル ";
+        if (residency.m_residentLevel >= 0) {
+            std::cout << residency.m_residentLevel << " (" << getLevelSize(residency.m_width, residency.m_residentLevel) << "x"
+                << getLevelSize(residency.m_height, residency.m_residentLevel) << ")";
+        } else {
+            std::cout << "-";
+        }
+        std::cout << " / 必要 " << residency.m_wantedLevel << ", " << residency.m_residentBytes / 1024 << " KB, 転送 "
+            << residency.m_uploadedBytes / 1024 << " KB (" << residency.m_uploads << " 回), 破棄 " << residency.m_evictions << " 回" << std::endl;
+    }
+}
@@ -0,0 +1,198 @@
+﻿#pragma once
+
+#include "PixelStagingPool.h"
+#include <GL/glew.h>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace tinygltf {
+    class Model;
+    struct Image;
+}
+
+// テクスチャストリーミングの設定
+struct TextureStreamingSettings {
+    size_t m_gpuBudgetBytes;        // GPUに常駐させるミップの合計の上限
+    size_t m_uploadBytesPerFrame;   // 1フレームに転送する上限（最低1テクスチャは転送する）
+    int m_initialMaxSize;           // ロード直後に常駐させるミップの辺の長さの上限（ピクセル）
+    float m_lodBias;                // 要求するミップレベルに加える値（正の値で粗くなる）
+    bool m_usePixelBuffers;         // PBOを経由して非同期に転送する（使えない環境では描画スレッドから直接転送する）
+    size_t m_stagingBytes;          // PBOに書き込み中・転送中の合計の上限
+
+    TextureStreamingSettings()
+        : m_gpuBudgetBytes(512u * 1024 * 1024)
+        , m_uploadBytesPerFrame(32u * 1024 * 1024)
+        , m_initialMaxSize(64)
+        , m_lodBias(0.0f)
+        , m_usePixelBuffers(true)
+        , m_stagingBytes(128u * 1024 * 1024)
+    {
+    }
+};
+
+// テクスチャごとの常駐状態と転送量
+struct TextureResidency {
+    int m_width;
+    int m_height;
+    int m_levelCount;
+    int m_residentLevel;    // GPUにある最も詳細なミップレベル（-1 は未転送）
+    int m_wantedLevel;      // 直近の描画リストで必要なミップレベル
+    size_t m_residentBytes;
+    size_t m_uploadedBytes; // 以下は build() からの累計
+    size_t m_uploads;
+    size_t m_evictions;     // 予算のために詳細なミップを捨てた回数
+
+    TextureResidency()
+        : m_width(0), m_height(0), m_levelCount(0), m_residentLevel(-1), m_wantedLevel(0)
+        , m_residentBytes(0), m_uploadedBytes(0), m_uploads(0), m_evictions(0) {}
+};
+
+// テクスチャストリーミングの統計（フレームの値は直近の update() のもの）
+struct TextureStreamingStats {
+    size_t m_textureCount;
+    size_t m_pendingTextures;       // ワーカーが画像のデコード・ミップを作成中
+    size_t m_pendingUploads;        // PBOへ書き込み中・GPUが転送中の常駐レベルの変更
+    size_t m_stagingBytes;          // 書き込み中・転送中のPBOの合計
+    size_t m_wantedTextures;        // 必要なミップまで常駐していないテクスチャ数
+    size_t m_residentBytes;
+    size_t m_fullResidentBytes;     // 全テクスチャを最も詳細なミップまで常駐させた場合
+    size_t m_budgetBytes;
+    size_t m_frameUploadedBytes;    // このフレームに発行した転送量
+    size_t m_frameUploads;
+    size_t m_frameCopiedBytes;      // GPU内でコピーして転送を省いたミップ
+    size_t m_frameEvictions;
+    size_t m_deferredUploads;       // 1フレームの転送量の上限で次のフレームへ回したもの
+    size_t m_totalUploadedBytes;    // build() からの累計
+    size_t m_totalEvictions;
+    double m_updateTimeMs;
+    double m_maxUpdateTimeMs;       // build() からの最大（ロード中に描画スレッドが止まった時間の目安）
+
+    TextureStreamingStats()
+        : m_textureCount(0), m_pendingTextures(0), m_pendingUploads(0), m_stagingBytes(0), m_wantedTextures(0), m_residentBytes(0)
+        , m_fullResidentBytes(0), m_budgetBytes(0), m_frameUploadedBytes(0), m_frameUploads(0), m_frameCopiedBytes(0), m_frameEvictions(0)
+        , m_deferredUploads(0), m_totalUploadedBytes(0), m_totalEvictions(0), m_updateTimeMs(0.0), m_maxUpdateTimeMs(0.0)
+    {
+    }
+};
+
+// glTFのテクスチャをミップ単位で常駐させる
+// ミップチェーン（RGBA8）はワーカースレッドで作成し（エンコードされたままの画像はワーカーでデコードする）、
+// 最初は m_initialMaxSize 以下の粗いミップだけを転送する
+// 描画リストを作るたびに、テクスチャを使うプリミティブの画面上の大きさから必要なミップレベルを request() で受け取り、
+// update() で不足の大きいものから予算内で詳細なミップを追加する
+// 予算を超える場合は、直近の描画で必要なレベルより詳細に常駐しているものを古い順に粗いレベルへ戻す
+// GPUのテクスチャは常駐レベル以下のミップだけを持つ immutable storage で、レベルを変えるときは作り直し、
+// 共通のミップは glCopyImageSubData でGPU内でコピーする（使えない場合はCPUのミップチェーンから転送し直す）
+// 追加するミップは描画スレッドがマップしたPBOへワーカーが書き込み、書き込みの終わったものから1フレームの転送量の上限まで
+// glTexSubImage2D をPBOから発行する。転送の後のフェンスをGPUが通過するまでは以前のテクスチャで描画を続ける
+class TextureStreamer {
+private:
+    // ワーカーが作成するミップチェーン（レベル 0 は元画像が RGBA8 なら元画像を直接参照して複製しない）
+    struct MipChain {
+        std::vector<std::vector<unsigned char>> m_levels;
+        const unsigned char* m_sourceLevel;
+        bool m_valid;               // デコードに失敗した場合は false
+    };
+
+    struct Texture {
+        const tinygltf::Image* m_image;
+        GLint m_minFilter;
+        GLint m_magFilter;
+        GLint m_wrapS;
+        GLint m_wrapT;
+        int m_initialLevel;         // 最初に常駐させるレベル（これより粗いレベルは常に常駐する）
+        std::shared_ptr<MipChain> m_mips;
+        std::future<void> m_prepare;
+        bool m_prepared;
+        GLuint m_texture;           // 常駐レベル以下のミップを持つテクスチャ（0 は未転送）
+        size_t m_lastUsedFrame;     // 最後に request() された描画リストの番号
+        TextureResidency m_residency;
+
+        // PBOを経由した常駐レベルの変更（m_uploadLevel が -1 の場合は無し）
+        int m_uploadLevel;
+        int m_staging;              // 書き込み先のPBO
+        std::future<void> m_stage;  // ワーカーがPBOへ書き込み中
+        GLuint m_uploadTexture;     // 転送を発行したテクスチャ（フェンスの通過で m_texture と差し替える。0 は未発行）
+        size_t m_uploadBytes;       // PBOから転送するバイト数
+        size_t m_reservedBytes;     // 完了時に増える常駐量（予算の判定では常駐しているものとして扱う）
+        size_t m_uploadSequence;    // 書き込みを始めた順番（発行はこの順に行う）
+
+        Texture()
+            : m_image(nullptr), m_minFilter(GL_LINEAR_MIPMAP_LINEAR), m_magFilter(GL_LINEAR), m_wrapS(GL_REPEAT), m_wrapT(GL_REPEAT)
+            , m_initialLevel(0), m_prepared(false), m_texture(0), m_lastUsedFrame(0)
+            , m_uploadLevel(-1), m_staging(-1), m_uploadTexture(0), m_uploadBytes(0), m_reservedBytes(0), m_uploadSequence(0) {}
+    };
+
+    std::vector<Texture> m_textures;
+    GLuint m_defaultTexture;        // 未転送・テクスチャ番号が不正な場合の白 (1x1)
+    bool m_hasTextureStorage;       // glTexStorage2D が使用可能か
+    bool m_hasCopyImage;            // glCopyImageSubData が使用可能か
+    bool m_hasPixelBuffers;         // PBOとフェンスが使用可能か
+    PixelStagingPool m_stagingPool;
+    size_t m_pendingBytes;          // 転送中の変更の m_reservedBytes の合計
+    size_t m_uploadSequence;
+    size_t m_requestFrame;          // beginRequests() の呼び出し回数
+    TextureStreamingSettings m_settings;
+    TextureStreamingStats m_stats;
+
+    static void buildMipChain(const tinygltf::Image& image, int levelCount, MipChain& mips);
+    static size_t getLevelBytes(const Texture& texture, int level);
+    size_t getResidentBytes(const Texture& texture, int level) const;   // level 以下の全ミップ
+    size_t getCommittedBytes() const { return m_stats.m_residentBytes + m_pendingBytes; }
+    bool usePixelBuffers() const { return m_hasPixelBuffers && m_settings.m_usePixelBuffers; }
+
+    // 以前のテクスチャからGPU内でコピーできないミップの範囲 [level, 戻り値) （この範囲を転送する）
+    int getUploadEndLevel(const Texture& texture) const;
+    size_t getUploadBytes(const Texture& texture, int level) const;
+
+    void receivePreparedTextures();
+    // level 以下のミップを持つテクスチャを作る（fromStaging の場合はバインド中のPBOから転送する）。失敗した場合は 0
+    GLuint createLevelTexture(const Texture& texture, int level, bool fromStaging);
+    void adoptTexture(Texture& texture, GLuint id, int level, size_t uploadedBytes);
+    bool setResidentLevel(Texture& texture, int level);
+    void evict(size_t requiredBytes, const Texture* requester);
+
+    // PBOを経由した常駐レベルの変更
+    bool beginUpload(Texture& texture, int level);
+    void issueUploads();
+    void receiveUploads();
+    void cancelUpload(Texture& texture);
+
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // 既定のテクスチャを作成し、使用できる拡張を調べる（OpenGLコンテキストが有効な状態で呼ぶ）
+    void initialize(const TextureStreamingSettings& settings = TextureStreamingSettings());
+    void cleanup();
+
+    // モデルの全テクスチャを登録し、ワーカーでミップチェーンの作成を始める
+    // 画像はデコード済みのもの、またはエンコードされたまま（as_is）のものを参照する
+    // model は clear() まで有効であること
+    void build(const tinygltf::Model& model);
+    void clear();   // ワーカーの完了を待ち、テクスチャを解放する
+
+    // 描画リストごとの必要なミップレベルの受け付け（beginRequests() の後に可視のプリミティブごとに呼ぶ）
+    // screenTexels はテクスチャ座標の 0〜1 が画面上で占める大きさ（ピクセル）
+    void beginRequests();
+    void request(int texture, float screenTexels);
+
+    // 完了したミップチェーンの初期転送と、予算内での常駐レベルの変更（毎フレーム描画前に呼ぶ）
+    // PBOを使う場合、描画スレッドで行うのは転送の発行とフェンスの確認だけで、画素の書き込みはワーカーが行う
+    void update();
+
+    // 描画にバインドするテクスチャ（常駐していない場合は白のテクスチャ）
+    GLuint getTexture(int texture) const;
+
+    void setSettings(const TextureStreamingSettings& settings) { m_settings = settings; }
+    const TextureStreamingSettings& getSettings() const { return m_settings; }
+    size_t getTextureCount() const { return m_textures.size(); }
+    const TextureResidency& getResidency(int texture) const { return m_textures[texture].m_residency; }
+    const TextureStreamingStats& getStats() const { return m_stats; }
+    void printResidency() const;
+};
@@ -0,0 +1,118 @@
+﻿#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : m_stopping(false)
+{
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+ThreadPool& ThreadPool::getInstance() {
+    static ThreadPool instance;
+    return instance;
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task) {
+    auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    std::future<void> result = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.emplace_back([packaged] { (*packaged)(); });
+    }
+    m_condition.notify_one();
+    return result;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    grainSize = std::max<size_t>(grainSize, 1);
+    const size_t chunkCount = (count + grainSize - 1) / grainSize;
+    if (chunkCount == 1 || m_workers.empty()) {
+        body(0, count);
+        return;
+    }
+
+    // 区間は共有カウンターから取り出す。遅れて開始したワーカーは何もせずに終わるため、
+    // 状態は shared_ptr で保持し、完了の判定は処理済み区間数で行う
+    struct State {
+        std::atomic<size_t> m_next;
+        std::atomic<size_t> m_done;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+    };
+    auto state = std::make_shared<State>();
+    state->m_next = 0;
+    state->m_done = 0;
+
+    const std::function<void(size_t, size_t)>* bodyPtr = &body;
+    auto runChunks = [state, bodyPtr, count, grainSize, chunkCount]() {
+        for (;;) {
+            size_t chunk = state->m_next.fetch_add(1);
+            if (chunk >= chunkCount) {
+                return;
+            }
+            size_t begin = chunk * grainSize;
+            (*bodyPtr)(begin, std::min(begin + grainSize, count));
+            if (state->m_done.fetch_add(1) + 1 == chunkCount) {
+                std::lock_guard<std::mutex> lock(state->m_mutex);
+                state->m_condition.notify_all();
+            }
+        }
+    };
+
+    const size_t helperCount = std::min(m_workers.size(), chunkCount - 1);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < helperCount; ++i) {
+            m_tasks.emplace_back(runChunks);
+        }
+    }
+    m_condition.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(state->m_mutex);
+    state->m_condition.wait(lock, [&state, chunkCount] { return state->m_done.load() == chunkCount; });
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定数のワーカースレッドでタスクを処理するスレッドプール
+// parallelFor は呼び出しスレッドも処理に参加するため、ワーカー内から呼んでもデッドロックしない
+class ThreadPool {
+private:
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping;
+
+    void workerLoop();
+
+public:
+    // threadCount が 0 の場合はハードウェアスレッド数 - 1（最低1）
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // アプリケーション全体で共有するプール
+    static ThreadPool& getInstance();
+
+    size_t getThreadCount() const { return m_workers.size(); }
+
+    // タスクを追加し、完了を待つための future を返す
+    std::future<void> submit(std::function<void()> task);
+
+    // [0, count) を grainSize ごとの区間に分割して並列に body(begin, end) を実行し、全区間の完了を待つ
+    void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body);
+};
@@ -1,9 +1,11 @@
 ﻿#pragma once
 
+#include <filesystem>
+
 // ファイルが存在するかをチェックする関数
 bool fileExists(const std::string& filename) {
-    DWORD dwAttrib = GetFileAttributesA(filename.c_str());
-    return (dwAttrib != INVALID_FILE_ATTRIBUTES && !(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
+    std::error_code error;
+    return std::filesystem::is_regular_file(filename, error);
 }
 
 // glTFファイル拡張子を検証する関数
@@ -16,6 +18,97 @@ bool isValidGltfFile(const std::string& filename) {
     return (extension == ".gltf" || filename.substr(filename.length() - 4) == ".glb");
 }
 
+// オプション引数（--で始まる引数）の解析結果
+struct CommandLineOptions {
+    std::string m_benchmark;         // --benchmark <名前>
+    int m_benchmarkCount;            // --benchmark <名前> [数]（省略時は0）
+    std::string m_buildChunks;       // --build-chunks <出力パス>
+    std::string m_stream;            // --stream <チャンクパック>
+    int m_cpuBudgetMB;               // --cpu-budget <MB>（0 は既定値）
+    int m_gpuBudgetMB;               // --gpu-budget <MB>（0 は既定値）
+    std::string m_render;            // --render <出力パス>（.png / .jpg）
+    int m_renderWidth;               // --size <幅>x<高さ>（0 は既定値）
+    int m_renderHeight;
+    int m_views;                     // --views <枚数>（0 は既定値）
+    std::string m_batch;             // --batch <モデル一覧ファイル>
+    std::string m_outputDirectory;   // --output-dir <ディレクトリ>
+    std::string m_imageFormat;       // --format <png|jpg>（空は既定値）
+    bool m_software;                 // --software（--render をソフトウェアレンダラーで描画）
+    int m_threads;                   // --threads <数>（ソフトウェアレンダラー、0 はハードウェアスレッド数）
+    std::vector<char*> m_arguments;  // オプションを除いた引数（argv[0] を含む）
+
+    CommandLineOptions() : m_benchmarkCount(0), m_cpuBudgetMB(0), m_gpuBudgetMB(0), m_renderWidth(0), m_renderHeight(0), m_views(0), m_software(false), m_threads(0) {}
+};
+
+// オプション引数を取り除き、残りの引数を m_arguments に格納する
+void parseCommandLineOptions(int argc, char* argv[], CommandLineOptions& options) {
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--benchmark" && i + 1 < argc) {
+            options.m_benchmark = argv[++i];
+            // 続く引数が数値ならインスタンス数などのパラメーターとして扱う
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                options.m_benchmarkCount = std::atoi(argv[++i]);
+            }
+            continue;
+        }
+        if (arg == "--build-chunks" && i + 1 < argc) {
+            options.m_buildChunks = argv[++i];
+            continue;
+        }
+        if (arg == "--stream" && i + 1 < argc) {
+            options.m_stream = argv[++i];
+            continue;
+        }
+        if (arg == "--cpu-budget" && i + 1 < argc) {
+            options.m_cpuBudgetMB = std::max(0, std::atoi(argv[++i]));
+            continue;
+        }
+        if (arg == "--gpu-budget" && i + 1 < argc) {
+            options.m_gpuBudgetMB = std::max(0, std::atoi(argv[++i]));
+            continue;
+        }
+        if (arg == "--render" && i + 1 < argc) {
+            options.m_render = argv[++i];
+            continue;
+        }
+        if (arg == "--size" && i + 1 < argc) {
+            const std::string size = argv[++i];
+            const size_t separator = size.find_first_of("xX");
+            if (separator != std::string::npos) {
+                options.m_renderWidth = std::max(0, std::atoi(size.substr(0, separator).c_str()));
+                options.m_renderHeight = std::max(0, std::atoi(size.substr(separator + 1).c_str()));
+            }
+            continue;
+        }
+        if (arg == "--views" && i + 1 < argc) {
+            options.m_views = std::max(0, std::atoi(argv[++i]));
+            continue;
+        }
+        if (arg == "--batch" && i + 1 < argc) {
+            options.m_batch = argv[++i];
+            continue;
+        }
+        if (arg == "--output-dir" && i + 1 < argc) {
+            options.m_outputDirectory = argv[++i];
+            continue;
+        }
+        if (arg == "--format" && i + 1 < argc) {
+            options.m_imageFormat = argv[++i];
+            continue;
+        }
+        if (arg == "--software") {
+            options.m_software = true;
+            continue;
+        }
+        if (arg == "--threads" && i + 1 < argc) {
+            options.m_threads = std::max(0, std::atoi(argv[++i]));
+            continue;
+        }
+        options.m_arguments.push_back(argv[i]);
+    }
+}
+
 // コマンドライン引数を処理する関数
 std::string processCommandLineArgs(int argc, char* argv[]) {
     std::cout << "glTFビューアー - OpenGLレンダラー" << std::endl;
@@ -27,6 +120,16 @@ std::string processCommandLineArgs(int argc, char* argv[]) {
     std::cout << "  QE: カメラ上下移動" << std::endl;
     std::cout << "  マウス左ドラッグ: カメラ回転" << std::endl;
     std::cout << "  マウスホイール: ズーム (未実装)" << std::endl;
+    std::cout << "オプション:" << std::endl;
+    std::cout << "  --benchmark <名前> [数]: 合成シーンで性能を計測して終了" << std::endl;
+    std::cout << "  --build-chunks <出力パス>: glTFファイルをストリーミング用のチャンクパックに変換して終了" << std::endl;
+    std::cout << "  --stream <チャンクパック>: チャンクパックをカメラに応じて読み込みながら表示" << std::endl;
+    std::cout << "  --cpu-budget <MB>, --gpu-budget <MB>: ストリーミングのメモリ予算" << std::endl;
+    std::cout << "  --render <出力パス>: ウィンドウを表示せずに描画して PNG / JPEG に書き出して終了" << std::endl;
+    std::cout << "  --size <幅>x<高さ>, --views <枚数>: 書き出す画像の大きさと、モデルの周りから描画する枚数" << std::endl;
+    std::cout << "  --batch <モデル一覧ファイル>: 一覧のモデルを1つのコンテキストで順にサムネイル画像へ描画して終了" << std::endl;
+    std::cout << "  --output-dir <ディレクトリ>, --format <png|jpg>: 一括描画の出力先と画像形式" << std::endl;
+    std::cout << "  --software [--threads <数>]: --render をGPUを使わずCPUのソフトウェアレンダラーで描画" << std::endl;
     std::cout << std::endl;
 
     // 引数の数をチェック
@@ -68,23 +171,19 @@ std::string processCommandLineArgs(int argc, char* argv[]) {
     }
 
     // 追加検証のためファイルサイズを取得
-    HANDLE hFile = CreateFileA(gltfFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (hFile != INVALID_HANDLE_VALUE) {
-        LARGE_INTEGER fileSize;
-        if (GetFileSizeEx(hFile, &fileSize)) {
-            std::cout << "ファイルサイズ: " << fileSize.QuadPart << " バイト" << std::endl;
-
-            if (fileSize.QuadPart == 0) {
-                std::cerr << "エラー: ファイルが空です。" << std::endl;
-                CloseHandle(hFile);
-                return "";
-            }
+    std::error_code sizeError;
+    const uintmax_t fileSize = std::filesystem::file_size(gltfFilePath, sizeError);
+    if (!sizeError) {
+        std::cout << "ファイルサイズ: " << fileSize << " バイト" << std::endl;
+
+        if (fileSize == 0) {
+            std::cerr << "エラー: ファイルが空です。" << std::endl;
+            return "";
+        }
 
-            if (fileSize.QuadPart > 100 * 1024 * 1024) { // 安全のため100MB制限
-                std::cout << "警告: 大きなファイルが検出されました（>100MB）。読み込みに時間がかかる場合があります。" << std::endl;
-            }
+        if (fileSize > 100 * 1024 * 1024) { // 安全のため100MB制限
+            std::cout << "警告: 大きなファイルが検出されました（>100MB）。読み込みに時間がかかる場合があります。" << std::endl;
         }
-        CloseHandle(hFile);
     }
 
     std::cout << "ファイル検証が成功しました。glTFファイルの読み込み準備完了。" << std::endl;
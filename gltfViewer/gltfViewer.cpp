@@ -1,9 +1,13 @@
-﻿#include <windows.h>
+﻿#ifdef _WIN32
+#include <windows.h>
 #include <tchar.h>
+#endif
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <iostream>
 #include <string>
+#include <chrono>
+#include <cstdlib>
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
@@ -18,17 +22,25 @@
 #include "OpenGLRenderer.h"
 #include "GLTFModel.h"
 #include "UtilFunc.h"
+#include "Benchmark.h"
+#include "HeadlessRenderer.h"
+#include "BatchRenderer.h"
+#include "SoftwareRenderer.h"
 
 // グローバル変数
 OpenGLRenderer* g_renderer = nullptr;
 GLTFModel* g_gltfModel = nullptr;
 Camera* g_camera = nullptr;
 bool g_running = true;
+CommandLineOptions g_options;
 
 // マウス入力制御用グローバル変数
 bool g_mousePressed = false;
 int g_lastMouseX = 0;
 int g_lastMouseY = 0;
+int g_mouseDownX = 0;                      // ボタンを押した位置（クリック判定用）
+int g_mouseDownY = 0;
+const int g_clickThreshold = 3;            // これ以下の移動量で離した場合はクリックとしてピッキングする
 const float g_mouseSensitivity = 0.005f;  // マウス感度
 const float g_movementSpeed = 0.1f;        // カメラ移動速度
 
@@ -67,6 +79,149 @@ void processKeyboardInput() {
     }
 }
 
+// シーンのバウンディングボリュームにカメラとクリップ面を合わせる
+void fitCameraToScene() {
+    const BoundingBox& sceneBounds = g_renderer->getSceneBounds();
+    if (sceneBounds.isValid()) {
+        const BoundingSphere& sphere = g_renderer->getSceneBoundingSphere();
+        g_camera->fitToBoundingBox(sceneBounds.m_min, sceneBounds.m_max);
+        g_camera->fitClipPlanesToSphere(sphere.m_center, sphere.m_radius);
+        g_renderer->updateCamera(g_camera);
+    }
+}
+
+#ifdef _WIN32
+// クリックした位置のレイで形状をピッキングし、結果をコンソールに出力
+void pickAtScreenPoint(HWND hWnd, int mouseX, int mouseY) {
+    if (!g_renderer || !g_camera) return;
+
+    RECT clientRect;
+    GetClientRect(hWnd, &clientRect);
+    const Ray ray = g_camera->screenPointToRay(static_cast<float>(mouseX) + 0.5f, static_cast<float>(mouseY) + 0.5f,
+        clientRect.right - clientRect.left, clientRect.bottom - clientRect.top);
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    PickResult result;
+    const bool hit = g_renderer->pick(ray, result);
+    const double timeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    if (!hit) {
+        std::cout << "ピッキング: (" << mouseX << ", " << mouseY << ") ヒットなし (" << timeMs << " ms)" << std::endl;
+        return;
+    }
+    std::cout << "ピッキング: (" << mouseX << ", " << mouseY << ") ノード " << result.m_node
+        << ", メッシュ " << result.m_mesh << ", プリミティブ " << result.m_primitive
+        << ", 三角形 " << result.m_triangle << ", 距離 " << result.m_distance
+        << ", 位置 (" << result.m_position.x << ", " << result.m_position.y << ", " << result.m_position.z << ")"
+        << " (" << timeMs << " ms)" << std::endl;
+}
+#endif
+
+// GPUを使わずにソフトウェアレンダラーで描画して書き出す（OpenGLドライバーの無い環境向け）
+bool renderSoftware(const HeadlessSettings& settings) {
+    SoftwareRenderer renderer;
+    renderer.setThreadCount(g_options.m_threads);
+    renderer.onResize(settings.m_width, settings.m_height);
+    if (!renderer.initialize() || !renderer.loadGLTFModel(g_gltfModel->getModel())) {
+        return false;
+    }
+
+    Camera camera;
+    camera.setPerspective(glm::radians(45.0f), static_cast<float>(settings.m_width) / settings.m_height, 0.1f, 100.0f);
+    const BoundingBox& bounds = renderer.getSceneBounds();
+    const BoundingSphere& sphere = renderer.getSceneBoundingSphere();
+    if (bounds.isValid()) {
+        camera.fitToBoundingBox(bounds.m_min, bounds.m_max);
+        camera.fitClipPlanesToSphere(sphere.m_center, sphere.m_radius);
+    }
+
+    // HeadlessRenderer::renderModel() と同じく、バウンディング球の中心の周りでカメラを水平に回す
+    const glm::vec3 offset = camera.getPosition() - sphere.m_center;
+    const int viewCount = std::max(settings.m_views, 1);
+    bool written = true;
+    ReadbackImage image;
+    for (int view = 0; view < viewCount; ++view) {
+        camera.setPosition(HeadlessRenderer::getOrbitPosition(sphere.m_center, offset, view, viewCount));
+        camera.setTarget(sphere.m_center);
+        renderer.updateCamera(&camera);
+        renderer.renderFrame();
+
+        renderer.readPixels(image);
+        const std::string path = HeadlessRenderer::makeOutputPath(g_options.m_render, view, viewCount);
+        written = ImageReadback::writeImage(path, image, settings.m_jpegQuality) && written;
+
+        const SoftwareRenderStats& stats = renderer.getStats();
+        std::cout << "ソフトウェア描画: " << stats.m_threads << " スレッド, 三角形 " << stats.m_triangles << " (ビニング " << stats.m_rasterTriangles
+            << "), フレーム " << stats.m_frameMs << " ms (セットアップ " << stats.m_setupMs << " ms, ラスタライズ " << stats.m_rasterMs << " ms) -> "
+            << path << std::endl;
+    }
+    return written;
+}
+
+// 表示するウィンドウを作らずにモデルを画像ファイルへ描画する
+bool renderHeadless() {
+    if (!g_gltfModel || !g_gltfModel->validateModel()) {
+        std::cerr << "エラー: 描画するglTFファイルを指定してください" << std::endl;
+        return false;
+    }
+
+    HeadlessSettings settings;
+    if (g_options.m_renderWidth > 0 && g_options.m_renderHeight > 0) {
+        settings.m_width = g_options.m_renderWidth;
+        settings.m_height = g_options.m_renderHeight;
+    }
+    if (g_options.m_views > 0) {
+        settings.m_views = g_options.m_views;
+    }
+    if (g_options.m_software) {
+        return renderSoftware(settings);
+    }
+
+    HeadlessRenderer headless;
+    if (!headless.initialize(settings)) {
+        return false;
+    }
+    const bool rendered = headless.renderModel(g_gltfModel->getModel(), g_options.m_render);
+    headless.printStats();
+    headless.cleanup();
+    return rendered;
+}
+
+// モデル一覧のサムネイルを1つのコンテキストで描画する
+bool renderBatch() {
+    std::vector<std::string> modelPaths;
+    if (!BatchRenderer::readModelList(g_options.m_batch, modelPaths)) {
+        return false;
+    }
+
+    BatchSettings settings;
+    if (g_options.m_renderWidth > 0 && g_options.m_renderHeight > 0) {
+        settings.m_headless.m_width = g_options.m_renderWidth;
+        settings.m_headless.m_height = g_options.m_renderHeight;
+    }
+    if (g_options.m_views > 0) {
+        settings.m_headless.m_views = g_options.m_views;
+    }
+    settings.m_outputDirectory = g_options.m_outputDirectory;
+    if (!g_options.m_imageFormat.empty()) {
+        settings.m_extension = "." + g_options.m_imageFormat;
+        if (settings.m_extension != ".png" && settings.m_extension != ".jpg" && settings.m_extension != ".jpeg") {
+            std::cerr << "エラー: 対応していない画像形式です (png / jpg): " << g_options.m_imageFormat << std::endl;
+            return false;
+        }
+    }
+
+    BatchRenderer batch;
+    if (!batch.initialize(settings)) {
+        return false;
+    }
+    const bool rendered = batch.run(modelPaths);
+    batch.printStats();
+    batch.cleanup();
+    return rendered;
+}
+
+#ifdef _WIN32
 // ウィンドウプロシージャ
 LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     switch (uMsg) {
@@ -83,9 +238,26 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             // カメラをレンダラーに設定
             g_renderer->updateCamera(g_camera);
 
+            // チャンクパック指定時はglTFモデルの代わりにストリーミングで表示
+            if (!g_options.m_stream.empty()) {
+                StreamingSettings settings;
+                if (g_options.m_cpuBudgetMB > 0) {
+                    settings.m_cpuBudgetBytes = static_cast<size_t>(g_options.m_cpuBudgetMB) * 1024 * 1024;
+                }
+                if (g_options.m_gpuBudgetMB > 0) {
+                    settings.m_gpuBudgetBytes = static_cast<size_t>(g_options.m_gpuBudgetMB) * 1024 * 1024;
+                }
+                if (g_renderer->openStreamingScene(g_options.m_stream, settings)) {
+                    fitCameraToScene();
+                }
+                break;
+            }
+
             if(g_gltfModel != nullptr && g_gltfModel->validateModel())
             {
-                g_renderer->loadGLTFModel(g_gltfModel->getModel());
+                if (g_renderer->loadGLTFModel(g_gltfModel->getModel())) {
+                    fitCameraToScene();
+                }
             }
         }
         break;
@@ -104,14 +276,9 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         int width = LOWORD(lParam);
         int height = HIWORD(lParam);
         if (g_renderer && width > 0 && height > 0) {
+            // カメラのアスペクト比もレンダラーが合わせる
             g_renderer->onResize(width, height);
 
-            // カメラのアスペクト比も更新
-            if (g_camera) {
-                g_camera->setAspectRatio((float)width / (float)height);
-                g_renderer->updateCamera(g_camera);
-            }
-
             InvalidateRect(hWnd, nullptr, FALSE);
         }
         break;
@@ -137,11 +304,19 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             g_mousePressed = true;
             g_lastMouseX = LOWORD(lParam);
             g_lastMouseY = HIWORD(lParam);
+            g_mouseDownX = g_lastMouseX;
+            g_mouseDownY = g_lastMouseY;
             SetCapture(hWnd);  // マウスキャプチャを開始
             break;
     }
 
     case WM_LBUTTONUP: {
+        const int mouseX = LOWORD(lParam);
+        const int mouseY = HIWORD(lParam);
+        if (g_mousePressed &&
+            std::abs(mouseX - g_mouseDownX) <= g_clickThreshold && std::abs(mouseY - g_mouseDownY) <= g_clickThreshold) {
+            pickAtScreenPoint(hWnd, mouseX, mouseY);
+        }
         g_mousePressed = false;
         ReleaseCapture();  // マウスキャプチャを終了
         break;
@@ -201,10 +376,24 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     }
     return 0;
 }
+#endif
 
 int main(int argc, char* argv[]) {
-    // コマンドライン引数を処理してglTFファイルパスを取得
-    std::string gltfFilePath = processCommandLineArgs(argc, argv);
+    // オプション引数を取り除いてから、コマンドライン引数を処理してglTFファイルパスを取得
+    parseCommandLineOptions(argc, argv, g_options);
+
+    // 一括描画はモデル一覧を使うので、引数のglTFファイルは読み込まずに終了
+    if (!g_options.m_batch.empty()) {
+        return renderBatch() ? 0 : -1;
+    }
+
+    // ベンチマークは合成シーンを使い、ウィンドウを作らずに計測して終了（描画を伴うものはオフスクリーンのコンテキストを使う）
+    if (!g_options.m_benchmark.empty()) {
+        return Benchmark::run(g_options.m_benchmark, g_options.m_benchmarkCount) ? 0 : -1;
+    }
+
+    std::string gltfFilePath = processCommandLineArgs(
+        static_cast<int>(g_options.m_arguments.size()), g_options.m_arguments.data());
 
     bool isDemo = gltfFilePath.empty();
     if (isDemo) {
@@ -215,6 +404,27 @@ int main(int argc, char* argv[]) {
         g_gltfModel->analyzeStructure();
     }
 
+    // チャンクパックへの変換指定時はウィンドウを作らずに終了
+    if (!g_options.m_buildChunks.empty()) {
+        const bool built = g_gltfModel != nullptr && g_gltfModel->validateModel() &&
+            ChunkPack::build(g_gltfModel->getModel(), g_options.m_buildChunks);
+        if (!built) {
+            std::cerr << "エラー: チャンクパックを作成できませんでした" << std::endl;
+        }
+        delete g_gltfModel;
+        g_gltfModel = nullptr;
+        return built ? 0 : -1;
+    }
+
+    // 画像への書き出し指定時も表示するウィンドウを作らずに終了
+    if (!g_options.m_render.empty()) {
+        const bool rendered = renderHeadless();
+        delete g_gltfModel;
+        g_gltfModel = nullptr;
+        return rendered ? 0 : -1;
+    }
+
+#ifdef _WIN32
     // インスタンスハンドルを取得
     HINSTANCE hInstance = GetModuleHandle(nullptr);
 
@@ -278,4 +488,11 @@ int main(int argc, char* argv[]) {
     }
 
     return 0;
+#else
+    // ウィンドウでの表示は WGL を使う Windows のみ（他のプラットフォームでは --render / --batch で画像に描画し、--benchmark で計測する）
+    std::cerr << "エラー: このプラットフォームではウィンドウで表示できません。--render <出力パス>、--batch <モデル一覧ファイル> または --benchmark <名前> を指定してください" << std::endl;
+    delete g_gltfModel;
+    g_gltfModel = nullptr;
+    return -1;
+#endif
 }
\ No newline at end of file
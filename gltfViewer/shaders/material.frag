@@ -0,0 +1,26 @@
+#version 330 core
+// マテリアルテーブルのベースカラー（BASE_COLOR_TEXTURE ではテクスチャを掛けたもの）で塗る（ALPHA_MASK では alphaCutoff 未満を破棄）
+in vec3 v_color;
+flat in vec4 v_baseColor;
+#ifdef ALPHA_MASK
+flat in float v_alphaCutoff;
+#endif
+#ifdef BASE_COLOR_TEXTURE
+in vec2 v_texcoord;
+
+uniform sampler2D u_baseColorTexture;
+#endif
+out vec4 FragColor;
+
+void main() {
+    vec4 baseColor = v_baseColor;
+#ifdef BASE_COLOR_TEXTURE
+    baseColor *= texture(u_baseColorTexture, v_texcoord);
+#endif
+#ifdef ALPHA_MASK
+    if (baseColor.a < v_alphaCutoff) {
+        discard;
+    }
+#endif
+    FragColor = vec4(baseColor.rgb * v_color, 1.0);
+}
@@ -0,0 +1,38 @@
+// C++ 側の GPUMaterial と同じ並び
+struct Material {
+    vec4 baseColorFactor;
+    vec4 emissiveFactor;    // xyz: 放射色, w: alphaCutoff
+    vec4 pbrFactors;        // x: metallic, y: roughness, z: normalScale, w: occlusionStrength
+    ivec4 textures;         // baseColor, metallicRoughness, normal, occlusion
+    ivec4 flags;            // x: emissiveTexture, y: alphaMode, z: doubleSided
+};
+
+#ifdef MATERIAL_STORAGE_BUFFER
+layout (std430, binding = 0) readonly buffer MaterialTable {
+    Material u_materials[];
+};
+#else
+#ifndef MAX_MATERIALS
+#define MAX_MATERIALS 256
+#endif
+layout (std140) uniform MaterialTable {
+    Material u_materials[MAX_MATERIALS];
+};
+#endif
+
+uniform int u_materialIndex;
+#ifdef DRAW_PARAMETERS
+layout (std430, binding = 1) readonly buffer DrawMaterials {
+    int u_drawMaterials[];
+};
+uniform int u_drawOffset;   // 負の場合はマルチドローではないので u_materialIndex を使う
+#endif
+
+int getMaterialIndex() {
+#ifdef DRAW_PARAMETERS
+    if (u_drawOffset >= 0) {
+        return u_drawMaterials[u_drawOffset + gl_DrawIDARB];
+    }
+#endif
+    return u_materialIndex;
+}
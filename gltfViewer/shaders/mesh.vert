@@ -0,0 +1,61 @@
+#version 330 core
+// glTFメッシュのインスタンス描画用（実行時に #version 行を環境と機能の #define に置き換える）
+layout (location = 0) in vec3 a_position;
+layout (location = 2) in mat4 a_instanceModel;
+#ifdef SKINNING
+layout (location = 6) in uvec4 a_joints;
+layout (location = 7) in vec4 a_weights;
+layout (location = 8) in int a_paletteOffset;
+
+uniform samplerBuffer u_jointPalette;
+#endif
+
+layout (std140) uniform FrameData {
+    mat4 u_viewProjection;
+};
+
+#ifdef BASE_COLOR_TEXTURE
+layout (location = 9) in vec2 a_texcoord;
+#endif
+
+out vec3 v_color;
+flat out vec4 v_baseColor;
+#ifdef ALPHA_MASK
+flat out float v_alphaCutoff;
+#endif
+#ifdef BASE_COLOR_TEXTURE
+out vec2 v_texcoord;
+#endif
+#include "material_table.glsl"
+
+#ifdef SKINNING
+mat4 fetchJoint(int joint) {
+    int texel = (a_paletteOffset + joint) * 4;
+    return mat4(texelFetch(u_jointPalette, texel),
+                texelFetch(u_jointPalette, texel + 1),
+                texelFetch(u_jointPalette, texel + 2),
+                texelFetch(u_jointPalette, texel + 3));
+}
+#endif
+
+void main() {
+    mat4 model = a_instanceModel;
+#ifdef SKINNING
+    if (a_paletteOffset >= 0) {
+        model = a_weights.x * fetchJoint(int(a_joints.x))
+              + a_weights.y * fetchJoint(int(a_joints.y))
+              + a_weights.z * fetchJoint(int(a_joints.z))
+              + a_weights.w * fetchJoint(int(a_joints.w));
+    }
+#endif
+    int materialIndex = getMaterialIndex();
+    v_color = vec3(1.0);
+    v_baseColor = u_materials[materialIndex].baseColorFactor;
+#ifdef ALPHA_MASK
+    v_alphaCutoff = u_materials[materialIndex].emissiveFactor.w;
+#endif
+#ifdef BASE_COLOR_TEXTURE
+    v_texcoord = a_texcoord;
+#endif
+    gl_Position = u_viewProjection * model * vec4(a_position, 1.0);
+}